@@ -0,0 +1,177 @@
+/*
+ * Backfill of directory of synthetic repository exports (posts and likes
+ * with realistic record sizes) with growing number of worker threads,
+ * with and without block verification.
+ */
+#define BSKY_API_IMPLEMENTATION
+#include "../bsky-api.h"
+
+#include "bench.h"
+
+#include <stdatomic.h>
+#include <unistd.h>
+
+#define REPOS   200
+#define RECORDS 2000                     // per repository, at most
+
+static char dir[] = "/tmp/bsky-bench-backfill-XXXXXX";
+
+static struct bsky_mst_entry entries[RECORDS];
+static char keys[RECORDS][64];
+
+// CAR of repository `n' with few hundreds to `RECORDS' records.
+static size_t write_repo(size_t n, struct bsky_bytes *car)
+{
+    enum bsky_error_code ec;
+    struct bsky_block_map map = { 0 };
+    struct bsky_block_store store = bsky_block_map_store(&map);
+    struct bsky_bytes buf = { 0 };
+    size_t records = RECORDS / 4 + n * 7919 % (RECORDS * 3 / 4);
+    long long ts = 1700000000000000LL + n * 1000000LL;
+    char text[160];
+
+    for (size_t i = 0; i < records; ++i) {
+        char tid[BSKY_TID_LEN + 1];
+        int post = i < records / 2;
+
+        ts += 1000 + i * 7919 % 100000;
+        bsky_tid_of_timestamp(tid, ts, n % 32);
+
+        buf.len = 0;
+        if (post) {
+            int len = snprintf(text, sizeof text, "post %zu of repository "
+                               "%zu, text of typical length, which is about "
+                               "hundred bytes or so.", i, n);
+
+            bsky_cbor_push_map(&buf, 3);
+            bsky_cbor_push_text(&buf, bsky_mk_str("text"));
+            bsky_cbor_push_text(&buf, (struct bsky_str) { text, text + len });
+            bsky_cbor_push_text(&buf, bsky_mk_str("$type"));
+            bsky_cbor_push_text(&buf, bsky_mk_str("app.bsky.feed.post"));
+            bsky_cbor_push_text(&buf, bsky_mk_str("createdAt"));
+            bsky_cbor_push_text(&buf, bsky_mk_str("2024-01-01T00:00:00Z"));
+        } else {
+            bsky_cbor_push_map(&buf, 3);
+            bsky_cbor_push_text(&buf, bsky_mk_str("$type"));
+            bsky_cbor_push_text(&buf, bsky_mk_str("app.bsky.feed.like"));
+            bsky_cbor_push_text(&buf, bsky_mk_str("subject"));
+            bsky_cbor_push_int(&buf, n * RECORDS + i);
+            bsky_cbor_push_text(&buf, bsky_mk_str("createdAt"));
+            bsky_cbor_push_text(&buf, bsky_mk_str("2024-01-01T00:00:00Z"));
+        }
+
+        // likes sort before posts.
+        size_t k = post ? i + (records - records / 2) : i - records / 2;
+        int len = snprintf(keys[k], sizeof keys[k], "app.bsky.feed.%s/%s",
+                           post ? "post" : "like", tid);
+        struct bsky_view record = { buf.data, buf.data + buf.len };
+
+        entries[k].key   = (struct bsky_str) { keys[k], keys[k] + len };
+        entries[k].value = bsky_cid_of_block(bsky_cid_Dag_cbor, record);
+        bsky_block_map_put(&map, entries[k].value, record);
+    }
+
+    struct bsky_commit commit = {
+        .did     = bsky_mk_str("did:plc:ewvi7nxzyoun6zhxrhs64oiz"),
+        .rev     = bsky_mk_str("3jzfcijpj2z2a"),
+        .data    = bsky_mst_build(store, entries, records, &ec),
+        .version = 3,
+    };
+
+    if (ec != bsky_ec_Ok) {
+        printf("mst/build: %s\n", bsky_str_of_error_code(ec));
+        exit(1);
+    }
+
+    buf.len = 0;
+    bsky_cbor_push_commit(&buf, &commit);
+
+    struct bsky_view block = { buf.data, buf.data + buf.len };
+    struct bsky_cid root = bsky_cid_of_block(bsky_cid_Dag_cbor, block);
+
+    car->len = 0;
+    bsky_car_push_header(car, root);
+    bsky_car_push_block(car, root, block);
+    for (size_t i = 0; i < map.cap; ++i)
+        if (map.slots[i].block.start != NULL)
+            bsky_car_push_block(car, map.slots[i].cid, map.slots[i].block);
+
+    bsky_da_free(&buf);
+    bsky_block_map_free(&map);
+
+    return records;
+}
+
+static enum bsky_error_code count(void *ctx,
+                                  const struct bsky_backfill_record *record)
+{
+    atomic_fetch_add_explicit((_Atomic size_t *) ctx,
+                              bsky_str_len(record->rkey),
+                              memory_order_relaxed);
+    return bsky_ec_Ok;
+}
+
+int main(void)
+{
+    if (mkdtemp(dir) == NULL) {
+        perror(dir);
+        return 1;
+    }
+
+    struct bsky_bytes car = { 0 };
+    size_t records = 0;
+    char path[128];
+
+    for (size_t n = 0; n < REPOS; ++n) {
+        records += write_repo(n, &car);
+
+        snprintf(path, sizeof path, "%s/%04zu.car", dir, n);
+        FILE *file = fopen(path, "wb");
+        if (file == NULL || fwrite(car.data, 1, car.len, file) != car.len) {
+            perror(path);
+            return 1;
+        }
+        fclose(file);
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threads[] = { 1, 2, 4, cpus > 0 ? cpus : 1 };
+    _Atomic size_t sink = 0;
+
+    printf("backfill: %d repos, %zu records\n", REPOS, records);
+
+    for (int verify = 0; verify <= 1; ++verify) {
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(threads); ++i) {
+            struct bsky_backfill backfill = {
+                .dir = dir, .threads = threads[i], .verify = verify,
+                .fn  = count, .ctx = &sink,
+            };
+            struct bsky_backfill_stats stats;
+            char name[64];
+
+            enum bsky_error_code ec = bsky_backfill_run(&backfill, &stats);
+
+            if (ec != bsky_ec_Ok || stats.records != records) {
+                printf("backfill: %s, %zu records\n",
+                       bsky_str_of_error_code(ec), stats.records);
+                return 1;
+            }
+
+            snprintf(name, sizeof name, "backfill/%zu threads%s per record",
+                     threads[i], verify ? " verify" : "");
+            bench_report(name, stats.records, stats.seconds * 1e9,
+                         stats.bytes);
+            printf("%-36s %12.0f repos/s %10.0f records/s\n", "",
+                   stats.repos_per_sec, stats.records_per_sec);
+        }
+    }
+
+    for (size_t n = 0; n < REPOS; ++n) {
+        snprintf(path, sizeof path, "%s/%04zu.car", dir, n);
+        unlink(path);
+    }
+    rmdir(dir);
+    bsky_da_free(&car);
+
+    return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * On-disk block store: batched puts of record sized blocks, close (index
+ * write), reopen, random gets through index and in-memory hash (right
+ * after put), and compaction dropping half of blocks.
+ */
+#define BSKY_API_IMPLEMENTATION
+#include "../bsky-api.h"
+
+#include "bench.h"
+
+#include <unistd.h>
+
+#define BLOCKS     500000
+#define BLOCK_SIZE 200
+
+static struct bsky_cid cids[BLOCKS];
+static char dir[] = "/tmp/bsky-bench-blocks-XXXXXX";
+
+// keep results alive.
+static volatile size_t sink;
+
+static struct bsky_view make_block(unsigned char *buf, size_t i)
+{
+    for (size_t j = 0; j < BLOCK_SIZE; ++j) buf[j] = (i * 31 + j) * 7919;
+    memcpy(buf, &i, sizeof i);
+
+    return (struct bsky_view) { buf, buf + BLOCK_SIZE };
+}
+
+static int keep_even(void *ctx, struct bsky_cid cid)
+{
+    (void) ctx;
+    return !(cid.digest[0] & 1);
+}
+
+static void gets(struct bsky_block_file *file, const char *name)
+{
+    enum bsky_error_code ec;
+    struct bsky_view block;
+    const size_t rounds = 1000000;
+
+    double start = bench_now_ns();
+    for (size_t i = 0; i < rounds; ++i) {
+        ec = bsky_block_file_get(file, cids[i * 7919 % BLOCKS], &block);
+        sink += ec + *(unsigned char *) block.start;
+    }
+    bench_report(name, rounds, bench_now_ns() - start, 0);
+}
+
+static void check(enum bsky_error_code ec, const char *what)
+{
+    if (ec == bsky_ec_Ok) return;
+
+    printf("%s: %s\n", what, bsky_str_of_error_code(ec));
+    exit(1);
+}
+
+int main(void)
+{
+    enum bsky_error_code ec;
+    unsigned char buf[BLOCK_SIZE];
+    char path[128];
+
+    if (mkdtemp(dir) == NULL) {
+        perror(dir);
+        return 1;
+    }
+    snprintf(path, sizeof path, "%s/blocks", dir);
+
+    for (size_t i = 0; i < BLOCKS; ++i)
+        cids[i] = bsky_cid_of_block(bsky_cid_Raw, make_block(buf, i));
+
+    struct bsky_block_file file = bsky_block_file_open(path, &ec);
+    check(ec, "open");
+
+    double start = bench_now_ns();
+    for (size_t i = 0; i < BLOCKS; ++i) {
+        ec = bsky_block_file_put(&file, cids[i], make_block(buf, i));
+        check(ec, "put");
+    }
+    check(bsky_block_file_flush(&file), "flush");
+    bench_report("block-file/put", BLOCKS, bench_now_ns() - start,
+                 (size_t) BLOCKS * BLOCK_SIZE);
+    printf("block-file: %zu blocks, %.1f MB data file\n",
+           bsky_block_file_len(&file), file.data_len / 1e6);
+
+    gets(&file, "block-file/get not indexed");
+
+    start = bench_now_ns();
+    check(bsky_block_file_close(&file), "close");
+    bench_report("block-file/close (index)", 1, bench_now_ns() - start, 0);
+
+    start = bench_now_ns();
+    file = bsky_block_file_open(path, &ec);
+    check(ec, "reopen");
+    bench_report("block-file/reopen", 1, bench_now_ns() - start, 0);
+
+    gets(&file, "block-file/get indexed");
+
+    start = bench_now_ns();
+    check(bsky_block_file_compact(&file, keep_even, NULL), "compact");
+    bench_report("block-file/compact half", 1, bench_now_ns() - start,
+                 file.data_len * 2);
+    printf("block-file: %zu blocks after compaction\n",
+           bsky_block_file_len(&file));
+
+    check(bsky_block_file_close(&file), "close");
+
+    unlink(path);
+    snprintf(path, sizeof path, "%s/blocks.idx", dir);
+    unlink(path);
+    rmdir(dir);
+
+    return 0;
+}
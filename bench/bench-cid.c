@@ -0,0 +1,114 @@
+/*
+ * SHA-256 throughput of backend in use against portable code, and CID
+ * computation over repository shaped blocks: many small records and
+ * MST nodes, few big blobs.
+ */
+#define BSKY_API_IMPLEMENTATION
+#include "../bsky-api.h"
+
+#include "bench.h"
+
+#define BYTES_PER_CASE (256 * 0x400 * 0x400)
+
+// keep results alive.
+static volatile size_t sink;
+
+static void bench_sha256(const char *name, const unsigned char *data,
+                         size_t len, int portable)
+{
+    size_t ops = BYTES_PER_CASE / len, acc = 0;
+    unsigned char digest[BSKY_SHA256_LEN];
+    double start = bench_now_ns();
+
+    for (size_t i = 0; i < ops; ++i) {
+        if (portable) {
+            // whole blocks only: padding is the same for both.
+            uint32_t state[8] = { 0 };
+
+            __bsky_sha256_blocks_portable(state, data, len / 64);
+            acc += state[0];
+        } else {
+            struct bsky_sha256 sha;
+
+            bsky_sha256_init(&sha);
+            __bsky_sha256_blocks(sha.state, data, len / 64);
+            acc += sha.state[0];
+        }
+    }
+
+    bsky_sha256(data, len, digest);
+    sink += acc + digest[0];
+
+    bench_report(name, ops, bench_now_ns() - start, ops * len);
+}
+
+int main(void)
+{
+    static unsigned char data[64 * 0x400];
+    char name[64];
+
+    for (size_t i = 0; i < sizeof data; ++i) data[i] = i * 131 + 7;
+
+    printf("sha256 backend: %s\n", bsky_sha256_backend());
+
+    static const size_t sizes[] = { 64, 1024, 64 * 0x400 };
+    for (size_t i = 0; i < BSKY_ARRAY_LEN(sizes); ++i) {
+        snprintf(name, sizeof name, "sha256/portable %zu", sizes[i]);
+        bench_sha256(name, data, sizes[i], 1);
+
+        snprintf(name, sizeof name, "sha256/%s %zu", bsky_sha256_backend(),
+                 sizes[i]);
+        bench_sha256(name, data, sizes[i], 0);
+    }
+
+    // repository: records of 150-600 bytes and MST nodes about 1-2K.
+    enum { BLOCKS = 8192 };
+    static struct bsky_view blocks[BLOCKS];
+    static struct bsky_cid  cids[BLOCKS];
+    size_t bytes = 0;
+
+    for (size_t i = 0; i < BLOCKS; ++i) {
+        size_t len   = i % 8 == 0 ? 1024 + i % 1024 : 150 + i * 37 % 450;
+        size_t start = i * 97 % (sizeof data - len);
+
+        blocks[i] = (struct bsky_view) { data + start, data + start + len };
+        bytes    += len;
+    }
+
+    const size_t rounds = 32;
+    double start = bench_now_ns();
+
+    for (size_t r = 0; r < rounds; ++r)
+        for (size_t i = 0; i < BLOCKS; ++i)
+            cids[i] = bsky_cid_of_block(bsky_cid_Dag_cbor, blocks[i]);
+    bench_report("cid/of_block repo", rounds * BLOCKS,
+                 bench_now_ns() - start, rounds * bytes);
+
+    start = bench_now_ns();
+    for (size_t r = 0; r < rounds; ++r)
+        bsky_cid_batch(bsky_cid_Dag_cbor, blocks, BLOCKS, cids);
+    bench_report("cid/batch repo", rounds * BLOCKS,
+                 bench_now_ns() - start, rounds * bytes);
+
+    char buf[BSKY_CID_STR_LEN + 1];
+    enum bsky_error_code ec;
+    size_t acc = 0;
+
+    start = bench_now_ns();
+    for (size_t r = 0; r < rounds; ++r)
+        for (size_t i = 0; i < BLOCKS; ++i)
+            acc += bsky_cid_format(buf, cids[i]).start[10];
+    bench_report("cid/format", rounds * BLOCKS, bench_now_ns() - start, 0);
+
+    struct bsky_str str = bsky_cid_format(buf, cids[0]);
+    start = bench_now_ns();
+    for (size_t i = 0; i < rounds * BLOCKS; ++i) {
+        bench_clobber();
+        acc += bsky_parse_cid(str, &ec).digest[0];
+    }
+    bench_report("cid/parse", rounds * BLOCKS, bench_now_ns() - start, 0);
+
+    sink += acc;
+
+    return 0;
+}
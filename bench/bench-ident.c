@@ -0,0 +1,186 @@
+/*
+ * Identifier parsing over a few millions of feed shaped AT-URIs:
+ * `bsky_parse_at_uri' against ad-hoc splitting which only checks prefix
+ * and separators (kept here as `old_*'), and validators one by one.
+ * Packed keys are compared with strings as keys of dedup hash set.
+ */
+#define BSKY_API_IMPLEMENTATION
+#include "../bsky-api.h"
+
+#include "bench.h"
+
+#define URIS 4096
+#define OPS  (4 * 0x400 * 0x400)
+
+// keep results alive.
+static volatile size_t sink;
+
+static int old_parse_at_uri(struct bsky_str str, struct bsky_at_uri *uri)
+{
+    if (!bsky_str_starts_with(str, bsky_mk_str("at://"))) return 0;
+
+    struct bsky_str rest = bsky_shift_str(str, 5);
+
+    uri->authority  = bsky_str_split(&rest, '/');
+    uri->collection = rest.start ? bsky_str_split(&rest, '/')
+                                 : (struct bsky_str) { 0 };
+    uri->rkey       = rest.start ? bsky_str_split(&rest, '/')
+                                 : (struct bsky_str) { 0 };
+
+    return 1;
+}
+
+static unsigned long long rng = 2024;
+
+static char random_char(const char *alphabet, size_t len)
+{
+    rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+    return alphabet[(rng >> 33) % len];
+}
+
+int main(void)
+{
+    static const char *collections[] = {
+        "app.bsky.feed.post", "app.bsky.feed.like", "app.bsky.feed.repost",
+        "app.bsky.graph.follow", "app.bsky.actor.profile",
+    };
+    static const char b32[] = "abcdefghijklmnopqrstuvwxyz234567";
+
+    static char store[URIS][96];
+    struct bsky_str uris[URIS], dids[URIS], tids[URIS];
+    size_t bytes = 0;
+
+    for (size_t i = 0; i < URIS; ++i) {
+        char did[25], tid[BSKY_TID_LEN + 1];
+
+        for (size_t j = 0; j < 24; ++j) did[j] = random_char(b32, 32);
+        did[24] = '\0';
+
+        bsky_tid_of_timestamp(tid, 1700000000000000LL + i * 7919, i & 0x3ff);
+
+        int len = snprintf(store[i], sizeof store[i], "at://did:plc:%s/%s/%s",
+                           did, collections[i % 5], tid);
+
+        uris[i] = (struct bsky_str) { store[i], store[i] + len };
+        dids[i] = (struct bsky_str) { store[i] + 5, store[i] + 5 + 32 };
+        tids[i] = (struct bsky_str) { uris[i].end - BSKY_TID_LEN, uris[i].end };
+        bytes  += len;
+    }
+    bytes /= URIS;
+
+    struct bsky_at_uri uri;
+    enum bsky_error_code ec;
+    size_t acc = 0;
+    double start = bench_now_ns();
+
+    for (size_t i = 0; i < OPS; ++i) {
+        acc += old_parse_at_uri(uris[i % URIS], &uri);
+        acc += bsky_str_len(uri.rkey);
+    }
+    bench_report("at-uri/split old", OPS, bench_now_ns() - start,
+                 OPS * bytes);
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < OPS; ++i) {
+        uri  = bsky_parse_at_uri(uris[i % URIS], &ec);
+        acc += ec + bsky_str_len(uri.rkey);
+    }
+    bench_report("at-uri/parse", OPS, bench_now_ns() - start, OPS * bytes);
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < OPS; ++i) acc += bsky_did_valid(dids[i % URIS]);
+    bench_report("did/valid plc", OPS, bench_now_ns() - start, OPS * 32);
+
+    struct bsky_str handle = bsky_mk_str("alice.bsky.social");
+    start = bench_now_ns();
+    for (size_t i = 0; i < OPS; ++i) {
+        bench_clobber();
+        acc += bsky_handle_valid(handle);
+    }
+    bench_report("handle/valid", OPS, bench_now_ns() - start,
+                 OPS * bsky_str_len(handle));
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < OPS; ++i)
+        acc += bsky_nsid_valid(bsky_mk_str((char *) collections[i % 5]));
+    bench_report("nsid/valid", OPS, bench_now_ns() - start, 0);
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < OPS; ++i)
+        acc += bsky_tid_timestamp(tids[i % URIS], NULL);
+    bench_report("tid/timestamp", OPS, bench_now_ns() - start,
+                 OPS * BSKY_TID_LEN);
+
+    struct bsky_did_key keys[URIS];
+    char buf[BSKY_DID_PLC_LEN + 1];
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < OPS; ++i)
+        acc += bsky_did_key_pack(dids[i % URIS], &keys[i % URIS]);
+    bench_report("did/key pack", OPS, bench_now_ns() - start, OPS * 32);
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < OPS; ++i)
+        acc += bsky_did_key_unpack(buf, keys[i % URIS]).start[8];
+    bench_report("did/key unpack", OPS, bench_now_ns() - start, OPS * 32);
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < OPS; ++i)
+        acc += bsky_str_hash(dids[i % URIS], BSKY_STR_HASH_SEED);
+    bench_report("did/str hash (fnv)", OPS, bench_now_ns() - start, 0);
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < OPS; ++i) acc += bsky_did_key_hash(keys[i % URIS]);
+    bench_report("did/key hash", OPS, bench_now_ns() - start, 0);
+
+    // dedup set of DIDs seen in feed: every DID is looked up OPS / URIS
+    // times, table is twice bigger than set. Keys are packed once, when
+    // record is ingested.
+    static struct bsky_str   str_set[URIS * 2];
+    static struct bsky_did_key key_set[URIS * 2];
+    static unsigned char     key_used[URIS * 2];
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < OPS; ++i) {
+        struct bsky_str did = dids[(i * 7) % URIS];
+        size_t slot = bsky_str_hash(did, BSKY_STR_HASH_SEED) % (URIS * 2);
+
+        while (str_set[slot].start != NULL &&
+               !bsky_str_eq(str_set[slot], did))
+            slot = (slot + 1) % (URIS * 2);
+
+        acc += str_set[slot].start == NULL;
+        str_set[slot] = did;
+    }
+    bench_report("did/dedup str set", OPS, bench_now_ns() - start, 0);
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < OPS; ++i) {
+        struct bsky_did_key key = keys[(i * 7) % URIS];
+        size_t slot = bsky_did_key_hash(key) % (URIS * 2);
+
+        while (key_used[slot] &&
+               memcmp(&key_set[slot], &key, sizeof key) != 0)
+            slot = (slot + 1) % (URIS * 2);
+
+        acc += !key_used[slot];
+        key_set[slot]  = key;
+        key_used[slot] = 1;
+    }
+    bench_report("did/dedup key set", OPS, bench_now_ns() - start, 0);
+
+    printf("did/entry bytes: str %zu (+%d chars), key %zu\n",
+           sizeof (struct bsky_str), BSKY_DID_PLC_LEN + 1,
+           sizeof (struct bsky_did_key));
+
+    unsigned long long tid_key;
+    start = bench_now_ns();
+    for (size_t i = 0; i < OPS; ++i)
+        acc += bsky_tid_key_pack(tids[i % URIS], &tid_key) + tid_key;
+    bench_report("tid/key pack", OPS, bench_now_ns() - start,
+                 OPS * BSKY_TID_LEN);
+
+    sink += acc;
+
+    return 0;
+}
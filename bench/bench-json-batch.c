@@ -0,0 +1,89 @@
+/*
+ * Parse of many small documents (post records of timeline corpus) one by
+ * one with tmp arena reset after every batch, against batch parse into one
+ * shared region with growing number of threads.
+ */
+#define BSKY_DEFAULT_TMP_ARENA_CAPACITY (0x40 * 0x400 * 0x400)
+#define BSKY_API_IMPLEMENTATION
+#include "../bsky-api.h"
+
+#include "bench.h"
+
+#include <unistd.h>
+
+#define DOCS  0x1000
+#define ITERS 200
+
+static struct bsky_str docs[DOCS];
+
+int main(void)
+{
+    enum bsky_error_code ec;
+    size_t timeline_len, records, bytes = 0;
+    char *timeline = bench_read_file("corpus/timeline.json", &timeline_len);
+
+    struct bsky_str timeline_str = { timeline, timeline + timeline_len };
+    struct bsky_json_path path = bsky_json_path_compile(
+        "/feed/" "*" "/post/record", &ec);
+
+    records = bsky_json_path_query(&path, timeline_str, docs, DOCS, &ec);
+    if (ec != bsky_ec_Ok || records == 0) {
+        printf("json-batch: %s\n", bsky_str_of_error_code(ec));
+        return 1;
+    }
+
+    // repeat records up to batch size.
+    for (size_t i = records; i < DOCS; ++i) docs[i] = docs[i % records];
+    for (size_t i = 0; i < DOCS; ++i) bytes += bsky_str_len(docs[i]);
+
+    printf("json-batch: %d records, %zu bytes average\n", DOCS,
+           bytes / DOCS);
+
+    double start = bench_now_ns();
+    for (size_t i = 0; i < ITERS; ++i) {
+        for (size_t j = 0; j < DOCS; ++j) {
+            struct bsky_str data = docs[j];
+
+            bsky_parse_json(&data, &ec);
+            if (ec != bsky_ec_Ok) return 1;
+        }
+
+        bsky_default_tmp_reset();
+    }
+    bench_report("json-batch/one by one per doc", ITERS * DOCS,
+                 bench_now_ns() - start, ITERS * bytes);
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threads[] = { 1, 2, 4, cpus > 0 ? cpus : 1 };
+
+    for (size_t t = 0; t < BSKY_ARRAY_LEN(threads); ++t) {
+        struct bsky_json_batch batch = { .threads = threads[t] };
+        char name[64];
+
+        // first parse sizes region.
+        if (bsky_json_batch_parse(&batch, docs, DOCS) != bsky_ec_Ok)
+            return 1;
+
+        start = bench_now_ns();
+        for (size_t i = 0; i < ITERS; ++i)
+            bsky_json_batch_parse(&batch, docs, DOCS);
+
+        snprintf(name, sizeof name, "json-batch/%zu threads per doc",
+                 threads[t]);
+        bench_report(name, ITERS * DOCS, bench_now_ns() - start,
+                     ITERS * bytes);
+
+        size_t used = 0;
+        for (size_t w = 0; w < batch.workers_len; ++w)
+            used += batch.workers[w].region.len;
+
+        printf("%-36s %12zu region bytes/doc %6zu bytes/doc reserved\n", "",
+               used / DOCS, batch.arena.cap / DOCS);
+
+        bsky_json_batch_free(&batch);
+    }
+
+    free(timeline);
+
+    return 0;
+}
@@ -0,0 +1,122 @@
+/*
+ * Canonical encoding of firehose records, as done before signing or CID
+ * computation: DAG-CBOR with CID (sha2-256) with and without cache of key
+ * orders, and canonical JSON.
+ */
+#define BSKY_DEFAULT_TMP_ARENA_CAPACITY (0x40 * 0x400 * 0x400)
+#define BSKY_API_IMPLEMENTATION
+#include "../bsky-api.h"
+
+#include "bench.h"
+
+#define ITERS 200
+
+// keep results alive.
+static volatile size_t sink;
+
+static void check(enum bsky_error_code ec, const char *what)
+{
+    if (ec == bsky_ec_Ok) return;
+
+    printf("%s: %s\n", what, bsky_str_of_error_code(ec));
+    exit(1);
+}
+
+static void bench_cbor(const char *name, struct bsky_json *records,
+                       size_t len, struct bsky_json_key_cache *cache)
+{
+    struct bsky_bytes buf = { 0 };
+    size_t bytes = 0;
+
+    double start = bench_now_ns();
+    for (size_t i = 0; i < ITERS; ++i) {
+        for (size_t j = 0; j < len; ++j) {
+            buf.len = 0;
+            check(bsky_cbor_push_json(&buf, records[j], cache), name);
+
+            struct bsky_view block = { buf.data, buf.data + buf.len };
+            struct bsky_cid cid = bsky_cid_of_block(bsky_cid_Dag_cbor,
+                                                    block);
+
+            sink  += cid.digest[0];
+            bytes += buf.len;
+        }
+        bsky_default_tmp_reset();
+    }
+    bench_report(name, ITERS * len, bench_now_ns() - start, bytes);
+
+    bsky_da_free(&buf);
+}
+
+int main(void)
+{
+    enum bsky_error_code ec;
+    size_t len;
+    char *data = bench_read_file("corpus/firehose-commits.json", &len);
+
+    // records stay in the heap, the tmp arena is reset between rounds.
+    struct bsky_str str = { data, data + len };
+    struct bsky_json events;
+    struct bsky_arena arena = { .cap = 0x40 * 0x400 * 0x400 };
+
+    bsky_tmp_use_arena(&arena);
+    events = bsky_parse_json(&str, &ec);
+    bsky_tmp_use_arena(NULL);
+    check(ec, "parse");
+
+    struct bsky_json *records = malloc(events.arr.len * sizeof *records);
+    size_t records_len = 0;
+
+    for (size_t i = 0; i < events.arr.len; ++i) {
+        struct bsky_json *commit = bsky_json_dct_get(events.arr.data[i],
+                                                     "commit");
+        struct bsky_json *record = commit != NULL
+                                 ? bsky_json_dct_get(*commit, "record")
+                                 : NULL;
+
+        if (record != NULL) records[records_len++] = *record;
+    }
+    printf("json-canonical: %zu records\n", records_len);
+
+    struct bsky_json_key_cache cache = { 0 };
+
+    bench_cbor("json-canonical/cbor+cid", records, records_len, NULL);
+    bench_cbor("json-canonical/cbor+cid cached", records, records_len,
+               &cache);
+    printf("json-canonical: %zu shapes, %zu hits, %zu misses\n", cache.len,
+           cache.hits, cache.misses);
+
+    struct bsky_str_builder sb = { 0 };
+
+    double start = bench_now_ns();
+    for (size_t i = 0; i < ITERS; ++i) {
+        for (size_t j = 0; j < records_len; ++j) {
+            sb.len = 0;
+            check(bsky_sb_push_json_canonical(&sb, records[j], &cache),
+                  "json");
+            sink += sb.len;
+        }
+        bsky_default_tmp_reset();
+    }
+    bench_report("json-canonical/json cached", ITERS * records_len,
+                 bench_now_ns() - start, 0);
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < ITERS; ++i) {
+        for (size_t j = 0; j < records_len; ++j) {
+            sb.len = 0;
+            bsky_sb_push_json(&sb, records[j]);
+            sink += sb.len;
+        }
+    }
+    bench_report("json-canonical/json as is", ITERS * records_len,
+                 bench_now_ns() - start, 0);
+
+    bsky_json_key_cache_free(&cache);
+    bsky_da_free(&sb);
+    bsky_arena_free(&arena);
+    free(records);
+    free(data);
+
+    return 0;
+}
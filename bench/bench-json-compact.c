@@ -0,0 +1,145 @@
+/*
+ * Compact JSON tree (16 byte nodes) against regular one (32 byte nodes,
+ * 48 byte pairs) on corpus: parse speed, tmp arena bytes taken by tree
+ * (strings included) and full traversal, which visits every node.
+ */
+#define BSKY_API_IMPLEMENTATION
+#include "../bsky-api.h"
+
+#include "bench.h"
+
+// every case processes about this amount of bytes.
+#define BYTES_PER_CASE (64 * 0x400 * 0x400)
+
+static const char *corpus[] = {
+    "corpus/timeline.json",
+    "corpus/thread.json",
+    "corpus/profiles.json",
+    "corpus/firehose-commits.json",
+    "corpus/repo-listing.json",
+};
+
+// keep results alive.
+static volatile double sink;
+
+static double walk(struct bsky_json json)
+{
+    double sum = 0;
+
+    switch (json.var) {
+    case bsky_json_Arr:
+        for (size_t i = 0; i < json.arr.len; ++i)
+            sum += walk(json.arr.data[i]);
+        break;
+    case bsky_json_Dct:
+        for (size_t i = 0; i < json.dct.len; ++i)
+            sum += walk(json.dct.data[i].value) + 1;
+        break;
+    case bsky_json_Num:  sum = json.num; break;
+    case bsky_json_Str:  sum = *json.str; break;
+    case bsky_json_Bool: sum = json._bool; break;
+    default: break;
+    }
+
+    return sum;
+}
+
+static double walk_compact(struct bsky_json_node *node)
+{
+    double sum = 0;
+
+    switch (node->var) {
+    case bsky_json_Arr:
+        for (size_t i = 0; i < node->len; ++i)
+            sum += walk_compact(bsky_json_node_at(node, i));
+        break;
+    case bsky_json_Dct:
+        for (size_t i = 0; i < node->len; ++i)
+            sum += walk_compact(bsky_json_node_at(node, i)) + 1;
+        break;
+    case bsky_json_Num:  sum = node->num; break;
+    case bsky_json_Str:  sum = *node->str; break;
+    case bsky_json_Bool: sum = node->_bool; break;
+    default: break;
+    }
+
+    return sum;
+}
+
+static void bench_file(const char *path)
+{
+    enum bsky_error_code ec;
+    size_t len;
+    char *data = bench_read_file(path, &len);
+    char name[64];
+
+    const char *file  = path + sizeof "corpus/" - 1;
+    size_t      iters = BYTES_PER_CASE / len;
+
+    struct bsky_arena arena = { .cap = 0x100 * 0x400 * 0x400 };
+    struct bsky_arena *prev = bsky_tmp_use_arena(&arena);
+
+    struct bsky_str str = { data, data + len };
+    struct bsky_json json = bsky_parse_json(&str, &ec);
+    size_t json_bytes = arena.len;
+
+    str = (struct bsky_str) { data, data + len };
+    struct bsky_json_node *root = bsky_parse_json_compact(&str, &ec);
+    size_t compact_bytes = arena.len - json_bytes;
+
+    if (ec != bsky_ec_Ok) {
+        printf("%s: %s\n", file, bsky_str_of_error_code(ec));
+        exit(1);
+    }
+
+    printf("compact/%s: %zu tree bytes, %zu compact (%.0f%%)\n", file,
+           json_bytes, compact_bytes, 100.0 * compact_bytes / json_bytes);
+
+    // parses use the rest of arena.
+    size_t mark = arena.len;
+
+    double start = bench_now_ns();
+    for (size_t i = 0; i < iters; ++i) {
+        str = (struct bsky_str) { data, data + len };
+        bsky_parse_json(&str, &ec);
+        arena.len = mark;
+    }
+    snprintf(name, sizeof name, "compact/%s parse", file);
+    bench_report(name, iters, bench_now_ns() - start, iters * len);
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < iters; ++i) {
+        str = (struct bsky_str) { data, data + len };
+        bsky_parse_json_compact(&str, &ec);
+        arena.len = mark;
+    }
+    snprintf(name, sizeof name, "compact/%s parse compact", file);
+    bench_report(name, iters, bench_now_ns() - start, iters * len);
+
+    iters *= 4;
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < iters; ++i) sink += walk(json);
+    snprintf(name, sizeof name, "compact/%s walk", file);
+    bench_report(name, iters, bench_now_ns() - start, 0);
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < iters; ++i) sink += walk_compact(root);
+    snprintf(name, sizeof name, "compact/%s walk compact", file);
+    bench_report(name, iters, bench_now_ns() - start, 0);
+
+    if (walk(json) != walk_compact(root))
+        printf("compact/%s: walks differ\n", file);
+
+    bsky_tmp_use_arena(prev);
+    bsky_arena_free(&arena);
+    free(data);
+}
+
+int main(void)
+{
+    for (size_t i = 0; i < BSKY_ARRAY_LEN(corpus); ++i)
+        bench_file(corpus[i]);
+
+    return 0;
+}
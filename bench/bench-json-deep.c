@@ -0,0 +1,83 @@
+/*
+ * Parse of deep `getPostThread' responses: chain of replies (every reply
+ * is the only reply of its parent) built from post of thread corpus, from
+ * default API depth to hundreds of levels, and of real shaped thread.
+ */
+#define BSKY_DEFAULT_TMP_ARENA_CAPACITY (0x100 * 0x400 * 0x400)
+#define BSKY_API_IMPLEMENTATION
+#include "../bsky-api.h"
+
+#include "bench.h"
+
+// every case processes about this amount of bytes.
+#define BYTES_PER_CASE (64 * 0x400 * 0x400)
+
+// thread view with `depth' nested replies of `post'.
+static struct bsky_str deep_thread(struct bsky_str post, size_t depth)
+{
+    struct bsky_str_builder sb = { 0 };
+    struct bsky_str view = bsky_mk_str(
+        "{\"$type\":\"app.bsky.feed.defs#threadViewPost\",\"post\":");
+
+    bsky_sb_push_str(&sb, bsky_mk_str("{\"thread\":"));
+    for (size_t i = 0; i <= depth; ++i) {
+        bsky_sb_push_str(&sb, view);
+        bsky_sb_push_str(&sb, post);
+        bsky_sb_push_str(&sb, bsky_mk_str(",\"replies\":["));
+    }
+    for (size_t i = 0; i <= depth; ++i)
+        bsky_sb_push_str(&sb, bsky_mk_str("]}"));
+    bsky_sb_push(&sb, '}');
+
+    return bsky_sb_build(&sb);
+}
+
+static void bench_parse(const char *name, struct bsky_str data)
+{
+    enum bsky_error_code ec = bsky_ec_Ok;
+    size_t len   = bsky_str_len(data);
+    size_t iters = BYTES_PER_CASE / len;
+
+    double start = bench_now_ns();
+    for (size_t i = 0; i < iters && ec == bsky_ec_Ok; ++i) {
+        struct bsky_str str = data;
+
+        bsky_parse_json(&str, &ec);
+        bsky_default_tmp_reset();
+    }
+
+    if (ec != bsky_ec_Ok) {
+        printf("%s: %s\n", name, bsky_str_of_error_code(ec));
+        return;
+    }
+
+    bench_report(name, iters, bench_now_ns() - start, iters * len);
+}
+
+int main(void)
+{
+    size_t thread_len;
+    char *thread = bench_read_file("corpus/thread.json", &thread_len);
+
+    struct bsky_str thread_str = { thread, thread + thread_len };
+    enum bsky_error_code ec;
+    struct bsky_json_path path = bsky_json_path_compile("/thread/post", &ec);
+    struct bsky_str post = bsky_json_path_first(&path, thread_str);
+
+    bench_parse("deep/thread.json", thread_str);
+
+    size_t depths[] = { 6, 80, 400 };
+    char name[64];
+
+    for (size_t i = 0; i < BSKY_ARRAY_LEN(depths); ++i) {
+        struct bsky_str data = deep_thread(post, depths[i]);
+
+        snprintf(name, sizeof name, "deep/%zu replies", depths[i]);
+        bench_parse(name, data);
+        free(data.start);
+    }
+
+    free(thread);
+
+    return 0;
+}
@@ -0,0 +1,114 @@
+/*
+ * Moderation style edit of post views of timeline corpus: replace record
+ * text, append label and re-emit. Full parse, tree edit and serialize
+ * against editable document which copies untouched text.
+ */
+#define BSKY_DEFAULT_TMP_ARENA_CAPACITY (0x40 * 0x400 * 0x400)
+#define BSKY_API_IMPLEMENTATION
+#include "../bsky-api.h"
+
+#include "bench.h"
+
+#define POSTS 0x100
+#define ITERS 200
+
+static struct bsky_str posts[POSTS];
+
+// keep results alive.
+static volatile size_t sink;
+
+static struct bsky_json hidden = { .var = bsky_json_Str, .str = "[hidden]" };
+static struct bsky_json label  = { .var = bsky_json_Str, .str = "spam" };
+
+static void check(enum bsky_error_code ec, const char *what)
+{
+    if (ec == bsky_ec_Ok) return;
+
+    printf("%s: %s\n", what, bsky_str_of_error_code(ec));
+    exit(1);
+}
+
+static void edit_tree(struct bsky_str_builder *sb, struct bsky_str post)
+{
+    enum bsky_error_code ec;
+    struct bsky_json json = bsky_parse_json(&post, &ec);
+    check(ec, "parse");
+
+    struct bsky_json *record = bsky_json_dct_get(json, "record");
+    struct bsky_json *text   = record ? bsky_json_dct_get(*record, "text")
+                                      : NULL;
+    struct bsky_json *labels = bsky_json_dct_get(json, "labels");
+
+    if (text == NULL || labels == NULL) check(bsky_ec_Json_path_not_found,
+                                              "tree");
+    *text = hidden;
+
+    // append to array of tree.
+    struct bsky_json *arr = bsky_tmp_alloc((labels->arr.len + 1) *
+                                           sizeof *arr);
+    memcpy(arr, labels->arr.data, labels->arr.len * sizeof *arr);
+    arr[labels->arr.len] = label;
+    labels->arr.data = arr;
+    labels->arr.len++;
+
+    bsky_sb_push_json(sb, json);
+}
+
+static void edit_doc(struct bsky_str_builder *sb, struct bsky_str post)
+{
+    struct bsky_json_doc doc = { .text = post };
+
+    check(bsky_json_doc_set(&doc, "/record/text", hidden), "doc");
+    check(bsky_json_doc_set(&doc, "/labels/-", label), "doc");
+
+    bsky_sb_push_json_doc(sb, &doc);
+    bsky_json_doc_free(&doc);
+}
+
+static void bench_edit(const char *name, size_t bytes,
+                       void (*edit)(struct bsky_str_builder *,
+                                    struct bsky_str))
+{
+    struct bsky_str_builder sb = { 0 };
+
+    double start = bench_now_ns();
+    for (size_t i = 0; i < ITERS; ++i) {
+        for (size_t j = 0; j < POSTS; ++j) {
+            sb.len = 0;
+            edit(&sb, posts[j]);
+            sink += sb.len;
+        }
+
+        bsky_default_tmp_reset();
+    }
+    bench_report(name, ITERS * POSTS, bench_now_ns() - start,
+                 ITERS * bytes);
+
+    bsky_da_free(&sb);
+}
+
+int main(void)
+{
+    enum bsky_error_code ec;
+    size_t timeline_len, len, bytes = 0;
+    char *timeline = bench_read_file("corpus/timeline.json", &timeline_len);
+
+    struct bsky_str timeline_str = { timeline, timeline + timeline_len };
+    struct bsky_json_path path = bsky_json_path_compile("/feed/" "*" "/post",
+                                                        &ec);
+
+    len = bsky_json_path_query(&path, timeline_str, posts, POSTS, &ec);
+    check(ec, "query");
+
+    for (size_t i = len; i < POSTS; ++i) posts[i] = posts[i % len];
+    for (size_t i = 0; i < POSTS; ++i) bytes += bsky_str_len(posts[i]);
+
+    printf("json-doc: %d posts, %zu bytes average\n", POSTS, bytes / POSTS);
+
+    bench_edit("json-doc/parse+edit+serialize", bytes, edit_tree);
+    bench_edit("json-doc/doc edit+serialize", bytes, edit_doc);
+
+    free(timeline);
+
+    return 0;
+}
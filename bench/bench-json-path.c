@@ -0,0 +1,100 @@
+/*
+ * Compiled path queries over raw payloads against parse of whole document
+ * and walk of the tree: texts of all timeline posts, single deep field of
+ * thread and the last top level field (cursor) of timeline.
+ */
+#define BSKY_DEFAULT_TMP_ARENA_CAPACITY (0x100 * 0x400 * 0x400)
+#define BSKY_API_IMPLEMENTATION
+#include "../bsky-api.h"
+
+#include "bench.h"
+
+#define ITERS 2000
+
+// keep results alive.
+static volatile size_t sink;
+
+static struct bsky_json *walk(struct bsky_json json, char **keys)
+{
+    struct bsky_json *value = &json;
+
+    for (; *keys != NULL && value != NULL; ++keys)
+        value = bsky_json_dct_get(*value, *keys);
+
+    return value;
+}
+
+static void bench_path(const char *name, struct bsky_str data,
+                       const char *query, char **keys, int each)
+{
+    enum bsky_error_code ec;
+    struct bsky_str out[256];
+    char case_name[64];
+    size_t found = 0;
+
+    struct bsky_json_path path = bsky_json_path_compile(query, &ec);
+
+    double start = bench_now_ns();
+    for (size_t i = 0; i < ITERS; ++i)
+        found = bsky_json_path_query(&path, data, out, 256, &ec);
+    snprintf(case_name, sizeof case_name, "path/%s query", name);
+    bench_report(case_name, ITERS, bench_now_ns() - start,
+                 ITERS * bsky_str_len(data));
+
+    size_t walked = 0;
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < ITERS; ++i) {
+        struct bsky_str str = data;
+        struct bsky_json json = bsky_parse_json(&str, &ec);
+
+        walked = 0;
+        if (each) {
+            // keys[0] is array, the rest is path in every element.
+            struct bsky_json *arr = bsky_json_dct_get(json, keys[0]);
+
+            for (size_t j = 0; arr != NULL && j < arr->arr.len; ++j)
+                walked += walk(arr->arr.data[j], keys + 1) != NULL;
+        } else {
+            walked += walk(json, keys) != NULL;
+        }
+
+        bsky_default_tmp_reset();
+    }
+    snprintf(case_name, sizeof case_name, "path/%s parse+walk", name);
+    bench_report(case_name, ITERS, bench_now_ns() - start,
+                 ITERS * bsky_str_len(data));
+
+    if (found != walked) printf("path/%s: %zu found, %zu walked\n", name,
+                                found, walked);
+    sink += found;
+}
+
+int main(void)
+{
+    size_t timeline_len, thread_len;
+    char *timeline = bench_read_file("corpus/timeline.json", &timeline_len);
+    char *thread   = bench_read_file("corpus/thread.json", &thread_len);
+
+    struct bsky_str timeline_str = { timeline, timeline + timeline_len };
+    struct bsky_str thread_str   = { thread, thread + thread_len };
+
+    bench_path("timeline texts", timeline_str,
+               "/feed/" "*" "/post/record/text",
+               (char *[]) { "feed", "post", "record", "text", NULL }, 1);
+    bench_path("thread text", thread_str, "/thread/post/record/text",
+               (char *[]) { "thread", "post", "record", "text", NULL }, 0);
+    bench_path("timeline cursor", timeline_str, "/cursor",
+               (char *[]) { "cursor", NULL }, 0);
+
+    double start = bench_now_ns();
+    for (size_t i = 0; i < ITERS; ++i)
+        sink += bsky_str_len(bsky_json_scan_field(timeline_str, "cursor"));
+    bench_report("path/timeline cursor scan_field", ITERS,
+                 bench_now_ns() - start, ITERS * timeline_len);
+
+    free(timeline);
+    free(thread);
+
+    return 0;
+}
@@ -0,0 +1,216 @@
+/*
+ * Throughput of JSON parse and serialize over corpus of real shaped
+ * payloads (see corpus/), and of tmp arena and string builder which they
+ * are built on.
+ */
+#define BENCH_COUNT_ALLOCS
+#include "bench.h"
+
+#define BSKY_DEFAULT_TMP_ARENA_CAPACITY (0x100 * 0x400 * 0x400)
+#define BSKY_API_IMPLEMENTATION
+#include "../bsky-api.h"
+
+// every case processes about this amount of bytes.
+#define BYTES_PER_CASE (64 * 0x400 * 0x400)
+
+static const char *corpus[] = {
+    "corpus/timeline.json",
+    "corpus/thread.json",
+    "corpus/profiles.json",
+    "corpus/firehose-commits.json",
+    "corpus/repo-listing.json",
+    "corpus/emoji-posts.json",
+};
+
+#define CORPUS_LEN (sizeof corpus / sizeof corpus[0])
+
+static size_t iterations(size_t len)
+{
+    size_t iters = BYTES_PER_CASE / len;
+
+    return iters < 10 ? 10 : iters;
+}
+
+static void bench_parse(const char *path, char *data, size_t len)
+{
+    char name[64];
+    size_t iters = iterations(len);
+    enum bsky_error_code ec = bsky_ec_Ok;
+
+    snprintf(name, sizeof name, "parse/%s", path + sizeof "corpus/" - 1);
+
+    bench_allocs = bench_tmp_allocs = 0;
+    double start = bench_now_ns(), total = 0;
+
+    for (size_t i = 0; i < iters; ++i) {
+        struct bsky_str str = { data, data + len };
+
+        bsky_parse_json(&str, &ec);
+        if (ec != bsky_ec_Ok) break;
+
+        bsky_default_tmp_reset();
+    }
+    total = bench_now_ns() - start;
+
+    if (ec != bsky_ec_Ok) {
+        printf("%s: %s\n", name, bsky_str_of_error_code(ec));
+        return;
+    }
+
+    bench_report_allocs(name, iters, total, iters * len,
+                        bench_allocs, bench_tmp_allocs);
+}
+
+static void bench_serialize(const char *path, char *data, size_t len)
+{
+    char name[64];
+    size_t iters = iterations(len), out_len = 0;
+    enum bsky_error_code ec;
+
+    snprintf(name, sizeof name, "serialize/%s", path + sizeof "corpus/" - 1);
+
+    // keep tree out of default tmp arena, which is reset every iteration.
+    struct bsky_arena tree_arena = { .cap = len * 0x40 };
+    struct bsky_arena *prev = bsky_tmp_use_arena(&tree_arena);
+
+    struct bsky_str str = { data, data + len };
+    struct bsky_json json = bsky_parse_json(&str, &ec);
+
+    bsky_tmp_use_arena(prev);
+
+    if (ec != bsky_ec_Ok) {
+        printf("%s: %s\n", name, bsky_str_of_error_code(ec));
+        bsky_arena_free(&tree_arena);
+        return;
+    }
+
+    bench_allocs = bench_tmp_allocs = 0;
+    double start = bench_now_ns();
+
+    for (size_t i = 0; i < iters; ++i) {
+        struct bsky_str_builder sb = { 0 };
+
+        bsky_sb_push_json(&sb, json);
+        out_len = sb.len;
+
+        bsky_da_free(&sb);
+        bsky_default_tmp_reset();
+    }
+
+    bench_report_allocs(name, iters, bench_now_ns() - start, iters * out_len,
+                        bench_allocs, bench_tmp_allocs);
+
+    bsky_arena_free(&tree_arena);
+}
+
+static void bench_arena(void)
+{
+    // sizes typical for parser: nodes, pairs and short strings.
+    static const size_t sizes[] = { 8, 24, 40, 13, 64, 7, 200, 32 };
+    const size_t ops = 0x400 * 0x400 * 8;
+
+    struct bsky_arena arena = { .cap = 0x400 * 0x400 * 0x40 };
+    size_t bytes = 0;
+
+    bench_allocs = bench_tmp_allocs = 0;
+    double start = bench_now_ns();
+
+    for (size_t i = 0; i < ops; ++i) {
+        size_t size = sizes[i % 8];
+
+        if (bsky_arena_alloc(&arena, size) == NULL) {
+            bsky_arena_reset(&arena);
+            bsky_arena_alloc(&arena, size);
+        }
+        bytes += size;
+    }
+
+    bench_report_allocs("arena/alloc", ops, bench_now_ns() - start, bytes,
+                        bench_allocs, bench_tmp_allocs);
+    bsky_arena_free(&arena);
+
+    bytes = 0;
+    bench_allocs = bench_tmp_allocs = 0;
+    start = bench_now_ns();
+
+    for (size_t i = 0; i < ops; ++i) {
+        size_t size = sizes[i % 8];
+
+        if (bsky_tmp_alloc(size) == NULL) {
+            bsky_default_tmp_reset();
+            bsky_tmp_alloc(size);
+        }
+        bytes += size;
+    }
+
+    bench_report_allocs("arena/tmp alloc", ops, bench_now_ns() - start,
+                        bytes, bench_allocs, bench_tmp_allocs);
+    bsky_default_tmp_reset();
+}
+
+static void bench_sb(void)
+{
+    const size_t ops = 0x400 * 0x400 * 4;
+    struct bsky_str word = bsky_mk_str("app.bsky.feed.post");
+    struct bsky_str_builder sb = { 0 };
+
+    bench_allocs = bench_tmp_allocs = 0;
+    double start = bench_now_ns();
+
+    for (size_t i = 0; i < ops; ++i) bsky_sb_push(&sb, 'a' + i % 26);
+
+    bench_report_allocs("sb/push char", ops, bench_now_ns() - start, ops,
+                        bench_allocs, bench_tmp_allocs);
+    bsky_da_free(&sb);
+    sb = (struct bsky_str_builder) { 0 };
+
+    bench_allocs = bench_tmp_allocs = 0;
+    start = bench_now_ns();
+
+    for (size_t i = 0; i < ops; ++i) bsky_sb_push_str(&sb, word);
+
+    bench_report_allocs("sb/push str", ops, bench_now_ns() - start,
+                        ops * bsky_str_len(word),
+                        bench_allocs, bench_tmp_allocs);
+    bsky_da_free(&sb);
+    sb = (struct bsky_str_builder) { 0 };
+
+    const size_t fmt_ops = ops / 8;
+    size_t len = 0;
+
+    bench_allocs = bench_tmp_allocs = 0;
+    start = bench_now_ns();
+
+    for (size_t i = 0; i < fmt_ops; ++i) {
+        bsky_sb_push_fmt(&sb, "\"%s\":%zu,", "likeCount", i);
+        if (i % 0x1000 == 0) bsky_default_tmp_reset();
+    }
+    len = sb.len;
+
+    bench_report_allocs("sb/push fmt", fmt_ops, bench_now_ns() - start, len,
+                        bench_allocs, bench_tmp_allocs);
+    bsky_da_free(&sb);
+    bsky_default_tmp_reset();
+}
+
+int main(void)
+{
+    char *data[CORPUS_LEN];
+    size_t len[CORPUS_LEN];
+
+    for (size_t i = 0; i < CORPUS_LEN; ++i)
+        data[i] = bench_read_file(corpus[i], &len[i]);
+
+    for (size_t i = 0; i < CORPUS_LEN; ++i)
+        bench_parse(corpus[i], data[i], len[i]);
+
+    for (size_t i = 0; i < CORPUS_LEN; ++i)
+        bench_serialize(corpus[i], data[i], len[i]);
+
+    bench_arena();
+    bench_sb();
+
+    for (size_t i = 0; i < CORPUS_LEN; ++i) free(data[i]);
+
+    return 0;
+}
@@ -0,0 +1,65 @@
+/*
+ * Per-call overhead of `bsky_log' with default (synchronous printf) logger
+ * versus asynchronous logger. Both write to /dev/null.
+ */
+#include <stdio.h>
+
+static FILE *sink;
+
+#define BSKY_SIMPLE_LOGGER(fmt, ...) fprintf(sink, fmt, __VA_ARGS__)
+#define BSKY_API_IMPLEMENTATION
+#include "../bsky-api.h"
+
+#include "bench.h"
+
+#define CALLS 1000000
+
+int main(void)
+{
+    double start;
+    char *handle = "alice.bsky.social";
+
+    sink = fopen("/dev/null", "w");
+    bsky_log_async_output(sink);
+
+    start = bench_now_ns();
+    for (int i = 0; i < CALLS; ++i)
+        bsky_log(bsky_log_Info, "fetched %d posts of %s in %.3f ms",
+                 i, handle, i * 0.001);
+    bench_report("log/sync printf", CALLS, bench_now_ns() - start, 0);
+
+    // warm up ring and worker thread.
+    bsky_log_async(bsky_log_Info, "%s", "warm up");
+    bsky_log_async_flush();
+
+    // batches fit into the ring, so nothing is dropped.
+    size_t batch = BSKY_LOG_RING_CAPACITY / 2;
+    double pushed = 0;
+
+    for (int i = 0; i < CALLS; i += batch) {
+        double batch_start = bench_now_ns();
+
+        for (size_t j = 0; j < batch; ++j)
+            bsky_log_async(bsky_log_Info, "fetched %d posts of %s in %.3f ms",
+                           i, handle, i * 0.001);
+
+        pushed += bench_now_ns() - batch_start;
+        bsky_log_async_flush();
+    }
+    bench_report("log/async push (caller)", CALLS, pushed, 0);
+
+    size_t dropped = bsky_log_async_dropped();
+
+    start = bench_now_ns();
+    for (int i = 0; i < CALLS; ++i)
+        bsky_log_async(bsky_log_Info, "fetched %d posts of %s in %.3f ms",
+                       i, handle, i * 0.001);
+    bench_report("log/async push (burst)", CALLS, bench_now_ns() - start, 0);
+    bsky_log_async_stop();
+
+    printf("%-36s %12zu\n", "log/async dropped in burst",
+           bsky_log_async_dropped() - dropped);
+
+    fclose(sink);
+    return 0;
+}
@@ -0,0 +1,224 @@
+/*
+ * Merkle search tree over large synthetic repository (posts, likes,
+ * follows and reposts keyed by TIDs): build, CAR export and load, full
+ * iteration, point lookups, and diff of two commits with a few changed
+ * records against diff by iterating both trees.
+ */
+#define BSKY_API_IMPLEMENTATION
+#include "../bsky-api.h"
+
+#include "bench.h"
+
+#define REPO_KEYS 200000
+#define CHANGES   20
+
+static char keys[REPO_KEYS][64];
+static struct bsky_mst_entry entries[REPO_KEYS], changed[REPO_KEYS + CHANGES];
+
+// keep results alive.
+static volatile size_t sink;
+
+static struct bsky_cid record_cid(size_t i, int version)
+{
+    size_t record[2] = { i, version };
+
+    return bsky_cid_of_block(bsky_cid_Dag_cbor,
+                             (struct bsky_view) { record, record + 2 });
+}
+
+// sorted keys: collections in name order, rkeys are TIDs in time order.
+static void make_repo(void)
+{
+    static const struct { char *nsid; size_t share; } collections[] = {
+        { "app.bsky.feed.like",    35 },
+        { "app.bsky.feed.post",    50 },
+        { "app.bsky.feed.repost",   5 },
+        { "app.bsky.graph.follow", 10 },
+    };
+    size_t i = 0;
+    long long ts = 1700000000000000LL;
+
+    for (size_t c = 0; c < BSKY_ARRAY_LEN(collections); ++c) {
+        size_t count = REPO_KEYS / 100 * collections[c].share;
+        char tid[BSKY_TID_LEN + 1];
+
+        for (size_t n = 0; n < count && i < REPO_KEYS; ++n, ++i) {
+            ts += 1000 + i * 7919 % 100000;
+            bsky_tid_of_timestamp(tid, ts, i % 32);
+
+            int len = snprintf(keys[i], sizeof keys[i], "%s/%s",
+                               collections[c].nsid, tid);
+
+            entries[i].key   = (struct bsky_str) { keys[i], keys[i] + len };
+            entries[i].value = record_cid(i, 0);
+        }
+    }
+}
+
+static enum bsky_error_code count_op(void *ctx, const struct bsky_mst_op *op)
+{
+    (void) op;
+    ++*(size_t *) ctx;
+
+    return bsky_ec_Ok;
+}
+
+// diff without skipping shared trees: merge of two full iterations.
+static size_t naive_diff(struct bsky_block_store store, struct bsky_cid from,
+                         struct bsky_cid to, size_t *loaded)
+{
+    enum bsky_error_code ec;
+    struct bsky_mst_iter a = bsky_mst_iter_init(store, from),
+                         b = bsky_mst_iter_init(store, to);
+    struct bsky_mst_entry ea, eb;
+    int has_a = bsky_mst_next(&a, &ea, &ec),
+        has_b = bsky_mst_next(&b, &eb, &ec);
+    size_t ops = 0;
+
+    while (has_a || has_b) {
+        int cmp = !has_a ? 1 : !has_b ? -1 : bsky_str_cmp(ea.key, eb.key);
+
+        if (cmp != 0 || !bsky_cid_eq(ea.value, eb.value)) ops++;
+        if (cmp <= 0) has_a = bsky_mst_next(&a, &ea, &ec);
+        if (cmp >= 0) has_b = bsky_mst_next(&b, &eb, &ec);
+    }
+
+    *loaded = a.loaded + b.loaded;
+
+    bsky_mst_iter_free(&a);
+    bsky_mst_iter_free(&b);
+
+    return ops;
+}
+
+int main(void)
+{
+    enum bsky_error_code ec;
+    struct bsky_block_map map = { 0 };
+    struct bsky_block_store store = bsky_block_map_store(&map);
+
+    make_repo();
+
+    double start = bench_now_ns();
+    struct bsky_cid root = bsky_mst_build(store, entries, REPO_KEYS, &ec);
+    bench_report("mst/build 200k", REPO_KEYS, bench_now_ns() - start, 0);
+
+    if (ec != bsky_ec_Ok) {
+        printf("mst/build: %s\n", bsky_str_of_error_code(ec));
+        return 1;
+    }
+
+    size_t nodes = map.len;
+    printf("mst/nodes: %zu\n", nodes);
+
+    // export as CAR and load it back.
+    struct bsky_bytes car_data = { 0 };
+
+    bsky_car_push_header(&car_data, root);
+    for (size_t i = 0; i < map.cap; ++i)
+        if (map.slots[i].block.start != NULL)
+            bsky_car_push_block(&car_data, map.slots[i].cid,
+                                map.slots[i].block);
+
+    struct bsky_view car_view = { car_data.data,
+                                  car_data.data + car_data.len };
+    static const struct { char *name; int borrow, verify; } loads[] = {
+        { "car/load copy",          0, 0 },
+        { "car/load borrow",        1, 0 },
+        { "car/load borrow+verify", 1, 1 },
+    };
+
+    for (size_t i = 0; i < BSKY_ARRAY_LEN(loads); ++i) {
+        const size_t rounds = 8;
+
+        start = bench_now_ns();
+        for (size_t r = 0; r < rounds; ++r) {
+            struct bsky_block_map loaded = { .borrow = loads[i].borrow };
+            struct bsky_car car = bsky_car_open(car_view, &ec);
+
+            ec = bsky_car_load(&car, bsky_block_map_store(&loaded),
+                               loads[i].verify);
+            sink += loaded.len;
+            bsky_block_map_free(&loaded);
+        }
+        bench_report(loads[i].name, rounds * nodes, bench_now_ns() - start,
+                     rounds * car_data.len);
+    }
+
+    // full iteration.
+    const size_t rounds = 16;
+    size_t count = 0, loaded = 0;
+
+    start = bench_now_ns();
+    for (size_t r = 0; r < rounds; ++r) {
+        struct bsky_mst_iter iter = bsky_mst_iter_init(store, root);
+        struct bsky_mst_entry entry;
+
+        while (bsky_mst_next(&iter, &entry, &ec)) count++;
+        loaded = iter.loaded;
+        bsky_mst_iter_free(&iter);
+    }
+    bench_report("mst/iterate per key", count, bench_now_ns() - start, 0);
+    printf("mst/iterate: %zu keys, %zu nodes loaded\n", count / rounds,
+           loaded);
+
+    const size_t gets = 200000;
+    struct bsky_cid value;
+
+    start = bench_now_ns();
+    for (size_t i = 0; i < gets; ++i)
+        sink += bsky_mst_get(store, root, entries[i * 7919 % REPO_KEYS].key,
+                             &value, &ec);
+    bench_report("mst/get", gets, bench_now_ns() - start, 0);
+
+    // next commit: few updated, deleted and created records.
+    size_t changed_len = 0;
+
+    for (size_t i = 0; i < REPO_KEYS; ++i) {
+        size_t pick = i * 104729 % REPO_KEYS;
+
+        if (pick < CHANGES / 4) continue;                  // deleted
+
+        changed[changed_len] = entries[i];
+        if (pick < CHANGES / 2) changed[changed_len].value = record_cid(i, 1);
+        changed_len++;
+
+        // created: same key with other record key suffix.
+        if (pick >= CHANGES / 2 && pick < CHANGES) {
+            static char created[CHANGES][72];
+            int len = snprintf(created[pick], sizeof created[pick], "%.*s2",
+                               (int) bsky_str_len(entries[i].key),
+                               entries[i].key.start);
+
+            changed[changed_len++] = (struct bsky_mst_entry) {
+                { created[pick], created[pick] + len }, record_cid(i, 2)
+            };
+        }
+    }
+
+    struct bsky_cid next = bsky_mst_build(store, changed, changed_len, &ec);
+    size_t ops = 0, diff_rounds = 2000;
+
+    start = bench_now_ns();
+    for (size_t r = 0; r < diff_rounds; ++r)
+        ec = bsky_mst_diff(store, root, next, count_op, &ops, &loaded);
+    bench_report("mst/diff 20 changes", diff_rounds, bench_now_ns() - start,
+                 0);
+    printf("mst/diff: %zu ops, %zu of %zu nodes loaded\n", ops / diff_rounds,
+           loaded, nodes * 2);
+
+    ops = 0;
+    diff_rounds = 4;
+    start = bench_now_ns();
+    for (size_t r = 0; r < diff_rounds; ++r)
+        ops += naive_diff(store, root, next, &loaded);
+    bench_report("mst/diff 20 changes naive", diff_rounds,
+                 bench_now_ns() - start, 0);
+    printf("mst/diff naive: %zu ops, %zu nodes loaded\n", ops / diff_rounds,
+           loaded);
+
+    bsky_da_free(&car_data);
+    bsky_block_map_free(&map);
+
+    return 0;
+}
@@ -0,0 +1,187 @@
+/*
+ * Commit signature verification over recorded firehose stream: every
+ * event of corpus becomes signed commit of its account (keys are mostly
+ * secp256k1, every fourth account is P-256). Verification with did:key
+ * parsed per event, with key cache by DID and in batches, in events/s.
+ */
+#define BSKY_DEFAULT_TMP_ARENA_CAPACITY (0x40 * 0x400 * 0x400)
+#define BSKY_API_IMPLEMENTATION
+#include "../bsky-api.h"
+
+#include "bench.h"
+
+#define ROUNDS 5
+#define BATCH  64
+
+struct event {
+    struct bsky_str did;
+    char did_key[BSKY_DID_KEY_STR_LEN + 1];  // as resolved from DID document
+    struct bsky_view block;                  // signed commit
+};
+
+// keep results alive.
+static volatile size_t sink;
+
+static void check(enum bsky_error_code ec, const char *what)
+{
+    if (ec == bsky_ec_Ok) return;
+
+    printf("%s: %s\n", what, bsky_str_of_error_code(ec));
+    exit(1);
+}
+
+static void report(const char *name, size_t events, double ns)
+{
+    bench_report(name, events, ns, 0);
+    printf("%-36s %12.0f events/s\n", "", events / (ns / 1e9));
+}
+
+int main(void)
+{
+    enum bsky_error_code ec;
+    size_t len;
+    char *data = bench_read_file("corpus/firehose-commits.json", &len);
+
+    struct bsky_str str = { data, data + len };
+    struct bsky_arena arena = { .cap = 0x40 * 0x400 * 0x400 };
+
+    // stream outlives resets of the default tmp arena.
+    bsky_tmp_use_arena(&arena);
+    struct bsky_json json = bsky_parse_json(&str, &ec);
+    check(ec, "parse");
+
+    struct event *events = malloc(json.arr.len * sizeof *events);
+    struct bsky_bytes buf = { 0 };
+    size_t events_len = 0;
+
+    double start = bench_now_ns();
+    for (size_t i = 0; i < json.arr.len; ++i) {
+        struct bsky_json *did    = bsky_json_dct_get(json.arr.data[i], "did");
+        struct bsky_json *commit = bsky_json_dct_get(json.arr.data[i],
+                                                     "commit");
+        struct bsky_json *rev    = commit != NULL
+                                 ? bsky_json_dct_get(*commit, "rev") : NULL;
+        struct bsky_json *record = commit != NULL
+                                 ? bsky_json_dct_get(*commit, "record")
+                                 : NULL;
+
+        if (did == NULL || rev == NULL || record == NULL) continue;
+
+        // account key of DID.
+        struct event *event = &events[events_len++];
+        unsigned char secret[BSKY_KEY_SECRET_LEN];
+
+        event->did = bsky_mk_str(did->str);
+        bsky_sha256(did->str, strlen(did->str), secret);
+
+        enum bsky_key_curve curve = secret[0] % 4 == 0 ? bsky_key_P256
+                                                       : bsky_key_Secp256k1;
+        struct bsky_key key = bsky_key_of_secret(curve, secret, &ec);
+        check(ec, "key");
+        bsky_key_format_did(event->did_key, &key);
+
+        // commit over record as data, signed.
+        unsigned char sig[BSKY_SIG_LEN];
+
+        buf.len = 0;
+        check(bsky_cbor_push_json(&buf, *record, NULL), "record");
+
+        struct bsky_view record_block = { buf.data, buf.data + buf.len };
+        struct bsky_commit signed_commit = {
+            .did     = event->did,
+            .rev     = bsky_mk_str(rev->str),
+            .data    = bsky_cid_of_block(bsky_cid_Dag_cbor, record_block),
+            .version = 3,
+        };
+        check(bsky_commit_sign(&signed_commit, &key, sig), "sign");
+
+        buf.len = 0;
+        bsky_cbor_push_commit(&buf, &signed_commit);
+
+        unsigned char *block = bsky_tmp_alloc(buf.len);
+        memcpy(block, buf.data, buf.len);
+        event->block = (struct bsky_view) { block, block + buf.len };
+    }
+    report("sig/sign commit", events_len, bench_now_ns() - start);
+    bsky_tmp_use_arena(NULL);
+
+    printf("sig: %zu events\n", events_len);
+
+    // did:key parsed for every event.
+    start = bench_now_ns();
+    for (size_t round = 0; round < ROUNDS; ++round) {
+        for (size_t i = 0; i < events_len; ++i) {
+            struct bsky_commit commit = bsky_parse_commit(events[i].block,
+                                                          &ec);
+            check(ec, "commit");
+
+            struct bsky_key key = bsky_key_parse_did(
+                bsky_mk_str(events[i].did_key), &ec);
+            check(ec, "did:key");
+            check(bsky_commit_verify(&commit, &key), "verify");
+        }
+    }
+    report("sig/verify parsed key", ROUNDS * events_len,
+           bench_now_ns() - start);
+
+    // keys cached by DID.
+    struct bsky_key_cache cache = { 0 };
+
+    start = bench_now_ns();
+    for (size_t round = 0; round < ROUNDS; ++round) {
+        for (size_t i = 0; i < events_len; ++i) {
+            struct bsky_commit commit = bsky_parse_commit(events[i].block,
+                                                          &ec);
+            check(ec, "commit");
+
+            const struct bsky_key *key = bsky_key_cache_get(&cache,
+                                                            commit.did);
+            if (key == NULL)
+                key = bsky_key_cache_put(&cache, commit.did,
+                                         bsky_mk_str(events[i].did_key), &ec);
+            check(ec, "did:key");
+            check(bsky_commit_verify(&commit, key), "verify");
+        }
+    }
+    report("sig/verify cached key", ROUNDS * events_len,
+           bench_now_ns() - start);
+    printf("sig: %zu keys, %zu hits, %zu misses\n", cache.len, cache.hits,
+           cache.misses);
+
+    // batches of commits, keys cached.
+    struct bsky_sig_check checks[BATCH];
+
+    start = bench_now_ns();
+    for (size_t round = 0; round < ROUNDS; ++round) {
+        for (size_t i = 0; i < events_len; i += BATCH) {
+            size_t n = events_len - i < BATCH ? events_len - i : BATCH;
+
+            for (size_t j = 0; j < n; ++j) {
+                struct event *event = &events[i + j];
+                struct bsky_commit commit = bsky_parse_commit(event->block,
+                                                              &ec);
+                check(ec, "commit");
+
+                checks[j].key = bsky_key_cache_get(&cache, commit.did);
+                checks[j].sig = commit.sig;
+                bsky_commit_digest(&commit, checks[j].digest);
+            }
+
+            if (bsky_sig_verify_batch(checks, n) != n) {
+                printf("sig: invalid signature in batch\n");
+                return 1;
+            }
+            sink += n;
+        }
+    }
+    report("sig/verify batch cached key", ROUNDS * events_len,
+           bench_now_ns() - start);
+
+    bsky_key_cache_free(&cache);
+    bsky_arena_free(&arena);
+    bsky_da_free(&buf);
+    free(events);
+    free(data);
+
+    return 0;
+}
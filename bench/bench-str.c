@@ -0,0 +1,227 @@
+/*
+ * String primitives: current `bsky_str_*' against their previous
+ * byte-by-byte versions (kept here as `old_*') and libc. UTF-8 helpers
+ * and JSON string decoding run over emoji heavy post text.
+ */
+#define _GNU_SOURCE // memmem
+#include <string.h>
+
+#define BSKY_API_IMPLEMENTATION
+#include "../bsky-api.h"
+
+#include "bench.h"
+
+#define OPS 4000000
+
+static int old_str_eq(struct bsky_str fst, struct bsky_str snd) {
+    return strcmp(fst.start, snd.start) == 0;
+}
+
+static int old_str_cmp(struct bsky_str fst, struct bsky_str snd) {
+    size_t fst_len = bsky_str_len(fst), snd_len = bsky_str_len(snd);
+
+    for (int i = 0; i < (fst_len > snd_len ? fst_len : snd_len); ++i) {
+        if (fst.start[i] > snd.start[i]) return  1 + i;
+        if (fst.start[i] < snd.start[i]) return -1 - i;
+    }
+
+    return fst_len > snd_len ?   1 + snd_len :
+           snd_len > fst_len ? - 1 - fst_len :
+           0;
+}
+
+static int old_str_starts_with(struct bsky_str fst, struct bsky_str pref)
+{
+    size_t fst_len = bsky_str_len(fst), pref_len = bsky_str_len(pref);
+
+    if (fst_len < pref_len) return 0;
+
+    return memcmp(fst.start, pref.start, pref_len) == 0;
+}
+
+static char *naive_find_char(struct bsky_str str, char c)
+{
+    for (char *p = str.start; p < str.end; ++p)
+        if (*p == c) return p;
+
+    return NULL;
+}
+
+static char *naive_find(struct bsky_str str, struct bsky_str sub)
+{
+    size_t len = bsky_str_len(sub);
+
+    for (char *p = str.start; p + len <= str.end; ++p)
+        if (memcmp(p, sub.start, len) == 0) return p;
+
+    return NULL;
+}
+
+static int scalar_utf8_valid(struct bsky_str str)
+{
+    for (const char *c = str.start; c < str.end; )
+        if (__bsky_utf8_next(&c, str.end) < 0) return 0;
+
+    return 1;
+}
+
+// keep results alive.
+static volatile size_t sink;
+
+#define BENCH(name, ops, bytes, expr) do {                              \
+        double start = bench_now_ns();                                  \
+        size_t acc = 0;                                                 \
+        for (size_t i = 0; i < (ops); ++i) {                            \
+            bench_clobber();                                            \
+            acc += (size_t) (expr);                                     \
+        }                                                               \
+        sink += acc;                                                    \
+        bench_report(name, ops, bench_now_ns() - start, bytes);         \
+    } while (0)
+
+int main(void)
+{
+    // lexicon keys differ in the tail, like most JSON keys.
+    char key_a[] = "app.bsky.feed.defs#threadViewPost";
+    char key_b[] = "app.bsky.feed.defs#threadViewPosT";
+    struct bsky_str ka = bsky_mk_str(key_a), kb = bsky_mk_str(key_b);
+
+    static char long_a[4096], long_b[4096];
+    for (size_t i = 0; i < sizeof long_a - 1; ++i)
+        long_a[i] = long_b[i] = 'a' + i % 26;
+    long_b[sizeof long_b - 2] = '!';
+
+    struct bsky_str la = bsky_mk_str(long_a), lb = bsky_mk_str(long_b);
+    size_t key_len = bsky_str_len(ka), long_len = bsky_str_len(la);
+
+    BENCH("str/eq key old (strcmp)", OPS, OPS * key_len,
+          old_str_eq(ka, kb));
+    BENCH("str/eq key", OPS, OPS * key_len, bsky_str_eq(ka, kb));
+    BENCH("str/eq 4k old (strcmp)", OPS / 16, OPS / 16 * long_len,
+          old_str_eq(la, lb));
+    BENCH("str/eq 4k", OPS / 16, OPS / 16 * long_len, bsky_str_eq(la, lb));
+
+    BENCH("str/cmp key old", OPS, OPS * key_len, old_str_cmp(ka, kb));
+    BENCH("str/cmp key", OPS, OPS * key_len, bsky_str_cmp(ka, kb));
+    BENCH("str/cmp 4k old", OPS / 16, OPS / 16 * long_len,
+          old_str_cmp(la, lb));
+    BENCH("str/cmp 4k", OPS / 16, OPS / 16 * long_len, bsky_str_cmp(la, lb));
+
+    struct bsky_str pref = bsky_mk_str("app.bsky.feed.");
+    BENCH("str/starts_with old", OPS, 0, old_str_starts_with(ka, pref));
+    BENCH("str/starts_with", OPS, 0, bsky_str_starts_with(ka, pref));
+
+    // char near the end of long text.
+    BENCH("str/find_char 4k naive", OPS / 16, OPS / 16 * long_len,
+          naive_find_char(la, 'z' + 1) == NULL);
+    BENCH("str/find_char 4k memchr", OPS / 16, OPS / 16 * long_len,
+          memchr(la.start, 'z' + 1, long_len) == NULL);
+    BENCH("str/find_char 4k", OPS / 16, OPS / 16 * long_len,
+          bsky_str_find_char(la, 'z' + 1) == NULL);
+
+    struct bsky_str sub = bsky_mk_str("xyzabcdefg!");
+    BENCH("str/find 4k naive", OPS / 64, OPS / 64 * long_len,
+          naive_find(la, sub) == NULL);
+    BENCH("str/find 4k memmem", OPS / 64, OPS / 64 * long_len,
+          memmem(la.start, long_len, sub.start, bsky_str_len(sub)) == NULL);
+    BENCH("str/find 4k", OPS / 64, OPS / 64 * long_len,
+          bsky_str_find(la, sub) == NULL);
+
+    struct bsky_str uri = bsky_mk_str(
+        "at://did:plc:z72i7hdynmk6r22z27h6tvur/app.bsky.feed.post/3l3qo2vu");
+    size_t parts = 0;
+    double start = bench_now_ns();
+    for (size_t i = 0; i < OPS; ++i) {
+        for (struct bsky_str rest = uri; rest.start != NULL; ) {
+            bsky_str_split(&rest, '/');
+            parts++;
+        }
+    }
+    sink += parts;
+    bench_report("str/split at-uri", OPS, bench_now_ns() - start,
+                 OPS * bsky_str_len(uri));
+
+    // string values of posts: long text without escapes.
+    static char text[2048];
+    text[0] = '"';
+    for (size_t i = 1; i < sizeof text - 2; ++i) text[i] = 'a' + i % 26;
+    text[sizeof text - 2] = '"';
+
+    enum bsky_error_code ec;
+    start = bench_now_ns();
+    for (size_t i = 0; i < OPS / 64; ++i) {
+        struct bsky_str str = bsky_mk_str(text);
+        bsky_parse_json_str(&str, &ec);
+        bsky_default_tmp_reset();
+    }
+    bench_report("json/parse str 2k", OPS / 64, bench_now_ns() - start,
+                 OPS / 64 * (sizeof text - 1));
+
+    // post text as clients write it: mixed scripts, emoji sequences.
+    static const char *words[] = {
+        "the ", "post ", "caf\xc3\xa9 ", "\xe6\x97\xa5\xe6\x9c\xac ",
+        "\xd0\xbc\xd0\xb8\xd1\x80 ", "\xf0\x9f\x8e\x89 ",
+        "\xf0\x9f\x91\x8d\xf0\x9f\x8f\xbd ",
+        "\xf0\x9f\x87\xba\xf0\x9f\x87\xa6 ", "bluesky ",
+    };
+    static char mixed[4096];
+    size_t mixed_len = 0;
+    for (size_t i = 0; ; ++i) {
+        size_t len = strlen(words[i % BSKY_ARRAY_LEN(words)]);
+
+        if (mixed_len + len >= sizeof mixed) break;
+        memcpy(mixed + mixed_len, words[i % BSKY_ARRAY_LEN(words)], len);
+        mixed_len += len;
+    }
+    struct bsky_str ms = { mixed, mixed + mixed_len };
+
+    BENCH("utf8/valid 4k ascii scalar", OPS / 16, OPS / 16 * long_len,
+          scalar_utf8_valid(la));
+    BENCH("utf8/valid 4k ascii", OPS / 16, OPS / 16 * long_len,
+          bsky_utf8_valid(la));
+    BENCH("utf8/valid 4k emoji scalar", OPS / 16, OPS / 16 * mixed_len,
+          scalar_utf8_valid(ms));
+    BENCH("utf8/valid 4k emoji", OPS / 16, OPS / 16 * mixed_len,
+          bsky_utf8_valid(ms));
+    BENCH("utf8/graphemes 4k emoji", OPS / 64, OPS / 64 * mixed_len,
+          bsky_utf8_graphemes(ms));
+
+    // the same text as JSON string, raw and with `\\u' escapes.
+    struct bsky_str_builder raw = { 0 }, escaped = { 0 };
+    bsky_sb_push_fmt(&raw, "\"%.*s\"", (int) mixed_len, mixed);
+
+    bsky_sb_push(&escaped, '"');
+    for (const char *c = mixed; c < mixed + mixed_len; ) {
+        long cp = __bsky_utf8_next(&c, mixed + mixed_len);
+
+        if (cp < 0x80) {
+            bsky_sb_push(&escaped, cp);
+        } else if (cp < 0x10000) {
+            bsky_sb_push_fmt(&escaped, "\\u%04lx", cp);
+        } else {
+            cp -= 0x10000;
+            bsky_sb_push_fmt(&escaped, "\\u%04lx\\u%04lx",
+                             0xd800 + (cp >> 10), 0xdc00 + (cp & 0x3ff));
+        }
+    }
+    bsky_sb_push(&escaped, '"');
+
+    struct bsky_str cases[] = { bsky_sb_build(&raw), bsky_sb_build(&escaped) };
+    char *names[] = { "json/parse str 4k emoji", "json/parse str 4k \\u" };
+
+    for (size_t c = 0; c < BSKY_ARRAY_LEN(cases); ++c) {
+        start = bench_now_ns();
+        for (size_t i = 0; i < OPS / 64; ++i) {
+            struct bsky_str str = cases[c];
+            bsky_parse_json_str(&str, &ec);
+            bsky_default_tmp_reset();
+        }
+        bench_report(names[c], OPS / 64, bench_now_ns() - start,
+                     OPS / 64 * bsky_str_len(cases[c]));
+    }
+
+    bsky_da_free(&raw);
+    bsky_da_free(&escaped);
+
+    return 0;
+}
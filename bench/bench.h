@@ -0,0 +1,106 @@
+#ifndef bench_h_INCLUDED
+#define bench_h_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * Tiny helpers shared by benchmarks. Every benchmark prints one line per
+ * case:
+ *      <name>  <ns/op>  [<MB/s>]  [<allocs/op>]
+ *
+ * Define `BENCH_COUNT_ALLOCS' and include this header before the library
+ * to count allocations made by the library: heap (through `BSKY_MALLOC'
+ * and `BSKY_REALLOC' hooks) and tmp arena ones.
+ */
+
+static double bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void bench_report(const char *name, size_t ops, double ns,
+                         size_t bytes)
+{
+    printf("%-36s %12.1f ns/op", name, ns / ops);
+
+    if (bytes != 0) printf(" %10.1f MB/s", bytes / (ns / 1e9) / 1e6);
+
+    printf("\n");
+}
+
+/*
+ * Compiler barrier: forces loop bodies with pure calls (strcmp, memchr)
+ * to be evaluated every iteration.
+ */
+#define bench_clobber() __asm__ volatile("" ::: "memory")
+
+/*
+ * Read whole file, exit on failure. Returned buffer is null terminated.
+ */
+static char *bench_read_file(const char *path, size_t *len)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) { perror(path); exit(1); }
+
+    fseek(file, 0, SEEK_END);
+    *len = ftell(file);
+    rewind(file);
+
+    char *data = malloc(*len + 1);
+    if (data == NULL || fread(data, 1, *len, file) != *len) {
+        perror(path);
+        exit(1);
+    }
+    data[*len] = '\0';
+
+    fclose(file);
+
+    return data;
+}
+
+#ifdef BENCH_COUNT_ALLOCS
+    static size_t bench_allocs, bench_tmp_allocs;
+
+    static void *bench_malloc(size_t size) {
+        bench_allocs++;
+        return malloc(size);
+    }
+
+    static void *bench_realloc(void *ptr, size_t size) {
+        bench_allocs++;
+        return realloc(ptr, size);
+    }
+
+    #define BSKY_MALLOC(size)       bench_malloc(size)
+    #define BSKY_REALLOC(ptr, size) bench_realloc(ptr, size)
+    #define BSKY_FREE(ptr)          free(ptr)
+
+    void *__bsky_default_tmp_alloc(size_t);
+
+    static void *bench_tmp_alloc(size_t size) {
+        bench_tmp_allocs++;
+        return __bsky_default_tmp_alloc(size);
+    }
+
+    #define bsky_tmp_alloc bench_tmp_alloc
+
+    static void bench_report_allocs(const char *name, size_t ops, double ns,
+                                    size_t bytes, size_t allocs,
+                                    size_t tmp_allocs)
+    {
+        printf("%-36s %12.1f ns/op", name, ns / ops);
+
+        if (bytes != 0) printf(" %10.1f MB/s", bytes / (ns / 1e9) / 1e6);
+        else            printf(" %15s", "");
+
+        printf(" %10.2f allocs/op %10.2f tmp/op\n",
+               (double) allocs / ops, (double) tmp_allocs / ops);
+    }
+#endif
+
+#endif // bench_h_INCLUDED
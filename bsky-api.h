@@ -33,7 +33,7 @@
  */
 
 
-#ifndef __BSKY_API_H_GUARD__ic_arr*)da)->data
+#ifndef __BSKY_API_H_GUARD__
 #define __BSKY_API_H_GUARD__
 #include <stddef.h>
 #include <stdlib.h>
@@ -60,6 +60,137 @@
     #define BSKY_LOG_LEVEL bsky_log_Info
     #endif
 
+    /**
+     * Asynchronous logger. `bsky_log_async' doesn't format message on the
+     * calling thread: it copies level, format pointer and arguments (string
+     * arguments are copied too) into fixed-size record of per-thread
+     * lock-free ring buffer. Background thread formats records and writes
+     * them to output (stdout by default), it sleeps once rings stay empty
+     * for `BSKY_LOG_IDLE_SPINS' polls and is woken by the next record. If
+     * ring is full record is dropped and counted (see
+     * `bsky_log_async_dropped').
+     *
+     * Predefine `BSKY_ASYNC_LOG' to make `bsky_log' use it.
+     *
+     * NOTE: format must be string literal (only pointer is stored), and
+     *       arguments count is limited by `BSKY_LOG_MAX_ARGS'.
+     */
+    #ifndef BSKY_LOG_MAX_ARGS
+        #define BSKY_LOG_MAX_ARGS 8
+    #endif
+    #ifndef BSKY_LOG_STR_CAPACITY
+        #define BSKY_LOG_STR_CAPACITY 192 // bytes of string args per record.
+    #endif
+    #ifndef BSKY_LOG_RING_CAPACITY
+        #define BSKY_LOG_RING_CAPACITY 256 // records, power of two.
+    #endif
+    #ifndef BSKY_LOG_IDLE_SPINS
+        #define BSKY_LOG_IDLE_SPINS 128 // empty polls before worker sleeps.
+    #endif
+
+    struct bsky_log_arg {
+        enum {
+            bsky_log_arg_Int,
+            bsky_log_arg_Uint,
+            bsky_log_arg_Double,
+            bsky_log_arg_Str,
+            bsky_log_arg_Ptr,
+        } kind;
+
+        union {
+            long long i; unsigned long long u; double d;
+            const char *s; const void *p;
+        };
+    };
+
+    void bsky_log_async_push(enum bsky_log_level, const char *fmt,
+                             size_t nargs, const struct bsky_log_arg *);
+
+    /**
+     * Wait until all records pushed before the call are written.
+     */
+    void   bsky_log_async_flush(void);
+
+    /**
+     * Flush and stop background thread. It will be started again by next
+     * pushed record.
+     */
+    void   bsky_log_async_stop(void);
+
+    /**
+     * Set output of asynchronous logger (NULL for stdout). Records pushed
+     * before the call are written to previous output.
+     */
+    void   bsky_log_async_output(FILE *);
+
+    /**
+     * Count of records dropped because of full ring buffers.
+     */
+    size_t bsky_log_async_dropped(void);
+
+    struct bsky_log_arg __bsky_log_arg_i(long long);
+    struct bsky_log_arg __bsky_log_arg_u(unsigned long long);
+    struct bsky_log_arg __bsky_log_arg_d(long double);
+    struct bsky_log_arg __bsky_log_arg_s(const char *);
+    struct bsky_log_arg __bsky_log_arg_p(const void *);
+
+    #define __BSKY_LOG_ARG(x) _Generic((x),                                 \
+                    _Bool:              __bsky_log_arg_u,                   \
+                    char:               __bsky_log_arg_i,                   \
+                    signed char:        __bsky_log_arg_i,                   \
+                    short:              __bsky_log_arg_i,                   \
+                    int:                __bsky_log_arg_i,                   \
+                    long:               __bsky_log_arg_i,                   \
+                    long long:          __bsky_log_arg_i,                   \
+                    unsigned char:      __bsky_log_arg_u,                   \
+                    unsigned short:     __bsky_log_arg_u,                   \
+                    unsigned int:       __bsky_log_arg_u,                   \
+                    unsigned long:      __bsky_log_arg_u,                   \
+                    unsigned long long: __bsky_log_arg_u,                   \
+                    float:              __bsky_log_arg_d,                   \
+                    double:             __bsky_log_arg_d,                   \
+                    long double:        __bsky_log_arg_d,                   \
+                    char *:             __bsky_log_arg_s,                   \
+                    const char *:       __bsky_log_arg_s,                   \
+                    default:            __bsky_log_arg_p)(x)
+
+    #define __BSKY_LOG_NARG(...) __BSKY_LOG_NARG_(__VA_ARGS__,              \
+                                                  8, 7, 6, 5, 4, 3, 2, 1)
+    #define __BSKY_LOG_NARG_(_1, _2, _3, _4, _5, _6, _7, _8, n, ...) n
+    #define __BSKY_LOG_CAT(a, b)  __BSKY_LOG_CAT_(a, b)
+    #define __BSKY_LOG_CAT_(a, b) a##b
+
+    #define __BSKY_LOG_A_1(a)      __BSKY_LOG_ARG(a)
+    #define __BSKY_LOG_A_2(a, ...) __BSKY_LOG_ARG(a), __BSKY_LOG_A_1(__VA_ARGS__)
+    #define __BSKY_LOG_A_3(a, ...) __BSKY_LOG_ARG(a), __BSKY_LOG_A_2(__VA_ARGS__)
+    #define __BSKY_LOG_A_4(a, ...) __BSKY_LOG_ARG(a), __BSKY_LOG_A_3(__VA_ARGS__)
+    #define __BSKY_LOG_A_5(a, ...) __BSKY_LOG_ARG(a), __BSKY_LOG_A_4(__VA_ARGS__)
+    #define __BSKY_LOG_A_6(a, ...) __BSKY_LOG_ARG(a), __BSKY_LOG_A_5(__VA_ARGS__)
+    #define __BSKY_LOG_A_7(a, ...) __BSKY_LOG_ARG(a), __BSKY_LOG_A_6(__VA_ARGS__)
+    #define __BSKY_LOG_A_8(a, ...) __BSKY_LOG_ARG(a), __BSKY_LOG_A_7(__VA_ARGS__)
+
+    #define __BSKY_LOG_ARGS(...)                                            \
+        __BSKY_LOG_CAT(__BSKY_LOG_A_,                                    \
+                       __BSKY_LOG_NARG(__VA_ARGS__))(__VA_ARGS__)
+
+    /**
+     * Push record to asynchronous logger. Like `BSKY_LOGGER' it expects at
+     * least one argument after format.
+     */
+    #define bsky_log_async(level, fmt, ...) do {                            \
+                const struct bsky_log_arg __bsky_log_args[] = {             \
+                    __BSKY_LOG_ARGS(__VA_ARGS__)                            \
+                };                                                          \
+                bsky_log_async_push(level, fmt,                             \
+                                    BSKY_ARRAY_LEN(__bsky_log_args),        \
+                                    __bsky_log_args);                       \
+            } while (0)
+
+    #if defined(BSKY_ASYNC_LOG) && !defined(BSKY_LOGGER)
+        #define BSKY_LOGGER(level, fmt, ...)                                \
+                          bsky_log_async(level, fmt, __VA_ARGS__)
+    #endif
+
     /**
      * Logger function used by `bsky_log'. Logger must sutisfy following
      * usage:
@@ -128,6 +259,47 @@
         bsky_ec_Json_expect_CQ,
         bsky_ec_Json_expect_Colon,
 		bsky_ec_Json_invalid_variant,
+        bsky_ec_Json_control_char,
+        bsky_ec_Json_invalid_escape,
+        bsky_ec_Json_invalid_utf8,
+        bsky_ec_Json_path_invalid,
+        bsky_ec_Json_too_deep,
+        bsky_ec_Json_path_not_found,
+        bsky_ec_Json_edit_conflict,
+        bsky_ec_Json_not_canonical,
+
+        bsky_ec_At_uri_scheme,
+        bsky_ec_At_uri_authority,
+        bsky_ec_At_uri_collection,
+        bsky_ec_At_uri_rkey,
+
+        bsky_ec_Cid_multibase,
+        bsky_ec_Cid_invalid,
+        bsky_ec_Cid_unsupported,
+
+        bsky_ec_Cbor_truncated,
+        bsky_ec_Cbor_invalid,
+        bsky_ec_Cbor_unsupported,
+
+        bsky_ec_Block_not_found,
+        bsky_ec_Block_mismatch,
+        bsky_ec_Car_invalid,
+        bsky_ec_Block_file_io,
+
+        bsky_ec_Mst_invalid_node,
+        bsky_ec_Mst_unsorted_keys,
+
+        bsky_ec_Repo_invalid_commit,
+        bsky_ec_Backfill_io,
+
+        bsky_ec_Key_invalid,
+        bsky_ec_Key_unsupported,
+        bsky_ec_Key_no_secret,
+        bsky_ec_Sig_invalid,
+
+        bsky_ec_Xrpc_transport,
+        bsky_ec_Xrpc_status,
+        bsky_ec_Xrpc_bad_response,
     };
 
     /**
@@ -139,7 +311,7 @@
                     "%s. %s:%d", bsky_str_of_error_code(ec),   \
                     __FILE__, __LINE__);                       \
 
-    #define bsky_return_error(ec) if (ec != bsky_log_Error) {  \
+    #define bsky_return_error(ec) if ((ec) != bsky_ec_Ok) {   \
                             bsky_log_error(ec);                \
                             return (ec);                       \
                         }                                      \
@@ -155,6 +327,100 @@
                     } while(0)                                 \
 
 
+/*
+ * module:
+ * ============================================================================
+ *                               HEAP ALLOCATION
+ * ============================================================================
+ */
+    /**
+     * All heap memory of the library goes through these hooks. Predefine
+     * all three to use your own allocator:
+     *      #define BSKY_MALLOC(size)       my_malloc(size)
+     *      #define BSKY_REALLOC(ptr, size) my_realloc(ptr, size)
+     *      #define BSKY_FREE(ptr)          my_free(ptr)
+     *      #define BSKY_API_IMPLEMENTATION
+     *      #include "bsky-api.h"
+     */
+    #ifndef BSKY_MALLOC
+        #define BSKY_MALLOC(size)       malloc(size)
+        #define BSKY_REALLOC(ptr, size) realloc(ptr, size)
+        #define BSKY_FREE(ptr)          free(ptr)
+    #endif
+
+    /**
+     * Allocation tracking. Predefine `BSKY_TRACK_ALLOCS' to count heap
+     * operations of every call site of the library and track live and peak
+     * bytes. Every block gets small header with its size, so memory
+     * allocated by library must be freed by library (as it's already
+     * required for `bsky_da_free' and friends).
+     *
+     * Without `BSKY_TRACK_ALLOCS' hooks are called directly and all
+     * counters stay zero.
+     *
+     * Example (allocations per request):
+     *      struct bsky_alloc_stats before = bsky_alloc_stats();
+     *      handle_request(...);
+     *      struct bsky_alloc_stats after = bsky_alloc_stats();
+     *      allocs = after.mallocs + after.reallocs
+     *             - before.mallocs - before.reallocs;
+     */
+    #ifndef BSKY_ALLOC_SITES_MAX
+        #define BSKY_ALLOC_SITES_MAX 128
+    #endif
+
+    struct bsky_alloc_site {
+        const char *func; int line;
+
+        size_t mallocs, reallocs, frees;
+        size_t bytes;       // total requested by this site.
+        size_t live_bytes;  // currently owned blocks allocated here.
+    };
+
+    struct bsky_alloc_stats {
+        size_t mallocs, reallocs, frees;
+        size_t bytes, live_bytes, peak_bytes;
+    };
+
+    /**
+     * Totals over all call sites.
+     */
+    struct bsky_alloc_stats bsky_alloc_stats(void);
+
+    /**
+     * Copy up to `cap' call sites to `sites'. Return number of known call
+     * sites.
+     */
+    size_t bsky_alloc_sites(struct bsky_alloc_site *sites, size_t cap);
+
+    /**
+     * Zero counters, peak bytes is set to current live bytes.
+     */
+    void bsky_alloc_stats_reset(void);
+
+    void *__bsky_track_malloc(size_t, const char *func, int line);
+    void *__bsky_track_realloc(void *, size_t, const char *func, int line);
+    void  __bsky_track_free(void *, const char *func, int line);
+
+    #ifdef BSKY_TRACK_ALLOCS
+        #define __bsky_malloc(size) \
+            __bsky_track_malloc(size, __func__, __LINE__)
+        #define __bsky_realloc(ptr, size) \
+            __bsky_track_realloc(ptr, size, __func__, __LINE__)
+        #define __bsky_free(ptr) \
+            __bsky_track_free(ptr, __func__, __LINE__)
+    #else
+        #define __bsky_malloc(size)       BSKY_MALLOC(size)
+        #define __bsky_realloc(ptr, size) BSKY_REALLOC(ptr, size)
+        #define __bsky_free(ptr)          BSKY_FREE(ptr)
+    #endif
+
+    #define __bsky_calloc(count, size) \
+        __bsky_zeroed(__bsky_malloc((count) * (size)), (count) * (size))
+
+    void *__bsky_zeroed(void *, size_t);
+
+
 /*
  * module:
  * ============================================================================
@@ -202,6 +468,34 @@
      */
     void bsky_default_tmp_reset(void);
 
+    /**
+     * Fixed capacity arena. Memory is allocated on first use, so arena can
+     * be created with designated initializer:
+     *      struct bsky_arena arena = { .cap = 0x400 * 0x400 };
+     *
+     * Allocations are aligned to `BSKY_ARENA_ALIGN'. Return NULL on
+     * overflow.
+     */
+    #ifndef BSKY_ARENA_ALIGN
+        #define BSKY_ARENA_ALIGN 16
+    #endif
+
+    struct bsky_arena { char *data; size_t len, cap; };
+
+    void *bsky_arena_alloc(struct bsky_arena *, size_t);
+    void  bsky_arena_reset(struct bsky_arena *);
+    void  bsky_arena_free(struct bsky_arena *);
+
+    /**
+     * Redirect default tmp allocations of the calling thread to the arena
+     * (NULL to return to default tmp arena). Return previous arena, so
+     * redirections can be nested:
+     *      struct bsky_arena *prev = bsky_tmp_use_arena(&arena);
+     *      ... parse into arena ...
+     *      bsky_tmp_use_arena(prev);
+     */
+    struct bsky_arena *bsky_tmp_use_arena(struct bsky_arena *);
+
 
 /*
  * module:
@@ -255,7 +549,7 @@
     /**
      * Push copy of element to the end of the dynamic array.
      */
-    #define bsky_da_append(da, elems, len) __bsky_da_push(da, elems,\
+    #define bsky_da_append(da, elems, len) __bsky_da_append(da, elems,\
                                                     sizeof (*elems), len)
 
 
@@ -417,678 +711,11681 @@
 
     struct bsky_str bsky_shift_str(struct bsky_str, size_t n);
 
+    /**
+     * Find first occurrence of char. Return pointer to it or NULL.
+     *
+     * NOTE: search and comparison functions use SSE2 or NEON when target
+     *       has them. Predefine `BSKY_NO_SIMD' to use portable code.
+     */
+    char *bsky_str_find_char(struct bsky_str, char);
+
+    /**
+     * Find first occurrence of substring. Return pointer to it or NULL.
+     * Empty substring is found at the start of the string.
+     */
+    char *bsky_str_find(struct bsky_str, struct bsky_str);
+
+    /**
+     * Split string by separator. Return part before first separator and
+     * move `rest' right after it. When there is no separator left, whole
+     * `rest' is returned and its start becomes NULL.
+     *
+     * Example:
+     *      struct bsky_str rest = bsky_mk_str("at://did:plc:x/app.bsky/3k");
+     *      while (rest.start != NULL) {
+     *          struct bsky_str part = bsky_str_split(&rest, '/');
+     *          ...
+     *      }
+     */
+    struct bsky_str bsky_str_split(struct bsky_str *rest, char sep);
+
+    /**
+     * Hash string content (FNV-1a). Can be chained by passing previous
+     * hash as `seed', start with `BSKY_STR_HASH_SEED'.
+     */
+    #define BSKY_STR_HASH_SEED 0xcbf29ce484222325ULL
+    unsigned long long bsky_str_hash(struct bsky_str, unsigned long long seed);
+
 
 
 /*
  * module:
  * ===========================================================================
- *                                    JSON
+ *                                   UTF-8
  * ===========================================================================
 */
-
-	// Just forward declaration :)
-    struct bsky_json_pair;
+    /**
+     * Check that string is valid UTF-8 (no overlong forms, surrogates or
+     * code points above U+10FFFF). ASCII is skipped 16 bytes at once.
+     * Return 1 if string is valid and 0 otherwise.
+     */
+    int bsky_utf8_valid(struct bsky_str);
 
     /**
-     * `bsky_json' is data structure to represent json format, parse, and
-     * serialize it. It can be static created.
+     * Count grapheme clusters (user perceived characters), e.g. for post
+     * length limit.
      *
-     * By default `bsky_json' is not dynamic data structure, cause in primary
-     * use cases it should just serve as help format to create JSON strings or
-     * read data from JSON format.
+     * NOTE: segmentation is simplified version of UAX #29: cluster is code
+     *       point followed by combining marks, variation selectors, emoji
+     *       modifiers and tags, ZWJ joins next code point, regional
+     *       indicators are paired, "\r\n" is single cluster. It is exact
+     *       for emoji sequences and latin/cyrillic/CJK text, but not for
+     *       Hangul jamo and Indic conjuncts. Invalid bytes are clusters of
+     *       one byte.
      */
-    struct bsky_json {
-        enum {
-            bsky_json_Arr,  // JSON Array
-            bsky_json_Dct,  // JSON Dictionary
+    size_t bsky_utf8_graphemes(struct bsky_str);
 
-            bsky_json_Num,  // JSON Number
-            bsky_json_Str,  // JSON String
-            bsky_json_Bool, // JSON Boolean
-            bsky_json_Null, // JSON NULL
-        } var;
+    /**
+     * Byte offset of the start of `n'-th grapheme cluster or length of
+     * string if it is shorter. Use it to convert text positions to facet
+     * `byteStart' and `byteEnd'.
+     */
+    size_t bsky_utf8_grapheme_offset(struct bsky_str, size_t n);
 
-        union {
-            struct { struct bsky_json      *data; size_t len; } arr;
-            struct { struct bsky_json_pair *data; size_t len; } dct;
-            long double num; 
-            char *str;
-            int _bool;
-        };
-    };
+    /**
+     * Slice of text between facet byte offsets. Return string with NULL
+     * start if offsets are out of text or not on code point boundaries.
+     *
+     * NOTE: returned string is a slice, it is not null terminated.
+     */
+    struct bsky_str bsky_utf8_slice(struct bsky_str, size_t byte_start,
+                                    size_t byte_end);
 
-    // pair to implement dictionaries.
-    struct bsky_json_pair {
-        char *name; struct bsky_json value;
-    };
 
+/*
+ * module:
+ * ===========================================================================
+ *                                IDENTIFIERS
+ * ===========================================================================
+*/
     /**
-     * Create temporary string of json. The resulting string would be in
-     * compressed format.
+     * AT Protocol identifiers: DIDs, handles, NSIDs, record keys, TIDs and
+     * AT-URIs. Validation follows syntax from atproto specs and doesn't
+     * allocate, parsed parts are slices of input.
      */
-    struct bsky_str bsky_tmp_str_of_json(struct bsky_json);
+    #define BSKY_DID_MAX    2048
+    #define BSKY_HANDLE_MAX 253
+    #define BSKY_NSID_MAX   317
+    #define BSKY_RKEY_MAX   512
+    #define BSKY_TID_LEN    13
+    #define BSKY_AT_URI_MAX 8192
 
     /**
-     * Push JSON string to string builder.
+     * `did:<method>:<id>', e.g. "did:plc:z72i7hdynmk6r22z27h6tvur".
+     * Return 1 if DID is valid and 0 otherwise.
      */
-    void bsky_sb_push_json(struct bsky_str_builder *, struct bsky_json);
+    int bsky_did_valid(struct bsky_str);
 
+    /**
+     * Domain name with at least two labels, e.g. "alice.bsky.social".
+     * Return 1 if handle is valid and 0 otherwise.
+     */
+    int bsky_handle_valid(struct bsky_str);
 
     /**
-     * 
+     * Reversed domain authority and name, e.g. "app.bsky.feed.post".
+     * Return 1 if NSID is valid and 0 otherwise.
      */
-    struct bsky_json bsky_parse_json(struct bsky_str*, enum bsky_error_code*); 
+    int bsky_nsid_valid(struct bsky_str);
 
-    struct bsky_json bsky_parse_json_arr(struct bsky_str*,
-                                         enum bsky_error_code*);
-    struct bsky_json bsky_parse_json_dct(struct bsky_str*,
-                                         enum bsky_error_code*);
-    struct bsky_json bsky_parse_json_str(struct bsky_str*,
-                                         enum bsky_error_code*);
-    struct bsky_json bsky_parse_json_num(struct bsky_str*,
-                                         enum bsky_error_code*);
-    struct bsky_json bsky_parse_json_null(struct bsky_str*,
-                                          enum bsky_error_code*);
-    struct bsky_json bsky_parse_json_bool(struct bsky_str*,
-                                          enum bsky_error_code*);
+    /**
+     * Record key: 1-512 chars of `A-Za-z0-9._:~-', except "." and "..".
+     * Return 1 if record key is valid and 0 otherwise.
+     */
+    int bsky_rkey_valid(struct bsky_str);
 
+    /**
+     * Timestamp identifier: 13 chars of sortable base32, e.g.
+     * "3jzfcijpj2z2a". Return 1 if TID is valid and 0 otherwise.
+     */
+    int bsky_tid_valid(struct bsky_str);
 
-    typedef struct bsky_json      bsky_Json;
-    typedef struct bsky_json_pair bsky_Json_Pair;
+    /**
+     * Decode TID into microseconds since UNIX epoch and 10 bit clock id
+     * (`clock_id' can be NULL). Return -1 if TID is invalid.
+     */
+    long long bsky_tid_timestamp(struct bsky_str, unsigned *clock_id);
 
-    // helper functions.
-    struct bsky_json_da      { struct bsky_json      *data; size_t len, cap; };
-    struct bsky_json_pair_da { struct bsky_json_pair *data; size_t len, cap; };
+    /**
+     * Encode TID into `buf' (`BSKY_TID_LEN' + 1 bytes, result is null
+     * terminated) and return it.
+     */
+    struct bsky_str bsky_tid_of_timestamp(char *buf, long long timestamp,
+                                          unsigned clock_id);
 
+    /**
+     * Parts of `at://<authority>[/<collection>[/<rkey>]]'. Missing parts
+     * have NULL start.
+     *
+     * NOTE: parts are slices of parsed string, they are not null
+     *       terminated.
+     */
+    struct bsky_at_uri {
+        struct bsky_str authority;       // DID or handle
+        struct bsky_str collection;      // NSID
+        struct bsky_str rkey;
+    };
 
-/*
- * ============================================================================
- *                             IMPLEMENTATION
- * ===========================================================================
- *
- * To enable implementation predefine `BSKY_API_IMPLEMENTATION' macro.
- */
-#ifdef BSKY_API_IMPLEMENTATION
+    typedef struct bsky_at_uri bsky_At_Uri;
 
-    /*
-     * BSKY ERROR CODE
+    /**
+     * Split and validate AT-URI. Query and fragment are not supported.
+     *
+     * Example:
+     *      struct bsky_at_uri uri = bsky_parse_at_uri(bsky_mk_str(
+     *          "at://did:plc:abc/app.bsky.feed.post/3jzfcijpj2z2a"), &ec);
+     *      long long us = bsky_tid_timestamp(uri.rkey, NULL);
      */
-    const char *bsky_str_of_error_code(enum bsky_error_code code)
-    {
-        switch (code) {
-        case bsky_ec_Ok:           return "Ok";
-        case bsky_ec_Tmp_overflow: return "overflow of temporary arena!";
-
-        case bsky_ec_Json_expect_CSB: 
-            return "JSON: expect ']' at the end of array!";
-        case bsky_ec_Json_expect_OSB: 
-            return "JSON: expect '[' at the start of the array!";
-        case bsky_ec_Json_expect_CCB: 
-            return "JSON: expect '}' at the end of dictionary!";
-        case bsky_ec_Json_expect_OCB: 
-            return "JSON: expect '}' at the start of dictionary!";
-        case bsky_ec_Json_expect_Bool: 
-            return "JSON: expect 'true' or 'false'!";
-        case bsky_ec_Json_expect_Null: 
-            return "JSON: expect 'null'!";
-        case bsky_ec_Json_expect_Number: 
-            return "JSON: expect number!";
-        case bsky_ec_Json_expect_OQ: 
-            return "JSON: expect '\"' at the start of string!";
-        case bsky_ec_Json_expect_CQ: 
-            return "JSON: expect '\"' at the end of string!";
-        case bsky_ec_Json_expect_Colon: 
-            return "JSON: expect ':' between key and value!";
-        case bsky_ec_Json_invalid_variant:
-            return "JSON: parse invalid json variant!";
-        }
-    }
+    struct bsky_at_uri bsky_parse_at_uri(struct bsky_str,
+                                         enum bsky_error_code *);
 
-    /*
-     * DEFAULT TMP ARENA
+    /**
+     * Packed keys for in-memory indexes. `did:plc' id (24 chars of base32)
+     * is packed into 15 bytes, TID into its 64 bit value. Keys are plain
+     * values: compare them with `memcmp'/`==', hash with `*_key_hash'.
+     * TID keys sort as TIDs, DID keys have their own total order (base32
+     * alphabet is not in ASCII order).
+     *
+     * Example:
+     *      struct bsky_did_key key;
+     *      if (bsky_did_key_pack(did, &key))
+     *          slot = bsky_did_key_hash(key) & (cap - 1);
      */
-    struct __bsky_default_tmp_arena {
-        void *allocator; size_t len;
-    } __bsky_default_tmp_arena = { 0 };
+    #define BSKY_DID_PLC_LEN 32          // "did:plc:" and 24 chars
 
-    void    bsky_default_tmp_reset(void) {
-        __bsky_default_tmp_arena.len = 0;
-    }
+    struct bsky_did_key { unsigned char bytes[15]; };
 
-    void *__bsky_default_tmp_alloc(size_t size_to_alloc)
-    {
-        if (__bsky_default_tmp_arena.allocator == 0) {
-            __bsky_default_tmp_arena.allocator =
-                calloc(BSKY_DEFAULT_TMP_ARENA_CAPACITY, sizeof(char));
-        }
+    /**
+     * Pack `did:plc' DID. Return 0 (key is untouched) if DID is not valid
+     * `did:plc', other methods don't have fixed size packing.
+     */
+    int bsky_did_key_pack(struct bsky_str, struct bsky_did_key *);
 
-        if (__bsky_default_tmp_arena.len + size_to_alloc >
-            BSKY_DEFAULT_TMP_ARENA_CAPACITY) 
-            return NULL;
+    /**
+     * Unpack key into `buf' (`BSKY_DID_PLC_LEN' + 1 bytes, result is null
+     * terminated) and return it.
+     */
+    struct bsky_str bsky_did_key_unpack(char *buf, struct bsky_did_key);
 
-        void *ret = __bsky_default_tmp_arena.allocator
-                    + __bsky_default_tmp_arena.len;
+    /**
+     * Compare keys for `qsort' and `bsearch'.
+     */
+    int bsky_did_key_cmp(const void *, const void *);
 
-        __bsky_default_tmp_arena.len += size_to_alloc;
+    unsigned long long bsky_did_key_hash(struct bsky_did_key);
 
-        return ret;
-    }
+    /**
+     * Pack TID. Return 0 (key is untouched) if TID is invalid.
+     */
+    int bsky_tid_key_pack(struct bsky_str, unsigned long long *key);
 
-    /*
-     * BKSY DYNAMIC ARRAY
+    /**
+     * Unpack key into `buf' (`BSKY_TID_LEN' + 1 bytes, result is null
+     * terminated) and return it.
      */
-	#include <string.h>
-    void bsky_da_free(void *da) {
-        struct bsky_dynamic_arr *self = (struct bsky_dynamic_arr*) da;
+    struct bsky_str bsky_tid_key_unpack(char *buf, unsigned long long key);
 
-        if (self->data != NULL) free(self->data);
-    }
+    unsigned long long bsky_tid_key_hash(unsigned long long key);
 
-    enum bsky_error_code 
-    __bsky_da_push(void *self_gen, const void *elem, size_t elem_size)
-    {
-        struct bsky_dynamic_arr *self = (struct bsky_dynamic_arr*) self_gen;
+
+/*
+ * module:
+ * ===========================================================================
+ *                                    CID
+ * ===========================================================================
+*/
+    /**
+     * Content identifiers of repository blocks and blobs: CIDv1 with
+     * sha2-256 multihash, written as base32 multibase ("bafyrei...").
+     * CIDv0 and other hash functions are not used by AT Protocol and
+     * are not supported.
+     *
+     * SHA-256 uses SHA-NI on x86 (detected at runtime) and ARMv8 crypto
+     * extension when it's enabled at compile time (`-march=armv8-a+crypto'),
+     * portable code otherwise or with `BSKY_NO_SIMD'.
+     */
+    #include <stdint.h>
+
+    #define BSKY_SHA256_LEN  32
+    #define BSKY_CID_BYTES   36          // version, codec, hash, length, digest
+    #define BSKY_CID_STR_LEN 59          // 'b' and 58 chars of base32
+
+    /**
+     * Incremental SHA-256.
+     *
+     * Example:
+     *      struct bsky_sha256 sha;
+     *      bsky_sha256_init(&sha);
+     *      bsky_sha256_update(&sha, header, header_len);
+     *      bsky_sha256_update(&sha, body, body_len);
+     *      bsky_sha256_final(&sha, digest);
+     */
+    struct bsky_sha256 {
+        uint32_t state[8];
+        uint64_t len;
+        unsigned char buf[64];
+    };
+
+    void bsky_sha256_init(struct bsky_sha256 *);
+    void bsky_sha256_update(struct bsky_sha256 *, const void *, size_t len);
+    void bsky_sha256_final(struct bsky_sha256 *,
+                           unsigned char digest[BSKY_SHA256_LEN]);
+
+    /**
+     * SHA-256 of whole buffer.
+     */
+    void bsky_sha256(const void *, size_t len,
+                     unsigned char digest[BSKY_SHA256_LEN]);
+
+    /**
+     * Name of SHA-256 implementation in use: "sha-ni", "armv8" or
+     * "portable".
+     */
+    const char *bsky_sha256_backend(void);
+
+    enum bsky_cid_codec {
+        bsky_cid_Raw      = 0x55,        // blobs
+        bsky_cid_Dag_cbor = 0x71,        // records, commits, MST nodes
+    };
+
+    struct bsky_cid {
+        enum bsky_cid_codec codec;
+        unsigned char digest[BSKY_SHA256_LEN];
+    };
+
+    /**
+     * Compute CID of block.
+     */
+    struct bsky_cid bsky_cid_of_block(enum bsky_cid_codec, struct bsky_view);
+
+    /**
+     * Compute CIDs of `len' blocks into `cids'.
+     */
+    void bsky_cid_batch(enum bsky_cid_codec, const struct bsky_view *blocks,
+                        size_t len, struct bsky_cid *cids);
+
+    /**
+     * Check that block hashes to CID. Return 1 if it does and 0 otherwise.
+     */
+    int bsky_cid_verify(struct bsky_cid, struct bsky_view block);
+
+    int bsky_cid_eq(struct bsky_cid, struct bsky_cid);
+
+    /**
+     * Parse base32 multibase CID string, e.g. value of `cid' field.
+     */
+    struct bsky_cid bsky_parse_cid(struct bsky_str, enum bsky_error_code *);
+
+    /**
+     * Format CID into `buf' (`BSKY_CID_STR_LEN' + 1 bytes, result is null
+     * terminated) and return it.
+     */
+    struct bsky_str bsky_cid_format(char *buf, struct bsky_cid);
+
+    /**
+     * Parse binary CID (as in CAR files and DAG-CBOR links, without
+     * multibase prefix) and move view after it.
+     */
+    struct bsky_cid bsky_parse_cid_bytes(struct bsky_view *,
+                                         enum bsky_error_code *);
+
+    /**
+     * Write binary CID into `buf' (`BSKY_CID_BYTES' bytes) and return
+     * number of written bytes.
+     */
+    size_t bsky_cid_to_bytes(unsigned char *buf, struct bsky_cid);
+
+
+/*
+ * module:
+ * ===========================================================================
+ *                                 DAG-CBOR
+ * ===========================================================================
+*/
+    /**
+     * Reader and writer of DAG-CBOR, binary encoding of repository blocks
+     * (commits, MST nodes, records).
+     *
+     * Reader is pull based: `bsky_cbor_read' returns one item, for arrays
+     * and maps only their length, so caller walks containers itself and
+     * skips what it doesn't need with `bsky_cbor_skip'. Text and bytes are
+     * views into the block, nothing is allocated.
+     *
+     * Only DAG-CBOR subset is accepted: minimal length encoding, definite
+     * lengths, tag 42 (CID link) and 64-bit floats. Keys of map are checked
+     * when the map is read: text only, sorted by length then bytes and
+     * without duplicates.
+     */
+    enum bsky_cbor_type {
+        bsky_cbor_Int,
+        bsky_cbor_Bytes,
+        bsky_cbor_Text,
+        bsky_cbor_Arr,               // `len' items follow
+        bsky_cbor_Map,               // `len' key-value pairs follow
+        bsky_cbor_Link,
+        bsky_cbor_Bool,
+        bsky_cbor_Null,
+        bsky_cbor_Float,
+    };
+
+    struct bsky_cbor {
+        enum bsky_cbor_type type;
+
+        union {
+            long long        integer;
+            struct bsky_view bytes;
+            struct bsky_str  text;   // not null terminated
+            size_t           len;
+            struct bsky_cid  link;
+            int              _bool;
+            double           num;
+        };
+    };
+
+    /**
+     * Read one item and move view after it (after the head for arrays and
+     * maps).
+     */
+    struct bsky_cbor bsky_cbor_read(struct bsky_view *,
+                                    enum bsky_error_code *);
+
+    /**
+     * Skip one item with all its content. Keys of skipped maps are not
+     * checked.
+     */
+    void bsky_cbor_skip(struct bsky_view *, enum bsky_error_code *);
+
+    /**
+     * Byte buffer for encoded blocks (dynamic array).
+     */
+    struct bsky_bytes { unsigned char *data; size_t len, cap; };
+
+    /**
+     * Push items to the buffer. Map keys must be pushed in DAG-CBOR order:
+     * shorter first, then bytewise. If buffer can't grow nothing is pushed
+     * and `bsky_ec_Tmp_overflow' is returned.
+     *
+     * Example, `{"a": 1, "bc": [null]}':
+     *      bsky_cbor_push_map(&buf, 2);
+     *      bsky_cbor_push_text(&buf, bsky_mk_str("a"));
+     *      bsky_cbor_push_int(&buf, 1);
+     *      bsky_cbor_push_text(&buf, bsky_mk_str("bc"));
+     *      bsky_cbor_push_arr(&buf, 1);
+     *      bsky_cbor_push_null(&buf);
+     */
+    enum bsky_error_code bsky_cbor_push_int(struct bsky_bytes *, long long);
+    enum bsky_error_code bsky_cbor_push_bytes(struct bsky_bytes *,
+                                              struct bsky_view);
+    enum bsky_error_code bsky_cbor_push_text(struct bsky_bytes *,
+                                             struct bsky_str);
+    enum bsky_error_code bsky_cbor_push_link(struct bsky_bytes *,
+                                             struct bsky_cid);
+    enum bsky_error_code bsky_cbor_push_bool(struct bsky_bytes *, int);
+    enum bsky_error_code bsky_cbor_push_null(struct bsky_bytes *);
+    enum bsky_error_code bsky_cbor_push_arr(struct bsky_bytes *, size_t len);
+    enum bsky_error_code bsky_cbor_push_map(struct bsky_bytes *, size_t len);
+
+
+/*
+ * module:
+ * ===========================================================================
+ *                                  BLOCKS
+ * ===========================================================================
+*/
+    /**
+     * Source of repository blocks by CID: in-memory map filled from CAR
+     * file, cache, local storage, etc.
+     *
+     * `get' must set view to the block and return `bsky_ec_Ok', or return
+     * `bsky_ec_Block_not_found'. Block must stay valid as long as store.
+     * `put' may be NULL for read only stores.
+     */
+    struct bsky_block_store {
+        enum bsky_error_code (*get)(void *ctx, struct bsky_cid,
+                                    struct bsky_view *block);
+        enum bsky_error_code (*put)(void *ctx, struct bsky_cid,
+                                    struct bsky_view block);
+        void *ctx;
+    };
+
+    /**
+     * In-memory block store (hash table by CID). Blocks are copied into
+     * map, unless `borrow' is set: then map keeps views as they are, e.g.
+     * to point into whole CAR file read to memory.
+     *
+     * Example:
+     *      struct bsky_block_map map = { 0 };
+     *      struct bsky_block_store store = bsky_block_map_store(&map);
+     *      ...
+     *      bsky_block_map_free(&map);
+     */
+    struct bsky_block_slot { struct bsky_cid cid; struct bsky_view block; };
+
+    struct bsky_block_map {
+        struct bsky_block_slot *slots; size_t len, cap;
+
+        struct __bsky_block_chunk *chunks;
+        int borrow;
+    };
+
+    enum bsky_error_code bsky_block_map_get(struct bsky_block_map *,
+                                            struct bsky_cid,
+                                            struct bsky_view *);
+    enum bsky_error_code bsky_block_map_put(struct bsky_block_map *,
+                                            struct bsky_cid,
+                                            struct bsky_view);
+
+    struct bsky_block_store bsky_block_map_store(struct bsky_block_map *);
+
+    /**
+     * Remove all blocks, keeping memory for the next ones.
+     */
+    void bsky_block_map_reset(struct bsky_block_map *);
+    void bsky_block_map_free(struct bsky_block_map *);
+
+    /**
+     * CARv1 reader (repository exports, `com.atproto.sync.getRepo',
+     * firehose commit blocks). Reads sections in place, the data must
+     * outlive returned blocks.
+     *
+     * Example:
+     *      struct bsky_car car = bsky_car_open(data, &ec);
+     *      struct bsky_cid cid;
+     *      struct bsky_view block;
+     *      while (bsky_car_next(&car, &cid, &block, &ec)) ...
+     */
+    struct bsky_car {
+        struct bsky_view rest;       // sections not read yet
+        struct bsky_cid  root;       // first root
+        size_t roots;
+    };
+
+    struct bsky_car bsky_car_open(struct bsky_view, enum bsky_error_code *);
+
+    /**
+     * Read next block. Return 1 if block is read and 0 at the end of file
+     * or on error.
+     */
+    int bsky_car_next(struct bsky_car *, struct bsky_cid *,
+                      struct bsky_view *block, enum bsky_error_code *);
+
+    /**
+     * Put all remaining blocks to store. With `verify' every block is
+     * hashed and `bsky_ec_Block_mismatch' returned if it doesn't match
+     * its CID.
+     */
+    enum bsky_error_code bsky_car_load(struct bsky_car *,
+                                       struct bsky_block_store, int verify);
+
+    /**
+     * Write CAR header with one root and block sections. Like CBOR pushes
+     * they push nothing if buffer can't grow.
+     */
+    enum bsky_error_code bsky_car_push_header(struct bsky_bytes *,
+                                              struct bsky_cid root);
+    enum bsky_error_code bsky_car_push_block(struct bsky_bytes *,
+                                             struct bsky_cid,
+                                             struct bsky_view block);
+
+    /**
+     * On-disk block store: append-only data file (magic and CAR sections)
+     * and sorted index file next to it (`<path>.idx'). Blocks are read
+     * through mmap, so returned views point right into page cache and
+     * stay valid until the file is closed (compaction included).
+     *
+     * Puts are buffered and written in batches of `batch' bytes (default
+     * `BSKY_BLOCK_FILE_BATCH'); reading a block not written yet flushes
+     * the batch. With `sync' every flush is followed by fsync.
+     *
+     * Index is written on close and compaction, blocks appended after it
+     * are indexed in memory. After crash index is stale, so the rest of
+     * data file is scanned on open (and torn last section cut off).
+     * Blocks which don't match their CID are skipped, and open fails with
+     * `bsky_ec_Block_file_io' if sections before the tail don't parse.
+     *
+     * Not thread safe.
+     *
+     * Example:
+     *      struct bsky_block_file file = bsky_block_file_open("blocks", &ec);
+     *      struct bsky_block_store store = bsky_block_file_store(&file);
+     *      ec = bsky_car_load(&car, store, 1);
+     *      ...
+     *      ec = bsky_block_file_close(&file);
+     */
+    #ifndef BSKY_BLOCK_FILE_BATCH
+        #define BSKY_BLOCK_FILE_BATCH (0x400 * 0x400)
+    #endif
+
+    // as in index file.
+    struct bsky_block_file_entry {
+        unsigned char digest[BSKY_SHA256_LEN];
+        uint64_t offset;                     // of block in data file
+        uint32_t len;
+        uint32_t codec;
+    };
+
+    struct bsky_block_file {
+        int fd;
+        char *path;
+
+        size_t data_len;                     // written to data file
+        struct bsky_bytes pending;           // batch to write
+        size_t batch;
+        int sync;
+
+        unsigned char *map;                  // reserved beyond `data_len'
+        size_t map_cap;
+        struct __bsky_block_file_map *retired;   // views may point there
+
+        const struct bsky_block_file_entry *index;   // sorted
+        size_t index_len;
+        size_t indexed;                      // data file part in index
+        void *index_map;
+        size_t index_map_len;
+
+        struct bsky_block_file_entry *recent;    // hash of not indexed
+        size_t recent_len, recent_cap;
+    };
+
+    /**
+     * Open store, creating data file if there's none.
+     */
+    struct bsky_block_file bsky_block_file_open(const char *path,
+                                                enum bsky_error_code *);
+
+    enum bsky_error_code bsky_block_file_get(struct bsky_block_file *,
+                                             struct bsky_cid,
+                                             struct bsky_view *);
+    enum bsky_error_code bsky_block_file_put(struct bsky_block_file *,
+                                             struct bsky_cid,
+                                             struct bsky_view);
+
+    /**
+     * Write pending batch.
+     */
+    enum bsky_error_code bsky_block_file_flush(struct bsky_block_file *);
+
+    /**
+     * Rewrite data file with blocks for which `keep' returns 1 (all blocks
+     * if it's NULL) and rebuild index.
+     */
+    enum bsky_error_code bsky_block_file_compact(struct bsky_block_file *,
+                                int (*keep)(void *ctx, struct bsky_cid),
+                                void *ctx);
+
+    struct bsky_block_store bsky_block_file_store(struct bsky_block_file *);
+
+    /**
+     * Number of blocks in store.
+     */
+    size_t bsky_block_file_len(const struct bsky_block_file *);
+
+    /**
+     * Flush, write index and release store. Store is released even if
+     * error is returned.
+     */
+    enum bsky_error_code bsky_block_file_close(struct bsky_block_file *);
+
+
+/*
+ * module:
+ * ===========================================================================
+ *                            MERKLE SEARCH TREE
+ * ===========================================================================
+*/
+    /**
+     * Repository records tree: keys are "<collection>/<rkey>", values are
+     * CIDs of records. Nodes are loaded lazily from block store, so
+     * iteration loads every node once and diff of two roots loads only
+     * nodes which are different (shared subtrees are skipped by CID).
+     *
+     * Node keys order is checked, key layers are not: nodes are trusted to
+     * be built by the rules (check root CID of commit instead).
+     */
+    struct bsky_mst_entry {
+        struct bsky_str key;
+        struct bsky_cid value;
+    };
+
+    /**
+     * In-order iterator.
+     *
+     * Example:
+     *      struct bsky_mst_iter iter = bsky_mst_iter_init(store, root);
+     *      struct bsky_mst_entry entry;
+     *      while (bsky_mst_next(&iter, &entry, &ec)) ...
+     *      bsky_mst_iter_free(&iter);
+     */
+    struct bsky_mst_iter {
+        struct bsky_block_store store;
+        struct bsky_cid root;
+        struct { struct __bsky_mst_frame *data; size_t len, cap; } frames;
+        size_t depth;
+        size_t loaded;               // number of nodes loaded
+    };
+
+    struct bsky_mst_iter bsky_mst_iter_init(struct bsky_block_store,
+                                            struct bsky_cid root);
+
+    /**
+     * Get next entry. Return 1 if there is entry and 0 at the end of tree
+     * or on error. Entry key is valid until next call.
+     */
+    int bsky_mst_next(struct bsky_mst_iter *, struct bsky_mst_entry *,
+                      enum bsky_error_code *);
+
+    void bsky_mst_iter_free(struct bsky_mst_iter *);
+
+    /**
+     * Find value of key, loading only nodes on the path to it. Return 1 if
+     * key is found and 0 otherwise.
+     */
+    int bsky_mst_get(struct bsky_block_store, struct bsky_cid root,
+                     struct bsky_str key, struct bsky_cid *value,
+                     enum bsky_error_code *);
+
+    enum bsky_mst_op_kind { bsky_mst_Create, bsky_mst_Update,
+                            bsky_mst_Delete };
+
+    /**
+     * Difference of the key: `prev' is not set for created keys, `value'
+     * is not set for deleted.
+     */
+    struct bsky_mst_op {
+        enum bsky_mst_op_kind kind;
+        struct bsky_str key;
+        struct bsky_cid prev, value;
+    };
+
+    typedef enum bsky_error_code (*bsky_mst_diff_fn)(
+                                        void *ctx, const struct bsky_mst_op *);
+
+    /**
+     * Call `fn' for every changed key from `from' tree to `to' tree in key
+     * order. Stop and return error if `fn' returns one. `loaded' (may be
+     * NULL) is set to number of nodes loaded from both trees.
+     */
+    enum bsky_error_code bsky_mst_diff(struct bsky_block_store,
+                                       struct bsky_cid from,
+                                       struct bsky_cid to,
+                                       bsky_mst_diff_fn fn, void *ctx,
+                                       size_t *loaded);
+
+    /**
+     * Build tree of entries sorted by key (without duplicates), put its
+     * nodes to store and return root CID.
+     */
+    struct bsky_cid bsky_mst_build(struct bsky_block_store,
+                                   const struct bsky_mst_entry *, size_t len,
+                                   enum bsky_error_code *);
+
+    /**
+     * Layer of the key: number of leading zero bit pairs of its SHA-256.
+     */
+    int bsky_mst_key_layer(struct bsky_str key);
+
+    typedef struct bsky_mst_entry bsky_Mst_Entry;
+
+
+/*
+ * module:
+ * ===========================================================================
+ *                                REPOSITORY
+ * ===========================================================================
+*/
+    #include <pthread.h>
+
+    /**
+     * Signed commit, root block of repository (version 3).
+     */
+    struct bsky_commit {
+        struct bsky_str  did, rev;       // not null terminated
+        struct bsky_cid  data;           // MST root
+        struct bsky_cid  prev;           // codec is 0 if there is no prev
+        struct bsky_view sig;            // start is NULL for unsigned
+        long long version;
+    };
+
+    struct bsky_commit bsky_parse_commit(struct bsky_view,
+                                         enum bsky_error_code *);
+
+    /**
+     * Encode commit. Without `sig' this is the unsigned commit, which is
+     * what signature is computed over.
+     */
+    enum bsky_error_code bsky_cbor_push_commit(struct bsky_bytes *,
+                                               const struct bsky_commit *);
+
+    /**
+     * Backfill: decode every record of every repository export (`.car'
+     * files, as returned by `com.atproto.sync.getRepo') in directory.
+     *
+     * Repositories are spread over worker threads. Every worker has its
+     * own tmp arena (tmp allocations of callback go there too), which is
+     * reset after each repository, and reuses its file buffer and block
+     * map, so memory stays flat however many repositories are processed.
+     *
+     * Record callback is called concurrently from all workers. Error
+     * returned by it stops backfill. Repository which fails to read or
+     * decode is counted in `failed' (and reported to `on_error' if it's
+     * set), records emitted from it before the failure are not revoked.
+     *
+     * Example:
+     *      struct bsky_backfill backfill = { .dir = "repos", .fn = index };
+     *      struct bsky_backfill_stats stats;
+     *      ec = bsky_backfill_run(&backfill, &stats);
+     *      printf("%.0f repos/s\n", stats.repos_per_sec);
+     */
+    #ifndef BSKY_BACKFILL_ARENA_CAPACITY
+        #define BSKY_BACKFILL_ARENA_CAPACITY (0x10 * 0x400 * 0x400)
+    #endif
+
+    struct bsky_backfill_record {
+        struct bsky_str  did;
+        struct bsky_str  collection, rkey;   // not null terminated
+        struct bsky_cid  cid;
+        struct bsky_view block;              // DAG-CBOR record
+        size_t worker;                       // index of calling thread
+    };
+
+    typedef enum bsky_error_code (*bsky_backfill_fn)(
+                                void *ctx, const struct bsky_backfill_record *);
+
+    struct bsky_backfill {
+        const char *dir;
+        size_t threads;                  // 0 for number of CPUs.
+        size_t arena_cap;                // 0 for default capacity.
+        int verify;                      // check blocks against CIDs.
+
+        bsky_backfill_fn fn;
+        void (*on_error)(void *ctx, const char *path, enum bsky_error_code);
+        void *ctx;
+    };
+
+    struct bsky_backfill_stats {
+        size_t repos, failed, records, blocks, bytes;
+        double seconds, repos_per_sec, records_per_sec;
+    };
+
+    /**
+     * Process all `.car' files of directory (in name order of start).
+     * Stats (may be NULL) are filled even if backfill is stopped.
+     */
+    enum bsky_error_code bsky_backfill_run(const struct bsky_backfill *,
+                                           struct bsky_backfill_stats *);
+
+    typedef struct bsky_commit bsky_Commit;
+
+
+/*
+ * module:
+ * ===========================================================================
+ *                                SIGNATURES
+ * ===========================================================================
+*/
+    /**
+     * ECDSA over SHA-256 with AT Protocol keys: secp256k1 ("k256") and
+     * NIST P-256. Public keys are written as multikey, `did:key:z...' (or
+     * just `z...' as in `publicKeyMultibase' of DID document): base58btc
+     * of multicodec and compressed point. Signatures are 64 bytes, r and
+     * s big-endian, and must be low-S: high-S signatures are rejected.
+     *
+     * Key keeps precomputed multiples of its point, which is most of the
+     * work of parsing it, so keys of accounts are parsed once and cached
+     * by DID (`bsky_key_cache'). Batch verification inverts all s values
+     * at once and shares tables of keys and of the base point.
+     *
+     * Verification isn't constant time, it works with public data only.
+     * Multiplications by secrets (public key of secret and nonce of
+     * signing, deterministic as in RFC 6979) use fixed windows, complete
+     * formulas and masked table lookups instead, and nonce state is wiped
+     * after signing.
+     *
+     * Example:
+     *      struct bsky_key_cache cache = { 0 };
+     *      const struct bsky_key *key = bsky_key_cache_get(&cache, did);
+     *      if (key == NULL)
+     *          key = bsky_key_cache_put(&cache, did, did_key, &ec);
+     *      ec = bsky_commit_verify(&commit, key);
+     *      ...
+     *      bsky_key_cache_free(&cache);
+     */
+    #define BSKY_SIG_LEN         64
+    #define BSKY_KEY_SECRET_LEN  32
+    #define BSKY_DID_KEY_STR_LEN 57      // "did:key:z" and 48 chars of base58
+
+    #define BSKY_KEY_TABLE_LEN   8       // odd multiples of point: 1..15
+
+    enum bsky_key_curve {
+        bsky_key_Secp256k1,
+        bsky_key_P256,
+    };
+
+    struct bsky_key {
+        enum bsky_key_curve curve;
+        uint64_t secret[4];              // zero for public keys
+
+        // affine points, internal.
+        uint64_t table[BSKY_KEY_TABLE_LEN][2][4];
+    };
+
+    /**
+     * Parse multikey: `did:key:z...' or `z...'.
+     */
+    struct bsky_key bsky_key_parse_did(struct bsky_str, enum bsky_error_code *);
+
+    /**
+     * Format public key as `did:key' into `buf' (`BSKY_DID_KEY_STR_LEN' + 1
+     * bytes, result is null terminated) and return it.
+     */
+    struct bsky_str bsky_key_format_did(char *buf, const struct bsky_key *);
+
+    /**
+     * Key pair of secret (big-endian scalar).
+     */
+    struct bsky_key
+    bsky_key_of_secret(enum bsky_key_curve,
+                       const unsigned char secret[BSKY_KEY_SECRET_LEN],
+                       enum bsky_error_code *);
+
+    /**
+     * Sign SHA-256 digest into `sig' (`BSKY_SIG_LEN' bytes).
+     */
+    enum bsky_error_code
+    bsky_key_sign(const struct bsky_key *,
+                  const unsigned char digest[BSKY_SHA256_LEN],
+                  unsigned char sig[BSKY_SIG_LEN]);
+
+    /**
+     * Check signature of SHA-256 digest. Return 1 if it's valid and 0
+     * otherwise.
+     */
+    int bsky_key_verify(const struct bsky_key *,
+                        const unsigned char digest[BSKY_SHA256_LEN],
+                        struct bsky_view sig);
+
+    /**
+     * Batch verification: `valid' of every check is set, number of valid
+     * signatures is returned. Keys may be of different curves.
+     *
+     * Example:
+     *      for (...) {
+     *          checks[i].key = key_of(commits[i].did);
+     *          checks[i].sig = commits[i].sig;
+     *          bsky_commit_digest(&commits[i], checks[i].digest);
+     *      }
+     *      if (bsky_sig_verify_batch(checks, len) != len) ...
+     */
+    struct bsky_sig_check {
+        const struct bsky_key *key;
+        unsigned char digest[BSKY_SHA256_LEN];
+        struct bsky_view sig;
+
+        int valid;
+    };
+
+    size_t bsky_sig_verify_batch(struct bsky_sig_check *, size_t len);
+
+    /**
+     * SHA-256 of unsigned commit, what commit signature is over.
+     */
+    enum bsky_error_code bsky_commit_digest(const struct bsky_commit *,
+                                            unsigned char digest[
+                                                BSKY_SHA256_LEN]);
+
+    /**
+     * Sign commit: signature is written to `sig' (`BSKY_SIG_LEN' bytes)
+     * and commit `sig' points to it.
+     */
+    enum bsky_error_code bsky_commit_sign(struct bsky_commit *,
+                                          const struct bsky_key *,
+                                          unsigned char sig[BSKY_SIG_LEN]);
+
+    /**
+     * Return `bsky_ec_Sig_invalid' if commit isn't signed by the key.
+     */
+    enum bsky_error_code bsky_commit_verify(const struct bsky_commit *,
+                                            const struct bsky_key *);
+
+    /**
+     * Keys of accounts by DID. Keys are parsed once and stay at the same
+     * address until cache is freed. When cache holds `BSKY_KEY_CACHE_MAX'
+     * keys it's cleared, so returned keys must not be kept over
+     * `bsky_key_cache_put'.
+     */
+    #ifndef BSKY_KEY_CACHE_MAX
+        #define BSKY_KEY_CACHE_MAX 0x10000       // keys
+    #endif
+
+    struct bsky_key_cache {
+        struct __bsky_key_entry **slots;     // open addressing
+        size_t len, cap;
+
+        size_t hits, misses, clears;
+    };
+
+    /**
+     * Return key of DID or NULL.
+     */
+    const struct bsky_key *bsky_key_cache_get(struct bsky_key_cache *,
+                                              struct bsky_str did);
+
+    /**
+     * Parse multikey and store it as key of DID, replacing previous one
+     * (key rotation). Return stored key or NULL on error.
+     */
+    const struct bsky_key *bsky_key_cache_put(struct bsky_key_cache *,
+                                              struct bsky_str did,
+                                              struct bsky_str did_key,
+                                              enum bsky_error_code *);
+
+    void bsky_key_cache_free(struct bsky_key_cache *);
+
+    typedef struct bsky_key       bsky_Key;
+    typedef struct bsky_key_cache bsky_Key_Cache;
+    typedef struct bsky_sig_check bsky_Sig_Check;
+
+
+/*
+ * module:
+ * ===========================================================================
+ *                                    JSON
+ * ===========================================================================
+*/
+
+	// Just forward declaration :)
+    struct bsky_json_pair;
+
+    /**
+     * `bsky_json' is data structure to represent json format, parse, and
+     * serialize it. It can be static created.
+     *
+     * By default `bsky_json' is not dynamic data structure, cause in primary
+     * use cases it should just serve as help format to create JSON strings or
+     * read data from JSON format.
+     */
+    struct bsky_json {
+        enum {
+            bsky_json_Arr,  // JSON Array
+            bsky_json_Dct,  // JSON Dictionary
+
+            bsky_json_Num,  // JSON Number
+            bsky_json_Str,  // JSON String
+            bsky_json_Bool, // JSON Boolean
+            bsky_json_Null, // JSON NULL
+        } var;
+
+        union {
+            struct { struct bsky_json      *data; size_t len; } arr;
+            struct { struct bsky_json_pair *data; size_t len; } dct;
+            long double num; 
+            char *str;
+            int _bool;
+        };
+    };
+
+    // pair to implement dictionaries.
+    struct bsky_json_pair {
+        char *name; struct bsky_json value;
+    };
+
+    /**
+     * Create temporary string of json. The resulting string would be in
+     * compressed format.
+     */
+    struct bsky_str bsky_tmp_str_of_json(struct bsky_json);
+
+    /**
+     * Push JSON string to string builder.
+     */
+    void bsky_sb_push_json(struct bsky_str_builder *, struct bsky_json);
+
+
+    /**
+     * Parse JSON value. Parser doesn't recurse: nesting deeper than
+     * `BSKY_JSON_MAX_DEPTH' arrays and dictionaries is rejected with
+     * `bsky_ec_Json_too_deep' instead of exhausting native stack.
+     */
+    #ifndef BSKY_JSON_MAX_DEPTH
+        #define BSKY_JSON_MAX_DEPTH 1024
+    #endif
+
+    struct bsky_json bsky_parse_json(struct bsky_str*, enum bsky_error_code*); 
+
+    struct bsky_json bsky_parse_json_arr(struct bsky_str*,
+                                         enum bsky_error_code*);
+    struct bsky_json bsky_parse_json_dct(struct bsky_str*,
+                                         enum bsky_error_code*);
+    struct bsky_json bsky_parse_json_str(struct bsky_str*,
+                                         enum bsky_error_code*);
+    struct bsky_json bsky_parse_json_num(struct bsky_str*,
+                                         enum bsky_error_code*);
+    struct bsky_json bsky_parse_json_null(struct bsky_str*,
+                                          enum bsky_error_code*);
+    struct bsky_json bsky_parse_json_bool(struct bsky_str*,
+                                          enum bsky_error_code*);
+
+    /**
+     * Parse many small documents (e.g. records of feed generator input) at
+     * once. All trees go to one arena region sized by total input, which is
+     * reset by the next parse: no per document bookkeeping and no frees.
+     * Region grows (and batch is parsed again) if it turns out too small,
+     * so after first batches it fits typical input.
+     *
+     * With `threads' > 1 documents are split between threads by bytes,
+     * every thread gets its own part of the region.
+     *
+     * Example:
+     *      struct bsky_json_batch batch = { .threads = 4 };
+     *      ec = bsky_json_batch_parse(&batch, records, len);
+     *      for (size_t i = 0; i < batch.len; ++i)
+     *          if (batch.ecs[i] == bsky_ec_Ok) index(batch.docs[i]);
+     *      ...
+     *      bsky_json_batch_free(&batch);
+     */
+    #ifndef BSKY_JSON_BATCH_RATIO
+        #define BSKY_JSON_BATCH_RATIO 4      // region bytes per input byte
+    #endif
+
+    struct bsky_json_batch {
+        size_t threads;                      // 0 and 1: calling thread
+
+        struct bsky_json *docs;              // results of the last parse
+        enum bsky_error_code *ecs;
+        size_t len, cap;
+
+        struct bsky_arena arena;
+        size_t ratio;
+        struct __bsky_json_batch_worker *workers;
+        size_t workers_len;
+    };
+
+    /**
+     * Parse `len' documents into `docs' and `ecs' of batch. Trees of the
+     * previous parse are released. Return `bsky_ec_Ok' if all documents
+     * are parsed and the first error otherwise.
+     */
+    enum bsky_error_code bsky_json_batch_parse(struct bsky_json_batch *,
+                                               const struct bsky_str *docs,
+                                               size_t len);
+
+    void bsky_json_batch_free(struct bsky_json_batch *);
+
+    /**
+     * Find value by key in JSON dictionary. Return NULL if json is not
+     * dictionary or there is no such key.
+     */
+    struct bsky_json *bsky_json_dct_get(struct bsky_json, char *key);
+
+    /**
+     * Compact JSON tree: 16 bytes per node instead of 32 bytes of
+     * `bsky_json' (48 of `bsky_json_pair'), so more of tree fits in cache
+     * during traversal. Nodes are in tmp arena: elements of container are
+     * contiguous and found by byte offset relative to container node
+     * itself, dictionary elements are key (string node) and value nodes.
+     * Numbers are `double'.
+     *
+     * `var' is one of `bsky_json' variants (`bsky_json_Arr', ...).
+     *
+     * Example:
+     *      struct bsky_json_node *root = bsky_parse_json_compact(&body, &ec);
+     *      struct bsky_json_node *feed = bsky_json_node_get(root, "feed");
+     *
+     *      for (size_t i = 0; feed != NULL && i < feed->len; ++i)
+     *          handle(bsky_json_node_at(feed, i));
+     */
+    struct bsky_json_node {
+        uint32_t var;
+        uint32_t len;                        // elements, pairs or bytes
+
+        union {
+            int64_t off;                     // bytes to first element
+            double  num;
+            char   *str;
+            int     _bool;
+        };
+    };
+
+    /**
+     * Parse JSON document into compact tree, return its root or NULL on
+     * error. Errors are the same as of `bsky_parse_json'.
+     */
+    struct bsky_json_node *bsky_parse_json_compact(struct bsky_str *,
+                                                   enum bsky_error_code *);
+
+    /**
+     * Element `i' of array or value of pair `i' of dictionary. Return NULL
+     * if node is not container or `i' is out of range.
+     */
+    struct bsky_json_node *bsky_json_node_at(struct bsky_json_node *,
+                                             size_t i);
+
+    /**
+     * Key of pair `i' of dictionary or NULL.
+     */
+    char *bsky_json_node_key(struct bsky_json_node *, size_t i);
+
+    /**
+     * Find value by key in dictionary, see `bsky_json_dct_get'.
+     */
+    struct bsky_json_node *bsky_json_node_get(struct bsky_json_node *,
+                                              char *key);
+
+    /**
+     * Convert compact subtree into `bsky_json' tree allocated in tmp arena
+     * (strings are shared), e.g. to serialize it.
+     */
+    struct bsky_json bsky_json_of_node(struct bsky_json_node *,
+                                       enum bsky_error_code *);
+
+    /**
+     * Find value of top level dictionary field without parsing whole
+     * document: nested values are just skipped. Escaped keys are decoded
+     * before comparison. Strings are returned without quotes and escapes
+     * are kept as is; other values are returned as raw text. Return
+     * string with NULL start if there is no such field.
+     *
+     * NOTE: returned string is a slice, it is not null terminated.
+     */
+    struct bsky_str bsky_json_scan_field(struct bsky_str, char *key);
+
+    /**
+     * Path query over raw JSON: compiled once, then matched against
+     * documents without building `bsky_json' nodes, subtrees which are not
+     * on the path are skipped.
+     *
+     * Path is JSON Pointer (RFC 6901): segments after `/' are dictionary
+     * keys (`~0' is `~' and `~1' is `/'), or array indexes, plus `*'
+     * segment which matches every array element or dictionary value. Empty
+     * path matches whole document.
+     *
+     * Matches are returned as `bsky_json_scan_field' returns them: slices
+     * of document, strings without quotes and with escapes as is (for them
+     * `start[-1]' is '"'), other values as raw text.
+     *
+     * Example:
+     *      struct bsky_json_path path = bsky_json_path_compile(
+     *          "/feed/" "*" "/post/record/text", &ec);
+     *      struct bsky_str texts[100];
+     *      size_t len = bsky_json_path_query(&path, body, texts, 100, &ec);
+     */
+    #ifndef BSKY_JSON_PATH_MAX
+        #define BSKY_JSON_PATH_MAX 16                // segments
+    #endif
+
+    struct bsky_json_path {
+        struct bsky_json_path_step {
+            enum { bsky_json_path_Key, bsky_json_path_Any } kind;
+            size_t index;                    // SIZE_MAX if key isn't index
+            unsigned short key, key_len;     // decoded key in `keys'
+        } steps[BSKY_JSON_PATH_MAX];
+        size_t len;
+
+        char keys[256];
+    };
+
+    struct bsky_json_path bsky_json_path_compile(const char *path,
+                                                 enum bsky_error_code *);
+
+    /**
+     * Find matches in document order and write up to `cap' of them to
+     * `out'. Return number of written matches, matching stops when `out'
+     * is full. Malformed document is reported only on the path.
+     */
+    size_t bsky_json_path_query(const struct bsky_json_path *,
+                                struct bsky_str json, struct bsky_str *out,
+                                size_t cap, enum bsky_error_code *);
+
+    /**
+     * First match or string with NULL start.
+     */
+    struct bsky_str bsky_json_path_first(const struct bsky_json_path *,
+                                         struct bsky_str json);
+
+
+    typedef struct bsky_json      bsky_Json;
+    typedef struct bsky_json_pair bsky_Json_Pair;
+    typedef struct bsky_json_node bsky_Json_Node;
+    typedef struct bsky_json_doc  bsky_Json_Doc;
+    typedef struct bsky_json_edit bsky_Json_Edit;
+
+    // helper functions.
+    struct bsky_json_da      { struct bsky_json      *data; size_t len, cap; };
+    struct bsky_json_pair_da { struct bsky_json_pair *data; size_t len, cap; };
+
+    /**
+     * Editable JSON document: original text plus edits made by path (see
+     * `bsky_json_path', `*' is not allowed). Serialization copies text
+     * outside of edits as is and renders only new values, so record with
+     * couple of changed fields is re-emitted with its formatting, key
+     * order and number spelling intact. Dictionaries and arrays which got
+     * or lost members are rendered without whitespace between members.
+     *
+     * Edits refer to original text and to values which must outlive the
+     * document (usually both are in tmp arena). Edits inside of replaced
+     * values fail with `bsky_ec_Json_edit_conflict', edits inside of
+     * removed ones have no effect.
+     *
+     * Example:
+     *      struct bsky_json_doc doc = { .text = record };
+     *      struct bsky_json hidden = { .var = bsky_json_Str, .str = "..." };
+     *
+     *      ec = bsky_json_doc_set(&doc, "/text", hidden);
+     *      ec = bsky_json_doc_remove(&doc, "/embed");
+     *      bsky_sb_push_json_doc(&sb, &doc);
+     *      bsky_json_doc_free(&doc);
+     */
+    struct bsky_json_edit {
+        char *start, *end;                   // span of original text
+
+        struct bsky_json value;              // replaces the span
+
+        // or edit of container: its members (removed ones have NULL
+        // start) and added ones, dictionary keys are not escaped.
+        struct bsky_str *members;
+        size_t members_len;
+        struct bsky_json_pair_da added;
+    };
+
+    struct bsky_json_doc {
+        struct bsky_str text;
+
+        struct {
+            struct bsky_json_edit *data; size_t len, cap;
+        } edits;                             // sorted by start
+    };
+
+    /**
+     * Replace value at path or add it: missing key of dictionary is added
+     * to its end, `-' key of array (as in JSON Patch) appends element.
+     */
+    enum bsky_error_code bsky_json_doc_set(struct bsky_json_doc *,
+                                           const char *path,
+                                           struct bsky_json value);
+
+    /**
+     * Remove dictionary member or array element at path.
+     */
+    enum bsky_error_code bsky_json_doc_remove(struct bsky_json_doc *,
+                                              const char *path);
+
+    /**
+     * Push edited document to string builder.
+     */
+    void bsky_sb_push_json_doc(struct bsky_str_builder *,
+                               const struct bsky_json_doc *);
+
+    void bsky_json_doc_free(struct bsky_json_doc *);
+
+    /**
+     * Canonical encodings of JSON tree, e.g. of record which is signed or
+     * whose CID is computed: DAG-CBOR (`bsky_cbor_push_json') and JSON
+     * without whitespace (`bsky_sb_push_json_canonical'). Dictionary keys
+     * are sorted: shorter first, then bytewise for DAG-CBOR and bytewise
+     * for JSON.
+     *
+     * Records of one lexicon mostly have the same keys in the same order,
+     * so sorted order of every shape (sequence of keys) is cached and then
+     * dictionary of known shape is only compared with it. Cache is
+     * optional (NULL) and is for one thread.
+     *
+     * DAG-CBOR follows AT Protocol data model: `{"$link": cid}' is link,
+     * `{"$bytes": base64}' is byte string and numbers are 64-bit signed
+     * integers (model has no floats). Duplicate keys, other numbers and
+     * bad `$bytes' fail with `bsky_ec_Json_not_canonical'.
+     *
+     * Example:
+     *      struct bsky_json_key_cache cache = { 0 };
+     *
+     *      for (...) {
+     *          buf.len = 0;
+     *          ec = bsky_cbor_push_json(&buf, record, &cache);
+     *          block = (struct bsky_view) { buf.data, buf.data + buf.len };
+     *          cid = bsky_cid_of_block(bsky_cid_Dag_cbor, block);
+     *      }
+     *      bsky_json_key_cache_free(&cache);
+     */
+    #ifndef BSKY_JSON_KEY_CACHE_MAX
+        #define BSKY_JSON_KEY_CACHE_MAX 0x400        // shapes
+    #endif
+
+    typedef struct bsky_json_key_cache bsky_Json_Key_Cache;
+
+    struct bsky_json_key_cache {
+        struct __bsky_json_shape *slots;     // open addressing
+        size_t len, cap;
+
+        size_t hits, misses;
+    };
+
+    enum bsky_error_code bsky_cbor_push_json(struct bsky_bytes *,
+                                             struct bsky_json,
+                                             struct bsky_json_key_cache *);
+
+    enum bsky_error_code
+    bsky_sb_push_json_canonical(struct bsky_str_builder *, struct bsky_json,
+                                struct bsky_json_key_cache *);
+
+    void bsky_json_key_cache_free(struct bsky_json_key_cache *);
+
+
+/*
+ * module:
+ * ===========================================================================
+ *                                    XRPC
+ * ===========================================================================
+*/
+    /**
+     * Library doesnot perform network requests by itself. Every XRPC call
+     * goes through transport callback provided by user (libcurl, own
+     * sockets, mock in tests, a.t.c.), so `bsky_xrpc_client' only builds
+     * requests and interprets responses.
+     */
+    enum bsky_xrpc_method { bsky_xrpc_Get, bsky_xrpc_Post };
+
+    /**
+     * Query parameter. Repeated names are allowed (e.g. `actors').
+     */
+    struct bsky_xrpc_param { char *name; struct bsky_str value; };
+
+    struct bsky_xrpc_request {
+        enum bsky_xrpc_method method;
+        char *host;                      // e.g. "public.api.bsky.app"
+        char *nsid;                      // e.g. "app.bsky.actor.getProfiles"
+
+        struct bsky_xrpc_param *params; size_t params_len;
+
+        struct bsky_str body;            // only for `bsky_xrpc_Post'
+        char *auth;                      // bearer token or NULL
+    };
+
+    /**
+     * Response filled by transport. `headers' are raw "name: value" lines
+     * separated by "\r\n" or "\n". Transport should allocate `body' and
+     * `headers' in tmp arena.
+     */
+    struct bsky_xrpc_response {
+        int status;
+        struct bsky_str headers;
+        struct bsky_str body;
+    };
+
+    /**
+     * Transport callback. Must return `bsky_ec_Ok' if request was
+     * delivered (whatever http status is) and `bsky_ec_Xrpc_transport'
+     * otherwise.
+     *
+     * NOTE: transport must be thread safe: it's called concurrently by
+     *       paginator prefetch, session calls from several threads, etc.
+     *       Response body and headers are allocated by the calling thread
+     *       (`bsky_tmp_alloc' is per thread).
+     */
+    typedef enum bsky_error_code (*bsky_xrpc_transport)(
+                                        void *ctx,
+                                        const struct bsky_xrpc_request *,
+                                        struct bsky_xrpc_response *);
+
+    struct bsky_rate_limiter;
+
+    struct bsky_xrpc_client {
+        bsky_xrpc_transport transport;
+        void *ctx;
+        char *host;                      // default host for requests.
+
+        struct bsky_rate_limiter *limiter; // NULL to send without pacing.
+    };
+
+    /**
+     * Perform request through client transport. Fill request host with
+     * client default if it's NULL. Return `bsky_ec_Xrpc_status' if
+     * response status is not 2xx.
+     */
+    enum bsky_error_code bsky_xrpc_call(struct bsky_xrpc_client *,
+                                        struct bsky_xrpc_request *,
+                                        struct bsky_xrpc_response *);
+
+    /**
+     * Push request path with url encoded query to string builder:
+     *      /xrpc/<nsid>?name=value&name=value
+     */
+    void bsky_sb_push_xrpc_path(struct bsky_str_builder *,
+                                const struct bsky_xrpc_request *);
+
+    /**
+     * Push url encoded (RFC 3986 unreserved set kept as is) string.
+     */
+    void bsky_sb_push_urlencoded(struct bsky_str_builder *, struct bsky_str);
+
+    /**
+     * Find response header value (name is case insensitive). Return string
+     * with NULL start if there is no such header.
+     *
+     * NOTE: returned string is a slice, it is not null terminated.
+     */
+    struct bsky_str bsky_xrpc_header(struct bsky_xrpc_response, char *name);
+
+
+/*
+ * module:
+ * ===========================================================================
+ *                                 HYDRATION
+ * ===========================================================================
+*/
+    /**
+     * Hydrator collects single profile/post lookups, coalesce duplicates
+     * and resolve them with batched `app.bsky.actor.getProfiles' and
+     * `app.bsky.feed.getPosts' calls (up to `BSKY_HYDRATE_BATCH_MAX'
+     * identifiers per call).
+     *
+     * Lookups are collected between `bsky_hydrate_request' and
+     * `bsky_hydrate_flush' (the window), a full batch is sent right away.
+     * Results are parsed into tmp arena, so don't reset it while using
+     * results.
+     *
+     * Example:
+     *      size_t a = bsky_hydrate_request(&h, bsky_hydrate_Profile, did_a);
+     *      size_t b = bsky_hydrate_request(&h, bsky_hydrate_Profile, did_b);
+     *      bsky_hydrate_flush(&h);                  // one getProfiles call
+     *      struct bsky_json *profile = bsky_hydrate_get(&h, a, &ec);
+     */
+    #ifndef BSKY_HYDRATE_BATCH_MAX
+        #define BSKY_HYDRATE_BATCH_MAX 25
+    #endif
+
+    enum bsky_hydrate_kind {
+        bsky_hydrate_Profile,  // actor (did or handle) -> profileViewDetailed
+        bsky_hydrate_Post,     // at-uri -> postView
+    };
+
+    struct bsky_hydrate_slot {
+        enum bsky_hydrate_kind kind;
+        struct bsky_str id;
+        unsigned long long hash;
+
+        int done;
+        enum bsky_error_code ec;
+        struct bsky_json *value;         // NULL if not found.
+    };
+
+    struct bsky_hydrate_slot_da {
+        struct bsky_hydrate_slot *data; size_t len, cap;
+    };
+
+    struct bsky_hydrator {
+        struct bsky_xrpc_client *client;
+
+        struct bsky_hydrate_slot_da slots;
+        size_t *index; size_t index_cap; // open addressing, slot idx + 1.
+
+        size_t pending[2];               // not sent lookups per kind.
+        size_t scan[2];                  // first slot may be pending.
+
+        // statistics.
+        size_t lookups, coalesced, calls;
+    };
+
+    /**
+     * Register lookup and return its slot. Duplicated lookups share slot.
+     * If memory is exhausted, lookup fails with `bsky_ec_Tmp_overflow'
+     * (slot may be `BSKY_HYDRATE_NO_SLOT', `bsky_hydrate_get' accepts it).
+     */
+    #define BSKY_HYDRATE_NO_SLOT ((size_t) -1)
+
+    size_t bsky_hydrate_request(struct bsky_hydrator *,
+                                enum bsky_hydrate_kind, struct bsky_str id);
+
+    /**
+     * Send all pending lookups in batches.
+     */
+    enum bsky_error_code bsky_hydrate_flush(struct bsky_hydrator *);
+
+    /**
+     * Get result of lookup (flush if it's still pending). Return NULL if
+     * server doesn't know such actor/post, or batch failed (see `ec').
+     */
+    struct bsky_json *bsky_hydrate_get(struct bsky_hydrator *, size_t slot,
+                                       enum bsky_error_code *ec);
+
+    /**
+     * Forget all lookups and free hydrator memory.
+     */
+    void bsky_hydrator_free(struct bsky_hydrator *);
+
+
+/*
+ * module:
+ * ===========================================================================
+ *                                 XRPC CACHE
+ * ===========================================================================
+*/
+    /**
+     * In-process cache of XRPC GET responses. Entries are keyed by
+     * canonical request string (host, nsid and query parameters sorted by
+     * name and value), so parameters order doesn't matter.
+     *
+     * Cache holds at most `capacity' bytes of keys and bodies, least
+     * recently used entries are evicted first. Entries older than `ttl_ms'
+     * are treated as misses. Every entry is one heap block (key and body),
+     * there is no preallocated pool: `capacity' bounds the sum of blocks,
+     * index and entry table take some more. If memory is exhausted,
+     * response is just not cached. Create it with designated initializer:
+     *
+     *      struct bsky_xrpc_cache cache = {
+     *          .capacity = 0x400 * 0x400, .ttl_ms = 60 * 1000,
+     *      };
+     *      ...
+     *      bsky_xrpc_cached_call(&cache, &client, &req, &res);
+     *      ...
+     *      bsky_xrpc_cache_free(&cache);
+     */
+    struct bsky_xrpc_cache_entry {
+        unsigned long long hash;
+        struct bsky_str key, body;    // both in one block owned by key.
+        long long expires;
+
+        size_t prev, next;            // LRU list (entry idx + 1).
+        size_t chain;                 // bucket chain or free list.
+    };
+
+    struct bsky_xrpc_cache_entry_da {
+        struct bsky_xrpc_cache_entry *data; size_t len, cap;
+    };
+
+    struct bsky_xrpc_cache {
+        size_t    capacity;           // bytes.
+        long long ttl_ms;
+
+        long long (*now_ms)(void);    // NULL for `bsky_clock_ms'.
+
+        struct bsky_xrpc_cache_entry_da entries;
+        size_t *buckets; size_t buckets_cap;
+        size_t head, tail, free;      // entry idx + 1.
+        size_t count, used;
+
+        // statistics.
+        size_t hits, misses, evictions, expired;
+    };
+
+    /**
+     * Monotonic clock in milliseconds.
+     */
+    long long bsky_clock_ms(void);
+
+    /**
+     * Same as `bsky_xrpc_call', but successful GET responses are served
+     * from/stored to cache. Cached body is copied to tmp arena, response
+     * `headers' are empty for cache hits.
+     */
+    enum bsky_error_code bsky_xrpc_cached_call(struct bsky_xrpc_cache *,
+                                               struct bsky_xrpc_client *,
+                                               struct bsky_xrpc_request *,
+                                               struct bsky_xrpc_response *);
+
+    /**
+     * Push canonical cache key of request to string builder. Return
+     * `bsky_ec_Tmp_overflow' if tmp arena is exhausted.
+     */
+    enum bsky_error_code
+    bsky_sb_push_xrpc_cache_key(struct bsky_str_builder *,
+                                const struct bsky_xrpc_request *);
+
+    /**
+     * Drop all entries (statistics are kept).
+     */
+    void bsky_xrpc_cache_clear(struct bsky_xrpc_cache *);
+
+    /**
+     * Drop all entries and free cache memory.
+     */
+    void bsky_xrpc_cache_free(struct bsky_xrpc_cache *);
+
+
+/*
+ * module:
+ * ===========================================================================
+ *                                 PAGINATOR
+ * ===========================================================================
+*/
+    /**
+     * Walk listing endpoints (`getAuthorFeed', `getFollowers',
+     * `listRecords', etc.) page by page following `cursor' field.
+     *
+     * As soon as page is returned, request of the next page is sent from
+     * background thread, so round trip overlaps with processing of the
+     * current page.
+     *
+     * Every page lives in its own arena, paginator uses only two of them
+     * in turn, and the arena is released by the next `bsky_paginator_next'
+     * call. Tmp arena of the calling thread is left as it was; to parse
+     * into the page arena redirect it with `bsky_tmp_use_arena' around the
+     * parsing, then memory stays flat however many pages are walked. Copy
+     * what you need to keep.
+     *
+     * NOTE: transport must allocate response body with `bsky_tmp_alloc'
+     *       and be thread safe: next page is requested while the caller
+     *       may send its own requests through the same client.
+     *
+     * Example:
+     *      struct bsky_paginator p = { .client = &client, .req = req };
+     *      while (bsky_paginator_next(&p, &page, &ec)) {
+     *          struct bsky_arena *prev =
+     *              bsky_tmp_use_arena(bsky_paginator_arena(&p));
+     *          struct bsky_json json = bsky_parse_json(&page, &ec);
+     *          ...
+     *          bsky_tmp_use_arena(prev);
+     *      }
+     *      bsky_paginator_free(&p);
+     */
+    #ifndef BSKY_PAGINATOR_ARENA_CAPACITY
+        #define BSKY_PAGINATOR_ARENA_CAPACITY (0x4 * 0x400 * 0x400)
+    #endif
+
+    struct bsky_paginator {
+        struct bsky_xrpc_client  *client;
+        struct bsky_xrpc_request  req;      // request of the first page.
+        size_t arena_cap;                   // 0 for default capacity.
+
+        struct bsky_arena arenas[2];
+        int cur, target;                    // arena of current/next page.
+        int started, fetching;
+
+        pthread_t worker;
+        struct bsky_xrpc_param   *params;   // `req' params and cursor.
+        struct bsky_xrpc_request  next_req;
+        struct bsky_xrpc_response next_res;
+        enum bsky_error_code      next_ec;
+
+        size_t pages;
+    };
+
+    /**
+     * Get next page body. Return 0 when there are no more pages or
+     * request failed (see `ec').
+     */
+    int bsky_paginator_next(struct bsky_paginator *, struct bsky_str *page,
+                            enum bsky_error_code *ec);
+
+    /**
+     * Arena of the current page, valid until the next call.
+     */
+    struct bsky_arena *bsky_paginator_arena(struct bsky_paginator *);
+
+    /**
+     * Wait for request in flight and free paginator memory.
+     */
+    void bsky_paginator_free(struct bsky_paginator *);
+
+
+/*
+ * module:
+ * ===========================================================================
+ *                               RATE LIMITER
+ * ===========================================================================
+*/
+    #include <stdatomic.h>
+
+    /**
+     * Client side scheduler for PDS/AppView rate limits. Set it as
+     * `limiter' of `bsky_xrpc_client' and every call will:
+     *      0. reserve token in bucket of request host, sleeping until
+     *         window reset if there are no tokens left;
+     *      1. update bucket from `ratelimit-limit', `ratelimit-remaining',
+     *         `ratelimit-reset' and `ratelimit-policy' response headers;
+     *      2. retry `429' responses up to `max_retries' times, waiting
+     *         `Retry-After' seconds or, when server gives no reset time,
+     *         with exponential backoff from `BSKY_RATE_RETRY_MIN_MS' to
+     *         `BSKY_RATE_RETRY_MAX_MS'.
+     *
+     * With `pace' set, remaining tokens are spread evenly until window
+     * reset instead of being spent in a burst.
+     *
+     * Concurrent callers reserve consecutive slots, so they are queued
+     * rather than racing for the last token. Hosts without rate limit
+     * headers are not limited.
+     *
+     * Limiter can be created with designated initializer and must be
+     * freed with `bsky_rate_limiter_free'.
+     */
+    #ifndef BSKY_RATE_RETRY_MIN_MS
+        #define BSKY_RATE_RETRY_MIN_MS 1000
+    #endif
+    #ifndef BSKY_RATE_RETRY_MAX_MS
+        #define BSKY_RATE_RETRY_MAX_MS (60 * 1000)
+    #endif
+
+    struct bsky_rate_bucket {
+        char *host;
+
+        int       known;               // headers have been seen.
+        double    limit, tokens;
+        long long reset_ms, window_ms; // unix time / duration.
+        long long next_ms;             // next paced slot.
+        size_t    in_flight;           // reserved, response not seen yet.
+        long long retry_ms;            // unix time to wait for after 429.
+        long long backoff_ms;          // last wait without reset time.
+    };
+
+    struct bsky_rate_bucket_da {
+        struct bsky_rate_bucket *data; size_t len, cap;
+    };
+
+    struct bsky_rate_limiter {
+        int pace;
+        int max_retries;
+
+        long long (*now_ms)(void);      // unix time, NULL for system clock.
+        void      (*sleep_ms)(long long); // NULL for `nanosleep'.
+
+        _Atomic int lock;               // spin lock, nothing blocks in it.
+        struct bsky_rate_bucket_da buckets;
+
+        // statistics.
+        size_t waits, throttled;
+        long long waited_ms;
+    };
+
+    /**
+     * Reserve token for request to host and wait for it.
+     */
+    void bsky_rate_acquire(struct bsky_rate_limiter *, char *host);
+
+    /**
+     * Update host bucket from response headers and release reservation of
+     * `bsky_rate_acquire' (call it with empty response if request has
+     * failed). Requests still in flight are subtracted from
+     * `ratelimit-remaining'.
+     */
+    void bsky_rate_update(struct bsky_rate_limiter *, char *host,
+                          struct bsky_xrpc_response);
+
+    void bsky_rate_limiter_free(struct bsky_rate_limiter *);
+
+
+/*
+ * module:
+ * ===========================================================================
+ *                                  SESSION
+ * ===========================================================================
+*/
+    /**
+     * Session tokens from `com.atproto.server.createSession' and
+     * `com.atproto.server.refreshSession'. Tokens are immutable snapshot,
+     * new one is published on every refresh.
+     */
+    struct bsky_session_tokens {
+        char *access_jwt, *refresh_jwt, *did, *handle;
+        long long expires_ms;          // unix time of access token `exp',
+                                       // LLONG_MAX if it has none.
+        size_t generation;
+
+        struct bsky_session_tokens *retired; // older snapshots.
+    };
+
+    /**
+     * Session shared by many threads. Readers get access token with single
+     * atomic load (no locks); when token is about to expire, exactly one
+     * caller refreshes it and publishes new snapshot, others keep using
+     * old token while it's still valid or wait for new one otherwise.
+     *
+     * Old snapshots are retired, not freed, since readers may still hold
+     * their tokens. Only `BSKY_SESSION_RETIRED_MAX' latest of them are
+     * kept, older are freed on refresh: token is replaced only when it is
+     * about to expire, so it is long unusable by then.
+     *
+     * Failed refresh is not repeated until backoff deadline (doubled on
+     * every failure, from `BSKY_SESSION_RETRY_MIN_MS' up to
+     * `BSKY_SESSION_RETRY_MAX_MS'); meanwhile callers get old token while
+     * it's valid or error of the last refresh.
+     *
+     * Example:
+     *      struct bsky_session session = {
+     *          .client = &client,
+     *          .identifier = "alice.bsky.social", .password = "app-pass",
+     *      };
+     *      ec = bsky_session_login(&session);
+     *      ...
+     *      ec = bsky_session_call(&session, &req, &res); // from any thread
+     *      ...
+     *      bsky_session_free(&session);
+     */
+    #ifndef BSKY_SESSION_REFRESH_MARGIN_MS
+        #define BSKY_SESSION_REFRESH_MARGIN_MS (60 * 1000)
+    #endif
+    #ifndef BSKY_SESSION_ARENA_CAPACITY
+        #define BSKY_SESSION_ARENA_CAPACITY (0x40 * 0x400)
+    #endif
+    #ifndef BSKY_SESSION_RETIRED_MAX
+        #define BSKY_SESSION_RETIRED_MAX 4
+    #endif
+    #ifndef BSKY_SESSION_RETRY_MIN_MS
+        #define BSKY_SESSION_RETRY_MIN_MS 1000
+    #endif
+    #ifndef BSKY_SESSION_RETRY_MAX_MS
+        #define BSKY_SESSION_RETRY_MAX_MS (60 * 1000)
+    #endif
+
+    struct bsky_session {
+        struct bsky_xrpc_client *client;
+        char *identifier, *password;
+
+        long long (*now_ms)(void);     // unix time, NULL for system clock.
+
+        _Atomic (struct bsky_session_tokens *) tokens;
+        _Atomic int refreshing;
+        _Atomic int refresh_ec;        // error of the last refresh.
+        _Atomic long long retry_ms;    // no refresh before, after failure.
+        int failures;                  // in a row, owned by refresher.
+
+        // statistics.
+        _Atomic size_t refreshes;
+    };
+
+    /**
+     * Create session with `identifier' and `password'.
+     */
+    enum bsky_error_code bsky_session_login(struct bsky_session *);
+
+    /**
+     * Get valid access token, refresh it if needed. Returned token is
+     * valid until it's replaced `BSKY_SESSION_RETIRED_MAX' times.
+     */
+    char *bsky_session_token(struct bsky_session *, enum bsky_error_code *);
+
+    /**
+     * Perform `bsky_xrpc_call' with session access token.
+     */
+    enum bsky_error_code bsky_session_call(struct bsky_session *,
+                                           struct bsky_xrpc_request *,
+                                           struct bsky_xrpc_response *);
+
+    void bsky_session_free(struct bsky_session *);
+
+
+/*
+ * module:
+ * ===========================================================================
+ *                              INSTRUMENTATION
+ * ===========================================================================
+*/
+    /**
+     * Hot-path counters and timing probes. Predefine `BSKY_INSTRUMENT' to
+     * enable them, otherwise probe macros expand to nothing and cost
+     * nothing.
+     *
+     * Every thread records into its own counters (no shared cache lines,
+     * no locked instructions), `bsky_probe_snapshot' sums all threads.
+     *
+     * Time is measured in ticks: TSC cycles on x86, nanoseconds of
+     * monotonic clock otherwise (see "unit" field of snapshot). Durations
+     * are also collected in log2 histogram: bucket `i' counts probes with
+     * duration in [2^(i-1), 2^i) ticks.
+     *
+     * Recursive probes (`bsky_sb_push_json') are recorded once for the
+     * outermost call.
+     */
+    #ifndef BSKY_PROBE_BUCKETS
+        #define BSKY_PROBE_BUCKETS 32
+    #endif
+
+    enum bsky_probe_kind {
+        bsky_probe_Parse_json,     // bytes: consumed input.
+        bsky_probe_Sb_push_json,   // bytes: produced output.
+        bsky_probe_Da_realloc,     // bytes: new capacity.
+        bsky_probe_Tmp_alloc,      // bytes: requested size.
+        bsky_probe_Tmp_overflow,   // bytes: requested size.
+
+        bsky_probe_Count,
+    };
+
+    /**
+     * Record probe manually. Used by probe macros.
+     */
+    void __bsky_probe_record(enum bsky_probe_kind, unsigned long long ticks,
+                             size_t bytes);
+
+    #ifdef BSKY_INSTRUMENT
+        #if defined(__x86_64__) || defined(__i386__)
+            #include <x86intrin.h>
+            #define __bsky_probe_now() ((unsigned long long) __rdtsc())
+            #define BSKY_PROBE_UNIT "cycles"
+        #else
+            unsigned long long __bsky_probe_clock_ns(void);
+            #define __bsky_probe_now() __bsky_probe_clock_ns()
+            #define BSKY_PROBE_UNIT "ns"
+        #endif
+
+        extern _Thread_local int __bsky_probe_depth[bsky_probe_Count];
+
+        /**
+         * Start probe `kind' in current scope. `mark' is integer (e.g.
+         * length or pointer), difference between marks of `BSKY_PROBE_END'
+         * and `BSKY_PROBE_BEGIN' is recorded as bytes.
+         */
+        #define BSKY_PROBE_BEGIN(kind, mark)                                 \
+            size_t __bsky_probe_mark_##kind = (size_t) (mark);               \
+            unsigned long long __bsky_probe_start_##kind =                   \
+                (__bsky_probe_depth[kind]++, __bsky_probe_now())
+
+        #define BSKY_PROBE_END(kind, mark)                                   \
+            do {                                                             \
+                if (--__bsky_probe_depth[kind] == 0)                         \
+                    __bsky_probe_record(kind,                                \
+                        __bsky_probe_now() - __bsky_probe_start_##kind,      \
+                        (size_t) (mark) - __bsky_probe_mark_##kind);         \
+            } while (0)
+
+        /**
+         * Count event without timing.
+         */
+        #define BSKY_PROBE_COUNT(kind, bytes) \
+            __bsky_probe_record(kind, 0, bytes)
+    #else
+        #define BSKY_PROBE_UNIT "none"
+
+        #define BSKY_PROBE_BEGIN(kind, mark)  ((void) 0)
+        #define BSKY_PROBE_END(kind, mark)    ((void) 0)
+        #define BSKY_PROBE_COUNT(kind, bytes) ((void) 0)
+    #endif
+
+    /**
+     * Return name of probe, e.g. "parse_json".
+     */
+    const char *bsky_str_of_probe_kind(enum bsky_probe_kind);
+
+    /**
+     * Snapshot of all probes summed over threads as JSON dictionary in tmp
+     * arena:
+     *      {"enabled":true,"unit":"cycles","threads":2,
+     *       "parse_json":{"count":..,"ticks":..,"bytes":..,"hist":[..]},
+     *       ...}
+     * Return `null' json if tmp arena overflows.
+     */
+    struct bsky_json bsky_probe_snapshot(void);
+
+    /**
+     * Zero counters of all threads. Should not race with recording threads
+     * if exact values are needed.
+     */
+    void bsky_probe_reset(void);
+
+
+/*
+ * ============================================================================
+ *                             IMPLEMENTATION
+ * ===========================================================================
+ *
+ * To enable implementation predefine `BSKY_API_IMPLEMENTATION' macro.
+ */
+#ifdef BSKY_API_IMPLEMENTATION
+
+    /*
+     * BSKY ERROR CODE
+     */
+    const char *bsky_str_of_error_code(enum bsky_error_code code)
+    {
+        switch (code) {
+        case bsky_ec_Ok:           return "Ok";
+        case bsky_ec_Tmp_overflow: return "overflow of temporary arena!";
+
+        case bsky_ec_Json_expect_CSB: 
+            return "JSON: expect ']' at the end of array!";
+        case bsky_ec_Json_expect_OSB: 
+            return "JSON: expect '[' at the start of the array!";
+        case bsky_ec_Json_expect_CCB: 
+            return "JSON: expect '}' at the end of dictionary!";
+        case bsky_ec_Json_expect_OCB: 
+            return "JSON: expect '}' at the start of dictionary!";
+        case bsky_ec_Json_expect_Bool: 
+            return "JSON: expect 'true' or 'false'!";
+        case bsky_ec_Json_expect_Null: 
+            return "JSON: expect 'null'!";
+        case bsky_ec_Json_expect_Number: 
+            return "JSON: expect number!";
+        case bsky_ec_Json_expect_OQ: 
+            return "JSON: expect '\"' at the start of string!";
+        case bsky_ec_Json_expect_CQ: 
+            return "JSON: expect '\"' at the end of string!";
+        case bsky_ec_Json_expect_Colon: 
+            return "JSON: expect ':' between key and value!";
+        case bsky_ec_Json_invalid_variant:
+            return "JSON: parse invalid json variant!";
+        case bsky_ec_Json_control_char:
+            return "JSON: unescaped control character in string!";
+        case bsky_ec_Json_invalid_escape:
+            return "JSON: invalid escape sequence in string!";
+        case bsky_ec_Json_invalid_utf8:
+            return "JSON: string is not valid UTF-8!";
+        case bsky_ec_Json_path_invalid:
+            return "JSON: invalid path (bad `~' escape or too long)!";
+        case bsky_ec_Json_too_deep:
+            return "JSON: nesting is deeper than `BSKY_JSON_MAX_DEPTH'!";
+        case bsky_ec_Json_path_not_found:
+            return "JSON: no value at path!";
+        case bsky_ec_Json_edit_conflict:
+            return "JSON: edit is inside of replaced value!";
+        case bsky_ec_Json_not_canonical:
+            return "JSON: value has no canonical encoding!";
+
+        case bsky_ec_At_uri_scheme:
+            return "AT-URI: expect `at://' scheme!";
+        case bsky_ec_At_uri_authority:
+            return "AT-URI: authority is neither DID nor handle!";
+        case bsky_ec_At_uri_collection:
+            return "AT-URI: collection is not valid NSID!";
+        case bsky_ec_At_uri_rkey:
+            return "AT-URI: invalid record key!";
+
+        case bsky_ec_Cid_multibase:
+            return "CID: expect base32 multibase ('b' prefix)!";
+        case bsky_ec_Cid_invalid:
+            return "CID: invalid length or encoding!";
+        case bsky_ec_Cid_unsupported:
+            return "CID: only CIDv1 with sha2-256 is supported!";
+
+        case bsky_ec_Cbor_truncated:
+            return "CBOR: unexpected end of data!";
+        case bsky_ec_Cbor_invalid:
+            return "CBOR: malformed item!";
+        case bsky_ec_Cbor_unsupported:
+            return "CBOR: item is not allowed in DAG-CBOR!";
+
+        case bsky_ec_Block_not_found:
+            return "BLOCKS: no block with such CID!";
+        case bsky_ec_Block_mismatch:
+            return "BLOCKS: block doesn't match its CID!";
+        case bsky_ec_Car_invalid:
+            return "CAR: invalid header or section (only CARv1 is supported)!";
+        case bsky_ec_Block_file_io:
+            return "BLOCKS: can't read or write block file, or it's corrupted!";
+
+        case bsky_ec_Mst_invalid_node:
+            return "MST: invalid node!";
+        case bsky_ec_Mst_unsorted_keys:
+            return "MST: keys are not sorted or have duplicates!";
+
+        case bsky_ec_Repo_invalid_commit:
+            return "REPOSITORY: invalid commit!";
+        case bsky_ec_Backfill_io:
+            return "BACKFILL: can't read directory or file!";
+
+        case bsky_ec_Key_invalid:
+            return "KEY: invalid multikey, secret or point not on curve!";
+        case bsky_ec_Key_unsupported:
+            return "KEY: only secp256k1 and P-256 keys are supported!";
+        case bsky_ec_Key_no_secret:
+            return "KEY: signing needs key with secret!";
+        case bsky_ec_Sig_invalid:
+            return "SIG: signature doesn't match (or isn't low-S)!";
+
+        case bsky_ec_Xrpc_transport:
+            return "XRPC: transport failed to perform request!";
+        case bsky_ec_Xrpc_status:
+            return "XRPC: server respond with error status!";
+        case bsky_ec_Xrpc_bad_response:
+            return "XRPC: unexpected response body!";
+        }
+    }
+
+    /*
+     * BSKY HEAP ALLOCATION
+     */
+    #include <string.h>
+
+    void *__bsky_zeroed(void *ptr, size_t size)
+    {
+        if (ptr != NULL) memset(ptr, 0, size);
+
+        return ptr;
+    }
+
+    // Header before every tracked block, keeps blocks 16 bytes aligned.
+    struct __bsky_alloc_header {
+        _Alignas(16) size_t size;
+        size_t site;
+    };
+
+    static struct {
+        _Atomic int lock;
+
+        struct bsky_alloc_site sites[BSKY_ALLOC_SITES_MAX];
+        size_t sites_len;
+
+        struct bsky_alloc_stats stats;
+    } __bsky_alloc_tracker;
+
+    static void __bsky_alloc_lock(void) {
+        while (atomic_exchange_explicit(&__bsky_alloc_tracker.lock, 1,
+                                        memory_order_acquire));
+    }
+
+    static void __bsky_alloc_unlock(void) {
+        atomic_store_explicit(&__bsky_alloc_tracker.lock, 0,
+                              memory_order_release);
+    }
+
+    // Find or add call site, last slot collects sites which doesn't fit.
+    // Must be called under lock.
+    static size_t __bsky_alloc_site(const char *func, int line)
+    {
+        struct bsky_alloc_site *sites = __bsky_alloc_tracker.sites;
+        size_t len = __bsky_alloc_tracker.sites_len;
+
+        for (size_t i = 0; i < len; ++i) {
+            if (sites[i].line == line && sites[i].func == func) return i;
+        }
+
+        if (len == BSKY_ALLOC_SITES_MAX) return len - 1;
+
+        sites[len] = (struct bsky_alloc_site) { .func = func, .line = line };
+        if (len == BSKY_ALLOC_SITES_MAX - 1) sites[len].func = "<other>";
+
+        return __bsky_alloc_tracker.sites_len++;
+    }
+
+    static void __bsky_alloc_grow(size_t site, size_t size)
+    {
+        struct bsky_alloc_stats *stats = &__bsky_alloc_tracker.stats;
+
+        __bsky_alloc_tracker.sites[site].bytes      += size;
+        __bsky_alloc_tracker.sites[site].live_bytes += size;
+
+        stats->bytes      += size;
+        stats->live_bytes += size;
+        if (stats->live_bytes > stats->peak_bytes)
+            stats->peak_bytes = stats->live_bytes;
+    }
+
+    static void __bsky_alloc_shrink(size_t site, size_t size)
+    {
+        __bsky_alloc_tracker.sites[site].live_bytes -= size;
+        __bsky_alloc_tracker.stats.live_bytes       -= size;
+    }
+
+    void *__bsky_track_malloc(size_t size, const char *func, int line)
+    {
+        struct __bsky_alloc_header *header =
+            BSKY_MALLOC(sizeof (*header) + size);
+        if (header == NULL) return NULL;
+
+        __bsky_alloc_lock();
+
+        size_t site = __bsky_alloc_site(func, line);
+
+        __bsky_alloc_tracker.sites[site].mallocs++;
+        __bsky_alloc_tracker.stats.mallocs++;
+        __bsky_alloc_grow(site, size);
+
+        __bsky_alloc_unlock();
+
+        *header = (struct __bsky_alloc_header) { size, site };
+
+        return header + 1;
+    }
+
+    void *__bsky_track_realloc(void *ptr, size_t size,
+                               const char *func, int line)
+    {
+        struct __bsky_alloc_header *header = NULL, old = { 0 };
+
+        if (ptr != NULL) {
+            header = (struct __bsky_alloc_header *) ptr - 1;
+            old    = *header;
+        }
+
+        header = BSKY_REALLOC(header, sizeof (*header) + size);
+        if (header == NULL) return NULL;
+
+        __bsky_alloc_lock();
+
+        size_t site = __bsky_alloc_site(func, line);
+
+        __bsky_alloc_tracker.sites[site].reallocs++;
+        __bsky_alloc_tracker.stats.reallocs++;
+        if (ptr != NULL) __bsky_alloc_shrink(old.site, old.size);
+        __bsky_alloc_grow(site, size);
+
+        __bsky_alloc_unlock();
+
+        *header = (struct __bsky_alloc_header) { size, site };
+
+        return header + 1;
+    }
+
+    void __bsky_track_free(void *ptr, const char *func, int line)
+    {
+        if (ptr == NULL) return;
+
+        struct __bsky_alloc_header *header =
+            (struct __bsky_alloc_header *) ptr - 1;
+
+        __bsky_alloc_lock();
+
+        size_t site = __bsky_alloc_site(func, line);
+
+        __bsky_alloc_tracker.sites[site].frees++;
+        __bsky_alloc_tracker.stats.frees++;
+        __bsky_alloc_shrink(header->site, header->size);
+
+        __bsky_alloc_unlock();
+
+        BSKY_FREE(header);
+    }
+
+    struct bsky_alloc_stats bsky_alloc_stats(void)
+    {
+        __bsky_alloc_lock();
+        struct bsky_alloc_stats stats = __bsky_alloc_tracker.stats;
+        __bsky_alloc_unlock();
+
+        return stats;
+    }
+
+    size_t bsky_alloc_sites(struct bsky_alloc_site *sites, size_t cap)
+    {
+        __bsky_alloc_lock();
+
+        size_t len = __bsky_alloc_tracker.sites_len;
+        memcpy(sites, __bsky_alloc_tracker.sites,
+               (len < cap ? len : cap) * sizeof (*sites));
+
+        __bsky_alloc_unlock();
+
+        return len;
+    }
+
+    void bsky_alloc_stats_reset(void)
+    {
+        __bsky_alloc_lock();
+
+        struct bsky_alloc_stats *stats = &__bsky_alloc_tracker.stats;
+
+        *stats = (struct bsky_alloc_stats) {
+            .live_bytes = stats->live_bytes, .peak_bytes = stats->live_bytes,
+        };
+
+        for (size_t i = 0; i < __bsky_alloc_tracker.sites_len; ++i) {
+            struct bsky_alloc_site *site = &__bsky_alloc_tracker.sites[i];
+
+            *site = (struct bsky_alloc_site) {
+                .func = site->func, .line = site->line,
+                .live_bytes = site->live_bytes,
+            };
+        }
+
+        __bsky_alloc_unlock();
+    }
+
+    /*
+     * DEFAULT TMP ARENA
+     */
+    struct __bsky_default_tmp_arena {
+        void *allocator; size_t len;
+    } __bsky_default_tmp_arena = { 0 };
+
+    void    bsky_default_tmp_reset(void) {
+        __bsky_default_tmp_arena.len = 0;
+    }
+
+    static _Thread_local struct bsky_arena *__bsky_tmp_arena_override;
+
+    #define __bsky_align_up(n) (((n) + BSKY_ARENA_ALIGN - 1) & \
+                                ~(size_t) (BSKY_ARENA_ALIGN - 1))
+
+    struct bsky_arena *bsky_tmp_use_arena(struct bsky_arena *arena)
+    {
+        struct bsky_arena *prev = __bsky_tmp_arena_override;
+
+        __bsky_tmp_arena_override = arena;
+
+        return prev;
+    }
+
+    void *__bsky_default_tmp_alloc(size_t size_to_alloc)
+    {
+        BSKY_PROBE_COUNT(bsky_probe_Tmp_alloc, size_to_alloc);
+
+        if (__bsky_tmp_arena_override != NULL) {
+            void *ret = bsky_arena_alloc(__bsky_tmp_arena_override,
+                                         size_to_alloc);
+            if (ret == NULL)
+                BSKY_PROBE_COUNT(bsky_probe_Tmp_overflow, size_to_alloc);
+
+            return ret;
+        }
+
+        if (__bsky_default_tmp_arena.allocator == 0) {
+            __bsky_default_tmp_arena.allocator =
+                __bsky_malloc(BSKY_DEFAULT_TMP_ARENA_CAPACITY);
+        }
+
+        __bsky_default_tmp_arena.len =
+            __bsky_align_up(__bsky_default_tmp_arena.len);
+
+        if (__bsky_default_tmp_arena.len + size_to_alloc >
+            BSKY_DEFAULT_TMP_ARENA_CAPACITY) {
+            BSKY_PROBE_COUNT(bsky_probe_Tmp_overflow, size_to_alloc);
+            return NULL;
+        }
+
+        void *ret = __bsky_default_tmp_arena.allocator
+                    + __bsky_default_tmp_arena.len;
+
+        __bsky_default_tmp_arena.len += size_to_alloc;
+
+        return ret;
+    }
+
+    void *bsky_arena_alloc(struct bsky_arena *arena, size_t size)
+    {
+        if (arena->data == NULL) {
+            arena->data = __bsky_malloc(arena->cap);
+            if (arena->data == NULL) return NULL;
+        }
+
+        size_t start = __bsky_align_up(arena->len);
+
+        if (start + size > arena->cap) return NULL;
+
+        arena->len = start + size;
+
+        return arena->data + start;
+    }
+
+    void bsky_arena_reset(struct bsky_arena *arena) {
+        arena->len = 0;
+    }
+
+    void bsky_arena_free(struct bsky_arena *arena)
+    {
+        __bsky_free(arena->data);
+
+        arena->data = NULL;
+        arena->len  = 0;
+    }
+
+    /*
+     * BKSY DYNAMIC ARRAY
+     */
+	#include <string.h>
+    void bsky_da_free(void *da) {
+        struct bsky_dynamic_arr *self = (struct bsky_dynamic_arr*) da;
+
+        if (self->data != NULL) __bsky_free(self->data);
+    }
+
+    enum bsky_error_code 
+    __bsky_da_push(void *self_gen, const void *elem, size_t elem_size)
+    {
+        struct bsky_dynamic_arr *self = (struct bsky_dynamic_arr*) self_gen;
 
         if (self->len >= self->cap) {
-            self->cap  = self->cap ?  self->cap * 2 : 16;
-            self->data = realloc(self->data, self->cap * elem_size);
-            if (self->data == NULL) bsky_return_error(bsky_ec_Tmp_overflow);
+            size_t cap = self->cap ? self->cap * 2 : 16;
+
+            // array is left as it was if it can't grow.
+            BSKY_PROBE_BEGIN(bsky_probe_Da_realloc, 0);
+            void *data = __bsky_realloc(self->data, cap * elem_size);
+            BSKY_PROBE_END(bsky_probe_Da_realloc, cap * elem_size);
+            if (data == NULL) bsky_return_error(bsky_ec_Tmp_overflow);
+
+            self->data = data;
+            self->cap  = cap;
+        }
+
+        memcpy(self->data + self->len++ * elem_size, elem, elem_size);
+
+        return bsky_ec_Ok;
+    }
+
+    enum bsky_error_code
+    __bsky_da_append(void *self_gen, const void *elems,
+                     size_t elem_size, size_t len)
+    {
+        struct bsky_dynamic_arr *self = (struct bsky_dynamic_arr*) self_gen;
+
+        if (len == 0) return bsky_ec_Ok;
+
+        if (self->len + len > self->cap) {
+            size_t cap = (self->cap ? self->cap * 2 : 16) + len;
+
+            BSKY_PROBE_BEGIN(bsky_probe_Da_realloc, 0);
+            void *data = __bsky_realloc(self->data, cap * elem_size);
+            BSKY_PROBE_END(bsky_probe_Da_realloc, cap * elem_size);
+
+            if (data == NULL) bsky_return_error(bsky_ec_Tmp_overflow);
+
+            self->data = data;
+            self->cap  = cap;
+        }
+
+        memcpy(self->data + self->len * elem_size, elems, elem_size * len);
+        self->len += len;
+
+        return bsky_ec_Ok;
+    }
+
+    void bsky_clear_da(void *self_gen) {
+        struct bsky_dynamic_arr *self = (struct bsky_dynamic_arr*) self_gen;
+
+        *self = (struct bsky_dynamic_arr) { 0 }; 
+    }
+
+    /*
+     * BSKY VIEW
+     */
+    struct bsky_view __bsky_view_of_da(void *_da, size_t elem_size)
+    {
+        struct bsky_dynamic_arr *da = (struct bsky_dynamic_arr *) _da;
+
+        return (struct bsky_view) { da->data, da->data + da->len * elem_size };
+    }
+
+    struct bsky_view bsky_view_to_tmp(struct bsky_view view)
+    {
+        void *data = bsky_tmp_alloc(view.end - view.start);
+        if (data == NULL) return (struct bsky_view) { 0 };
+
+        if (view.end != view.start)
+            memcpy(data, view.start, view.end - view.start);
+
+        return (struct bsky_view) { data, data +  (view.end - view.start) };
+    }
+
+    struct bsky_view __bsky_tmp_view_of_da(void *da, size_t elem_size)
+    {
+        struct bsky_view ret = bsky_view_to_tmp(
+                                 __bsky_view_of_da(da, elem_size));
+
+        bsky_da_free(da);
+        bsky_clear_da(da);
+
+        return ret;
+    }
+
+    /*
+     * BSKY STRING
+     */
+    void bsky_sb_push(struct bsky_str_builder *sb, char c)
+    {
+        const char nullc = '\0';
+
+        if (sb->len == 0) {
+            char buf[] = { c, nullc };
+            __bsky_da_append(sb, buf, sizeof(char), 2);
+        }
+        else {
+            sb->data[sb->len-1] = c;
+            bsky_da_push(sb, nullc);
+        }
+    }
+
+    void bsky_sb_push_str(struct bsky_str_builder *sb, struct bsky_str str)
+    {
+        const char nullc = '\0';
+
+        if (sb->len != 0) sb->len--; // remove null character.
+
+        __bsky_da_append(sb, str.start, sizeof(char), str.end - str.start);
+
+        if (sb->len == 0 || sb->data[sb->len-1] != '\0')
+            bsky_da_push(sb, nullc);
+    }
+
+    #include <stdarg.h>
+
+    void bsky_sb_push_fmt(struct bsky_str_builder *sb, char *fmt, ...)
+    {
+        va_list args;
+        va_start(args, fmt);
+        int len = vsnprintf(NULL, 0, fmt, args);
+        va_end(args);
+
+        char *result = bsky_tmp_alloc(len + 1);
+        va_start(args, fmt);
+        vsnprintf(result, len + 1, fmt, args);
+        va_end(args);
+
+        bsky_sb_push_str(sb, (struct bsky_str) {result, result + len + 1});
+    }
+
+    struct bsky_str bsky_sb_build(struct bsky_str_builder *sb)
+    {
+        return (struct bsky_str) { sb->data, sb->data + sb->len-1 };
+    }
+
+    struct bsky_str bsky_sb_build_tmp(struct bsky_str_builder *sb)
+    {
+        struct bsky_view str = bsky_view_of_str(bsky_sb_build(sb));
+        struct bsky_view tmp = bsky_view_to_tmp(str);
+
+        bsky_da_free(sb);
+        *sb = (struct bsky_str_builder) { 0 };
+
+        return (struct bsky_str) { tmp.start, tmp.end-1 };
+    }
+
+    struct bsky_view bsky_view_of_str(struct bsky_str str)
+    {
+        return (struct bsky_view) { str.start, str.end + 1 };
+    }
+
+    static int __s_is_whitespace(char c) {
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+    }
+
+    struct bsky_str bsky_trim_left(struct bsky_str str)
+    {
+        while (str.start != str.end && __s_is_whitespace(*str.start)) {
+            str.start++;
+        }
+
+        return str;
+    }
+
+    /*
+     * 16 byte vectors. Comparison gives mask with `__BSKY_VEC_LANE_BITS'
+     * bits per byte, so index of first match is ctz(mask) / LANE_BITS.
+     */
+    #if !defined(BSKY_NO_SIMD) && defined(__SSE2__)
+        #include <emmintrin.h>
+        #define __BSKY_SIMD
+
+        typedef __m128i __bsky_vec;
+        #define __BSKY_VEC_LANE_BITS 1
+        #define __BSKY_VEC_LANE_MASK 0x1ULL
+        #define __BSKY_VEC_FULL      0xffffULL
+
+        #define __bsky_vec_load(p)   _mm_loadu_si128((const __m128i *) (p))
+        #define __bsky_vec_splat(c)  _mm_set1_epi8(c)
+        #define __bsky_vec_eq(a, b)  _mm_cmpeq_epi8(a, b)
+        #define __bsky_vec_or(a, b)  _mm_or_si128(a, b)
+        #define __bsky_vec_and(a, b) _mm_and_si128(a, b)
+        // unsigned a <= b
+        #define __bsky_vec_le(a, b)  _mm_cmpeq_epi8(_mm_min_epu8(a, b), a)
+        #define __bsky_vec_mask(v) \
+            ((unsigned long long) (unsigned) _mm_movemask_epi8(v))
+
+    #elif !defined(BSKY_NO_SIMD) && defined(__ARM_NEON)
+        #include <arm_neon.h>
+        #define __BSKY_SIMD
+
+        typedef uint8x16_t __bsky_vec;
+        #define __BSKY_VEC_LANE_BITS 4
+        #define __BSKY_VEC_LANE_MASK 0xfULL
+        #define __BSKY_VEC_FULL      0xffffffffffffffffULL
+
+        #define __bsky_vec_load(p)   vld1q_u8((const uint8_t *) (p))
+        #define __bsky_vec_splat(c)  vdupq_n_u8((uint8_t) (c))
+        #define __bsky_vec_eq(a, b)  vceqq_u8(a, b)
+        #define __bsky_vec_or(a, b)  vorrq_u8(a, b)
+        #define __bsky_vec_and(a, b) vandq_u8(a, b)
+        #define __bsky_vec_le(a, b)  vcleq_u8(a, b)
+        #define __bsky_vec_mask(v) vget_lane_u64(vreinterpret_u64_u8(    \
+                    vshrn_n_u16(vreinterpretq_u16_u8(v), 4)), 0)
+    #endif
+
+    #define __bsky_vec_index(mask) \
+        ((size_t) __builtin_ctzll(mask) / __BSKY_VEC_LANE_BITS)
+
+    // Index of first different byte or `n'.
+    static size_t __bsky_mismatch(const char *a, const char *b, size_t n)
+    {
+        size_t i = 0;
+
+    #ifdef __BSKY_SIMD
+        for (; i + 16 <= n; i += 16) {
+            unsigned long long eq = __bsky_vec_mask(
+                __bsky_vec_eq(__bsky_vec_load(a + i), __bsky_vec_load(b + i)));
+
+            if (eq != __BSKY_VEC_FULL)
+                return i + __bsky_vec_index(~eq & __BSKY_VEC_FULL);
+        }
+    #endif
+
+    #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        for (; i + 8 <= n; i += 8) {
+            unsigned long long x, y;
+
+            memcpy(&x, a + i, 8);
+            memcpy(&y, b + i, 8);
+            if (x != y) return i + __builtin_ctzll(x ^ y) / 8;
+        }
+    #endif
+
+        for (; i < n; ++i) {
+            if (a[i] != b[i]) return i;
+        }
+
+        return n;
+    }
+
+    // Equality only needs `memcmp', which is builtin for small constant
+    // sizes and vectorized by libc for others.
+    int bsky_str_starts_with(struct bsky_str fst, struct bsky_str pref)
+    {
+        size_t pref_len = bsky_str_len(pref);
+
+        if (bsky_str_len(fst) < pref_len) return 0;
+
+        return memcmp(fst.start, pref.start, pref_len) == 0;
+    }
+
+    int bsky_str_ends_with(struct bsky_str fst, struct bsky_str post)
+    {
+        size_t fst_len = bsky_str_len(fst), post_len = bsky_str_len(post);
+
+        if (fst_len < post_len) return 0;
+
+        return memcmp(fst.start + fst_len - post_len,
+                      post.start, post_len) == 0;
+    }
+
+    size_t bsky_str_len(struct bsky_str str) {
+        return (str.end - str.start) / sizeof (char);
+    }
+
+    int bsky_str_eq(struct bsky_str fst, struct bsky_str snd) {
+        size_t len = bsky_str_len(fst);
+
+        return len == bsky_str_len(snd) &&
+               memcmp(fst.start, snd.start, len) == 0;
+    }
+
+    int bsky_str_cmp(struct bsky_str fst, struct bsky_str snd) {
+        size_t fst_len = bsky_str_len(fst), snd_len = bsky_str_len(snd);
+        size_t len = fst_len < snd_len ? fst_len : snd_len;
+        size_t i   = __bsky_mismatch(fst.start, snd.start, len);
+
+        if (i < len) {
+            return (unsigned char) fst.start[i] > (unsigned char) snd.start[i]
+                   ? 1 + i : -1 - i;
+        }
+
+        return fst_len > snd_len ?   1 + snd_len :
+               snd_len > fst_len ? - 1 - fst_len :
+               0;
+    }
+
+    // libc `memchr' is already vectorized and wider than SSE2.
+    char *bsky_str_find_char(struct bsky_str str, char c)
+    {
+        if (str.start == str.end) return NULL;
+
+        return memchr(str.start, c, bsky_str_len(str));
+    }
+
+    char *bsky_str_find(struct bsky_str str, struct bsky_str sub)
+    {
+        size_t len = bsky_str_len(sub);
+
+        if (len == 0) return str.start;
+        if (len > bsky_str_len(str)) return NULL;
+        if (len == 1) return bsky_str_find_char(str, *sub.start);
+
+        char *p = str.start, *last = str.end - len;
+
+    #ifdef __BSKY_SIMD
+        // candidates must match first and last char of substring.
+        __bsky_vec first = __bsky_vec_splat(sub.start[0]);
+        __bsky_vec tail  = __bsky_vec_splat(sub.start[len - 1]);
+
+        for (; p + 16 <= last + 1; p += 16) {
+            unsigned long long mask = __bsky_vec_mask(__bsky_vec_and(
+                __bsky_vec_eq(__bsky_vec_load(p), first),
+                __bsky_vec_eq(__bsky_vec_load(p + len - 1), tail)));
+
+            while (mask != 0) {
+                size_t i = __bsky_vec_index(mask);
+
+                if (__bsky_mismatch(p + i + 1, sub.start + 1, len - 2) ==
+                    len - 2)
+                    return p + i;
+
+                mask &= ~(__BSKY_VEC_LANE_MASK << (i * __BSKY_VEC_LANE_BITS));
+            }
+        }
+    #endif
+
+        for (; p <= last; ++p) {
+            if (*p == *sub.start &&
+                __bsky_mismatch(p + 1, sub.start + 1, len - 1) == len - 1)
+                return p;
+        }
+
+        return NULL;
+    }
+
+    struct bsky_str bsky_str_split(struct bsky_str *rest, char sep)
+    {
+        struct bsky_str part = *rest;
+        char *found = bsky_str_find_char(*rest, sep);
+
+        if (found == NULL) {
+            *rest = (struct bsky_str) { 0 };
+            return part;
+        }
+
+        part.end    = found;
+        rest->start = found + 1;
+
+        return part;
+    }
+
+
+    struct bsky_str bsky_shift_str(struct bsky_str str, size_t n) {
+        if (n > bsky_str_len(str)) {
+            return (struct bsky_str){str.end, str.end};
+        }
+
+
+        return (struct bsky_str) {str.start + n, str.end};
+    }
+
+    struct bsky_str bsky_mk_str(char *str) {
+        return (struct bsky_str) { str, str + strlen(str) };
+    }
+
+    unsigned long long bsky_str_hash(struct bsky_str str,
+                                     unsigned long long seed)
+    {
+        for (char *c = str.start; c < str.end; ++c) {
+            seed ^= (unsigned char) *c;
+            seed *= 0x100000001b3ULL;
+        }
+
+        return seed;
+    }
+
+    /*
+     * BSKY UTF-8
+     */
+    // Decode code point at `*c' and move `*c' after it. On invalid
+    // sequence return -1 and move `*c' by one byte.
+    static long __bsky_utf8_next(const char **c, const char *end)
+    {
+        const unsigned char *s = (const unsigned char *) *c;
+        size_t left = (const unsigned char *) end - s, len;
+        long cp, min;
+
+        if      (s[0] < 0x80) { *c += 1; return s[0]; }
+        else if (s[0] < 0xc2) { *c += 1; return -1; }
+        else if (s[0] < 0xe0) { len = 2; cp = s[0] & 0x1f; min = 0x80; }
+        else if (s[0] < 0xf0) { len = 3; cp = s[0] & 0x0f; min = 0x800; }
+        else if (s[0] < 0xf5) { len = 4; cp = s[0] & 0x07; min = 0x10000; }
+        else                  { *c += 1; return -1; }
+
+        if (left < len) { *c += 1; return -1; }
+
+        for (size_t i = 1; i < len; ++i) {
+            if ((s[i] & 0xc0) != 0x80) { *c += 1; return -1; }
+            cp = cp << 6 | (s[i] & 0x3f);
+        }
+
+        if (cp < min || cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff)) {
+            *c += 1;
+            return -1;
+        }
+
+        *c += len;
+        return cp;
+    }
+
+    // Length of well formed sequence at `s' or 0 (table 3-7 of Unicode
+    // standard): it only checks byte ranges and does not decode.
+    static size_t __bsky_utf8_seq_len(const unsigned char *s, size_t left)
+    {
+        unsigned char lo = 0x80, hi = 0xbf;
+        size_t len;
+
+        if      (s[0] < 0xc2) return 0;
+        else if (s[0] < 0xe0) len = 2;
+        else if (s[0] < 0xf0) len = 3;
+        else if (s[0] < 0xf5) len = 4;
+        else                  return 0;
+
+        if (left < len) return 0;
+
+        switch (s[0]) {
+        case 0xe0: lo = 0xa0; break;
+        case 0xed: hi = 0x9f; break;
+        case 0xf0: lo = 0x90; break;
+        case 0xf4: hi = 0x8f; break;
+        }
+
+        if (s[1] < lo || s[1] > hi) return 0;
+        if (len > 2 && (s[2] & 0xc0) != 0x80) return 0;
+        if (len > 3 && (s[3] & 0xc0) != 0x80) return 0;
+
+        return len;
+    }
+
+    int bsky_utf8_valid(struct bsky_str str)
+    {
+        const char *c = str.start, *end = str.end;
+
+    #ifdef __BSKY_SIMD
+        __bsky_vec high = __bsky_vec_splat((char) 0x80);
+    #endif
+
+        while (c < end) {
+    #ifdef __BSKY_SIMD
+            // skip ASCII blocks, then decode the rest of block.
+            for (; end - c >= 16; c += 16) {
+                unsigned long long mask = __bsky_vec_mask(
+                    __bsky_vec_le(high, __bsky_vec_load(c)));
+
+                if (mask != 0) break;
+            }
+
+            const char *block_end = end - c >= 16 ? c + 16 : end;
+    #else
+            const char *block_end = end;
+    #endif
+
+            while (c < block_end) {
+                size_t len = 1;
+
+                if ((unsigned char) *c >= 0x80) {
+                    len = __bsky_utf8_seq_len((const unsigned char *) c,
+                                              end - c);
+                    if (len == 0) return 0;
+                }
+
+                c += len;
+            }
+        }
+
+        return 1;
+    }
+
+    static int __bsky_utf8_is_ri(long cp) {
+        return cp >= 0x1f1e6 && cp <= 0x1f1ff;
+    }
+
+    // Code points which continue current grapheme cluster.
+    static int __bsky_utf8_is_extend(long cp)
+    {
+        return (cp >= 0x0300  && cp <= 0x036f)  ||  // combining marks
+               (cp >= 0x1ab0  && cp <= 0x1aff)  ||
+               (cp >= 0x1dc0  && cp <= 0x1dff)  ||
+               (cp >= 0x20d0  && cp <= 0x20ff)  ||
+               (cp >= 0xfe20  && cp <= 0xfe2f)  ||
+               (cp >= 0xfe00  && cp <= 0xfe0f)  ||  // variation selectors
+               (cp >= 0xe0100 && cp <= 0xe01ef) ||
+               (cp >= 0x1f3fb && cp <= 0x1f3ff) ||  // emoji modifiers
+               (cp >= 0xe0020 && cp <= 0xe007f) ||  // tags
+               cp == 0x200d;                        // ZWJ
+    }
+
+    static const char *__bsky_utf8_next_grapheme(const char *c,
+                                                 const char *end)
+    {
+        long cp = __bsky_utf8_next(&c, end), prev = cp;
+        int  ri = __bsky_utf8_is_ri(cp);
+
+        if (cp == '\r' && c < end && *c == '\n') return c + 1;
+
+        while (c < end) {
+            const char *next = c;
+            long ext = __bsky_utf8_next(&next, end);
+
+            if (prev == 0x200d && ext >= 0x80) {
+                // ZWJ joins next code point.
+            } else if (ri && __bsky_utf8_is_ri(ext)) {
+                ri = 0;
+            } else if (ext < 0 || !__bsky_utf8_is_extend(ext)) {
+                break;
+            }
+
+            prev = ext;
+            c    = next;
+        }
+
+        return c;
+    }
+
+    size_t bsky_utf8_graphemes(struct bsky_str str)
+    {
+        size_t count = 0;
+
+        for (const char *c = str.start; c < str.end; count++) {
+            // ASCII followed by ASCII is a cluster by itself.
+            if ((unsigned char) *c < 0x80 && *c != '\r' &&
+                c + 1 < str.end && (unsigned char) c[1] < 0x80) {
+                c++;
+                continue;
+            }
+
+            c = __bsky_utf8_next_grapheme(c, str.end);
+        }
+
+        return count;
+    }
+
+    size_t bsky_utf8_grapheme_offset(struct bsky_str str, size_t n)
+    {
+        const char *c = str.start;
+
+        for (; c < str.end && n > 0; --n)
+            c = __bsky_utf8_next_grapheme(c, str.end);
+
+        return c - str.start;
+    }
+
+    static int __bsky_utf8_is_boundary(struct bsky_str str, size_t offset) {
+        return offset == bsky_str_len(str) ||
+               ((unsigned char) str.start[offset] & 0xc0) != 0x80;
+    }
+
+    struct bsky_str bsky_utf8_slice(struct bsky_str str, size_t byte_start,
+                                    size_t byte_end)
+    {
+        if (byte_start > byte_end || byte_end > bsky_str_len(str) ||
+            !__bsky_utf8_is_boundary(str, byte_start) ||
+            !__bsky_utf8_is_boundary(str, byte_end))
+            return (struct bsky_str) { 0 };
+
+        return (struct bsky_str) {
+            str.start + byte_start, str.start + byte_end
+        };
+    }
+
+    /*
+     * BSKY IDENTIFIERS
+     */
+    enum {
+        __BSKY_ID_ALNUM = 1 << 0,
+        __BSKY_ID_DID   = 1 << 1,        // method specific id
+        __BSKY_ID_RKEY  = 1 << 2,
+        __BSKY_ID_TID   = 1 << 3,
+        __BSKY_ID_TID0  = 1 << 4,        // first char of TID
+        __BSKY_ID_ALPHA = 1 << 5,
+        __BSKY_ID_LABEL = 1 << 6,        // domain label
+    };
+
+    static const unsigned char __bsky_id_class[256] = {
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x46, 0x06, 0x00,
+        0x47, 0x47, 0x5f, 0x5f, 0x5f, 0x5f, 0x5f, 0x5f,
+        0x47, 0x47, 0x06, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x67, 0x67, 0x67, 0x67, 0x67, 0x67, 0x67,
+        0x67, 0x67, 0x67, 0x67, 0x67, 0x67, 0x67, 0x67,
+        0x67, 0x67, 0x67, 0x67, 0x67, 0x67, 0x67, 0x67,
+        0x67, 0x67, 0x67, 0x00, 0x00, 0x00, 0x00, 0x06,
+        0x00, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f,
+        0x7f, 0x7f, 0x7f, 0x6f, 0x6f, 0x6f, 0x6f, 0x6f,
+        0x6f, 0x6f, 0x6f, 0x6f, 0x6f, 0x6f, 0x6f, 0x6f,
+        0x6f, 0x6f, 0x6f, 0x00, 0x00, 0x00, 0x04, 0x00,
+    };
+
+    static int __bsky_id_is(char c, int class) {
+        return __bsky_id_class[(unsigned char) c] & class;
+    }
+
+    static int __bsky_id_all(struct bsky_str str, int class)
+    {
+        for (char *c = str.start; c < str.end; ++c)
+            if (!__bsky_id_is(*c, class)) return 0;
+
+        return 1;
+    }
+
+    int bsky_did_valid(struct bsky_str did)
+    {
+        size_t len = bsky_str_len(did);
+
+        if (len > BSKY_DID_MAX || len < 4 || memcmp(did.start, "did:", 4))
+            return 0;
+
+        char *c = did.start + 4;
+        for (; c < did.end && *c >= 'a' && *c <= 'z'; ++c);
+
+        if (c == did.start + 4 || c >= did.end || *c != ':') return 0;
+
+        struct bsky_str id = { c + 1, did.end };
+
+        return id.start < id.end && __bsky_id_all(id, __BSKY_ID_DID) &&
+               id.end[-1] != ':' && id.end[-1] != '%';
+    }
+
+    // Domain labels: 1-63 of `A-Za-z0-9-', no hyphen at the edges. Return
+    // number of labels or 0 if some label is invalid.
+    static size_t __bsky_id_labels(struct bsky_str str, char **last)
+    {
+        size_t count = 0;
+        char  *label = str.start;
+
+        for (char *c = str.start; ; ++c) {
+            if (c < str.end && *c != '.') {
+                if (!__bsky_id_is(*c, __BSKY_ID_LABEL)) return 0;
+                continue;
+            }
+
+            if (c == label || c - label > 63 || *label == '-' ||
+                c[-1] == '-')
+                return 0;
+
+            *last = label;
+            count++;
+
+            if (c >= str.end) return count;
+            label = c + 1;
+        }
+    }
+
+    int bsky_handle_valid(struct bsky_str handle)
+    {
+        char *tld = NULL;
+
+        if (bsky_str_len(handle) > BSKY_HANDLE_MAX) return 0;
+
+        return __bsky_id_labels(handle, &tld) >= 2 &&
+               __bsky_id_is(*tld, __BSKY_ID_ALPHA);
+    }
+
+    int bsky_nsid_valid(struct bsky_str nsid)
+    {
+        char *name = NULL, *dot;
+
+        if (bsky_str_len(nsid) > BSKY_NSID_MAX ||
+            nsid.start == nsid.end || !__bsky_id_is(*nsid.start,
+                                                    __BSKY_ID_ALPHA))
+            return 0;
+
+        // name is the last segment, it has no hyphens.
+        for (dot = nsid.end; dot > nsid.start && dot[-1] != '.'; --dot);
+        if (dot == nsid.start) return 0;
+
+        struct bsky_str authority = { nsid.start, dot - 1 };
+        struct bsky_str last      = { dot, nsid.end };
+
+        return __bsky_id_labels(authority, &name) >= 2 &&
+               last.start < last.end && bsky_str_len(last) <= 63 &&
+               __bsky_id_is(*last.start, __BSKY_ID_ALPHA) &&
+               __bsky_id_all(last, __BSKY_ID_ALNUM);
+    }
+
+    int bsky_rkey_valid(struct bsky_str rkey)
+    {
+        size_t len = bsky_str_len(rkey);
+
+        if (len == 0 || len > BSKY_RKEY_MAX) return 0;
+        if (rkey.start[0] == '.' && (len == 1 || (len == 2 &&
+                                                  rkey.start[1] == '.')))
+            return 0;
+
+        return __bsky_id_all(rkey, __BSKY_ID_RKEY);
+    }
+
+    int bsky_tid_valid(struct bsky_str tid)
+    {
+        return bsky_str_len(tid) == BSKY_TID_LEN &&
+               __bsky_id_is(*tid.start, __BSKY_ID_TID0) &&
+               __bsky_id_all(tid, __BSKY_ID_TID);
+    }
+
+    // Sortable base32 alphabet is "234567abcdefghijklmnopqrstuvwxyz".
+    static const char __bsky_tid_chars[] = "234567abcdefghijklmnopqrstuvwxyz";
+
+    int bsky_tid_key_pack(struct bsky_str tid, unsigned long long *key)
+    {
+        unsigned long long value = 0;
+        int class = __BSKY_ID_TID;
+
+        if (bsky_str_len(tid) != BSKY_TID_LEN ||
+            !__bsky_id_is(*tid.start, __BSKY_ID_TID0))
+            return 0;
+
+        for (char *c = tid.start; c < tid.end; ++c) {
+            class &= __bsky_id_class[(unsigned char) *c];
+            value  = value << 5 | (*c <= '7' ? *c - '2' : *c - 'a' + 6);
+        }
+
+        if (class == 0) return 0;
+
+        *key = value;
+        return 1;
+    }
+
+    struct bsky_str bsky_tid_key_unpack(char *buf, unsigned long long key)
+    {
+        key &= ~(1ULL << 63);
+
+        for (int i = BSKY_TID_LEN - 1; i >= 0; --i, key >>= 5)
+            buf[i] = __bsky_tid_chars[key & 0x1f];
+        buf[BSKY_TID_LEN] = '\0';
+
+        return (struct bsky_str) { buf, buf + BSKY_TID_LEN };
+    }
+
+    long long bsky_tid_timestamp(struct bsky_str tid, unsigned *clock_id)
+    {
+        unsigned long long value;
+
+        if (!bsky_tid_key_pack(tid, &value)) return -1;
+
+        if (clock_id != NULL) *clock_id = value & 0x3ff;
+
+        return value >> 10;
+    }
+
+    struct bsky_str bsky_tid_of_timestamp(char *buf, long long timestamp,
+                                          unsigned clock_id)
+    {
+        return bsky_tid_key_unpack(buf, (unsigned long long) timestamp << 10 |
+                                        (clock_id & 0x3ff));
+    }
+
+    // Finalizer of splitmix64: every input bit affects every output bit.
+    static unsigned long long __bsky_id_mix(unsigned long long x)
+    {
+        x = (x ^ x >> 30) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ x >> 27) * 0x94d049bb133111ebULL;
+        return x ^ x >> 31;
+    }
+
+    unsigned long long bsky_tid_key_hash(unsigned long long key) {
+        return __bsky_id_mix(key);
+    }
+
+    // Standard base32 (RFC 4648) values with 0x20 bit set, 0 for other
+    // chars.
+    static const unsigned char __bsky_b32_values[256] = {
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26,
+        0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e,
+        0x2f, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36,
+        0x37, 0x38, 0x39, 0x00, 0x00, 0x00, 0x00, 0x00,
+    };
+
+    static const char __bsky_b32_chars[] = "abcdefghijklmnopqrstuvwxyz234567";
+
+    int bsky_did_key_pack(struct bsky_str did, struct bsky_did_key *key)
+    {
+        struct bsky_did_key packed;
+
+        if (bsky_str_len(did) != BSKY_DID_PLC_LEN ||
+            memcmp(did.start, "did:plc:", 8) != 0)
+            return 0;
+
+        // 8 chars are 40 bits, 5 bytes.
+        for (int group = 0; group < 3; ++group) {
+            unsigned long long bits = 0;
+            unsigned char valid = 0x20;
+
+            for (int i = 0; i < 8; ++i) {
+                unsigned char value = __bsky_b32_values[
+                    (unsigned char) did.start[8 + group * 8 + i]];
+
+                valid &= value;
+                bits   = bits << 5 | (value & 0x1f);
+            }
+
+            if (valid == 0) return 0;
+
+            for (int i = 4; i >= 0; --i, bits >>= 8)
+                packed.bytes[group * 5 + i] = bits & 0xff;
+        }
+
+        *key = packed;
+        return 1;
+    }
+
+    struct bsky_str bsky_did_key_unpack(char *buf, struct bsky_did_key key)
+    {
+        memcpy(buf, "did:plc:", 8);
+
+        for (int group = 0; group < 3; ++group) {
+            unsigned long long bits = 0;
+
+            for (int i = 0; i < 5; ++i)
+                bits = bits << 8 | key.bytes[group * 5 + i];
+
+            for (int i = 7; i >= 0; --i, bits >>= 5)
+                buf[8 + group * 8 + i] = __bsky_b32_chars[bits & 0x1f];
+        }
+        buf[BSKY_DID_PLC_LEN] = '\0';
+
+        return (struct bsky_str) { buf, buf + BSKY_DID_PLC_LEN };
+    }
+
+    int bsky_did_key_cmp(const void *fst, const void *snd) {
+        return memcmp(fst, snd, sizeof (struct bsky_did_key));
+    }
+
+    unsigned long long bsky_did_key_hash(struct bsky_did_key key)
+    {
+        unsigned long long lo = 0, hi = 0;
+
+        // words overlap in one byte, so both are full loads.
+        memcpy(&lo, key.bytes, 8);
+        memcpy(&hi, key.bytes + 7, 8);
+
+        return __bsky_id_mix(lo ^ __bsky_id_mix(hi));
+    }
+
+    struct bsky_at_uri bsky_parse_at_uri(struct bsky_str str,
+                                         enum bsky_error_code *ec)
+    {
+        *ec = bsky_ec_Ok;
+
+        struct bsky_at_uri uri = { 0 };
+        struct bsky_str rest = { 0 };
+
+        if (bsky_str_len(str) > BSKY_AT_URI_MAX || bsky_str_len(str) < 5 ||
+            memcmp(str.start, "at://", 5) != 0)
+            bsky_defer_ec(bsky_ec_At_uri_scheme);
+
+        rest = bsky_shift_str(str, 5);
+
+        uri.authority = bsky_str_split(&rest, '/');
+        if (bsky_str_len(uri.authority) > 4 &&
+            memcmp(uri.authority.start, "did:", 4) == 0
+                ? !bsky_did_valid(uri.authority)
+                : !bsky_handle_valid(uri.authority))
+            bsky_defer_ec(bsky_ec_At_uri_authority);
+
+        if (rest.start == NULL) goto defer;
+
+        uri.collection = bsky_str_split(&rest, '/');
+        if (!bsky_nsid_valid(uri.collection))
+            bsky_defer_ec(bsky_ec_At_uri_collection);
+
+        if (rest.start == NULL) goto defer;
+
+        uri.rkey = bsky_str_split(&rest, '/');
+        if (rest.start != NULL || !bsky_rkey_valid(uri.rkey))
+            bsky_defer_ec(bsky_ec_At_uri_rkey);
+
+    defer:
+        if (*ec != bsky_ec_Ok) uri = (struct bsky_at_uri) { 0 };
+        return uri;
+    }
+
+    /*
+     * BSKY CID
+     */
+    static const uint32_t __bsky_sha256_k[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+        0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+        0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+        0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+        0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+        0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+        0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+        0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+        0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+
+    #define __BSKY_ROTR(x, n) ((x) >> (n) | (x) << (32 - (n)))
+
+    static void __bsky_sha256_blocks_portable(uint32_t state[8],
+                                              const unsigned char *data,
+                                              size_t blocks)
+    {
+        for (; blocks > 0; --blocks, data += 64) {
+            uint32_t w[64];
+
+            for (int i = 0; i < 16; ++i)
+                w[i] = (uint32_t) data[i * 4] << 24 |
+                       (uint32_t) data[i * 4 + 1] << 16 |
+                       (uint32_t) data[i * 4 + 2] << 8 |
+                       (uint32_t) data[i * 4 + 3];
+
+            for (int i = 16; i < 64; ++i) {
+                uint32_t s0 = __BSKY_ROTR(w[i - 15], 7) ^
+                              __BSKY_ROTR(w[i - 15], 18) ^ w[i - 15] >> 3;
+                uint32_t s1 = __BSKY_ROTR(w[i - 2], 17) ^
+                              __BSKY_ROTR(w[i - 2], 19) ^ w[i - 2] >> 10;
+
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+
+            uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+            uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+            // Round with variables renamed instead of moved: after eight
+            // rounds they are back in place.
+            #define __BSKY_SHA_ROUND(a, b, c, d, e, f, g, h, i) do {        \
+                    uint32_t t1 = h + (__BSKY_ROTR(e, 6) ^                  \
+                                       __BSKY_ROTR(e, 11) ^                 \
+                                       __BSKY_ROTR(e, 25)) +                \
+                                  ((e & f) ^ (~e & g)) +                    \
+                                  __bsky_sha256_k[i] + w[i];                \
+                    uint32_t t2 = (__BSKY_ROTR(a, 2) ^ __BSKY_ROTR(a, 13) ^ \
+                                   __BSKY_ROTR(a, 22)) +                    \
+                                  ((a & b) ^ (a & c) ^ (b & c));            \
+                    d += t1;                                                \
+                    h  = t1 + t2;                                           \
+                } while (0)
+
+            for (int i = 0; i < 64; i += 8) {
+                __BSKY_SHA_ROUND(a, b, c, d, e, f, g, h, i);
+                __BSKY_SHA_ROUND(h, a, b, c, d, e, f, g, i + 1);
+                __BSKY_SHA_ROUND(g, h, a, b, c, d, e, f, i + 2);
+                __BSKY_SHA_ROUND(f, g, h, a, b, c, d, e, i + 3);
+                __BSKY_SHA_ROUND(e, f, g, h, a, b, c, d, i + 4);
+                __BSKY_SHA_ROUND(d, e, f, g, h, a, b, c, i + 5);
+                __BSKY_SHA_ROUND(c, d, e, f, g, h, a, b, i + 6);
+                __BSKY_SHA_ROUND(b, c, d, e, f, g, h, a, i + 7);
+            }
+
+            #undef __BSKY_SHA_ROUND
+
+            state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+            state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+        }
+    }
+
+    #undef __BSKY_ROTR
+
+    #if !defined(BSKY_NO_SIMD) && defined(__x86_64__) && \
+        (defined(__GNUC__) || defined(__clang__))
+        #include <immintrin.h>
+        #include <cpuid.h>
+        #define __BSKY_SHA_NI
+
+        // Message schedule and rounds run in SHA-NI registers, state is
+        // kept as ABEF/CDGH halves required by `sha256rnds2'.
+        __attribute__((target("sha,sse4.1")))
+        static void __bsky_sha256_blocks_ni(uint32_t state[8],
+                                            const unsigned char *data,
+                                            size_t blocks)
+        {
+            const __m128i shuf = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+                                                0x0405060700010203ULL);
+            __m128i tmp   = _mm_loadu_si128((const __m128i *) &state[0]);
+            __m128i state1 = _mm_loadu_si128((const __m128i *) &state[4]);
+
+            tmp    = _mm_shuffle_epi32(tmp, 0xb1);             // CDAB
+            state1 = _mm_shuffle_epi32(state1, 0x1b);          // EFGH
+            __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);  // ABEF
+            state1 = _mm_blend_epi16(state1, tmp, 0xf0);       // CDGH
+
+            for (; blocks > 0; --blocks, data += 64) {
+                __m128i abef = state0, cdgh = state1, m;
+                __m128i m0, m1, m2, m3;
+
+                // Four rounds `i' with schedule words `cur' (rounds i..i+3),
+                // `prev' and `next'; conditions are folded at compile time.
+                #define __BSKY_SHA_NI_QUAD(i, cur, prev, next)              \
+                    m = _mm_add_epi32(cur, _mm_loadu_si128(                 \
+                        (const __m128i *) &__bsky_sha256_k[(i) * 4]));      \
+                    state1 = _mm_sha256rnds2_epu32(state1, state0, m);      \
+                    if ((i) >= 3 && (i) <= 14)                              \
+                        next = _mm_sha256msg2_epu32(_mm_add_epi32(next,     \
+                            _mm_alignr_epi8(cur, prev, 4)), cur);           \
+                    m      = _mm_shuffle_epi32(m, 0x0e);                    \
+                    state0 = _mm_sha256rnds2_epu32(state0, state1, m);      \
+                    if ((i) >= 1 && (i) <= 12)                              \
+                        prev = _mm_sha256msg1_epu32(prev, cur);
+
+                m0 = _mm_shuffle_epi8(_mm_loadu_si128(
+                    (const __m128i *) (data + 0)), shuf);
+                m1 = _mm_shuffle_epi8(_mm_loadu_si128(
+                    (const __m128i *) (data + 16)), shuf);
+                m2 = _mm_shuffle_epi8(_mm_loadu_si128(
+                    (const __m128i *) (data + 32)), shuf);
+                m3 = _mm_shuffle_epi8(_mm_loadu_si128(
+                    (const __m128i *) (data + 48)), shuf);
+
+                __BSKY_SHA_NI_QUAD( 0, m0, m3, m1)
+                __BSKY_SHA_NI_QUAD( 1, m1, m0, m2)
+                __BSKY_SHA_NI_QUAD( 2, m2, m1, m3)
+                __BSKY_SHA_NI_QUAD( 3, m3, m2, m0)
+                __BSKY_SHA_NI_QUAD( 4, m0, m3, m1)
+                __BSKY_SHA_NI_QUAD( 5, m1, m0, m2)
+                __BSKY_SHA_NI_QUAD( 6, m2, m1, m3)
+                __BSKY_SHA_NI_QUAD( 7, m3, m2, m0)
+                __BSKY_SHA_NI_QUAD( 8, m0, m3, m1)
+                __BSKY_SHA_NI_QUAD( 9, m1, m0, m2)
+                __BSKY_SHA_NI_QUAD(10, m2, m1, m3)
+                __BSKY_SHA_NI_QUAD(11, m3, m2, m0)
+                __BSKY_SHA_NI_QUAD(12, m0, m3, m1)
+                __BSKY_SHA_NI_QUAD(13, m1, m0, m2)
+                __BSKY_SHA_NI_QUAD(14, m2, m1, m3)
+                __BSKY_SHA_NI_QUAD(15, m3, m2, m0)
+
+                #undef __BSKY_SHA_NI_QUAD
+
+                state0 = _mm_add_epi32(state0, abef);
+                state1 = _mm_add_epi32(state1, cdgh);
+            }
+
+            tmp    = _mm_shuffle_epi32(state0, 0x1b);          // FEBA
+            state1 = _mm_shuffle_epi32(state1, 0xb1);          // DCHG
+            _mm_storeu_si128((__m128i *) &state[0],
+                             _mm_blend_epi16(tmp, state1, 0xf0));  // DCBA
+            _mm_storeu_si128((__m128i *) &state[4],
+                             _mm_alignr_epi8(state1, tmp, 8));     // HGFE
+        }
+
+        static int __bsky_sha_ni_supported(void)
+        {
+            static _Atomic int supported = -1;
+            int value = atomic_load_explicit(&supported,
+                                             memory_order_relaxed);
+
+            if (value < 0) {
+                unsigned a, b, c, d;
+
+                value = __get_cpuid_count(7, 0, &a, &b, &c, &d) &&
+                        (b & 1u << 29) &&                      // SHA
+                        __get_cpuid(1, &a, &b, &c, &d) &&
+                        (c & 1u << 19) && (c & 1u << 9);       // SSE4.1, SSSE3
+
+                atomic_store_explicit(&supported, value,
+                                      memory_order_relaxed);
+            }
+
+            return value;
+        }
+
+    #elif !defined(BSKY_NO_SIMD) && defined(__ARM_FEATURE_SHA2)
+        #include <arm_neon.h>
+        #define __BSKY_SHA_ARMV8
+
+        static void __bsky_sha256_blocks_armv8(uint32_t state[8],
+                                               const unsigned char *data,
+                                               size_t blocks)
+        {
+            uint32x4_t state0 = vld1q_u32(&state[0]);
+            uint32x4_t state1 = vld1q_u32(&state[4]);
+
+            for (; blocks > 0; --blocks, data += 64) {
+                uint32x4_t abcd = state0, efgh = state1, prev, wk, next;
+                uint32x4_t m0, m1, m2, m3;
+
+                // Four rounds `i' with schedule words `cur' and three next
+                // ones; `wk' holds words plus constants of these rounds.
+                #define __BSKY_SHA_ARMV8_QUAD(i, cur, n1, n2, n3)           \
+                    prev = state0;                                          \
+                    if ((i) < 12) cur = vsha256su0q_u32(cur, n1);           \
+                    if ((i) < 15) next = vaddq_u32(n1,                      \
+                        vld1q_u32(&__bsky_sha256_k[((i) + 1) * 4]));        \
+                    state0 = vsha256hq_u32(state0, state1, wk);             \
+                    state1 = vsha256h2q_u32(state1, prev, wk);              \
+                    if ((i) < 12) cur = vsha256su1q_u32(cur, n2, n3);       \
+                    wk = next;
+
+                m0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data)));
+                m1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16)));
+                m2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 32)));
+                m3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 48)));
+
+                wk = vaddq_u32(m0, vld1q_u32(&__bsky_sha256_k[0]));
+
+                __BSKY_SHA_ARMV8_QUAD( 0, m0, m1, m2, m3)
+                __BSKY_SHA_ARMV8_QUAD( 1, m1, m2, m3, m0)
+                __BSKY_SHA_ARMV8_QUAD( 2, m2, m3, m0, m1)
+                __BSKY_SHA_ARMV8_QUAD( 3, m3, m0, m1, m2)
+                __BSKY_SHA_ARMV8_QUAD( 4, m0, m1, m2, m3)
+                __BSKY_SHA_ARMV8_QUAD( 5, m1, m2, m3, m0)
+                __BSKY_SHA_ARMV8_QUAD( 6, m2, m3, m0, m1)
+                __BSKY_SHA_ARMV8_QUAD( 7, m3, m0, m1, m2)
+                __BSKY_SHA_ARMV8_QUAD( 8, m0, m1, m2, m3)
+                __BSKY_SHA_ARMV8_QUAD( 9, m1, m2, m3, m0)
+                __BSKY_SHA_ARMV8_QUAD(10, m2, m3, m0, m1)
+                __BSKY_SHA_ARMV8_QUAD(11, m3, m0, m1, m2)
+                __BSKY_SHA_ARMV8_QUAD(12, m0, m1, m2, m3)
+                __BSKY_SHA_ARMV8_QUAD(13, m1, m2, m3, m0)
+                __BSKY_SHA_ARMV8_QUAD(14, m2, m3, m0, m1)
+                __BSKY_SHA_ARMV8_QUAD(15, m3, m0, m1, m2)
+
+                #undef __BSKY_SHA_ARMV8_QUAD
+
+                state0 = vaddq_u32(state0, abcd);
+                state1 = vaddq_u32(state1, efgh);
+            }
+
+            vst1q_u32(&state[0], state0);
+            vst1q_u32(&state[4], state1);
+        }
+    #endif
+
+    static void __bsky_sha256_blocks(uint32_t state[8],
+                                     const unsigned char *data, size_t blocks)
+    {
+    #if defined(__BSKY_SHA_NI)
+        if (__bsky_sha_ni_supported()) {
+            __bsky_sha256_blocks_ni(state, data, blocks);
+            return;
+        }
+    #elif defined(__BSKY_SHA_ARMV8)
+        __bsky_sha256_blocks_armv8(state, data, blocks);
+        return;
+    #endif
+
+        __bsky_sha256_blocks_portable(state, data, blocks);
+    }
+
+    const char *bsky_sha256_backend(void)
+    {
+    #if defined(__BSKY_SHA_NI)
+        if (__bsky_sha_ni_supported()) return "sha-ni";
+    #elif defined(__BSKY_SHA_ARMV8)
+        return "armv8";
+    #endif
+
+        return "portable";
+    }
+
+    void bsky_sha256_init(struct bsky_sha256 *sha)
+    {
+        static const uint32_t init[8] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+            0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+        };
+
+        memcpy(sha->state, init, sizeof init);
+        sha->len = 0;
+    }
+
+    void bsky_sha256_update(struct bsky_sha256 *sha, const void *data,
+                            size_t len)
+    {
+        const unsigned char *c = data;
+        size_t used = sha->len % 64;
+
+        sha->len += len;
+
+        if (used != 0) {
+            size_t part = len < 64 - used ? len : 64 - used;
+
+            memcpy(sha->buf + used, c, part);
+            c   += part;
+            len -= part;
+
+            if (used + part < 64) return;
+            __bsky_sha256_blocks(sha->state, sha->buf, 1);
+        }
+
+        if (len >= 64) {
+            __bsky_sha256_blocks(sha->state, c, len / 64);
+            c   += len / 64 * 64;
+            len %= 64;
+        }
+
+        if (len != 0) memcpy(sha->buf, c, len);
+    }
+
+    void bsky_sha256_final(struct bsky_sha256 *sha,
+                           unsigned char digest[BSKY_SHA256_LEN])
+    {
+        size_t   used = sha->len % 64;
+        uint64_t bits = sha->len * 8;
+
+        sha->buf[used++] = 0x80;
+
+        if (used > 56) {
+            memset(sha->buf + used, 0, 64 - used);
+            __bsky_sha256_blocks(sha->state, sha->buf, 1);
+            used = 0;
+        }
+
+        memset(sha->buf + used, 0, 56 - used);
+        for (int i = 0; i < 8; ++i) sha->buf[56 + i] = bits >> (56 - i * 8);
+        __bsky_sha256_blocks(sha->state, sha->buf, 1);
+
+        for (int i = 0; i < 8; ++i) {
+            digest[i * 4]     = sha->state[i] >> 24;
+            digest[i * 4 + 1] = sha->state[i] >> 16;
+            digest[i * 4 + 2] = sha->state[i] >> 8;
+            digest[i * 4 + 3] = sha->state[i];
+        }
+    }
+
+    void bsky_sha256(const void *data, size_t len,
+                     unsigned char digest[BSKY_SHA256_LEN])
+    {
+        struct bsky_sha256 sha;
+
+        bsky_sha256_init(&sha);
+        bsky_sha256_update(&sha, data, len);
+        bsky_sha256_final(&sha, digest);
+    }
+
+    struct bsky_cid bsky_cid_of_block(enum bsky_cid_codec codec,
+                                      struct bsky_view block)
+    {
+        struct bsky_cid cid = { .codec = codec };
+
+        bsky_sha256(block.start, (char *) block.end - (char *) block.start,
+                    cid.digest);
+
+        return cid;
+    }
+
+    void bsky_cid_batch(enum bsky_cid_codec codec,
+                        const struct bsky_view *blocks, size_t len,
+                        struct bsky_cid *cids)
+    {
+        for (size_t i = 0; i < len; ++i) {
+            // blocks of CAR file are often scattered over tmp arena.
+            if (i + 1 < len) __builtin_prefetch(blocks[i + 1].start);
+
+            cids[i] = bsky_cid_of_block(codec, blocks[i]);
+        }
+    }
+
+    int bsky_cid_eq(struct bsky_cid fst, struct bsky_cid snd) {
+        return fst.codec == snd.codec &&
+               memcmp(fst.digest, snd.digest, BSKY_SHA256_LEN) == 0;
+    }
+
+    int bsky_cid_verify(struct bsky_cid cid, struct bsky_view block) {
+        return bsky_cid_eq(cid, bsky_cid_of_block(cid.codec, block));
+    }
+
+    size_t bsky_cid_to_bytes(unsigned char *buf, struct bsky_cid cid)
+    {
+        buf[0] = 0x01;                   // CIDv1
+        buf[1] = cid.codec;
+        buf[2] = 0x12;                   // sha2-256
+        buf[3] = BSKY_SHA256_LEN;
+        memcpy(buf + 4, cid.digest, BSKY_SHA256_LEN);
+
+        return BSKY_CID_BYTES;
+    }
+
+    struct bsky_cid bsky_parse_cid_bytes(struct bsky_view *data,
+                                         enum bsky_error_code *ec)
+    {
+        *ec = bsky_ec_Ok;
+
+        struct bsky_cid cid = { 0 };
+        unsigned char *c = data->start;
+
+        if ((unsigned char *) data->end - c < BSKY_CID_BYTES)
+            bsky_defer_ec(bsky_ec_Cid_invalid);
+
+        if (c[0] != 0x01 || c[2] != 0x12 || c[3] != BSKY_SHA256_LEN ||
+            (c[1] != bsky_cid_Raw && c[1] != bsky_cid_Dag_cbor))
+            bsky_defer_ec(bsky_ec_Cid_unsupported);
+
+        cid.codec = c[1];
+        memcpy(cid.digest, c + 4, BSKY_SHA256_LEN);
+        data->start = c + BSKY_CID_BYTES;
+
+    defer:
+        return cid;
+    }
+
+    struct bsky_cid bsky_parse_cid(struct bsky_str str,
+                                   enum bsky_error_code *ec)
+    {
+        *ec = bsky_ec_Ok;
+
+        struct bsky_cid cid = { 0 };
+        unsigned char bytes[BSKY_CID_BYTES + 1];
+        unsigned long long bits = 0;
+        size_t nbits = 0, len = 0;
+
+        if (bsky_str_len(str) == 0 || str.start[0] != 'b')
+            bsky_defer_ec(bsky_ec_Cid_multibase);
+
+        if (bsky_str_len(str) != BSKY_CID_STR_LEN)
+            bsky_defer_ec(bsky_ec_Cid_invalid);
+
+        for (char *c = str.start + 1; c < str.end; ++c) {
+            unsigned char value = __bsky_b32_values[(unsigned char) *c];
+            if (value == 0) bsky_defer_ec(bsky_ec_Cid_invalid);
+
+            bits   = bits << 5 | (value & 0x1f);
+            nbits += 5;
+
+            if (nbits >= 8) {
+                nbits -= 8;
+                bytes[len++] = bits >> nbits;
+            }
+        }
+
+        struct bsky_view view = { bytes, bytes + len };
+        cid = bsky_parse_cid_bytes(&view, ec);
+
+    defer:
+        return cid;
+    }
+
+    struct bsky_str bsky_cid_format(char *buf, struct bsky_cid cid)
+    {
+        unsigned char bytes[BSKY_CID_BYTES];
+        unsigned long long bits = 0;
+        size_t nbits = 0, len = 0;
+
+        bsky_cid_to_bytes(bytes, cid);
+
+        buf[len++] = 'b';
+        for (size_t i = 0; i < BSKY_CID_BYTES; ++i) {
+            bits   = bits << 8 | bytes[i];
+            nbits += 8;
+
+            while (nbits >= 5) {
+                nbits -= 5;
+                buf[len++] = __bsky_b32_chars[bits >> nbits & 0x1f];
+            }
+        }
+
+        if (nbits > 0)
+            buf[len++] = __bsky_b32_chars[bits << (5 - nbits) & 0x1f];
+        buf[len] = '\0';
+
+        return (struct bsky_str) { buf, buf + len };
+    }
+
+    /*
+     * BSKY DAG-CBOR
+     */
+    #include <limits.h>
+
+    // read head of item: major type and its argument.
+    static unsigned long long __bsky_cbor_head(struct bsky_view *data,
+                                               int *major,
+                                               enum bsky_error_code *ec)
+    {
+        *ec = bsky_ec_Ok;
+
+        unsigned char *c = data->start, *end = data->end;
+        unsigned long long value = 0;
+
+        if (c >= end) bsky_defer_ec(bsky_ec_Cbor_truncated);
+
+        *major = *c >> 5;
+        int info = *c++ & 0x1f;
+
+        if (info < 24) {
+            value = info;
+        } else if (info <= 27) {
+            size_t size = (size_t) 1 << (info - 24);
+
+            if ((size_t) (end - c) < size)
+                bsky_defer_ec(bsky_ec_Cbor_truncated);
+
+            for (size_t i = 0; i < size; ++i) value = value << 8 | c[i];
+            c += size;
+
+            // shortest form only (floats are bits, not length).
+            if (*major != 7 && value < (size == 1 ? 24 : 1ULL << size * 4))
+                bsky_defer_ec(bsky_ec_Cbor_invalid);
+        } else if (info == 31) {
+            bsky_defer_ec(bsky_ec_Cbor_unsupported);
+        } else {
+            bsky_defer_ec(bsky_ec_Cbor_invalid);
+        }
+
+        data->start = c;
+
+    defer:
+        return value;
+    }
+
+    static struct bsky_cbor __bsky_cbor_item(struct bsky_view *data,
+                                             enum bsky_error_code *ec)
+    {
+        struct bsky_cbor item = { 0 };
+        unsigned char *start = data->start;
+        int major = 0, info = start < (unsigned char *) data->end
+                                ? *start & 0x1f : 0;
+
+        unsigned long long value = __bsky_cbor_head(data, &major, ec);
+        if (*ec != bsky_ec_Ok) goto defer;
+
+        unsigned char *c = data->start;
+        size_t rest = (unsigned char *) data->end - c;
+
+        switch (major) {
+        case 0: case 1:
+            if (value > LLONG_MAX) bsky_defer_ec(bsky_ec_Cbor_unsupported);
+
+            item.type    = bsky_cbor_Int;
+            item.integer = major == 0 ? (long long) value
+                                      : -1 - (long long) value;
+            break;
+
+        case 2: case 3:
+            if (value > rest) bsky_defer_ec(bsky_ec_Cbor_truncated);
+
+            item.type  = major == 2 ? bsky_cbor_Bytes : bsky_cbor_Text;
+            item.bytes = (struct bsky_view) { c, c + value };
+
+            if (major == 3 && !bsky_utf8_valid(item.text))
+                bsky_defer_ec(bsky_ec_Cbor_invalid);
+
+            data->start = c + value;
+            break;
+
+        case 4: case 5:
+            // every item takes at least a byte.
+            if (value > rest / (major == 4 ? 1 : 2))
+                bsky_defer_ec(bsky_ec_Cbor_truncated);
+
+            item.type = major == 4 ? bsky_cbor_Arr : bsky_cbor_Map;
+            item.len  = value;
+            break;
+
+        case 6: {
+            if (value != 42) bsky_defer_ec(bsky_ec_Cbor_unsupported);
+
+            // link is byte string of 0x00 (identity multibase) and CID.
+            value = __bsky_cbor_head(data, &major, ec);
+            if (*ec != bsky_ec_Ok) goto defer;
+
+            c = data->start;
+            if (major != 2 || value != 1 + BSKY_CID_BYTES ||
+                value > (size_t) ((unsigned char *) data->end - c) || *c != 0)
+                bsky_defer_ec(bsky_ec_Cbor_invalid);
+
+            struct bsky_view cid = { c + 1, c + value };
+
+            item.type = bsky_cbor_Link;
+            item.link = bsky_parse_cid_bytes(&cid, ec);
+            if (*ec != bsky_ec_Ok) goto defer;
+
+            data->start = cid.start;
+            break;
+        }
+
+        case 7:
+            if (info == 20 || info == 21) {
+                item.type  = bsky_cbor_Bool;
+                item._bool = info == 21;
+            } else if (info == 22) {
+                item.type = bsky_cbor_Null;
+            } else if (info == 27) {
+                item.type = bsky_cbor_Float;
+                memcpy(&item.num, &value, sizeof item.num);
+            } else {
+                bsky_defer_ec(bsky_ec_Cbor_unsupported);
+            }
+            break;
+        }
+
+    defer:
+        if (*ec != bsky_ec_Ok) {
+            data->start = start;
+            item = (struct bsky_cbor) { 0 };
+        }
+
+        return item;
+    }
+
+    // skip items by heads only, content is checked when it's read.
+    static enum bsky_error_code __bsky_cbor_skip_heads(struct bsky_view *data,
+                                                       size_t left)
+    {
+        enum bsky_error_code ec = bsky_ec_Ok;
+
+        for (; left > 0; --left) {
+            int major;
+            unsigned long long value = __bsky_cbor_head(data, &major, &ec);
+            if (ec != bsky_ec_Ok) return ec;
+
+            size_t rest = (char *) data->end - (char *) data->start;
+
+            switch (major) {
+            case 2: case 3:
+                if (value > rest) return bsky_ec_Cbor_truncated;
+                data->start = (char *) data->start + value;
+                break;
+            case 4: case 5:
+                if (value > rest / (major == 4 ? 1 : 2))
+                    return bsky_ec_Cbor_truncated;
+                left += major == 4 ? value : value * 2;
+                break;
+            case 6:
+                left++;
+                break;
+            }
+        }
+
+        return ec;
+    }
+
+    // keys of DAG-CBOR map: text, sorted by length then bytes, unique.
+    static enum bsky_error_code __bsky_cbor_check_keys(struct bsky_view data,
+                                                       size_t len)
+    {
+        enum bsky_error_code ec = bsky_ec_Ok;
+        unsigned char *prev = NULL;
+        size_t prev_len = 0;
+
+        for (size_t i = 0; i < len; ++i) {
+            int major;
+            unsigned long long value = __bsky_cbor_head(&data, &major, &ec);
+            if (ec != bsky_ec_Ok) return ec;
+
+            unsigned char *key = data.start;
+            size_t key_len = (size_t) value;
+
+            if (major != 3) return bsky_ec_Cbor_invalid;
+            if (value > (size_t) ((unsigned char *) data.end - key))
+                return bsky_ec_Cbor_truncated;
+
+            if (prev != NULL && (key_len < prev_len ||
+                                 (key_len == prev_len &&
+                                  memcmp(prev, key, key_len) >= 0)))
+                return bsky_ec_Cbor_invalid;
+
+            prev       = key;
+            prev_len   = key_len;
+            data.start = key + key_len;
+
+            ec = __bsky_cbor_skip_heads(&data, 1);
+            if (ec != bsky_ec_Ok) return ec;
+        }
+
+        return ec;
+    }
+
+    struct bsky_cbor bsky_cbor_read(struct bsky_view *data,
+                                    enum bsky_error_code *ec)
+    {
+        void *start = data->start;
+        struct bsky_cbor item = __bsky_cbor_item(data, ec);
+
+        if (*ec == bsky_ec_Ok && item.type == bsky_cbor_Map) {
+            *ec = __bsky_cbor_check_keys(*data, item.len);
+
+            if (*ec != bsky_ec_Ok) {
+                data->start = start;
+                item = (struct bsky_cbor) { 0 };
+            }
+        }
+
+        return item;
+    }
+
+    void bsky_cbor_skip(struct bsky_view *data, enum bsky_error_code *ec)
+    {
+        // containers only add their items to skip, so no recursion.
+        for (size_t left = 1; left > 0; --left) {
+            struct bsky_cbor item = __bsky_cbor_item(data, ec);
+            if (*ec != bsky_ec_Ok) return;
+
+            if (item.type == bsky_cbor_Arr) left += item.len;
+            if (item.type == bsky_cbor_Map) left += item.len * 2;
+        }
+    }
+
+    // Leave function with error of push.
+    #define __bsky_try_push(push) do {                              \
+                enum bsky_error_code __push_ec = (push);            \
+                if (__push_ec != bsky_ec_Ok) return __push_ec;      \
+            } while (0)
+
+    static enum bsky_error_code __bsky_cbor_push_head(struct bsky_bytes *buf,
+                                                      int major,
+                                                      unsigned long long value)
+    {
+        unsigned char head[9];
+        size_t size = value < 24          ? 0 :
+                      value <= 0xff       ? 1 :
+                      value <= 0xffff     ? 2 :
+                      value <= 0xffffffff ? 4 : 8;
+        int info = 24;
+
+        for (size_t s = size; s > 1; s >>= 1) info++;
+
+        if (size == 0) info = (int) value;
+
+        head[0] = (unsigned char) (major << 5 | info);
+        for (size_t i = 0; i < size; ++i)
+            head[1 + i] = value >> (size - 1 - i) * 8;
+
+        return __bsky_da_append(buf, head, 1, 1 + size);
+    }
+
+    // Head and payload, or nothing.
+    static enum bsky_error_code __bsky_cbor_push_string(struct bsky_bytes *buf,
+                                                        int major,
+                                                        const void *data,
+                                                        size_t len)
+    {
+        size_t buf_len = buf->len;
+        enum bsky_error_code ec = __bsky_cbor_push_head(buf, major, len);
+
+        if (ec == bsky_ec_Ok) ec = __bsky_da_append(buf, data, 1, len);
+        if (ec != bsky_ec_Ok) buf->len = buf_len;
+
+        return ec;
+    }
+
+    enum bsky_error_code bsky_cbor_push_int(struct bsky_bytes *buf,
+                                            long long value)
+    {
+        if (value >= 0) return __bsky_cbor_push_head(buf, 0, value);
+        else            return __bsky_cbor_push_head(buf, 1, -1 - value);
+    }
+
+    enum bsky_error_code bsky_cbor_push_bytes(struct bsky_bytes *buf,
+                                              struct bsky_view bytes)
+    {
+        return __bsky_cbor_push_string(buf, 2, bytes.start,
+                                       (char *) bytes.end -
+                                       (char *) bytes.start);
+    }
+
+    enum bsky_error_code bsky_cbor_push_text(struct bsky_bytes *buf,
+                                             struct bsky_str text)
+    {
+        return __bsky_cbor_push_string(buf, 3, text.start,
+                                       bsky_str_len(text));
+    }
+
+    enum bsky_error_code bsky_cbor_push_link(struct bsky_bytes *buf,
+                                             struct bsky_cid cid)
+    {
+        unsigned char bytes[1 + BSKY_CID_BYTES] = { 0 };
+        size_t buf_len = buf->len;
+
+        bsky_cid_to_bytes(bytes + 1, cid);
+
+        enum bsky_error_code ec = __bsky_cbor_push_head(buf, 6, 42);
+
+        if (ec == bsky_ec_Ok)
+            ec = __bsky_cbor_push_string(buf, 2, bytes, sizeof bytes);
+        if (ec != bsky_ec_Ok) buf->len = buf_len;
+
+        return ec;
+    }
+
+    enum bsky_error_code bsky_cbor_push_bool(struct bsky_bytes *buf,
+                                             int value) {
+        return __bsky_cbor_push_head(buf, 7, value ? 21 : 20);
+    }
+
+    enum bsky_error_code bsky_cbor_push_null(struct bsky_bytes *buf) {
+        return __bsky_cbor_push_head(buf, 7, 22);
+    }
+
+    enum bsky_error_code bsky_cbor_push_arr(struct bsky_bytes *buf,
+                                            size_t len) {
+        return __bsky_cbor_push_head(buf, 4, len);
+    }
+
+    enum bsky_error_code bsky_cbor_push_map(struct bsky_bytes *buf,
+                                            size_t len) {
+        return __bsky_cbor_push_head(buf, 5, len);
+    }
+
+    /*
+     * BSKY BLOCKS
+     */
+    // copies of blocks are bump allocated from chunks.
+    struct __bsky_block_chunk {
+        struct __bsky_block_chunk *next;
+        size_t len, cap;
+        unsigned char data[];
+    };
+
+    #define __BSKY_BLOCK_CHUNK (0x40 * 0x400)
+
+    static unsigned char __bsky_block_empty[1];
+
+    static size_t __bsky_block_slot(struct bsky_block_slot *slots, size_t cap,
+                                    struct bsky_cid cid)
+    {
+        unsigned long long hash;
+
+        // digest is uniform already.
+        memcpy(&hash, cid.digest, sizeof hash);
+
+        size_t i = hash & (cap - 1);
+        while (slots[i].block.start != NULL && !bsky_cid_eq(slots[i].cid, cid))
+            i = (i + 1) & (cap - 1);
+
+        return i;
+    }
+
+    static void *__bsky_block_copy(struct bsky_block_map *map,
+                                   struct bsky_view block)
+    {
+        size_t len = (char *) block.end - (char *) block.start;
+        struct __bsky_block_chunk *chunk = map->chunks;
+
+        if (chunk == NULL || chunk->cap - chunk->len < len) {
+            size_t cap = len > __BSKY_BLOCK_CHUNK / 4 ? len
+                                                      : __BSKY_BLOCK_CHUNK;
+
+            chunk = __bsky_malloc(sizeof *chunk + cap);
+            if (chunk == NULL) return NULL;
+
+            chunk->len = 0;
+            chunk->cap = cap;
+
+            // big blocks get own chunk, behind the current one.
+            if (map->chunks != NULL && cap == len) {
+                chunk->next       = map->chunks->next;
+                map->chunks->next = chunk;
+            } else {
+                chunk->next = map->chunks;
+                map->chunks = chunk;
+            }
+        }
+
+        void *copy = chunk->data + chunk->len;
+        memcpy(copy, block.start, len);
+        chunk->len += len;
+
+        return copy;
+    }
+
+    enum bsky_error_code bsky_block_map_get(struct bsky_block_map *map,
+                                            struct bsky_cid cid,
+                                            struct bsky_view *block)
+    {
+        if (map->cap == 0) return bsky_ec_Block_not_found;
+
+        struct bsky_block_slot *slot =
+            &map->slots[__bsky_block_slot(map->slots, map->cap, cid)];
+
+        if (slot->block.start == NULL) return bsky_ec_Block_not_found;
+
+        *block = slot->block;
+        return bsky_ec_Ok;
+    }
+
+    enum bsky_error_code bsky_block_map_put(struct bsky_block_map *map,
+                                            struct bsky_cid cid,
+                                            struct bsky_view block)
+    {
+        if ((map->len + 1) * 4 > map->cap * 3) {
+            size_t cap = map->cap ? map->cap * 2 : 64;
+            struct bsky_block_slot *slots = __bsky_calloc(cap, sizeof *slots);
+
+            if (slots == NULL) return bsky_ec_Tmp_overflow;
+
+            for (size_t i = 0; i < map->cap; ++i) {
+                if (map->slots[i].block.start == NULL) continue;
+
+                slots[__bsky_block_slot(slots, cap, map->slots[i].cid)] =
+                    map->slots[i];
+            }
+
+            if (map->slots != NULL) __bsky_free(map->slots);
+            map->slots = slots;
+            map->cap   = cap;
+        }
+
+        struct bsky_block_slot *slot =
+            &map->slots[__bsky_block_slot(map->slots, map->cap, cid)];
+
+        // same CID is the same block.
+        if (slot->block.start != NULL) return bsky_ec_Ok;
+
+        if (!map->borrow) {
+            void *copy = __bsky_block_copy(map, block);
+            if (copy == NULL) return bsky_ec_Tmp_overflow;
+
+            block.end   = (char *) copy + ((char *) block.end -
+                                           (char *) block.start);
+            block.start = copy;
+        } else if (block.start == NULL) {
+            block.start = block.end = __bsky_block_empty;
+        }
+
+        slot->cid   = cid;
+        slot->block = block;
+        map->len++;
+
+        return bsky_ec_Ok;
+    }
+
+    static enum bsky_error_code __bsky_block_map_get(void *ctx,
+                                                     struct bsky_cid cid,
+                                                     struct bsky_view *block)
+    {
+        return bsky_block_map_get(ctx, cid, block);
+    }
+
+    static enum bsky_error_code __bsky_block_map_put(void *ctx,
+                                                     struct bsky_cid cid,
+                                                     struct bsky_view block)
+    {
+        return bsky_block_map_put(ctx, cid, block);
+    }
+
+    struct bsky_block_store bsky_block_map_store(struct bsky_block_map *map)
+    {
+        return (struct bsky_block_store) {
+            .get = __bsky_block_map_get,
+            .put = __bsky_block_map_put,
+            .ctx = map,
+        };
+    }
+
+    void bsky_block_map_reset(struct bsky_block_map *map)
+    {
+        struct __bsky_block_chunk *keep = map->chunks, *next;
+
+        // the newest chunk is kept for the next blocks.
+        if (keep != NULL) {
+            for (struct __bsky_block_chunk *c = keep->next; c; c = next) {
+                next = c->next;
+                __bsky_free(c);
+            }
+
+            keep->next = NULL;
+            keep->len  = 0;
+        }
+
+        if (map->len != 0)
+            memset(map->slots, 0, map->cap * sizeof *map->slots);
+
+        map->len = 0;
+    }
+
+    void bsky_block_map_free(struct bsky_block_map *map)
+    {
+        for (struct __bsky_block_chunk *next; map->chunks; map->chunks = next) {
+            next = map->chunks->next;
+            __bsky_free(map->chunks);
+        }
+
+        if (map->slots != NULL) __bsky_free(map->slots);
+
+        map->slots = NULL;
+        map->len   = map->cap = 0;
+    }
+
+    static unsigned long long __bsky_car_varint(struct bsky_view *data,
+                                                enum bsky_error_code *ec)
+    {
+        *ec = bsky_ec_Ok;
+
+        unsigned char *c = data->start, *end = data->end;
+        unsigned long long value = 0;
+
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (c >= end) break;
+
+            value |= (unsigned long long) (*c & 0x7f) << shift;
+            if ((*c++ & 0x80) == 0) {
+                data->start = c;
+                return value;
+            }
+        }
+
+        *ec = bsky_ec_Car_invalid;
+        return 0;
+    }
+
+    static enum bsky_error_code
+    __bsky_car_push_varint(struct bsky_bytes *buf, unsigned long long value)
+    {
+        unsigned char bytes[10];
+        size_t len = 0;
+
+        do {
+            bytes[len++] = (value & 0x7f) | (value > 0x7f ? 0x80 : 0);
+            value >>= 7;
+        } while (value > 0);
+
+        return __bsky_da_append(buf, bytes, 1, len);
+    }
+
+    struct bsky_car bsky_car_open(struct bsky_view data,
+                                  enum bsky_error_code *ec)
+    {
+        struct bsky_car car = { 0 };
+        long long version = 0;
+
+        unsigned long long len = __bsky_car_varint(&data, ec);
+        if (*ec != bsky_ec_Ok) goto defer;
+
+        if (len > (size_t) ((char *) data.end - (char *) data.start))
+            bsky_defer_ec(bsky_ec_Car_invalid);
+
+        struct bsky_view header = { data.start, (char *) data.start + len };
+        car.rest = (struct bsky_view) { header.end, data.end };
+
+        struct bsky_cbor map = bsky_cbor_read(&header, ec);
+        if (*ec != bsky_ec_Ok) goto defer;
+        if (map.type != bsky_cbor_Map) bsky_defer_ec(bsky_ec_Car_invalid);
+
+        for (size_t i = 0; i < map.len; ++i) {
+            struct bsky_cbor key = bsky_cbor_read(&header, ec), value;
+            if (*ec != bsky_ec_Ok) goto defer;
+            if (key.type != bsky_cbor_Text) bsky_defer_ec(bsky_ec_Car_invalid);
+
+            if (bsky_str_eq(key.text, bsky_mk_str("version"))) {
+                value = bsky_cbor_read(&header, ec);
+                if (*ec != bsky_ec_Ok) goto defer;
+                if (value.type != bsky_cbor_Int)
+                    bsky_defer_ec(bsky_ec_Car_invalid);
+
+                version = value.integer;
+            } else if (bsky_str_eq(key.text, bsky_mk_str("roots"))) {
+                struct bsky_cbor roots = bsky_cbor_read(&header, ec);
+                if (*ec != bsky_ec_Ok) goto defer;
+                if (roots.type != bsky_cbor_Arr)
+                    bsky_defer_ec(bsky_ec_Car_invalid);
+
+                for (size_t j = 0; j < roots.len; ++j) {
+                    value = bsky_cbor_read(&header, ec);
+                    if (*ec != bsky_ec_Ok) goto defer;
+                    if (value.type != bsky_cbor_Link)
+                        bsky_defer_ec(bsky_ec_Car_invalid);
+
+                    if (car.roots++ == 0) car.root = value.link;
+                }
+            } else {
+                bsky_cbor_skip(&header, ec);
+                if (*ec != bsky_ec_Ok) goto defer;
+            }
+        }
+
+        if (version != 1) bsky_defer_ec(bsky_ec_Car_invalid);
+
+    defer:
+        if (*ec != bsky_ec_Ok) car = (struct bsky_car) { 0 };
+
+        return car;
+    }
+
+    int bsky_car_next(struct bsky_car *car, struct bsky_cid *cid,
+                      struct bsky_view *block, enum bsky_error_code *ec)
+    {
+        *ec = bsky_ec_Ok;
+
+        if (car->rest.start >= car->rest.end) return 0;
+
+        unsigned long long len = __bsky_car_varint(&car->rest, ec);
+        if (*ec != bsky_ec_Ok) return 0;
+
+        if (len > (size_t) ((char *) car->rest.end - (char *) car->rest.start))
+            bsky_defer_ec(bsky_ec_Car_invalid);
+
+        struct bsky_view section = { car->rest.start,
+                                     (char *) car->rest.start + len };
+
+        *cid = bsky_parse_cid_bytes(&section, ec);
+        if (*ec != bsky_ec_Ok) goto defer;
+
+        *block = section;
+        car->rest.start = section.end;
+
+    defer:
+        return *ec == bsky_ec_Ok;
+    }
+
+    enum bsky_error_code bsky_car_load(struct bsky_car *car,
+                                       struct bsky_block_store store,
+                                       int verify)
+    {
+        enum bsky_error_code ec;
+        struct bsky_cid cid;
+        struct bsky_view block;
+
+        while (bsky_car_next(car, &cid, &block, &ec)) {
+            if (verify && !bsky_cid_verify(cid, block))
+                return bsky_ec_Block_mismatch;
+
+            if ((ec = store.put(store.ctx, cid, block)) != bsky_ec_Ok)
+                return ec;
+        }
+
+        return ec;
+    }
+
+    static enum bsky_error_code
+    __bsky_car_push_header(struct bsky_bytes *buf, struct bsky_bytes *header,
+                           struct bsky_cid root)
+    {
+        __bsky_try_push(bsky_cbor_push_map(header, 2));
+        __bsky_try_push(bsky_cbor_push_text(header, bsky_mk_str("roots")));
+        __bsky_try_push(bsky_cbor_push_arr(header, 1));
+        __bsky_try_push(bsky_cbor_push_link(header, root));
+        __bsky_try_push(bsky_cbor_push_text(header, bsky_mk_str("version")));
+        __bsky_try_push(bsky_cbor_push_int(header, 1));
+
+        __bsky_try_push(__bsky_car_push_varint(buf, header->len));
+
+        return __bsky_da_append(buf, header->data, 1, header->len);
+    }
+
+    enum bsky_error_code bsky_car_push_header(struct bsky_bytes *buf,
+                                              struct bsky_cid root)
+    {
+        struct bsky_bytes header = { 0 };
+        size_t buf_len = buf->len;
+        enum bsky_error_code ec = __bsky_car_push_header(buf, &header, root);
+
+        if (ec != bsky_ec_Ok) buf->len = buf_len;
+        bsky_da_free(&header);
+
+        return ec;
+    }
+
+    enum bsky_error_code bsky_car_push_block(struct bsky_bytes *buf,
+                                             struct bsky_cid cid,
+                                             struct bsky_view block)
+    {
+        unsigned char bytes[BSKY_CID_BYTES];
+        size_t len = (char *) block.end - (char *) block.start,
+               buf_len = buf->len;
+        enum bsky_error_code ec;
+
+        ec = __bsky_car_push_varint(buf, BSKY_CID_BYTES + len);
+        if (ec == bsky_ec_Ok)
+            ec = __bsky_da_append(buf, bytes, 1,
+                                  bsky_cid_to_bytes(bytes, cid));
+        if (ec == bsky_ec_Ok)
+            ec = __bsky_da_append(buf, block.start, 1, len);
+
+        if (ec != bsky_ec_Ok) buf->len = buf_len;
+
+        return ec;
+    }
+
+    /*
+     * BSKY BLOCK FILE
+     */
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+
+    #define __BSKY_BLOCK_FILE_MAGIC   "BSKYBLK1"
+    #define __BSKY_BLOCK_INDEX_MAGIC  "BSKYIDX1"
+    #define __BSKY_BLOCK_FILE_RESERVE (0x40 * 0x400 * 0x400)
+
+    struct __bsky_block_index_header {
+        char magic[8];
+        uint32_t order;                  // 0x01020304 in native order
+        uint32_t entry_size;
+        uint64_t data_len;               // part of data file indexed
+        uint64_t len;
+    };
+
+    struct __bsky_block_file_map {
+        struct __bsky_block_file_map *next;
+        void *data;
+        size_t len;
+    };
+
+    static int __bsky_block_file_cmp(const struct bsky_block_file_entry *e,
+                                     struct bsky_cid cid)
+    {
+        int cmp = memcmp(e->digest, cid.digest, BSKY_SHA256_LEN);
+
+        if (cmp != 0) return cmp;
+
+        return (e->codec > (uint32_t) cid.codec) -
+               (e->codec < (uint32_t) cid.codec);
+    }
+
+    static int __bsky_block_file_entry_cmp(const void *fst, const void *snd)
+    {
+        const struct bsky_block_file_entry *e = snd;
+        struct bsky_cid cid = { .codec = e->codec };
+
+        memcpy(cid.digest, e->digest, BSKY_SHA256_LEN);
+
+        return __bsky_block_file_cmp(fst, cid);
+    }
+
+    // first digest bytes as number, in order of digests.
+    static uint64_t __bsky_block_file_key(const unsigned char *digest)
+    {
+        uint64_t key = 0;
+
+        for (size_t i = 0; i < 8; ++i) key = key << 8 | digest[i];
+
+        return key;
+    }
+
+    static const struct bsky_block_file_entry *
+    __bsky_block_file_search(const struct bsky_block_file_entry *index,
+                             size_t len, struct bsky_cid cid)
+    {
+        uint64_t key = __bsky_block_file_key(cid.digest);
+        size_t lo = 0, hi = len;
+
+        // digests are uniform: interpolation finds the entry in a couple
+        // of probes (few pages touched), bisection bounds the worst case.
+        for (size_t probe = 0; lo < hi; ++probe) {
+            size_t mid = lo + (hi - lo) / 2;
+
+            if (probe < 4) {
+                uint64_t lo_key = __bsky_block_file_key(index[lo].digest),
+                         hi_key = __bsky_block_file_key(index[hi - 1].digest);
+
+                if (key < lo_key || key > hi_key) return NULL;
+                if (hi_key > lo_key)
+                    mid = lo + (size_t) ((double) (key - lo_key) /
+                                         (hi_key - lo_key) * (hi - 1 - lo));
+            }
+
+            int cmp = __bsky_block_file_cmp(&index[mid], cid);
+
+            if (cmp == 0) return &index[mid];
+            if (cmp < 0) lo = mid + 1;
+            else         hi = mid;
+        }
+
+        return NULL;
+    }
+
+    static size_t __bsky_block_file_slot(struct bsky_block_file_entry *slots,
+                                         size_t cap, struct bsky_cid cid)
+    {
+        unsigned long long hash;
+
+        memcpy(&hash, cid.digest, sizeof hash);
+
+        size_t i = hash & (cap - 1);
+        while (slots[i].offset != 0 && __bsky_block_file_cmp(&slots[i], cid))
+            i = (i + 1) & (cap - 1);
+
+        return i;
+    }
+
+    static const struct bsky_block_file_entry *
+    __bsky_block_file_find(struct bsky_block_file *file, struct bsky_cid cid)
+    {
+        if (file->recent_len != 0) {
+            struct bsky_block_file_entry *slot = &file->recent[
+                __bsky_block_file_slot(file->recent, file->recent_cap, cid)];
+
+            if (slot->offset != 0) return slot;
+        }
+
+        return __bsky_block_file_search(file->index, file->index_len, cid);
+    }
+
+    static enum bsky_error_code
+    __bsky_block_file_add(struct bsky_block_file *file,
+                          struct bsky_block_file_entry entry)
+    {
+        if ((file->recent_len + 1) * 4 > file->recent_cap * 3) {
+            size_t cap = file->recent_cap ? file->recent_cap * 2 : 64;
+            struct bsky_block_file_entry *slots = __bsky_calloc(cap,
+                                                                sizeof *slots);
+
+            if (slots == NULL) return bsky_ec_Tmp_overflow;
+
+            for (size_t i = 0; i < file->recent_cap; ++i) {
+                struct bsky_block_file_entry *e = &file->recent[i];
+                struct bsky_cid cid = { .codec = e->codec };
+
+                if (e->offset == 0) continue;
+
+                memcpy(cid.digest, e->digest, BSKY_SHA256_LEN);
+                slots[__bsky_block_file_slot(slots, cap, cid)] = *e;
+            }
+
+            if (file->recent != NULL) __bsky_free(file->recent);
+            file->recent     = slots;
+            file->recent_cap = cap;
+        }
+
+        struct bsky_cid cid = { .codec = entry.codec };
+        memcpy(cid.digest, entry.digest, BSKY_SHA256_LEN);
+
+        file->recent[__bsky_block_file_slot(file->recent, file->recent_cap,
+                                            cid)] = entry;
+        file->recent_len++;
+
+        return bsky_ec_Ok;
+    }
+
+    static enum bsky_error_code __bsky_block_file_pwrite(int fd,
+                                                         const void *data,
+                                                         size_t len,
+                                                         size_t offset)
+    {
+        while (len > 0) {
+            ssize_t n = pwrite(fd, data, len, offset);
+
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return bsky_ec_Block_file_io;
+
+            data    = (const char *) data + n;
+            len    -= n;
+            offset += n;
+        }
+
+        return bsky_ec_Ok;
+    }
+
+    static char *__bsky_block_file_name(const char *path, const char *suffix)
+    {
+        size_t len = strlen(path), suffix_len = strlen(suffix);
+        char *name = __bsky_malloc(len + suffix_len + 1);
+
+        if (name == NULL) return NULL;
+
+        memcpy(name, path, len);
+        memcpy(name + len, suffix, suffix_len + 1);
+
+        return name;
+    }
+
+    // (re)map data file so that mapping covers `data_len', previous
+    // mapping is retired to `old' (taken even on error): views into it
+    // stay valid.
+    static enum bsky_error_code __bsky_block_file_remap(
+                                            struct bsky_block_file *file,
+                                            struct __bsky_block_file_map *old)
+    {
+        size_t cap = __BSKY_BLOCK_FILE_RESERVE;
+
+        // room to grow, so that remaps are rare.
+        while (cap < file->data_len * 2) cap *= 2;
+
+        // pages beyond end of file are not touched, but once file grows
+        // they are backed by it.
+        void *map = mmap(NULL, cap, PROT_READ, MAP_SHARED, file->fd, 0);
+
+        if (map == MAP_FAILED) {
+            if (old != NULL) __bsky_free(old);
+            return bsky_ec_Block_file_io;
+        }
+
+        if (old != NULL) {
+            *old = (struct __bsky_block_file_map) {
+                file->retired, file->map, file->map_cap
+            };
+            file->retired = old;
+        }
+
+        file->map     = map;
+        file->map_cap = cap;
+
+        return bsky_ec_Ok;
+    }
+
+    static enum bsky_error_code __bsky_block_file_map(
+                                                struct bsky_block_file *file)
+    {
+        struct __bsky_block_file_map *old = NULL;
+
+        if (file->map != NULL) {
+            old = __bsky_malloc(sizeof *old);
+            if (old == NULL) return bsky_ec_Tmp_overflow;
+        }
+
+        return __bsky_block_file_remap(file, old);
+    }
+
+    // Map index file if it's valid for the data file.
+    static void __bsky_block_file_load_index(struct bsky_block_file *file)
+    {
+        struct __bsky_block_index_header header;
+        struct stat st;
+        char *name = __bsky_block_file_name(file->path, ".idx");
+
+        if (name == NULL) return;
+
+        int fd = open(name, O_RDONLY | O_CLOEXEC);
+        __bsky_free(name);
+
+        if (fd < 0) return;
+
+        if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof header ||
+            pread(fd, &header, sizeof header, 0) != (ssize_t) sizeof header ||
+            memcmp(header.magic, __BSKY_BLOCK_INDEX_MAGIC, 8) != 0 ||
+            header.order != 0x01020304 ||
+            header.entry_size != sizeof (struct bsky_block_file_entry) ||
+            header.data_len > file->data_len ||
+            header.data_len < sizeof __BSKY_BLOCK_FILE_MAGIC - 1 ||
+            (size_t) st.st_size != sizeof header + header.len *
+                                   sizeof (struct bsky_block_file_entry))
+            goto defer;
+
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) goto defer;
+
+        file->index_map     = map;
+        file->index_map_len = st.st_size;
+        file->index         = (void *) ((char *) map + sizeof header);
+        file->index_len     = header.len;
+        file->indexed       = header.data_len;
+
+    defer:
+        close(fd);
+    }
+
+    // Make renames in directory of `path' durable.
+    static enum bsky_error_code __bsky_block_file_sync_dir(const char *path)
+    {
+        const char *slash = strrchr(path, '/');
+        char *dir = slash == NULL ? __bsky_block_file_name(".", "")
+                                  : __bsky_block_file_name(path, "");
+
+        if (dir == NULL) return bsky_ec_Tmp_overflow;
+        if (slash != NULL) dir[slash == path ? 1 : slash - path] = '\0';
+
+        int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        __bsky_free(dir);
+
+        if (fd < 0) return bsky_ec_Block_file_io;
+
+        enum bsky_error_code ec = fsync(fd) == 0 ? bsky_ec_Ok
+                                                 : bsky_ec_Block_file_io;
+        close(fd);
+
+        return ec;
+    }
+
+    // Write index of sorted `fst' and `snd' entries covering `data_len'
+    // bytes of data file. Data must be synced before.
+    static enum bsky_error_code
+    __bsky_block_file_write_index(struct bsky_block_file *file,
+                                  const struct bsky_block_file_entry *fst,
+                                  size_t fst_len,
+                                  const struct bsky_block_file_entry *snd,
+                                  size_t snd_len)
+    {
+        enum bsky_error_code ec = bsky_ec_Tmp_overflow;
+        struct bsky_bytes buf = { 0 };
+        struct __bsky_block_index_header header = {
+            .order      = 0x01020304,
+            .entry_size = sizeof (struct bsky_block_file_entry),
+            .data_len   = file->data_len,
+            .len        = fst_len + snd_len,
+        };
+        size_t written = 0;
+        int fd = -1;
+        char *name = __bsky_block_file_name(file->path, ".idx"),
+             *tmp  = __bsky_block_file_name(file->path, ".idx.tmp");
+
+        if (name == NULL || tmp == NULL) goto defer;
+
+        memcpy(header.magic, __BSKY_BLOCK_INDEX_MAGIC, sizeof header.magic);
+
+        ec = bsky_ec_Block_file_io;
+        fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) goto defer;
+
+        ec = __bsky_da_append(&buf, &header, 1, sizeof header);
+        if (ec != bsky_ec_Ok) goto defer;
+
+        // merge, written by chunks.
+        while (fst_len + snd_len > 0) {
+            const struct bsky_block_file_entry *e;
+
+            if (snd_len == 0 ||
+                (fst_len > 0 && __bsky_block_file_entry_cmp(fst, snd) < 0)) {
+                e = fst++;
+                fst_len--;
+            } else {
+                e = snd++;
+                snd_len--;
+            }
+
+            ec = __bsky_da_append(&buf, e, 1, sizeof *e);
+            if (ec != bsky_ec_Ok) goto defer;
+
+            if (buf.len >= file->batch || fst_len + snd_len == 0) {
+                ec = __bsky_block_file_pwrite(fd, buf.data, buf.len, written);
+                if (ec != bsky_ec_Ok) goto defer;
+
+                written += buf.len;
+                buf.len  = 0;
+            }
+        }
+
+        if (buf.len > 0) {
+            ec = __bsky_block_file_pwrite(fd, buf.data, buf.len, written);
+            if (ec != bsky_ec_Ok) goto defer;
+        }
+
+        ec = fsync(fd) == 0 && rename(tmp, name) == 0
+           ? __bsky_block_file_sync_dir(file->path) : bsky_ec_Block_file_io;
+
+    defer:
+        if (fd >= 0) close(fd);
+        if (name != NULL) __bsky_free(name);
+        if (tmp != NULL) __bsky_free(tmp);
+        bsky_da_free(&buf);
+
+        return ec;
+    }
+
+    static void __bsky_block_file_unload_index(struct bsky_block_file *file)
+    {
+        if (file->index_map != NULL)
+            munmap(file->index_map, file->index_map_len);
+
+        file->index_map = NULL;
+        file->index     = NULL;
+        file->index_len = file->index_map_len = 0;
+        file->indexed   = 0;
+    }
+
+    static void __bsky_block_file_release(struct bsky_block_file *file)
+    {
+        __bsky_block_file_unload_index(file);
+
+        if (file->map != NULL) munmap(file->map, file->map_cap);
+
+        for (struct __bsky_block_file_map *next; file->retired;
+             file->retired = next) {
+            next = file->retired->next;
+            munmap(file->retired->data, file->retired->len);
+            __bsky_free(file->retired);
+        }
+
+        if (file->fd >= 0) close(file->fd);
+        if (file->path != NULL) __bsky_free(file->path);
+        if (file->recent != NULL) __bsky_free(file->recent);
+        bsky_da_free(&file->pending);
+
+        *file = (struct bsky_block_file) { .fd = -1 };
+    }
+
+    // Whether unparsable rest of data file is torn append: section running
+    // past end of file or zeros of space which has never been written.
+    static int __bsky_block_file_torn(struct bsky_view rest)
+    {
+        enum bsky_error_code ec;
+        struct bsky_view section = rest;
+        unsigned long long len = __bsky_car_varint(&section, &ec);
+
+        if (ec != bsky_ec_Ok ||
+            len > (size_t) ((char *) rest.end - (char *) section.start))
+            return 1;
+
+        // length may be written before the section.
+        for (unsigned char *c = section.start;
+             c < (unsigned char *) rest.end; ++c) {
+            if (*c != 0) return 0;
+        }
+
+        return 1;
+    }
+
+    // Index blocks in `[from, data_len)' of data file, cut off torn tail.
+    // Torn tail may still parse as sections, so every block is checked
+    // against its CID: block which doesn't match is left in place, but
+    // isn't indexed (compaction drops it). Sections which don't parse
+    // before the tail are reported, data isn't cut off.
+    static enum bsky_error_code __bsky_block_file_scan(
+                                                struct bsky_block_file *file,
+                                                size_t from)
+    {
+        enum bsky_error_code ec = bsky_ec_Ok;
+        struct bsky_car car = {
+            .rest = { file->map + from, file->map + file->data_len }
+        };
+        struct bsky_cid cid;
+        struct bsky_view block;
+        unsigned char *good = car.rest.start;
+
+        while (bsky_car_next(&car, &cid, &block, &ec)) {
+            good = car.rest.start;
+
+            if (!bsky_cid_verify(cid, block) ||
+                __bsky_block_file_find(file, cid) != NULL)
+                continue;
+
+            struct bsky_block_file_entry entry = {
+                .offset = (unsigned char *) block.start - file->map,
+                .len    = (unsigned char *) block.end -
+                          (unsigned char *) block.start,
+                .codec  = cid.codec,
+            };
+            memcpy(entry.digest, cid.digest, BSKY_SHA256_LEN);
+
+            enum bsky_error_code add_ec = __bsky_block_file_add(file, entry);
+            if (add_ec != bsky_ec_Ok) return add_ec;
+        }
+
+        if (ec != bsky_ec_Ok) {
+            if (!__bsky_block_file_torn((struct bsky_view) {
+                    good, file->map + file->data_len }))
+                return bsky_ec_Block_file_io;
+
+            file->data_len = good - file->map;
+            if (ftruncate(file->fd, file->data_len) != 0)
+                return bsky_ec_Block_file_io;
+        }
+
+        return bsky_ec_Ok;
+    }
+
+    struct bsky_block_file bsky_block_file_open(const char *path,
+                                                enum bsky_error_code *ec)
+    {
+        struct bsky_block_file file = { .fd = -1 };
+        struct stat st;
+        const size_t magic_len = sizeof __BSKY_BLOCK_FILE_MAGIC - 1;
+        char magic[sizeof __BSKY_BLOCK_FILE_MAGIC - 1];
+
+        file.path  = __bsky_block_file_name(path, "");
+        file.batch = BSKY_BLOCK_FILE_BATCH;
+        if (file.path == NULL) bsky_defer_ec(bsky_ec_Tmp_overflow);
+
+        file.fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (file.fd < 0 || fstat(file.fd, &st) != 0)
+            bsky_defer_ec(bsky_ec_Block_file_io);
+
+        if (st.st_size == 0) {
+            *ec = __bsky_block_file_pwrite(file.fd, __BSKY_BLOCK_FILE_MAGIC,
+                                           magic_len, 0);
+            if (*ec != bsky_ec_Ok) goto defer;
+
+            st.st_size = magic_len;
+        }
+
+        if ((size_t) st.st_size < magic_len ||
+            pread(file.fd, magic, magic_len, 0) != (ssize_t) magic_len ||
+            memcmp(magic, __BSKY_BLOCK_FILE_MAGIC, magic_len) != 0)
+            bsky_defer_ec(bsky_ec_Block_file_io);
+
+        file.data_len = st.st_size;
+
+        *ec = __bsky_block_file_map(&file);
+        if (*ec != bsky_ec_Ok) goto defer;
+
+        __bsky_block_file_load_index(&file);
+
+        *ec = __bsky_block_file_scan(&file, file.index != NULL ? file.indexed
+                                                               : magic_len);
+        if (*ec != bsky_ec_Ok) goto defer;
+
+        return file;
+
+    defer:
+        __bsky_block_file_release(&file);
+        return file;
+    }
+
+    enum bsky_error_code bsky_block_file_flush(struct bsky_block_file *file)
+    {
+        enum bsky_error_code ec;
+
+        if (file->pending.len == 0) return bsky_ec_Ok;
+
+        ec = __bsky_block_file_pwrite(file->fd, file->pending.data,
+                                      file->pending.len, file->data_len);
+        if (ec != bsky_ec_Ok) return ec;
+
+        if (file->sync && fsync(file->fd) != 0) return bsky_ec_Block_file_io;
+
+        file->data_len   += file->pending.len;
+        file->pending.len = 0;
+
+        if (file->data_len > file->map_cap)
+            return __bsky_block_file_map(file);
+
+        return bsky_ec_Ok;
+    }
+
+    enum bsky_error_code bsky_block_file_get(struct bsky_block_file *file,
+                                             struct bsky_cid cid,
+                                             struct bsky_view *block)
+    {
+        const struct bsky_block_file_entry *e =
+            __bsky_block_file_find(file, cid);
+
+        if (e == NULL) return bsky_ec_Block_not_found;
+
+        if (e->offset + e->len > file->data_len) {
+            enum bsky_error_code ec = bsky_block_file_flush(file);
+            if (ec != bsky_ec_Ok) return ec;
+
+            // index points past data.
+            if (e->offset + e->len > file->data_len)
+                return bsky_ec_Block_file_io;
+        }
+
+        block->start = file->map + e->offset;
+        block->end   = file->map + e->offset + e->len;
+
+        return bsky_ec_Ok;
+    }
+
+    enum bsky_error_code bsky_block_file_put(struct bsky_block_file *file,
+                                             struct bsky_cid cid,
+                                             struct bsky_view block)
+    {
+        enum bsky_error_code ec;
+        size_t len = (char *) block.end - (char *) block.start,
+               pending = file->pending.len;
+
+        if (__bsky_block_file_find(file, cid) != NULL) return bsky_ec_Ok;
+
+        // index keeps 32 bit lengths.
+        if (len > UINT32_MAX) return bsky_ec_Block_file_io;
+
+        ec = bsky_car_push_block(&file->pending, cid, block);
+        if (ec != bsky_ec_Ok) return ec;
+
+        struct bsky_block_file_entry entry = {
+            .offset = file->data_len + file->pending.len - len,
+            .len    = len,
+            .codec  = cid.codec,
+        };
+        memcpy(entry.digest, cid.digest, BSKY_SHA256_LEN);
+
+        ec = __bsky_block_file_add(file, entry);
+        if (ec != bsky_ec_Ok) {
+            file->pending.len = pending;
+            return ec;
+        }
+
+        if (file->pending.len >= file->batch)
+            return bsky_block_file_flush(file);
+
+        return bsky_ec_Ok;
+    }
+
+    // Sorted copy of recent entries.
+    static struct bsky_block_file_entry *
+    __bsky_block_file_sorted_recent(struct bsky_block_file *file)
+    {
+        struct bsky_block_file_entry *sorted =
+            __bsky_malloc(file->recent_len * sizeof *sorted + 1);
+        size_t len = 0;
+
+        if (sorted == NULL) return NULL;
+
+        for (size_t i = 0; i < file->recent_cap; ++i)
+            if (file->recent[i].offset != 0) sorted[len++] = file->recent[i];
+
+        qsort(sorted, len, sizeof *sorted, __bsky_block_file_entry_cmp);
+
+        return sorted;
+    }
+
+    enum bsky_error_code bsky_block_file_compact(struct bsky_block_file *file,
+                                int (*keep)(void *ctx, struct bsky_cid),
+                                void *ctx)
+    {
+        enum bsky_error_code ec;
+        struct { struct bsky_block_file_entry *data; size_t len, cap; }
+            entries = { 0 };
+        struct bsky_bytes buf = { 0 };
+        const size_t magic_len = sizeof __BSKY_BLOCK_FILE_MAGIC - 1;
+        size_t written = 0;
+        int fd = -1;
+        char *tmp = NULL, *name = NULL;
+        struct __bsky_block_file_map *retired = NULL;
+
+        ec = bsky_block_file_flush(file);
+        if (ec != bsky_ec_Ok) goto defer;
+
+        // node of current mapping is allocated upfront: once data file
+        // is replaced, it must be mapped.
+        tmp     = __bsky_block_file_name(file->path, ".compact");
+        name    = __bsky_block_file_name(file->path, ".idx");
+        retired = __bsky_malloc(sizeof *retired);
+        ec      = bsky_ec_Tmp_overflow;
+        if (tmp == NULL || name == NULL || retired == NULL) goto defer;
+
+        ec = bsky_ec_Block_file_io;
+        fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) goto defer;
+
+        ec = __bsky_da_append(&buf, __BSKY_BLOCK_FILE_MAGIC, 1, magic_len);
+        if (ec != bsky_ec_Ok) goto defer;
+
+        // live blocks in order of data file.
+        struct bsky_car car = {
+            .rest = { file->map + magic_len, file->map + file->data_len }
+        };
+        struct bsky_cid cid;
+        struct bsky_view block;
+
+        while (bsky_car_next(&car, &cid, &block, &ec)) {
+            const struct bsky_block_file_entry *e =
+                __bsky_block_file_find(file, cid);
+            size_t offset = (unsigned char *) block.start - file->map;
+
+            // duplicate or damaged block (only these aren't indexed).
+            if (e != NULL ? e->offset != offset : !bsky_cid_verify(cid, block))
+                continue;
+
+            if (keep != NULL && !keep(ctx, cid)) continue;
+
+            size_t len = (char *) block.end - (char *) block.start;
+
+            ec = bsky_car_push_block(&buf, cid, block);
+            if (ec != bsky_ec_Ok) goto defer;
+
+            struct bsky_block_file_entry entry = {
+                .offset = written + buf.len - len,
+                .len    = len,
+                .codec  = cid.codec,
+            };
+            memcpy(entry.digest, cid.digest, BSKY_SHA256_LEN);
+
+            ec = bsky_da_push(&entries, entry);
+            if (ec != bsky_ec_Ok) goto defer;
+
+            if (buf.len >= file->batch) {
+                ec = __bsky_block_file_pwrite(fd, buf.data, buf.len, written);
+                if (ec != bsky_ec_Ok) goto defer;
+
+                written += buf.len;
+                buf.len  = 0;
+            }
+        }
+        if (ec != bsky_ec_Ok) goto defer;
+
+        ec = __bsky_block_file_pwrite(fd, buf.data, buf.len, written);
+        if (ec != bsky_ec_Ok) goto defer;
+        written += buf.len;
+
+        // without index data file is scanned on open, so crash at any
+        // point leaves consistent store.
+        ec = bsky_ec_Block_file_io;
+        if (fsync(fd) != 0 || (unlink(name) != 0 && errno != ENOENT) ||
+            rename(tmp, file->path) != 0)
+            goto defer;
+
+        __bsky_block_file_unload_index(file);
+        close(file->fd);
+
+        file->fd       = fd;
+        file->data_len = written;
+        fd = -1;
+
+        if (file->recent != NULL) __bsky_free(file->recent);
+        file->recent     = NULL;
+        file->recent_len = file->recent_cap = 0;
+
+        ec = __bsky_block_file_remap(file, retired);
+        retired = NULL;
+        if (ec != bsky_ec_Ok) goto defer;
+
+        ec = __bsky_block_file_sync_dir(file->path);
+
+        if (ec == bsky_ec_Ok) {
+            qsort(entries.data, entries.len, sizeof *entries.data,
+                  __bsky_block_file_entry_cmp);
+
+            ec = __bsky_block_file_write_index(file, entries.data,
+                                               entries.len, NULL, 0);
+        }
+
+        if (ec == bsky_ec_Ok) __bsky_block_file_load_index(file);
+
+        // index is lost, but data is there (error is still reported).
+        if (file->index == NULL) {
+            enum bsky_error_code scan_ec = __bsky_block_file_scan(file,
+                                                                  magic_len);
+            if (ec == bsky_ec_Ok) ec = scan_ec;
+        }
+
+    defer:
+        if (fd >= 0) {
+            close(fd);
+            unlink(tmp);
+        }
+        if (tmp != NULL) __bsky_free(tmp);
+        if (name != NULL) __bsky_free(name);
+        if (retired != NULL) __bsky_free(retired);
+        bsky_da_free(&entries);
+        bsky_da_free(&buf);
+
+        return ec;
+    }
+
+    size_t bsky_block_file_len(const struct bsky_block_file *file) {
+        return file->index_len + file->recent_len;
+    }
+
+    static enum bsky_error_code __bsky_block_file_get(void *ctx,
+                                                      struct bsky_cid cid,
+                                                      struct bsky_view *block)
+    {
+        return bsky_block_file_get(ctx, cid, block);
+    }
+
+    static enum bsky_error_code __bsky_block_file_put(void *ctx,
+                                                      struct bsky_cid cid,
+                                                      struct bsky_view block)
+    {
+        return bsky_block_file_put(ctx, cid, block);
+    }
+
+    struct bsky_block_store bsky_block_file_store(struct bsky_block_file *file)
+    {
+        return (struct bsky_block_store) {
+            .get = __bsky_block_file_get,
+            .put = __bsky_block_file_put,
+            .ctx = file,
+        };
+    }
+
+    enum bsky_error_code bsky_block_file_close(struct bsky_block_file *file)
+    {
+        enum bsky_error_code ec = bsky_block_file_flush(file);
+
+        if (ec == bsky_ec_Ok && (file->recent_len != 0 ||
+                                 file->indexed != file->data_len)) {
+            struct bsky_block_file_entry *sorted =
+                __bsky_block_file_sorted_recent(file);
+
+            if (sorted == NULL)
+                ec = bsky_ec_Tmp_overflow;
+            else if (fsync(file->fd) != 0)
+                ec = bsky_ec_Block_file_io;
+            else
+                ec = __bsky_block_file_write_index(file, file->index,
+                                                   file->index_len, sorted,
+                                                   file->recent_len);
+
+            if (sorted != NULL) __bsky_free(sorted);
+        }
+
+        __bsky_block_file_release(file);
+
+        return ec;
+    }
+
+    /*
+     * BSKY MERKLE SEARCH TREE
+     */
+    struct __bsky_mst_leaf {
+        size_t key, key_len;             // key in frame `keys'
+        struct bsky_cid value;
+        struct bsky_cid tree;            // tree after the key, codec is 0
+                                         // if there is no tree.
+    };
+
+    // decoded node, frames are reused with their buffers.
+    struct __bsky_mst_frame {
+        struct { struct __bsky_mst_leaf *data; size_t len, cap; } leaves;
+        struct bsky_bytes keys;
+        struct bsky_cid left;
+
+        size_t pos;                      // 2i: tree before leaf i,
+                                         // 2i + 1: leaf i.
+        int layer;
+    };
+
+    enum { __bsky_mst_End, __bsky_mst_Tree, __bsky_mst_Leaf };
+
+    int bsky_mst_key_layer(struct bsky_str key)
+    {
+        unsigned char digest[BSKY_SHA256_LEN];
+        int layer = 0;
+
+        bsky_sha256(key.start, bsky_str_len(key), digest);
+
+        for (size_t i = 0; i < BSKY_SHA256_LEN; ++i) {
+            unsigned char c = digest[i];
+
+            if (c == 0) {
+                layer += 4;
+                continue;
+            }
+
+            layer += c < 0x04 ? 3 : c < 0x10 ? 2 : c < 0x40 ? 1 : 0;
+            break;
+        }
+
+        return layer;
+    }
+
+    static int __bsky_mst_key_cmp(const void *fst, size_t fst_len,
+                                  const void *snd, size_t snd_len)
+    {
+        int cmp = memcmp(fst, snd, fst_len < snd_len ? fst_len : snd_len);
+
+        if (cmp != 0) return cmp;
+
+        return (fst_len > snd_len) - (fst_len < snd_len);
+    }
+
+    static struct bsky_str __bsky_mst_key(struct __bsky_mst_frame *frame,
+                                          struct __bsky_mst_leaf *leaf)
+    {
+        char *key = (char *) frame->keys.data + leaf->key;
+
+        return (struct bsky_str) { key, key + leaf->key_len };
+    }
+
+    static enum bsky_error_code
+    __bsky_mst_decode_leaf(struct __bsky_mst_frame *frame,
+                           struct bsky_view *node)
+    {
+        enum bsky_error_code ec;
+        struct __bsky_mst_leaf leaf = { 0 };
+        struct bsky_view suffix = { 0 };
+        long long prefix = -1;
+        char last = 0;
+
+        // keys are single letters, so their order is checked here and
+        // items are read without the key pass of `bsky_cbor_read'.
+        struct bsky_cbor map = __bsky_cbor_item(node, &ec);
+        if (ec != bsky_ec_Ok) return ec;
+        if (map.type != bsky_cbor_Map) return bsky_ec_Mst_invalid_node;
+
+        for (size_t i = 0; i < map.len; ++i) {
+            struct bsky_cbor key = __bsky_cbor_item(node, &ec), value;
+            if (ec != bsky_ec_Ok) return ec;
+
+            if (key.type != bsky_cbor_Text || bsky_str_len(key.text) != 1 ||
+                key.text.start[0] <= last)
+                return bsky_ec_Mst_invalid_node;
+            last = key.text.start[0];
+
+            value = __bsky_cbor_item(node, &ec);
+            if (ec != bsky_ec_Ok) return ec;
+
+            switch (key.text.start[0]) {
+            case 'k':
+                if (value.type != bsky_cbor_Bytes) goto invalid;
+                suffix = value.bytes;
+                break;
+            case 'p':
+                if (value.type != bsky_cbor_Int) goto invalid;
+                prefix = value.integer;
+                break;
+            case 't':
+                if (value.type == bsky_cbor_Link) leaf.tree = value.link;
+                else if (value.type != bsky_cbor_Null) goto invalid;
+                break;
+            case 'v':
+                if (value.type != bsky_cbor_Link) goto invalid;
+                leaf.value = value.link;
+                break;
+            default:
+                goto invalid;
+            }
+        }
+
+        struct __bsky_mst_leaf *prev = frame->leaves.len == 0 ? NULL
+                        : &frame->leaves.data[frame->leaves.len - 1];
+        size_t suffix_len = (char *) suffix.end - (char *) suffix.start;
+
+        if (suffix.start == NULL || leaf.value.codec == 0 || prefix < 0 ||
+            (size_t) prefix > (prev ? prev->key_len : 0) ||
+            prefix + suffix_len == 0)
+            goto invalid;
+
+        // key is prefix of previous key and suffix.
+        leaf.key     = frame->keys.len;
+        leaf.key_len = prefix + suffix_len;
+
+        if (frame->keys.len + leaf.key_len > frame->keys.cap) {
+            size_t cap = (frame->keys.len + leaf.key_len) * 2;
+            void *data = __bsky_realloc(frame->keys.data, cap);
+
+            if (data == NULL) return bsky_ec_Tmp_overflow;
+            frame->keys.data = data;
+            frame->keys.cap  = cap;
+        }
+
+        unsigned char *key = frame->keys.data + leaf.key;
+
+        if (prefix > 0) memcpy(key, frame->keys.data + prev->key, prefix);
+        memcpy(key + prefix, suffix.start, suffix_len);
+        frame->keys.len += leaf.key_len;
+
+        if (prev != NULL &&
+            __bsky_mst_key_cmp(frame->keys.data + prev->key, prev->key_len,
+                               key, leaf.key_len) >= 0)
+            goto invalid;
+
+        return bsky_da_push(&frame->leaves, leaf);
+
+    invalid:
+        return bsky_ec_Mst_invalid_node;
+    }
+
+    static enum bsky_error_code
+    __bsky_mst_decode(struct __bsky_mst_frame *frame, struct bsky_view node)
+    {
+        enum bsky_error_code ec;
+
+        frame->leaves.len = frame->keys.len = frame->pos = 0;
+        frame->left = (struct bsky_cid) { 0 };
+
+        // single letter keys, order is checked as in leaf.
+        char last = 0;
+        struct bsky_cbor map = __bsky_cbor_item(&node, &ec);
+        if (ec != bsky_ec_Ok) return ec;
+        if (map.type != bsky_cbor_Map) return bsky_ec_Mst_invalid_node;
+
+        for (size_t i = 0; i < map.len; ++i) {
+            struct bsky_cbor key = __bsky_cbor_item(&node, &ec), value;
+            if (ec != bsky_ec_Ok) return ec;
+
+            if (key.type != bsky_cbor_Text || bsky_str_len(key.text) != 1 ||
+                key.text.start[0] <= last)
+                return bsky_ec_Mst_invalid_node;
+            last = key.text.start[0];
+
+            value = __bsky_cbor_item(&node, &ec);
+            if (ec != bsky_ec_Ok) return ec;
+
+            if (key.text.start[0] == 'l' && value.type == bsky_cbor_Link) {
+                frame->left = value.link;
+            } else if (key.text.start[0] == 'e' &&
+                       value.type == bsky_cbor_Arr) {
+                for (size_t j = 0; j < value.len; ++j) {
+                    ec = __bsky_mst_decode_leaf(frame, &node);
+                    if (ec != bsky_ec_Ok) return ec;
+                }
+            } else if (key.text.start[0] != 'l' ||
+                       value.type != bsky_cbor_Null) {
+                return bsky_ec_Mst_invalid_node;
+            }
+        }
+
+        if (node.start != node.end) return bsky_ec_Mst_invalid_node;
+
+        return bsky_ec_Ok;
+    }
+
+    static struct __bsky_mst_frame *__bsky_mst_top(struct bsky_mst_iter *iter)
+    {
+        return &iter->frames.data[iter->depth - 1];
+    }
+
+    static enum bsky_error_code __bsky_mst_start(struct bsky_mst_iter *iter)
+    {
+        // virtual frame with root as its only tree, layer is not known
+        // before root is loaded.
+        struct __bsky_mst_frame frame = { .left  = iter->root,
+                                          .layer = INT_MAX };
+
+        enum bsky_error_code ec = bsky_da_push(&iter->frames, frame);
+        if (ec == bsky_ec_Ok) iter->depth = 1;
+
+        return ec;
+    }
+
+    // current token of top frame: tree, leaf or end of tree.
+    static int __bsky_mst_peek(struct bsky_mst_iter *iter,
+                               struct bsky_cid *tree,
+                               struct __bsky_mst_leaf **leaf)
+    {
+        while (iter->depth > 0) {
+            struct __bsky_mst_frame *frame = __bsky_mst_top(iter);
+            size_t i = frame->pos / 2;
+
+            if (frame->pos > frame->leaves.len * 2) {
+                iter->depth--;
+                continue;
+            }
+
+            if (frame->pos % 2 == 1) {
+                *leaf = &frame->leaves.data[i];
+                return __bsky_mst_Leaf;
+            }
+
+            *tree = i == 0 ? frame->left : frame->leaves.data[i - 1].tree;
+            if (tree->codec != 0) return __bsky_mst_Tree;
+
+            frame->pos++;
+        }
+
+        return __bsky_mst_End;
+    }
+
+    // load tree of the current token as new top frame.
+    static enum bsky_error_code __bsky_mst_descend(struct bsky_mst_iter *iter,
+                                                   struct bsky_cid tree)
+    {
+        enum bsky_error_code ec;
+        struct bsky_view node;
+
+        __bsky_mst_top(iter)->pos++;
+
+        if (iter->depth == iter->frames.len) {
+            struct __bsky_mst_frame frame = { 0 };
+
+            if ((ec = bsky_da_push(&iter->frames, frame)) != bsky_ec_Ok)
+                return ec;
+        }
+
+        ec = iter->store.get(iter->store.ctx, tree, &node);
+        if (ec != bsky_ec_Ok) return ec;
+
+        struct __bsky_mst_frame *frame = &iter->frames.data[iter->depth++];
+        int layer = frame[-1].layer - 1;
+
+        iter->loaded++;
+        if ((ec = __bsky_mst_decode(frame, node)) != bsky_ec_Ok) return ec;
+
+        // layer of root is layer of its keys, others are one below parent.
+        if (iter->depth == 2 && frame->leaves.len > 0)
+            layer = bsky_mst_key_layer(__bsky_mst_key(frame,
+                                                      frame->leaves.data));
+        frame->layer = layer;
+
+        return bsky_ec_Ok;
+    }
+
+    struct bsky_mst_iter bsky_mst_iter_init(struct bsky_block_store store,
+                                            struct bsky_cid root)
+    {
+        return (struct bsky_mst_iter) { .store = store, .root = root };
+    }
+
+    int bsky_mst_next(struct bsky_mst_iter *iter,
+                      struct bsky_mst_entry *entry, enum bsky_error_code *ec)
+    {
+        *ec = bsky_ec_Ok;
+
+        if (iter->frames.len == 0 &&
+            (*ec = __bsky_mst_start(iter)) != bsky_ec_Ok)
+            return 0;
+
+        for (;;) {
+            struct bsky_cid tree;
+            struct __bsky_mst_leaf *leaf;
+
+            switch (__bsky_mst_peek(iter, &tree, &leaf)) {
+            case __bsky_mst_End:
+                return 0;
+
+            case __bsky_mst_Tree:
+                *ec = __bsky_mst_descend(iter, tree);
+                if (*ec != bsky_ec_Ok) return 0;
+                break;
+
+            case __bsky_mst_Leaf:
+                entry->key   = __bsky_mst_key(__bsky_mst_top(iter), leaf);
+                entry->value = leaf->value;
+                __bsky_mst_top(iter)->pos++;
+                return 1;
+            }
+        }
+    }
+
+    static void __bsky_mst_frame_free(struct __bsky_mst_frame *frame)
+    {
+        bsky_da_free(&frame->leaves);
+        bsky_da_free(&frame->keys);
+    }
+
+    void bsky_mst_iter_free(struct bsky_mst_iter *iter)
+    {
+        for (size_t i = 0; i < iter->frames.len; ++i)
+            __bsky_mst_frame_free(&iter->frames.data[i]);
+
+        bsky_da_free(&iter->frames);
+        iter->frames.data = NULL;
+        iter->frames.len  = iter->frames.cap = iter->depth = 0;
+    }
+
+    int bsky_mst_get(struct bsky_block_store store, struct bsky_cid root,
+                     struct bsky_str key, struct bsky_cid *value,
+                     enum bsky_error_code *ec)
+    {
+        struct __bsky_mst_frame frame = { 0 };
+        struct bsky_cid node = root;
+        int found = 0;
+
+        *ec = bsky_ec_Ok;
+
+        while (node.codec != 0) {
+            struct bsky_view block;
+            size_t i = 0;
+            int cmp = 1;
+
+            if ((*ec = store.get(store.ctx, node, &block)) != bsky_ec_Ok ||
+                (*ec = __bsky_mst_decode(&frame, block)) != bsky_ec_Ok)
+                break;
+
+            for (; i < frame.leaves.len; ++i) {
+                struct bsky_str leaf = __bsky_mst_key(&frame,
+                                                      &frame.leaves.data[i]);
+
+                cmp = __bsky_mst_key_cmp(leaf.start, bsky_str_len(leaf),
+                                         key.start, bsky_str_len(key));
+                if (cmp >= 0) break;
+            }
+
+            if (cmp == 0) {
+                *value = frame.leaves.data[i].value;
+                found  = 1;
+                break;
+            }
+
+            node = i == 0 ? frame.left : frame.leaves.data[i - 1].tree;
+        }
+
+        __bsky_mst_frame_free(&frame);
+
+        return found;
+    }
+
+    enum bsky_error_code bsky_mst_diff(struct bsky_block_store store,
+                                       struct bsky_cid from,
+                                       struct bsky_cid to,
+                                       bsky_mst_diff_fn fn, void *ctx,
+                                       size_t *loaded)
+    {
+        struct bsky_mst_iter a = bsky_mst_iter_init(store, from),
+                             b = bsky_mst_iter_init(store, to);
+
+        enum bsky_error_code ec = __bsky_mst_start(&a);
+        if (ec == bsky_ec_Ok) ec = __bsky_mst_start(&b);
+
+        while (ec == bsky_ec_Ok) {
+            struct bsky_cid ta, tb;
+            struct __bsky_mst_leaf *la, *lb;
+            struct bsky_mst_op op = { 0 };
+
+            int ka = __bsky_mst_peek(&a, &ta, &la),
+                kb = __bsky_mst_peek(&b, &tb, &lb);
+
+            if (ka == __bsky_mst_End && kb == __bsky_mst_End) break;
+
+            // same tree has the same keys: skip it in both.
+            if (ka == __bsky_mst_Tree && kb == __bsky_mst_Tree &&
+                bsky_cid_eq(ta, tb)) {
+                __bsky_mst_top(&a)->pos++;
+                __bsky_mst_top(&b)->pos++;
+                continue;
+            }
+
+            // open higher of trees, or both if they're on the same layer,
+            // so that next trees may match.
+            if (ka == __bsky_mst_Tree || kb == __bsky_mst_Tree) {
+                int layer_a = a.depth ? __bsky_mst_top(&a)->layer : INT_MIN,
+                    layer_b = b.depth ? __bsky_mst_top(&b)->layer : INT_MIN;
+
+                int open_a = ka == __bsky_mst_Tree &&
+                             (kb != __bsky_mst_Tree || layer_a >= layer_b),
+                    open_b = kb == __bsky_mst_Tree &&
+                             (ka != __bsky_mst_Tree || layer_b >= layer_a);
+
+                if (open_a) ec = __bsky_mst_descend(&a, ta);
+                if (open_b && ec == bsky_ec_Ok)
+                    ec = __bsky_mst_descend(&b, tb);
+                continue;
+            }
+
+            struct bsky_str key_a = { 0 }, key_b = { 0 };
+
+            if (ka == __bsky_mst_Leaf)
+                key_a = __bsky_mst_key(__bsky_mst_top(&a), la);
+            if (kb == __bsky_mst_Leaf)
+                key_b = __bsky_mst_key(__bsky_mst_top(&b), lb);
+
+            int cmp = ka == __bsky_mst_End ?  1 :
+                  kb == __bsky_mst_End ? -1 :
+                  __bsky_mst_key_cmp(key_a.start, bsky_str_len(key_a),
+                                     key_b.start, bsky_str_len(key_b));
+
+            if (cmp < 0) {
+                op = (struct bsky_mst_op) { .kind = bsky_mst_Delete,
+                                            .key = key_a, .prev = la->value };
+                __bsky_mst_top(&a)->pos++;
+            } else if (cmp > 0) {
+                op = (struct bsky_mst_op) { .kind = bsky_mst_Create,
+                                            .key = key_b, .value = lb->value };
+                __bsky_mst_top(&b)->pos++;
+            } else {
+                if (!bsky_cid_eq(la->value, lb->value))
+                    op = (struct bsky_mst_op) { bsky_mst_Update, key_b,
+                                                la->value, lb->value };
+                __bsky_mst_top(&a)->pos++;
+                __bsky_mst_top(&b)->pos++;
+            }
+
+            if (op.key.start != NULL) ec = fn(ctx, &op);
+        }
+
+        if (loaded != NULL) *loaded = a.loaded + b.loaded;
+
+        bsky_mst_iter_free(&a);
+        bsky_mst_iter_free(&b);
+
+        return ec;
+    }
+
+    struct __bsky_mst_builder {
+        struct bsky_block_store store;
+        const struct bsky_mst_entry *entries;
+        int *layers;
+
+        struct { struct bsky_cid *data; size_t len, cap; } trees;
+        struct bsky_bytes node;
+    };
+
+    // build node of keys [lo, hi) on the layer.
+    static enum bsky_error_code
+    __bsky_mst_build_node(struct __bsky_mst_builder *b, size_t lo, size_t hi,
+                          int layer, struct bsky_cid *cid)
+    {
+        enum bsky_error_code ec;
+        size_t base = b->trees.len;
+
+        // keys between keys of this layer go to trees one layer down.
+        for (size_t i = lo, start = lo; i <= hi; ++i) {
+            struct bsky_cid tree = { 0 };
+
+            if (i < hi && b->layers[i] < layer) continue;
+
+            if (start < i) {
+                ec = __bsky_mst_build_node(b, start, i, layer - 1, &tree);
+                if (ec != bsky_ec_Ok) return ec;
+            }
+
+            if ((ec = bsky_da_push(&b->trees, tree)) != bsky_ec_Ok) return ec;
+            start = i + 1;
+        }
+
+        struct bsky_bytes *node = &b->node;
+        struct bsky_str prev = { 0 };
+        struct bsky_cid *trees = b->trees.data + base;
+
+        node->len = 0;
+        __bsky_try_push(bsky_cbor_push_map(node, 2));
+        __bsky_try_push(bsky_cbor_push_text(node, bsky_mk_str("e")));
+        __bsky_try_push(bsky_cbor_push_arr(node, b->trees.len - base - 1));
+
+        for (size_t i = lo; i < hi; ++i) {
+            if (b->layers[i] != layer) continue;
+
+            struct bsky_str key = b->entries[i].key;
+            size_t prefix = 0, len = bsky_str_len(key);
+
+            while (prefix < len && prev.start + prefix < prev.end &&
+                   prev.start[prefix] == key.start[prefix])
+                prefix++;
+
+            __bsky_try_push(bsky_cbor_push_map(node, 4));
+            __bsky_try_push(bsky_cbor_push_text(node, bsky_mk_str("k")));
+            __bsky_try_push(bsky_cbor_push_bytes(node, (struct bsky_view) {
+                                                 key.start + prefix,
+                                                 key.end }));
+            __bsky_try_push(bsky_cbor_push_text(node, bsky_mk_str("p")));
+            __bsky_try_push(bsky_cbor_push_int(node, prefix));
+            __bsky_try_push(bsky_cbor_push_text(node, bsky_mk_str("t")));
+            __bsky_try_push((++trees)->codec != 0
+                            ? bsky_cbor_push_link(node, *trees)
+                            : bsky_cbor_push_null(node));
+            __bsky_try_push(bsky_cbor_push_text(node, bsky_mk_str("v")));
+            __bsky_try_push(bsky_cbor_push_link(node, b->entries[i].value));
+
+            prev = key;
+        }
+
+        __bsky_try_push(bsky_cbor_push_text(node, bsky_mk_str("l")));
+        __bsky_try_push(b->trees.data[base].codec != 0
+                        ? bsky_cbor_push_link(node, b->trees.data[base])
+                        : bsky_cbor_push_null(node));
+
+        struct bsky_view block = { node->data, node->data + node->len };
+
+        *cid = bsky_cid_of_block(bsky_cid_Dag_cbor, block);
+        b->trees.len = base;
+
+        return b->store.put(b->store.ctx, *cid, block);
+    }
+
+    struct bsky_cid bsky_mst_build(struct bsky_block_store store,
+                                   const struct bsky_mst_entry *entries,
+                                   size_t len, enum bsky_error_code *ec)
+    {
+        *ec = bsky_ec_Ok;
+
+        struct __bsky_mst_builder b = { .store = store, .entries = entries };
+        struct bsky_cid root = { 0 };
+        int top = 0;
+
+        b.layers = __bsky_malloc((len + 1) * sizeof *b.layers);
+        if (b.layers == NULL) bsky_defer_ec(bsky_ec_Tmp_overflow);
+
+        for (size_t i = 0; i < len; ++i) {
+            struct bsky_str key = entries[i].key;
+
+            if (i > 0 && __bsky_mst_key_cmp(entries[i - 1].key.start,
+                                            bsky_str_len(entries[i - 1].key),
+                                            key.start, bsky_str_len(key)) >= 0)
+                bsky_defer_ec(bsky_ec_Mst_unsorted_keys);
+
+            b.layers[i] = bsky_mst_key_layer(key);
+            if (b.layers[i] > top) top = b.layers[i];
+        }
+
+        *ec = __bsky_mst_build_node(&b, 0, len, top, &root);
+
+    defer:
+        if (b.layers != NULL) __bsky_free(b.layers);
+        bsky_da_free(&b.trees);
+        bsky_da_free(&b.node);
+
+        if (*ec != bsky_ec_Ok) root = (struct bsky_cid) { 0 };
+
+        return root;
+    }
+
+    /*
+     * BSKY REPOSITORY
+     */
+    #include <dirent.h>
+    #include <string.h>
+    #include <time.h>
+    #include <unistd.h>
+
+    struct bsky_commit bsky_parse_commit(struct bsky_view block,
+                                         enum bsky_error_code *ec)
+    {
+        struct bsky_commit commit = { 0 };
+        int has_version = 0;
+
+        struct bsky_cbor map = bsky_cbor_read(&block, ec);
+        if (*ec != bsky_ec_Ok) goto defer;
+        if (map.type != bsky_cbor_Map) goto invalid;
+
+        for (size_t i = 0; i < map.len; ++i) {
+            struct bsky_cbor key = bsky_cbor_read(&block, ec), value;
+            if (*ec != bsky_ec_Ok) goto defer;
+            if (key.type != bsky_cbor_Text) goto invalid;
+
+            struct bsky_view at = block;
+
+            value = bsky_cbor_read(&block, ec);
+            if (*ec != bsky_ec_Ok) goto defer;
+
+            if (bsky_str_eq(key.text, bsky_mk_str("did"))) {
+                if (value.type != bsky_cbor_Text) goto invalid;
+                commit.did = value.text;
+            } else if (bsky_str_eq(key.text, bsky_mk_str("rev"))) {
+                if (value.type != bsky_cbor_Text) goto invalid;
+                commit.rev = value.text;
+            } else if (bsky_str_eq(key.text, bsky_mk_str("data"))) {
+                if (value.type != bsky_cbor_Link) goto invalid;
+                commit.data = value.link;
+            } else if (bsky_str_eq(key.text, bsky_mk_str("prev"))) {
+                if (value.type == bsky_cbor_Link) commit.prev = value.link;
+                else if (value.type != bsky_cbor_Null) goto invalid;
+            } else if (bsky_str_eq(key.text, bsky_mk_str("sig"))) {
+                if (value.type != bsky_cbor_Bytes) goto invalid;
+                commit.sig = value.bytes;
+            } else if (bsky_str_eq(key.text, bsky_mk_str("version"))) {
+                if (value.type != bsky_cbor_Int) goto invalid;
+                commit.version = value.integer;
+                has_version    = 1;
+            } else {
+                // unknown fields are allowed, but whole of them.
+                block = at;
+                bsky_cbor_skip(&block, ec);
+                if (*ec != bsky_ec_Ok) goto defer;
+            }
+        }
+
+        if (block.start != block.end || !has_version ||
+            commit.version < 2 || commit.version > 3 ||
+            commit.data.codec == 0 || !bsky_did_valid(commit.did) ||
+            (commit.version == 3 && commit.rev.start == NULL))
+            goto invalid;
+
+        *ec = bsky_ec_Ok;
+        return commit;
+
+    invalid:
+        *ec = bsky_ec_Repo_invalid_commit;
+    defer:
+        return (struct bsky_commit) { 0 };
+    }
+
+    static enum bsky_error_code
+    __bsky_cbor_push_commit(struct bsky_bytes *buf,
+                            const struct bsky_commit *commit)
+    {
+        // DAG-CBOR key order: shorter keys first.
+        __bsky_try_push(bsky_cbor_push_map(buf, commit->sig.start != NULL
+                                                ? 6 : 5));
+
+        __bsky_try_push(bsky_cbor_push_text(buf, bsky_mk_str("did")));
+        __bsky_try_push(bsky_cbor_push_text(buf, commit->did));
+        __bsky_try_push(bsky_cbor_push_text(buf, bsky_mk_str("rev")));
+        __bsky_try_push(bsky_cbor_push_text(buf, commit->rev));
+
+        if (commit->sig.start != NULL) {
+            __bsky_try_push(bsky_cbor_push_text(buf, bsky_mk_str("sig")));
+            __bsky_try_push(bsky_cbor_push_bytes(buf, commit->sig));
+        }
+
+        __bsky_try_push(bsky_cbor_push_text(buf, bsky_mk_str("data")));
+        __bsky_try_push(bsky_cbor_push_link(buf, commit->data));
+        __bsky_try_push(bsky_cbor_push_text(buf, bsky_mk_str("prev")));
+        __bsky_try_push(commit->prev.codec != 0
+                        ? bsky_cbor_push_link(buf, commit->prev)
+                        : bsky_cbor_push_null(buf));
+
+        __bsky_try_push(bsky_cbor_push_text(buf, bsky_mk_str("version")));
+
+        return bsky_cbor_push_int(buf, commit->version);
+    }
+
+    enum bsky_error_code bsky_cbor_push_commit(struct bsky_bytes *buf,
+                                               const struct bsky_commit *commit)
+    {
+        size_t buf_len = buf->len;
+        enum bsky_error_code ec = __bsky_cbor_push_commit(buf, commit);
+
+        if (ec != bsky_ec_Ok) buf->len = buf_len;
+
+        return ec;
+    }
+
+    struct __bsky_backfill_job {
+        const struct bsky_backfill *backfill;
+
+        struct { char **data; size_t len, cap; } paths;
+        _Atomic size_t next;
+        _Atomic int stop;
+        enum bsky_error_code ec;         // of callback which stopped it
+    };
+
+    // everything is reused from repository to repository.
+    struct __bsky_backfill_worker {
+        struct __bsky_backfill_job *job;
+        size_t index;
+        pthread_t thread;
+        int started;
+
+        struct bsky_bytes file;
+        struct bsky_block_map map;       // borrows from `file'
+        struct bsky_arena arena;
+        struct bsky_backfill_stats stats;
+    };
+
+    static enum bsky_error_code
+    __bsky_backfill_read(struct bsky_bytes *buf, const char *path)
+    {
+        FILE *file = fopen(path, "rb");
+        if (file == NULL) return bsky_ec_Backfill_io;
+
+        long size = -1;
+
+        if (fseek(file, 0, SEEK_END) == 0) size = ftell(file);
+        if (size < 0 || fseek(file, 0, SEEK_SET) != 0) goto io;
+
+        if ((size_t) size > buf->cap) {
+            void *data = __bsky_realloc(buf->data, size);
+            if (data == NULL) {
+                fclose(file);
+                return bsky_ec_Tmp_overflow;
+            }
+
+            buf->data = data;
+            buf->cap  = size;
+        }
+
+        buf->len = fread(buf->data, 1, size, file);
+        if (buf->len != (size_t) size) goto io;
+
+        fclose(file);
+        return bsky_ec_Ok;
+
+    io:
+        fclose(file);
+        return bsky_ec_Backfill_io;
+    }
+
+    // Return error of repository; error of callback is also put to worker
+    // job.
+    static enum bsky_error_code
+    __bsky_backfill_repo(struct __bsky_backfill_worker *w, const char *path)
+    {
+        enum bsky_error_code ec;
+        const struct bsky_backfill *backfill = w->job->backfill;
+        struct bsky_block_store store = bsky_block_map_store(&w->map);
+        struct bsky_mst_iter iter = { 0 };
+
+        bsky_block_map_reset(&w->map);
+        bsky_arena_reset(&w->arena);
+
+        ec = __bsky_backfill_read(&w->file, path);
+        if (ec != bsky_ec_Ok) goto defer;
+
+        struct bsky_car car = bsky_car_open((struct bsky_view) {
+            w->file.data, w->file.data + w->file.len
+        }, &ec);
+        if (ec != bsky_ec_Ok) goto defer;
+
+        ec = bsky_car_load(&car, store, backfill->verify);
+        if (ec != bsky_ec_Ok) goto defer;
+
+        struct bsky_view block;
+        struct bsky_commit commit;
+
+        ec = bsky_block_map_get(&w->map, car.root, &block);
+        if (ec != bsky_ec_Ok) goto defer;
+
+        commit = bsky_parse_commit(block, &ec);
+        if (ec != bsky_ec_Ok) goto defer;
+
+        struct bsky_backfill_record record = {
+            .did = commit.did, .worker = w->index
+        };
+        struct bsky_mst_entry entry;
+
+        iter = bsky_mst_iter_init(store, commit.data);
+
+        while (!atomic_load_explicit(&w->job->stop, memory_order_relaxed) &&
+               bsky_mst_next(&iter, &entry, &ec)) {
+            char *slash = memchr(entry.key.start, '/',
+                                 bsky_str_len(entry.key));
+
+            if (slash == NULL) {
+                ec = bsky_ec_Mst_invalid_node;
+                goto defer;
+            }
+
+            ec = bsky_block_map_get(&w->map, entry.value, &block);
+            if (ec != bsky_ec_Ok) goto defer;
+
+            // record must be one whole item.
+            struct bsky_view rest = block;
+
+            bsky_cbor_skip(&rest, &ec);
+            if (ec != bsky_ec_Ok) goto defer;
+            if (rest.start != rest.end) {
+                ec = bsky_ec_Cbor_invalid;
+                goto defer;
+            }
+
+            record.collection = (struct bsky_str) { entry.key.start, slash };
+            record.rkey       = (struct bsky_str) { slash + 1,
+                                                    entry.key.end };
+            record.cid        = entry.value;
+            record.block      = block;
+
+            ec = backfill->fn(backfill->ctx, &record);
+            if (ec != bsky_ec_Ok) {
+                int running = 0;
+
+                if (atomic_compare_exchange_strong(&w->job->stop, &running,
+                                                   1))
+                    w->job->ec = ec;
+                goto defer;
+            }
+
+            w->stats.records++;
+        }
+
+        if (ec == bsky_ec_Ok) {
+            w->stats.blocks += w->map.len;
+            w->stats.bytes  += w->file.len;
+        }
+
+    defer:
+        bsky_mst_iter_free(&iter);
+        return ec;
+    }
+
+    static void *__bsky_backfill_work(void *self)
+    {
+        struct __bsky_backfill_worker *w = self;
+        struct __bsky_backfill_job *job = w->job;
+        struct bsky_arena *prev = bsky_tmp_use_arena(&w->arena);
+
+        while (!atomic_load(&job->stop)) {
+            size_t i = atomic_fetch_add(&job->next, 1);
+            if (i >= job->paths.len) break;
+
+            enum bsky_error_code ec = __bsky_backfill_repo(w,
+                                                        job->paths.data[i]);
+
+            // repository cut short by stop is not counted.
+            if (atomic_load(&job->stop)) break;
+
+            if (ec == bsky_ec_Ok) {
+                w->stats.repos++;
+                continue;
+            }
+
+            w->stats.failed++;
+            if (job->backfill->on_error != NULL)
+                job->backfill->on_error(job->backfill->ctx,
+                                        job->paths.data[i], ec);
+        }
+
+        bsky_tmp_use_arena(prev);
+        return NULL;
+    }
+
+    static int __bsky_backfill_path_cmp(const void *fst, const void *snd) {
+        return strcmp(*(char *const *) fst, *(char *const *) snd);
+    }
+
+    static enum bsky_error_code
+    __bsky_backfill_list(struct __bsky_backfill_job *job, const char *dir)
+    {
+        DIR *d = opendir(dir);
+        if (d == NULL) return bsky_ec_Backfill_io;
+
+        size_t dir_len = strlen(dir);
+
+        for (struct dirent *e; (e = readdir(d)) != NULL;) {
+            size_t len = strlen(e->d_name);
+
+            if (len <= 4 || strcmp(e->d_name + len - 4, ".car") != 0)
+                continue;
+
+            char *path = __bsky_malloc(dir_len + len + 2);
+            if (path == NULL) goto overflow;
+
+            memcpy(path, dir, dir_len);
+            path[dir_len] = '/';
+            memcpy(path + dir_len + 1, e->d_name, len + 1);
+
+            if (bsky_da_push(&job->paths, path) != bsky_ec_Ok) {
+                __bsky_free(path);
+                goto overflow;
+            }
+        }
+
+        closedir(d);
+        qsort(job->paths.data, job->paths.len, sizeof *job->paths.data,
+              __bsky_backfill_path_cmp);
+
+        return bsky_ec_Ok;
+
+    overflow:
+        closedir(d);
+        return bsky_ec_Tmp_overflow;
+    }
+
+    enum bsky_error_code bsky_backfill_run(const struct bsky_backfill *backfill,
+                                           struct bsky_backfill_stats *stats)
+    {
+        enum bsky_error_code ec;
+        struct __bsky_backfill_job job = { .backfill = backfill };
+        struct __bsky_backfill_worker *workers = NULL;
+        struct bsky_backfill_stats total = { 0 };
+        struct timespec start, end;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        ec = __bsky_backfill_list(&job, backfill->dir);
+        if (ec != bsky_ec_Ok) goto defer;
+
+        size_t threads = backfill->threads;
+
+        if (threads == 0) {
+            long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+            threads   = cpus > 0 ? cpus : 1;
+        }
+        if (threads > job.paths.len) threads = job.paths.len;
+        if (threads == 0)            threads = 1;
+
+        workers = __bsky_calloc(threads, sizeof *workers);
+        if (workers == NULL) {
+            ec = bsky_ec_Tmp_overflow;
+            goto defer;
+        }
+
+        for (size_t i = 0; i < threads; ++i) {
+            workers[i].job        = &job;
+            workers[i].index      = i;
+            workers[i].map.borrow = 1;
+            workers[i].arena.cap  = backfill->arena_cap
+                                  ? backfill->arena_cap
+                                  : BSKY_BACKFILL_ARENA_CAPACITY;
+        }
+
+        // calling thread is the first worker. If thread can't be started
+        // its share is done by the others.
+        for (size_t i = 1; i < threads; ++i)
+            workers[i].started = pthread_create(&workers[i].thread, NULL,
+                                                __bsky_backfill_work,
+                                                &workers[i]) == 0;
+
+        __bsky_backfill_work(&workers[0]);
+
+        for (size_t i = 0; i < threads; ++i) {
+            struct __bsky_backfill_worker *w = &workers[i];
+
+            if (w->started) pthread_join(w->thread, NULL);
+
+            total.repos   += w->stats.repos;
+            total.failed  += w->stats.failed;
+            total.records += w->stats.records;
+            total.blocks  += w->stats.blocks;
+            total.bytes   += w->stats.bytes;
+
+            if (w->file.data != NULL) __bsky_free(w->file.data);
+            bsky_block_map_free(&w->map);
+            bsky_arena_free(&w->arena);
+        }
+
+        ec = job.ec;
+
+    defer:
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        if (stats != NULL) {
+            total.seconds = (end.tv_sec - start.tv_sec) +
+                            (end.tv_nsec - start.tv_nsec) / 1e9;
+
+            if (total.seconds > 0) {
+                total.repos_per_sec   = total.repos   / total.seconds;
+                total.records_per_sec = total.records / total.seconds;
+            }
+
+            *stats = total;
+        }
+
+        for (size_t i = 0; i < job.paths.len; ++i)
+            __bsky_free(job.paths.data[i]);
+        bsky_da_free(&job.paths);
+        if (workers != NULL) __bsky_free(workers);
+
+        return ec;
+    }
+
+	/*
+     * BSKY SIGNATURES
+     */
+    // 256 bit numbers are 4 limbs, least significant first. Field and
+    // scalar elements are in Montgomery form (x * 2^256 mod m).
+    struct __bsky_mod {
+        uint64_t m[4];
+        uint64_t inv;                        // -m^-1 mod 2^64
+        uint64_t r2[4];                      // 2^512 mod m
+        uint64_t one[4];                     // 2^256 mod m
+    };
+
+    struct __bsky_jac { uint64_t x[4], y[4], z[4]; };    // z = 0: infinity
+
+    // Projective (x / z, y / z), infinity is (0, 1, 0). Used by constant
+    // time multiplication of secrets.
+    struct __bsky_proj { uint64_t x[4], y[4], z[4]; };
+
+    #define __BSKY_G_TABLE_LEN 32            // odd multiples: 1..63
+    #define __BSKY_G_FIXED_LEN 16            // multiples: 0..15
+
+    struct __bsky_curve {
+        struct __bsky_mod p, n;
+        int a_minus_3;                       // a is -3 or 0
+        uint64_t b[4], b3[4], gx[4], gy[4];
+        uint64_t g_table[__BSKY_G_TABLE_LEN][2][4];
+        struct __bsky_proj g_fixed[__BSKY_G_FIXED_LEN];
+        unsigned char codec[2];              // multicodec varint
+    };
+
+    static struct __bsky_curve __bsky_curves[2] = {
+        [bsky_key_Secp256k1] = {
+            .p = {
+                .m   = { 0xfffffffefffffc2fULL, 0xffffffffffffffffULL,
+                         0xffffffffffffffffULL, 0xffffffffffffffffULL },
+                .inv = 0xd838091dd2253531ULL,
+                .r2  = { 0x000007a2000e90a1ULL, 0x0000000000000001ULL },
+            },
+            .n = {
+                .m   = { 0xbfd25e8cd0364141ULL, 0xbaaedce6af48a03bULL,
+                         0xfffffffffffffffeULL, 0xffffffffffffffffULL },
+                .inv = 0x4b0dff665588b13fULL,
+                .r2  = { 0x896cf21467d7d140ULL, 0x741496c20e7cf878ULL,
+                         0xe697f5e45bcd07c6ULL, 0x9d671cd581c69bc5ULL },
+            },
+            .b  = { 7 },
+            .gx = { 0x59f2815b16f81798ULL, 0x029bfcdb2dce28d9ULL,
+                    0x55a06295ce870b07ULL, 0x79be667ef9dcbbacULL },
+            .gy = { 0x9c47d08ffb10d4b8ULL, 0xfd17b448a6855419ULL,
+                    0x5da4fbfc0e1108a8ULL, 0x483ada7726a3c465ULL },
+            .codec = { 0xe7, 0x01 },
+        },
+        [bsky_key_P256] = {
+            .p = {
+                .m   = { 0xffffffffffffffffULL, 0x00000000ffffffffULL,
+                         0x0000000000000000ULL, 0xffffffff00000001ULL },
+                .inv = 0x0000000000000001ULL,
+                .r2  = { 0x0000000000000003ULL, 0xfffffffbffffffffULL,
+                         0xfffffffffffffffeULL, 0x00000004fffffffdULL },
+            },
+            .n = {
+                .m   = { 0xf3b9cac2fc632551ULL, 0xbce6faada7179e84ULL,
+                         0xffffffffffffffffULL, 0xffffffff00000000ULL },
+                .inv = 0xccd1c8aaee00bc4fULL,
+                .r2  = { 0x83244c95be79eea2ULL, 0x4699799c49bd6fa6ULL,
+                         0x2845b2392b6bec59ULL, 0x66e12d94f3d95620ULL },
+            },
+            .a_minus_3 = 1,
+            .b  = { 0x3bce3c3e27d2604bULL, 0x651d06b0cc53b0f6ULL,
+                    0xb3ebbd55769886bcULL, 0x5ac635d8aa3a93e7ULL },
+            .gx = { 0xf4a13945d898c296ULL, 0x77037d812deb33a0ULL,
+                    0xf8bce6e563a440f2ULL, 0x6b17d1f2e12c4247ULL },
+            .gy = { 0xcbb6406837bf51f5ULL, 0x2bce33576b315eceULL,
+                    0x8ee7eb4a7c0f9e16ULL, 0x4fe342e2fe1a7f9bULL },
+            .codec = { 0x80, 0x24 },
+        },
+    };
+
+    static pthread_once_t __bsky_curves_once = PTHREAD_ONCE_INIT;
+
+    static int __bsky_u256_is_zero(const uint64_t a[4]) {
+        return (a[0] | a[1] | a[2] | a[3]) == 0;
+    }
+
+    static int __bsky_u256_cmp(const uint64_t a[4], const uint64_t b[4])
+    {
+        for (int i = 3; i >= 0; --i)
+            if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+
+        return 0;
+    }
+
+    // a + b + carry, carry is updated.
+    static inline uint64_t __bsky_adc(uint64_t a, uint64_t b,
+                                      uint64_t *carry)
+    {
+        uint64_t s = a + *carry, t = s + b;
+
+        *carry = (s < a) + (t < s);
+        return t;
+    }
+
+    // a - b - borrow, borrow is updated.
+    static inline uint64_t __bsky_sbb(uint64_t a, uint64_t b,
+                                      uint64_t *borrow)
+    {
+        uint64_t d = a - b, t = d - *borrow;
+
+        *borrow = (a < b) | (d < *borrow);
+        return t;
+    }
+
+    // r = a + b, return carry.
+    static uint64_t __bsky_u256_add(uint64_t r[4], const uint64_t a[4],
+                                    const uint64_t b[4])
+    {
+        uint64_t carry = 0;
+
+        for (int i = 0; i < 4; ++i) r[i] = __bsky_adc(a[i], b[i], &carry);
+        return carry;
+    }
+
+    // r = a - b, return borrow.
+    static uint64_t __bsky_u256_sub(uint64_t r[4], const uint64_t a[4],
+                                    const uint64_t b[4])
+    {
+        uint64_t borrow = 0;
+
+        for (int i = 0; i < 4; ++i) r[i] = __bsky_sbb(a[i], b[i], &borrow);
+        return borrow;
+    }
+
+    static void __bsky_u256_of_bytes(uint64_t r[4], const unsigned char *b)
+    {
+        for (int i = 0; i < 4; ++i) {
+            r[3 - i] = 0;
+            for (int j = 0; j < 8; ++j)
+                r[3 - i] = r[3 - i] << 8 | b[i * 8 + j];
+        }
+    }
+
+    static void __bsky_u256_to_bytes(unsigned char *b, const uint64_t a[4])
+    {
+        for (int i = 0; i < 32; ++i)
+            b[i] = a[3 - i / 8] >> (56 - i % 8 * 8);
+    }
+
+    // t += x * y + c, c is the high half.
+    #ifdef __SIZEOF_INT128__
+        #define __BSKY_MAC(t, x, y, c) do {                               \
+                unsigned __int128 __p = (unsigned __int128) (x) * (y) +   \
+                                        (t) + (c);                        \
+                (t) = (uint64_t) __p;                                     \
+                (c) = (uint64_t) (__p >> 64);                             \
+            } while (0)
+    #else
+        // x * y of 32-bit halves, for targets without 128-bit integers.
+        static inline uint64_t __bsky_mul64(uint64_t x, uint64_t y,
+                                            uint64_t *hi)
+        {
+            uint64_t x0 = (uint32_t) x, x1 = x >> 32;
+            uint64_t y0 = (uint32_t) y, y1 = y >> 32;
+            uint64_t p00 = x0 * y0, p01 = x0 * y1;
+            uint64_t p10 = x1 * y0, p11 = x1 * y1;
+            uint64_t mid = (p00 >> 32) + (uint32_t) p01 + (uint32_t) p10;
+
+            *hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+            return mid << 32 | (uint32_t) p00;
+        }
+
+        #define __BSKY_MAC(t, x, y, c) do {                               \
+                uint64_t __hi, __lo = __bsky_mul64((x), (y), &__hi);      \
+                __lo += (t); __hi += __lo < (t);                          \
+                __lo += (c); __hi += __lo < (c);                          \
+                (t) = __lo;                                               \
+                (c) = __hi;                                               \
+            } while (0)
+    #endif
+
+    // Montgomery product a * b / 2^256 mod m (CIOS). This is the hot loop
+    // of signature verification: limbs are kept in locals so that they
+    // stay in registers.
+    static void __bsky_mod_mul(const struct __bsky_mod *mod, uint64_t r[4],
+                               const uint64_t a[4], const uint64_t b[4])
+    {
+        uint64_t t0 = 0, t1 = 0, t2 = 0, t3 = 0, t4 = 0, t5, c, q;
+        const uint64_t *m = mod->m;
+
+        for (int i = 0; i < 4; ++i) {
+            c = 0;
+            __BSKY_MAC(t0, a[0], b[i], c);
+            __BSKY_MAC(t1, a[1], b[i], c);
+            __BSKY_MAC(t2, a[2], b[i], c);
+            __BSKY_MAC(t3, a[3], b[i], c);
+            t4 += c;
+            t5  = t4 < c;
+
+            q = t0 * mod->inv;
+            c = 0;
+            __BSKY_MAC(t0, q, m[0], c);              // t0 is 0 now
+            __BSKY_MAC(t1, q, m[1], c);
+            __BSKY_MAC(t2, q, m[2], c);
+            __BSKY_MAC(t3, q, m[3], c);
+
+            t0 = t1;
+            t1 = t2;
+            t2 = t3;
+            t3 = t4 + c;
+            t4 = t5 + (t3 < c);
+        }
+
+        // t < 2m, the final subtraction is done in locals too.
+        uint64_t borrow = 0;
+        uint64_t s0 = __bsky_sbb(t0, m[0], &borrow);
+        uint64_t s1 = __bsky_sbb(t1, m[1], &borrow);
+        uint64_t s2 = __bsky_sbb(t2, m[2], &borrow);
+        uint64_t s3 = __bsky_sbb(t3, m[3], &borrow);
+        uint64_t keep = -(uint64_t) (borrow & ~t4 & 1);
+
+        r[0] = (t0 & keep) | (s0 & ~keep);
+        r[1] = (t1 & keep) | (s1 & ~keep);
+        r[2] = (t2 & keep) | (s2 & ~keep);
+        r[3] = (t3 & keep) | (s3 & ~keep);
+    }
+
+    #undef __BSKY_MAC
+
+    static void __bsky_mod_add(const struct __bsky_mod *mod, uint64_t r[4],
+                               const uint64_t a[4], const uint64_t b[4])
+    {
+        const uint64_t *m = mod->m;
+        uint64_t carry = 0, borrow = 0;
+        uint64_t t0 = __bsky_adc(a[0], b[0], &carry);
+        uint64_t t1 = __bsky_adc(a[1], b[1], &carry);
+        uint64_t t2 = __bsky_adc(a[2], b[2], &carry);
+        uint64_t t3 = __bsky_adc(a[3], b[3], &carry);
+        uint64_t s0 = __bsky_sbb(t0, m[0], &borrow);
+        uint64_t s1 = __bsky_sbb(t1, m[1], &borrow);
+        uint64_t s2 = __bsky_sbb(t2, m[2], &borrow);
+        uint64_t s3 = __bsky_sbb(t3, m[3], &borrow);
+
+        uint64_t keep = -(borrow & ~carry & 1);
+
+        r[0] = (t0 & keep) | (s0 & ~keep);
+        r[1] = (t1 & keep) | (s1 & ~keep);
+        r[2] = (t2 & keep) | (s2 & ~keep);
+        r[3] = (t3 & keep) | (s3 & ~keep);
+    }
+
+    static void __bsky_mod_sub(const struct __bsky_mod *mod, uint64_t r[4],
+                               const uint64_t a[4], const uint64_t b[4])
+    {
+        const uint64_t *m = mod->m;
+        uint64_t borrow = 0, carry = 0;
+        uint64_t t0 = __bsky_sbb(a[0], b[0], &borrow);
+        uint64_t t1 = __bsky_sbb(a[1], b[1], &borrow);
+        uint64_t t2 = __bsky_sbb(a[2], b[2], &borrow);
+        uint64_t t3 = __bsky_sbb(a[3], b[3], &borrow);
+
+        uint64_t mask = -borrow;
+
+        r[0] = __bsky_adc(t0, m[0] & mask, &carry);
+        r[1] = __bsky_adc(t1, m[1] & mask, &carry);
+        r[2] = __bsky_adc(t2, m[2] & mask, &carry);
+        r[3] = __bsky_adc(t3, m[3] & mask, &carry);
+    }
+
+    static void __bsky_mod_to(const struct __bsky_mod *mod, uint64_t r[4],
+                              const uint64_t a[4]) {
+        __bsky_mod_mul(mod, r, a, mod->r2);
+    }
+
+    static void __bsky_mod_from(const struct __bsky_mod *mod, uint64_t r[4],
+                                const uint64_t a[4]) {
+        static const uint64_t one[4] = { 1 };
+        __bsky_mod_mul(mod, r, a, one);
+    }
+
+    // a^e, `e' isn't in Montgomery form.
+    static void __bsky_mod_pow(const struct __bsky_mod *mod, uint64_t r[4],
+                               const uint64_t a[4], const uint64_t e[4])
+    {
+        uint64_t x[4];
+
+        memcpy(x, mod->one, sizeof x);
+
+        for (int i = 255; i >= 0; --i) {
+            __bsky_mod_mul(mod, x, x, x);
+            if (e[i / 64] >> (i % 64) & 1) __bsky_mod_mul(mod, x, x, a);
+        }
+
+        memcpy(r, x, sizeof x);
+    }
+
+    // a^-1 as a^(m - 2), moduli are prime.
+    static void __bsky_mod_inv(const struct __bsky_mod *mod, uint64_t r[4],
+                               const uint64_t a[4])
+    {
+        static const uint64_t two[4] = { 2 };
+        uint64_t e[4];
+
+        __bsky_u256_sub(e, mod->m, two);
+        __bsky_mod_pow(mod, r, a, e);
+    }
+
+    // Invert `len' nonzero elements at once: 3 products per element and
+    // one inversion. `tmp' holds `len' elements.
+    static void __bsky_mod_inv_batch(const struct __bsky_mod *mod,
+                                     uint64_t (*elems)[4], size_t len,
+                                     uint64_t (*tmp)[4])
+    {
+        uint64_t acc[4], inv[4];
+
+        if (len == 0) return;
+
+        memcpy(tmp[0], elems[0], sizeof acc);
+        for (size_t i = 1; i < len; ++i)
+            __bsky_mod_mul(mod, tmp[i], tmp[i - 1], elems[i]);
+
+        __bsky_mod_inv(mod, acc, tmp[len - 1]);
+
+        for (size_t i = len - 1; i > 0; --i) {
+            __bsky_mod_mul(mod, inv, acc, tmp[i - 1]);
+            __bsky_mod_mul(mod, acc, acc, elems[i]);
+            memcpy(elems[i], inv, sizeof inv);
+        }
+        memcpy(elems[0], acc, sizeof acc);
+    }
+
+    // Jacobian doubling (dbl-2001-b for a = -3).
+    static void __bsky_ec_dbl(const struct __bsky_curve *c,
+                              struct __bsky_jac *r, const struct __bsky_jac *p)
+    {
+        const struct __bsky_mod *f = &c->p;
+        uint64_t yy[4], s[4], m[4], t[4];
+        struct __bsky_jac q;
+
+        if (__bsky_u256_is_zero(p->z)) {
+            *r = *p;
+            return;
+        }
+
+        __bsky_mod_mul(f, yy, p->y, p->y);
+        __bsky_mod_mul(f, s, p->x, yy);
+        __bsky_mod_add(f, s, s, s);
+        __bsky_mod_add(f, s, s, s);                  // 4XY^2
+
+        if (c->a_minus_3) {
+            __bsky_mod_mul(f, t, p->z, p->z);
+            __bsky_mod_add(f, m, p->x, t);
+            __bsky_mod_sub(f, t, p->x, t);
+            __bsky_mod_mul(f, m, m, t);              // X^2 - Z^4
+        } else {
+            __bsky_mod_mul(f, m, p->x, p->x);
+        }
+        __bsky_mod_add(f, t, m, m);
+        __bsky_mod_add(f, m, t, m);
+
+        __bsky_mod_mul(f, q.z, p->y, p->z);
+        __bsky_mod_add(f, q.z, q.z, q.z);
+
+        __bsky_mod_mul(f, q.x, m, m);
+        __bsky_mod_sub(f, q.x, q.x, s);
+        __bsky_mod_sub(f, q.x, q.x, s);
+
+        __bsky_mod_mul(f, yy, yy, yy);
+        __bsky_mod_add(f, yy, yy, yy);
+        __bsky_mod_add(f, yy, yy, yy);
+        __bsky_mod_add(f, yy, yy, yy);               // 8Y^4
+
+        __bsky_mod_sub(f, t, s, q.x);
+        __bsky_mod_mul(f, q.y, m, t);
+        __bsky_mod_sub(f, q.y, q.y, yy);
+
+        *r = q;
+    }
+
+    // Jacobian plus affine point.
+    static void __bsky_ec_madd(const struct __bsky_curve *c,
+                               struct __bsky_jac *r, const struct __bsky_jac *p,
+                               const uint64_t x[4], const uint64_t y[4])
+    {
+        const struct __bsky_mod *f = &c->p;
+        uint64_t zz[4], u[4], s[4], h[4], hh[4], hhh[4], v[4];
+        struct __bsky_jac q;
+
+        if (__bsky_u256_is_zero(p->z)) {
+            memcpy(r->x, x, sizeof r->x);
+            memcpy(r->y, y, sizeof r->y);
+            memcpy(r->z, f->one, sizeof r->z);
+            return;
+        }
+
+        __bsky_mod_mul(f, zz, p->z, p->z);
+        __bsky_mod_mul(f, u, x, zz);
+        __bsky_mod_mul(f, s, y, zz);
+        __bsky_mod_mul(f, s, s, p->z);
+
+        __bsky_mod_sub(f, h, u, p->x);
+        __bsky_mod_sub(f, s, s, p->y);
+
+        if (__bsky_u256_is_zero(h)) {
+            if (!__bsky_u256_is_zero(s)) {
+                memset(r, 0, sizeof *r);
+                return;
+            }
+
+            memcpy(q.x, x, sizeof q.x);
+            memcpy(q.y, y, sizeof q.y);
+            memcpy(q.z, f->one, sizeof q.z);
+            __bsky_ec_dbl(c, r, &q);
+            return;
+        }
+
+        __bsky_mod_mul(f, hh, h, h);
+        __bsky_mod_mul(f, hhh, hh, h);
+        __bsky_mod_mul(f, v, p->x, hh);
+
+        __bsky_mod_mul(f, q.x, s, s);
+        __bsky_mod_sub(f, q.x, q.x, hhh);
+        __bsky_mod_sub(f, q.x, q.x, v);
+        __bsky_mod_sub(f, q.x, q.x, v);
+
+        __bsky_mod_sub(f, v, v, q.x);
+        __bsky_mod_mul(f, q.y, s, v);
+        __bsky_mod_mul(f, hhh, hhh, p->y);
+        __bsky_mod_sub(f, q.y, q.y, hhh);
+
+        __bsky_mod_mul(f, q.z, p->z, h);
+
+        *r = q;
+    }
+
+    // Complete addition (Renes, Costello, Batina 2015: algorithms 4 and
+    // 7), no exceptional cases, so it doesn't branch on points.
+    static void __bsky_proj_add(const struct __bsky_curve *c,
+                                struct __bsky_proj *r,
+                                const struct __bsky_proj *p,
+                                const struct __bsky_proj *q)
+    {
+        const struct __bsky_mod *f = &c->p;
+        uint64_t t0[4], t1[4], t2[4], t3[4], t4[4], x[4], y[4], z[4];
+
+        __bsky_mod_mul(f, t0, p->x, q->x);
+        __bsky_mod_mul(f, t1, p->y, q->y);
+        __bsky_mod_mul(f, t2, p->z, q->z);
+        __bsky_mod_add(f, t3, p->x, p->y);
+        __bsky_mod_add(f, t4, q->x, q->y);
+        __bsky_mod_mul(f, t3, t3, t4);
+        __bsky_mod_add(f, t4, t0, t1);
+        __bsky_mod_sub(f, t3, t3, t4);
+        __bsky_mod_add(f, t4, p->y, p->z);
+        __bsky_mod_add(f, x, q->y, q->z);
+        __bsky_mod_mul(f, t4, t4, x);
+        __bsky_mod_add(f, x, t1, t2);
+        __bsky_mod_sub(f, t4, t4, x);
+        __bsky_mod_add(f, x, p->x, p->z);
+        __bsky_mod_add(f, y, q->x, q->z);
+        __bsky_mod_mul(f, x, x, y);
+        __bsky_mod_add(f, y, t0, t2);
+        __bsky_mod_sub(f, y, x, y);
+
+        if (c->a_minus_3) {
+            __bsky_mod_mul(f, z, c->b, t2);
+            __bsky_mod_sub(f, x, y, z);
+            __bsky_mod_add(f, z, x, x);
+            __bsky_mod_add(f, x, x, z);
+            __bsky_mod_sub(f, z, t1, x);
+            __bsky_mod_add(f, x, t1, x);
+            __bsky_mod_mul(f, y, c->b, y);
+            __bsky_mod_add(f, t1, t2, t2);
+            __bsky_mod_add(f, t2, t1, t2);
+            __bsky_mod_sub(f, y, y, t2);
+            __bsky_mod_sub(f, y, y, t0);
+            __bsky_mod_add(f, t1, y, y);
+            __bsky_mod_add(f, y, t1, y);
+            __bsky_mod_add(f, t1, t0, t0);
+            __bsky_mod_add(f, t0, t1, t0);
+            __bsky_mod_sub(f, t0, t0, t2);
+            __bsky_mod_mul(f, t1, t4, y);
+            __bsky_mod_mul(f, t2, t0, y);
+            __bsky_mod_mul(f, y, x, z);
+            __bsky_mod_add(f, r->y, y, t2);
+            __bsky_mod_mul(f, x, t3, x);
+            __bsky_mod_sub(f, r->x, x, t1);
+            __bsky_mod_mul(f, z, t4, z);
+            __bsky_mod_mul(f, t1, t3, t0);
+            __bsky_mod_add(f, r->z, z, t1);
+        } else {
+            __bsky_mod_add(f, x, t0, t0);
+            __bsky_mod_add(f, t0, x, t0);
+            __bsky_mod_mul(f, t2, c->b3, t2);
+            __bsky_mod_add(f, z, t1, t2);
+            __bsky_mod_sub(f, t1, t1, t2);
+            __bsky_mod_mul(f, y, c->b3, y);
+            __bsky_mod_mul(f, x, t4, y);
+            __bsky_mod_mul(f, t2, t3, t1);
+            __bsky_mod_sub(f, r->x, t2, x);
+            __bsky_mod_mul(f, y, y, t0);
+            __bsky_mod_mul(f, t1, t1, z);
+            __bsky_mod_add(f, r->y, t1, y);
+            __bsky_mod_mul(f, t0, t0, t3);
+            __bsky_mod_mul(f, z, z, t4);
+            __bsky_mod_add(f, r->z, z, t0);
+        }
+    }
+
+    // Complete doubling (algorithms 6 and 9 of the same paper).
+    static void __bsky_proj_dbl(const struct __bsky_curve *c,
+                                struct __bsky_proj *r,
+                                const struct __bsky_proj *p)
+    {
+        const struct __bsky_mod *f = &c->p;
+        uint64_t t0[4], t1[4], t2[4], t3[4], x[4], y[4], z[4];
+
+        if (c->a_minus_3) {
+            __bsky_mod_mul(f, t0, p->x, p->x);
+            __bsky_mod_mul(f, t1, p->y, p->y);
+            __bsky_mod_mul(f, t2, p->z, p->z);
+            __bsky_mod_mul(f, t3, p->x, p->y);
+            __bsky_mod_add(f, t3, t3, t3);
+            __bsky_mod_mul(f, z, p->x, p->z);
+            __bsky_mod_add(f, z, z, z);
+            __bsky_mod_mul(f, y, c->b, t2);
+            __bsky_mod_sub(f, y, y, z);
+            __bsky_mod_add(f, x, y, y);
+            __bsky_mod_add(f, y, x, y);
+            __bsky_mod_sub(f, x, t1, y);
+            __bsky_mod_add(f, y, t1, y);
+            __bsky_mod_mul(f, y, x, y);
+            __bsky_mod_mul(f, x, x, t3);
+            __bsky_mod_add(f, t3, t2, t2);
+            __bsky_mod_add(f, t2, t2, t3);
+            __bsky_mod_mul(f, z, c->b, z);
+            __bsky_mod_sub(f, z, z, t2);
+            __bsky_mod_sub(f, z, z, t0);
+            __bsky_mod_add(f, t3, z, z);
+            __bsky_mod_add(f, z, z, t3);
+            __bsky_mod_add(f, t3, t0, t0);
+            __bsky_mod_add(f, t0, t3, t0);
+            __bsky_mod_sub(f, t0, t0, t2);
+            __bsky_mod_mul(f, t0, t0, z);
+            __bsky_mod_add(f, y, y, t0);
+            __bsky_mod_mul(f, t0, p->y, p->z);
+            __bsky_mod_add(f, t0, t0, t0);
+            __bsky_mod_mul(f, z, t0, z);
+            __bsky_mod_sub(f, r->x, x, z);
+            __bsky_mod_mul(f, z, t0, t1);
+            __bsky_mod_add(f, z, z, z);
+            __bsky_mod_add(f, r->z, z, z);
+            memcpy(r->y, y, sizeof r->y);
+        } else {
+            __bsky_mod_mul(f, t0, p->y, p->y);
+            __bsky_mod_add(f, z, t0, t0);
+            __bsky_mod_add(f, z, z, z);
+            __bsky_mod_add(f, z, z, z);
+            __bsky_mod_mul(f, t1, p->y, p->z);
+            __bsky_mod_mul(f, t2, p->z, p->z);
+            __bsky_mod_mul(f, t2, c->b3, t2);
+            __bsky_mod_mul(f, x, t2, z);
+            __bsky_mod_add(f, y, t0, t2);
+            __bsky_mod_mul(f, z, t1, z);
+            __bsky_mod_add(f, t1, t2, t2);
+            __bsky_mod_add(f, t2, t1, t2);
+            __bsky_mod_sub(f, t0, t0, t2);
+            __bsky_mod_mul(f, y, t0, y);
+            __bsky_mod_add(f, y, x, y);
+            __bsky_mod_mul(f, t1, p->x, p->y);
+            __bsky_mod_mul(f, x, t0, t1);
+            __bsky_mod_add(f, r->x, x, x);
+            memcpy(r->y, y, sizeof r->y);
+            memcpy(r->z, z, sizeof r->z);
+        }
+    }
+
+    // Odd multiples of affine point: P, 3P, ..., (2 * len - 1)P.
+    static void __bsky_ec_table(const struct __bsky_curve *c,
+                                const uint64_t x[4], const uint64_t y[4],
+                                uint64_t (*table)[2][4], size_t len)
+    {
+        const struct __bsky_mod *f = &c->p;
+        struct __bsky_jac points[__BSKY_G_TABLE_LEN], twice;
+        uint64_t zs[__BSKY_G_TABLE_LEN][4], tmp[__BSKY_G_TABLE_LEN][4];
+        uint64_t two[2][4], zz[4];
+
+        memcpy(points[0].x, x, sizeof points[0].x);
+        memcpy(points[0].y, y, sizeof points[0].y);
+        memcpy(points[0].z, f->one, sizeof points[0].z);
+
+        __bsky_ec_dbl(c, &twice, &points[0]);
+        __bsky_mod_inv(f, zz, twice.z);
+        __bsky_mod_mul(f, two[1], zz, zz);
+        __bsky_mod_mul(f, two[0], twice.x, two[1]);
+        __bsky_mod_mul(f, two[1], two[1], zz);
+        __bsky_mod_mul(f, two[1], twice.y, two[1]);
+
+        for (size_t i = 1; i < len; ++i)
+            __bsky_ec_madd(c, &points[i], &points[i - 1], two[0], two[1]);
+
+        for (size_t i = 0; i < len; ++i)
+            memcpy(zs[i], points[i].z, sizeof zs[i]);
+        __bsky_mod_inv_batch(f, zs, len, tmp);
+
+        for (size_t i = 0; i < len; ++i) {
+            __bsky_mod_mul(f, zz, zs[i], zs[i]);
+            __bsky_mod_mul(f, table[i][0], points[i].x, zz);
+            __bsky_mod_mul(f, zz, zz, zs[i]);
+            __bsky_mod_mul(f, table[i][1], points[i].y, zz);
+        }
+    }
+
+    static void __bsky_curves_init(void)
+    {
+        static const uint64_t one[4] = { 1 };
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(__bsky_curves); ++i) {
+            struct __bsky_curve *c = &__bsky_curves[i];
+
+            __bsky_mod_mul(&c->p, c->p.one, c->p.r2, one);
+            __bsky_mod_mul(&c->n, c->n.one, c->n.r2, one);
+
+            __bsky_mod_to(&c->p, c->b, c->b);
+            __bsky_mod_to(&c->p, c->gx, c->gx);
+            __bsky_mod_to(&c->p, c->gy, c->gy);
+
+            __bsky_ec_table(c, c->gx, c->gy, c->g_table,
+                            __BSKY_G_TABLE_LEN);
+
+            __bsky_mod_add(&c->p, c->b3, c->b, c->b);
+            __bsky_mod_add(&c->p, c->b3, c->b3, c->b);
+
+            struct __bsky_proj *fixed = c->g_fixed;
+
+            memcpy(fixed[0].y, c->p.one, sizeof fixed[0].y);
+            memcpy(fixed[1].x, c->gx, sizeof fixed[1].x);
+            memcpy(fixed[1].y, c->gy, sizeof fixed[1].y);
+            memcpy(fixed[1].z, c->p.one, sizeof fixed[1].z);
+
+            for (size_t j = 2; j < __BSKY_G_FIXED_LEN; ++j)
+                __bsky_proj_add(c, &fixed[j], &fixed[j - 1], &fixed[1]);
+        }
+    }
+
+    static const struct __bsky_curve *
+    __bsky_curve_of(enum bsky_key_curve curve)
+    {
+        pthread_once(&__bsky_curves_once, __bsky_curves_init);
+        return &__bsky_curves[curve];
+    }
+
+    // Width-`w' NAF: digits are zero or odd with `|d| < 2^(w - 1)'.
+    // Return number of digits.
+    static int __bsky_wnaf(signed char naf[257], const uint64_t k[4], int w)
+    {
+        uint64_t d[5] = { k[0], k[1], k[2], k[3], 0 };
+        int len = 0;
+
+        while ((d[0] | d[1] | d[2] | d[3] | d[4]) != 0) {
+            int digit = 0;
+
+            if (d[0] & 1) {
+                digit = d[0] & ((1 << w) - 1);
+                if (digit >= 1 << (w - 1)) digit -= 1 << w;
+
+                // d -= digit, low bits of d are at least `digit'.
+                uint64_t prev = d[0];
+                d[0] -= (uint64_t) (int64_t) digit;
+
+                if (digit < 0 && d[0] < prev)
+                    for (int i = 1; i < 5 && ++d[i] == 0; ++i);
+            }
+
+            naf[len++] = digit;
+
+            for (int i = 0; i < 4; ++i) d[i] = d[i] >> 1 | d[i + 1] << 63;
+            d[4] >>= 1;
+        }
+
+        return len;
+    }
+
+    // r = u1 * G + u2 * P, `table' are odd multiples of P (may be NULL).
+    static void __bsky_ec_mul(const struct __bsky_curve *c,
+                              struct __bsky_jac *r, const uint64_t u1[4],
+                              const uint64_t u2[4],
+                              const uint64_t (*table)[2][4])
+    {
+        signed char naf1[257], naf2[257];
+        int len1 = __bsky_wnaf(naf1, u1, 7);
+        int len2 = table != NULL ? __bsky_wnaf(naf2, u2, 5) : 0;
+        uint64_t y[4];
+
+        memset(r, 0, sizeof *r);
+
+        for (int i = (len1 > len2 ? len1 : len2) - 1; i >= 0; --i) {
+            __bsky_ec_dbl(c, r, r);
+
+            int d = i < len1 ? naf1[i] : 0;
+            if (d != 0) {
+                const uint64_t (*point)[4] = c->g_table[(d < 0 ? -d : d) / 2];
+
+                if (d < 0) __bsky_mod_sub(&c->p, y, c->p.m, point[1]);
+                __bsky_ec_madd(c, r, r, point[0], d < 0 ? y : point[1]);
+            }
+
+            d = i < len2 ? naf2[i] : 0;
+            if (d != 0) {
+                const uint64_t (*point)[4] = table[(d < 0 ? -d : d) / 2];
+
+                if (d < 0) __bsky_mod_sub(&c->p, y, c->p.m, point[1]);
+                __bsky_ec_madd(c, r, r, point[0], d < 0 ? y : point[1]);
+            }
+        }
+    }
+
+    // Clear secret which goes out of scope, stores are not optimized away.
+    static void __bsky_wipe(void *data, size_t len)
+    {
+        volatile unsigned char *c = data;
+
+        while (len-- > 0) *c++ = 0;
+    }
+
+    // r = k * G for secret `k': fixed 4 bit windows, complete formulas
+    // and table entry selected by masks, so neither branches nor memory
+    // accesses depend on `k'.
+    static void __bsky_ec_mul_secret(const struct __bsky_curve *c,
+                                     struct __bsky_proj *r,
+                                     const uint64_t k[4])
+    {
+        struct __bsky_proj q;
+
+        memset(r, 0, sizeof *r);
+        memcpy(r->y, c->p.one, sizeof r->y);
+
+        for (int i = 63; i >= 0; --i) {
+            uint64_t digit = k[i / 16] >> (i % 16 * 4) & 0xf;
+
+            for (int j = 0; j < 4; ++j) __bsky_proj_dbl(c, r, r);
+
+            memset(&q, 0, sizeof q);
+            for (uint64_t j = 0; j < __BSKY_G_FIXED_LEN; ++j) {
+                uint64_t mask = -(((j ^ digit) - 1) >> 63);
+                const uint64_t *entry = (const uint64_t *) &c->g_fixed[j];
+
+                for (size_t l = 0; l < sizeof q / sizeof (uint64_t); ++l)
+                    ((uint64_t *) &q)[l] |= entry[l] & mask;
+            }
+
+            __bsky_proj_add(c, r, r, &q);
+        }
+
+        __bsky_wipe(&q, sizeof q);
+    }
+
+    // Affine point (Montgomery form) of projective one, it's not infinity.
+    static void __bsky_proj_affine(const struct __bsky_curve *c,
+                                   const struct __bsky_proj *p, uint64_t x[4],
+                                   uint64_t y[4])
+    {
+        uint64_t zi[4];
+
+        __bsky_mod_inv(&c->p, zi, p->z);
+        __bsky_mod_mul(&c->p, x, p->x, zi);
+        if (y != NULL) __bsky_mod_mul(&c->p, y, p->y, zi);
+    }
+
+    static void __bsky_key_init(struct bsky_key *key, const uint64_t x[4],
+                                const uint64_t y[4])
+    {
+        __bsky_ec_table(__bsky_curve_of(key->curve), x, y, key->table,
+                        BSKY_KEY_TABLE_LEN);
+    }
+
+    // Point of SEC1 encoding (compressed or not), Montgomery form.
+    static enum bsky_error_code
+    __bsky_ec_decode(const struct __bsky_curve *c, const unsigned char *data,
+                     size_t len, uint64_t x[4], uint64_t y[4])
+    {
+        const struct __bsky_mod *f = &c->p;
+        uint64_t rhs[4], t[4], e[4];
+
+        if ((len != 33 || (data[0] != 2 && data[0] != 3)) &&
+            (len != 65 || data[0] != 4))
+            return bsky_ec_Key_invalid;
+
+        __bsky_u256_of_bytes(x, data + 1);
+        if (__bsky_u256_cmp(x, f->m) >= 0) return bsky_ec_Key_invalid;
+        __bsky_mod_to(f, x, x);
+
+        // x^3 + ax + b
+        __bsky_mod_mul(f, rhs, x, x);
+        __bsky_mod_mul(f, rhs, rhs, x);
+        if (c->a_minus_3) {
+            __bsky_mod_add(f, t, x, x);
+            __bsky_mod_add(f, t, t, x);
+            __bsky_mod_sub(f, rhs, rhs, t);
+        }
+        __bsky_mod_add(f, rhs, rhs, c->b);
+
+        if (len == 65) {
+            __bsky_u256_of_bytes(y, data + 33);
+            if (__bsky_u256_cmp(y, f->m) >= 0) return bsky_ec_Key_invalid;
+            __bsky_mod_to(f, y, y);
+        } else {
+            // p = 3 mod 4: sqrt is rhs^((p + 1) / 4).
+            static const uint64_t one[4] = { 1 };
+
+            __bsky_u256_add(e, f->m, one);
+            for (int i = 0; i < 4; ++i)
+                e[i] = e[i] >> 2 | (i < 3 ? e[i + 1] << 62 : 0);
+            __bsky_mod_pow(f, y, rhs, e);
+
+            __bsky_mod_from(f, t, y);
+            if ((t[0] & 1) != (data[0] & 1)) __bsky_mod_sub(f, y, f->m, y);
+        }
+
+        __bsky_mod_mul(f, t, y, y);
+        if (__bsky_u256_cmp(t, rhs) != 0) return bsky_ec_Key_invalid;
+
+        return bsky_ec_Ok;
+    }
+
+    static const char __bsky_base58[] =
+        "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+    struct bsky_key bsky_key_parse_did(struct bsky_str str,
+                                       enum bsky_error_code *ec)
+    {
+        struct bsky_key key = { 0 };
+        unsigned char bytes[80] = { 0 };
+        size_t len = 0;
+        uint64_t x[4], y[4];
+
+        *ec = bsky_ec_Ok;
+
+        if (bsky_str_starts_with(str, bsky_mk_str("did:key:")))
+            str.start += strlen("did:key:");
+        if (bsky_str_len(str) < 2 || *str.start != 'z')
+            bsky_defer_ec(bsky_ec_Key_invalid);
+
+        // base58btc: bytes = bytes * 58 + digit, big-endian.
+        for (char *c = str.start + 1; c < str.end; ++c) {
+            char *digit = memchr(__bsky_base58, *c, 58);
+            if (digit == NULL) bsky_defer_ec(bsky_ec_Key_invalid);
+
+            unsigned carry = digit - __bsky_base58;
+            for (size_t i = 0; i < len; ++i) {
+                carry += bytes[sizeof bytes - 1 - i] * 58;
+                bytes[sizeof bytes - 1 - i] = carry & 0xff;
+                carry >>= 8;
+            }
+            for (; carry != 0; carry >>= 8) {
+                if (len == sizeof bytes) bsky_defer_ec(bsky_ec_Key_invalid);
+                bytes[sizeof bytes - 1 - len++] = carry & 0xff;
+            }
+        }
+
+        // leading '1's are zero bytes.
+        for (char *c = str.start + 1; c < str.end && *c == '1'; ++c)
+            if (++len > sizeof bytes) bsky_defer_ec(bsky_ec_Key_invalid);
+
+        unsigned char *data = bytes + sizeof bytes - len;
+
+        if (len < 2) bsky_defer_ec(bsky_ec_Key_invalid);
+
+        size_t curve = 0;
+        for (; curve < BSKY_ARRAY_LEN(__bsky_curves); ++curve)
+            if (memcmp(data, __bsky_curves[curve].codec, 2) == 0) break;
+
+        if (curve == BSKY_ARRAY_LEN(__bsky_curves))
+            bsky_defer_ec(bsky_ec_Key_unsupported);
+
+        key.curve = curve;
+
+        *ec = __bsky_ec_decode(__bsky_curve_of(key.curve), data + 2,
+                               len - 2, x, y);
+        if (*ec != bsky_ec_Ok) goto defer;
+
+        __bsky_key_init(&key, x, y);
+
+    defer:
+        return key;
+    }
+
+    struct bsky_str bsky_key_format_did(char *buf, const struct bsky_key *key)
+    {
+        const struct __bsky_curve *c = __bsky_curve_of(key->curve);
+        unsigned char bytes[35];
+        uint64_t t[4];
+        char digits[BSKY_DID_KEY_STR_LEN];
+        size_t len = 0;
+
+        memcpy(bytes, c->codec, 2);
+        __bsky_mod_from(&c->p, t, key->table[0][1]);
+        bytes[2] = 2 | (t[0] & 1);
+        __bsky_mod_from(&c->p, t, key->table[0][0]);
+        __bsky_u256_to_bytes(bytes + 3, t);
+
+        // repeated division by 58, codec is never zero.
+        for (size_t start = 0; start < sizeof bytes;) {
+            unsigned rem = 0;
+
+            for (size_t i = start; i < sizeof bytes; ++i) {
+                rem      = rem << 8 | bytes[i];
+                bytes[i] = rem / 58;
+                rem     %= 58;
+            }
+            digits[len++] = __bsky_base58[rem];
+
+            while (start < sizeof bytes && bytes[start] == 0) start++;
+        }
+
+        char *out = buf + strlen("did:key:z");
+
+        memcpy(buf, "did:key:z", out - buf);
+        while (len > 0) *out++ = digits[--len];
+        *out = '\0';
+
+        return (struct bsky_str) { buf, out };
+    }
+
+    struct bsky_key
+    bsky_key_of_secret(enum bsky_key_curve curve,
+                       const unsigned char secret[BSKY_KEY_SECRET_LEN],
+                       enum bsky_error_code *ec)
+    {
+        struct bsky_key key = { .curve = curve };
+        const struct __bsky_curve *c;
+        struct __bsky_proj point;
+        uint64_t x[4], y[4];
+
+        *ec = bsky_ec_Ok;
+
+        if ((unsigned) curve >= BSKY_ARRAY_LEN(__bsky_curves))
+            bsky_defer_ec(bsky_ec_Key_unsupported);
+
+        c = __bsky_curve_of(curve);
+        __bsky_u256_of_bytes(key.secret, secret);
+
+        if (__bsky_u256_is_zero(key.secret) ||
+            __bsky_u256_cmp(key.secret, c->n.m) >= 0) {
+            memset(key.secret, 0, sizeof key.secret);
+            bsky_defer_ec(bsky_ec_Key_invalid);
+        }
+
+        __bsky_ec_mul_secret(c, &point, key.secret);
+        __bsky_proj_affine(c, &point, x, y);
+        __bsky_key_init(&key, x, y);
+        __bsky_wipe(&point, sizeof point);
+
+    defer:
+        return key;
+    }
+
+    static void __bsky_hmac_sha256(const unsigned char key[BSKY_SHA256_LEN],
+                                   const void *data, size_t len,
+                                   unsigned char out[BSKY_SHA256_LEN])
+    {
+        unsigned char pad[64], inner[BSKY_SHA256_LEN];
+        struct bsky_sha256 sha;
+
+        for (size_t i = 0; i < sizeof pad; ++i)
+            pad[i] = (i < BSKY_SHA256_LEN ? key[i] : 0) ^ 0x36;
+
+        bsky_sha256_init(&sha);
+        bsky_sha256_update(&sha, pad, sizeof pad);
+        bsky_sha256_update(&sha, data, len);
+        bsky_sha256_final(&sha, inner);
+
+        for (size_t i = 0; i < sizeof pad; ++i) pad[i] ^= 0x36 ^ 0x5c;
+
+        bsky_sha256_init(&sha);
+        bsky_sha256_update(&sha, pad, sizeof pad);
+        bsky_sha256_update(&sha, inner, sizeof inner);
+        bsky_sha256_final(&sha, out);
+    }
+
+    // Digest as scalar: big-endian, reduced mod n.
+    static void __bsky_ec_digest(const struct __bsky_curve *c, uint64_t e[4],
+                                 const unsigned char *digest)
+    {
+        __bsky_u256_of_bytes(e, digest);
+        if (__bsky_u256_cmp(e, c->n.m) >= 0) __bsky_u256_sub(e, e, c->n.m);
+    }
+
+    enum bsky_error_code
+    bsky_key_sign(const struct bsky_key *key,
+                  const unsigned char digest[BSKY_SHA256_LEN],
+                  unsigned char sig[BSKY_SIG_LEN])
+    {
+        const struct __bsky_curve *c = __bsky_curve_of(key->curve);
+        const struct __bsky_mod *n = &c->n;
+        uint64_t e[4], k[4], r[4], s[4], t[4], half[4];
+        struct __bsky_proj point;
+
+        // RFC 6979: K and V, then data is V, separator, secret and digest.
+        unsigned char hk[BSKY_SHA256_LEN], data[97];
+        unsigned char *v = data;
+
+        if (__bsky_u256_is_zero(key->secret)) return bsky_ec_Key_no_secret;
+
+        __bsky_ec_digest(c, e, digest);
+        memset(hk, 0, sizeof hk);
+        memset(v, 1, BSKY_SHA256_LEN);
+        __bsky_u256_to_bytes(data + 33, key->secret);
+        __bsky_u256_to_bytes(data + 65, e);
+
+        for (int sep = 0; sep <= 1; ++sep) {
+            data[32] = sep;
+            __bsky_hmac_sha256(hk, data, sizeof data, hk);
+            __bsky_hmac_sha256(hk, v, BSKY_SHA256_LEN, v);
+        }
+
+        for (;;) {
+            __bsky_hmac_sha256(hk, v, BSKY_SHA256_LEN, v);
+            __bsky_u256_of_bytes(k, v);
+
+            if (!__bsky_u256_is_zero(k) && __bsky_u256_cmp(k, n->m) < 0) {
+                __bsky_ec_mul_secret(c, &point, k);
+                __bsky_proj_affine(c, &point, r, NULL);
+                __bsky_mod_from(&c->p, r, r);
+                if (__bsky_u256_cmp(r, n->m) >= 0)
+                    __bsky_u256_sub(r, r, n->m);
+
+                // s = (e + r * secret) / k
+                __bsky_mod_to(n, t, r);
+                __bsky_mod_mul(n, t, t, key->secret);
+                __bsky_mod_add(n, t, t, e);
+                __bsky_mod_to(n, k, k);
+                __bsky_mod_inv(n, k, k);
+                __bsky_mod_mul(n, s, t, k);
+
+                if (!__bsky_u256_is_zero(r) && !__bsky_u256_is_zero(s))
+                    break;
+            }
+
+            data[32] = 0;
+            __bsky_hmac_sha256(hk, data, BSKY_SHA256_LEN + 1, hk);
+            __bsky_hmac_sha256(hk, v, BSKY_SHA256_LEN, v);
+        }
+
+        // nonce, its state and r * secret.
+        __bsky_wipe(k, sizeof k);
+        __bsky_wipe(t, sizeof t);
+        __bsky_wipe(&point, sizeof point);
+        __bsky_wipe(hk, sizeof hk);
+        __bsky_wipe(data, sizeof data);
+
+        // low-S
+        for (int i = 0; i < 4; ++i)
+            half[i] = n->m[i] >> 1 | (i < 3 ? n->m[i + 1] << 63 : 0);
+        if (__bsky_u256_cmp(s, half) > 0) __bsky_u256_sub(s, n->m, s);
+
+        __bsky_u256_to_bytes(sig, r);
+        __bsky_u256_to_bytes(sig + 32, s);
+
+        return bsky_ec_Ok;
+    }
+
+    // Parse r and s, check ranges and low-S. Return 0 if signature is
+    // malformed.
+    static int __bsky_sig_parse(const struct __bsky_curve *c,
+                                struct bsky_view sig, uint64_t r[4],
+                                uint64_t s[4])
+    {
+        uint64_t half[4];
+
+        if ((char *) sig.end - (char *) sig.start != BSKY_SIG_LEN) return 0;
+
+        __bsky_u256_of_bytes(r, sig.start);
+        __bsky_u256_of_bytes(s, (unsigned char *) sig.start + 32);
+
+        for (int i = 0; i < 4; ++i)
+            half[i] = c->n.m[i] >> 1 | (i < 3 ? c->n.m[i + 1] << 63 : 0);
+
+        return !__bsky_u256_is_zero(r) && __bsky_u256_cmp(r, c->n.m) < 0 &&
+               !__bsky_u256_is_zero(s) && __bsky_u256_cmp(s, half) <= 0;
+    }
+
+    // Verification with `w' = 1 / s (Montgomery form mod n).
+    static int __bsky_sig_check(const struct bsky_key *key,
+                                const unsigned char *digest,
+                                const uint64_t r[4], const uint64_t w[4])
+    {
+        const struct __bsky_curve *c = __bsky_curve_of(key->curve);
+        const struct __bsky_mod *f = &c->p;
+        uint64_t e[4], u1[4], u2[4], zz[4], t[4];
+        struct __bsky_jac point;
+
+        __bsky_ec_digest(c, e, digest);
+        __bsky_mod_mul(&c->n, u1, e, w);
+        __bsky_mod_mul(&c->n, u2, r, w);
+
+        __bsky_ec_mul(c, &point, u1, u2,
+                      (const uint64_t (*)[2][4]) key->table);
+        if (__bsky_u256_is_zero(point.z)) return 0;
+
+        // x / z^2 = r (mod n): x = r z^2 or, if r + n < p, (r + n) z^2.
+        __bsky_mod_mul(f, zz, point.z, point.z);
+        __bsky_mod_to(f, t, r);
+        __bsky_mod_mul(f, t, t, zz);
+        if (__bsky_u256_cmp(t, point.x) == 0) return 1;
+
+        if (__bsky_u256_add(t, r, c->n.m) || __bsky_u256_cmp(t, f->m) >= 0)
+            return 0;
+
+        __bsky_mod_to(f, t, t);
+        __bsky_mod_mul(f, t, t, zz);
+
+        return __bsky_u256_cmp(t, point.x) == 0;
+    }
+
+    int bsky_key_verify(const struct bsky_key *key,
+                        const unsigned char digest[BSKY_SHA256_LEN],
+                        struct bsky_view sig)
+    {
+        const struct __bsky_curve *c = __bsky_curve_of(key->curve);
+        uint64_t r[4], s[4];
+
+        if (!__bsky_sig_parse(c, sig, r, s)) return 0;
+
+        __bsky_mod_to(&c->n, s, s);
+        __bsky_mod_inv(&c->n, s, s);
+
+        return __bsky_sig_check(key, digest, r, s);
+    }
+
+    #define __BSKY_SIG_BATCH 64
+
+    size_t bsky_sig_verify_batch(struct bsky_sig_check *checks, size_t len)
+    {
+        uint64_t r[__BSKY_SIG_BATCH][4], s[__BSKY_SIG_BATCH][4];
+        uint64_t tmp[__BSKY_SIG_BATCH][4];
+        size_t idx[__BSKY_SIG_BATCH], valid = 0;
+
+        // chunks of one curve: inverses of s are computed together.
+        for (size_t curve = 0; curve < BSKY_ARRAY_LEN(__bsky_curves);
+             ++curve) {
+            const struct __bsky_curve *c = __bsky_curve_of(curve);
+
+            for (size_t i = 0; i < len;) {
+                size_t n = 0;
+
+                for (; i < len && n < __BSKY_SIG_BATCH; ++i) {
+                    struct bsky_sig_check *check = &checks[i];
+
+                    if (check->key->curve != curve) continue;
+
+                    check->valid = 0;
+                    if (!__bsky_sig_parse(c, check->sig, r[n], s[n]))
+                        continue;
+
+                    __bsky_mod_to(&c->n, s[n], s[n]);
+                    idx[n++] = i;
+                }
+
+                __bsky_mod_inv_batch(&c->n, s, n, tmp);
+
+                for (size_t j = 0; j < n; ++j) {
+                    struct bsky_sig_check *check = &checks[idx[j]];
+
+                    check->valid = __bsky_sig_check(check->key,
+                                                    check->digest, r[j], s[j]);
+                    valid += check->valid;
+                }
+            }
+        }
+
+        return valid;
+    }
+
+    enum bsky_error_code bsky_commit_digest(const struct bsky_commit *commit,
+                                            unsigned char digest[
+                                                BSKY_SHA256_LEN])
+    {
+        struct bsky_commit unsigned_commit = *commit;
+        struct bsky_bytes buf = { 0 };
+
+        unsigned_commit.sig = (struct bsky_view) { 0 };
+
+        enum bsky_error_code ec = bsky_cbor_push_commit(&buf,
+                                                        &unsigned_commit);
+        if (ec == bsky_ec_Ok) bsky_sha256(buf.data, buf.len, digest);
+
+        bsky_da_free(&buf);
+
+        return ec;
+    }
+
+    enum bsky_error_code bsky_commit_sign(struct bsky_commit *commit,
+                                          const struct bsky_key *key,
+                                          unsigned char sig[BSKY_SIG_LEN])
+    {
+        unsigned char digest[BSKY_SHA256_LEN];
+        enum bsky_error_code ec = bsky_commit_digest(commit, digest);
+
+        if (ec == bsky_ec_Ok) ec = bsky_key_sign(key, digest, sig);
+        if (ec == bsky_ec_Ok)
+            commit->sig = (struct bsky_view) { sig, sig + BSKY_SIG_LEN };
+
+        return ec;
+    }
+
+    enum bsky_error_code bsky_commit_verify(const struct bsky_commit *commit,
+                                            const struct bsky_key *key)
+    {
+        unsigned char digest[BSKY_SHA256_LEN];
+        enum bsky_error_code ec = bsky_commit_digest(commit, digest);
+
+        if (ec != bsky_ec_Ok) return ec;
+
+        return bsky_key_verify(key, digest, commit->sig)
+             ? bsky_ec_Ok
+             : bsky_ec_Sig_invalid;
+    }
+
+    struct __bsky_key_entry {
+        unsigned long long hash;
+        struct bsky_key key;
+        size_t did_len;
+        char did[];
+    };
+
+    static struct __bsky_key_entry **
+    __bsky_key_cache_find(struct bsky_key_cache *cache, struct bsky_str did,
+                          unsigned long long hash)
+    {
+        size_t len = bsky_str_len(did);
+
+        for (size_t i = hash & (cache->cap - 1);;
+             i = (i + 1) & (cache->cap - 1)) {
+            struct __bsky_key_entry *entry = cache->slots[i];
+
+            if (entry == NULL ||
+                (entry->hash == hash && entry->did_len == len &&
+                 memcmp(entry->did, did.start, len) == 0))
+                return &cache->slots[i];
+        }
+    }
+
+    static void __bsky_key_cache_clear(struct bsky_key_cache *cache)
+    {
+        for (size_t i = 0; i < cache->cap; ++i) {
+            if (cache->slots[i] != NULL) __bsky_free(cache->slots[i]);
+            cache->slots[i] = NULL;
+        }
+
+        cache->len = 0;
+    }
+
+    const struct bsky_key *bsky_key_cache_get(struct bsky_key_cache *cache,
+                                              struct bsky_str did)
+    {
+        if (cache->len == 0) {
+            cache->misses++;
+            return NULL;
+        }
+
+        unsigned long long hash = bsky_str_hash(did, BSKY_STR_HASH_SEED);
+        struct __bsky_key_entry *entry = *__bsky_key_cache_find(cache, did,
+                                                                hash);
+
+        if (entry == NULL) {
+            cache->misses++;
+            return NULL;
+        }
+
+        cache->hits++;
+        return &entry->key;
+    }
+
+    const struct bsky_key *bsky_key_cache_put(struct bsky_key_cache *cache,
+                                              struct bsky_str did,
+                                              struct bsky_str did_key,
+                                              enum bsky_error_code *ec)
+    {
+        struct bsky_key key = bsky_key_parse_did(did_key, ec);
+        if (*ec != bsky_ec_Ok) return NULL;
+
+        unsigned long long hash = bsky_str_hash(did, BSKY_STR_HASH_SEED);
+        struct __bsky_key_entry **slot;
+
+        if (cache->cap != 0) {
+            slot = __bsky_key_cache_find(cache, did, hash);
+
+            if (*slot != NULL) {
+                (*slot)->key = key;
+                return &(*slot)->key;
+            }
+        }
+
+        if (cache->len >= BSKY_KEY_CACHE_MAX) {
+            __bsky_key_cache_clear(cache);
+            cache->clears++;
+        }
+
+        if (2 * (cache->len + 1) > cache->cap) {
+            size_t cap = cache->cap ? cache->cap * 2 : 64;
+            struct __bsky_key_entry **slots = __bsky_calloc(cap,
+                                                            sizeof *slots);
+
+            if (slots == NULL) bsky_defer_ec(bsky_ec_Tmp_overflow);
+
+            for (size_t i = 0; i < cache->cap; ++i) {
+                struct __bsky_key_entry *entry = cache->slots[i];
+                if (entry == NULL) continue;
+
+                size_t j = entry->hash & (cap - 1);
+                while (slots[j] != NULL) j = (j + 1) & (cap - 1);
+                slots[j] = entry;
+            }
+
+            if (cache->slots != NULL) __bsky_free(cache->slots);
+            cache->slots = slots;
+            cache->cap   = cap;
+        }
+
+        size_t len = bsky_str_len(did);
+        struct __bsky_key_entry *entry = __bsky_malloc(sizeof *entry + len);
+
+        if (entry == NULL) bsky_defer_ec(bsky_ec_Tmp_overflow);
+
+        entry->hash    = hash;
+        entry->key     = key;
+        entry->did_len = len;
+        memcpy(entry->did, did.start, len);
+
+        slot  = __bsky_key_cache_find(cache, did, hash);
+        *slot = entry;
+        cache->len++;
+
+        return &entry->key;
+
+    defer:
+        return NULL;
+    }
+
+    void bsky_key_cache_free(struct bsky_key_cache *cache)
+    {
+        if (cache->slots != NULL) {
+            __bsky_key_cache_clear(cache);
+            __bsky_free(cache->slots);
+        }
+
+        *cache = (struct bsky_key_cache) { 0 };
+    }
+
+	/*
+     * BSKY JSON
+     */
+    // First '"', '\\' or control char in [c, end), or `end'.
+    static char *__bsky_json_str_special(char *c, char *end)
+    {
+    #ifdef __BSKY_SIMD
+        __bsky_vec quote = __bsky_vec_splat('"');
+        __bsky_vec slash = __bsky_vec_splat('\\');
+        __bsky_vec ctl   = __bsky_vec_splat(0x1f);
+
+        for (; c + 16 <= end; c += 16) {
+            __bsky_vec v = __bsky_vec_load(c);
+            unsigned long long mask = __bsky_vec_mask(__bsky_vec_or(
+                __bsky_vec_or(__bsky_vec_eq(v, quote), __bsky_vec_eq(v, slash)),
+                __bsky_vec_le(v, ctl)));
+
+            if (mask != 0) return c + __bsky_vec_index(mask);
+        }
+    #endif
+
+        for (; c < end; ++c) {
+            if (*c == '"' || *c == '\\' || (unsigned char) *c < 0x20)
+                return c;
+        }
+
+        return end;
+    }
+
+    // Escape quotes, backslashes and control chars, other bytes are
+    // pushed as is in runs.
+    static void __bsky_sb_push_json_str(struct bsky_str_builder *sb,
+                                        char *str)
+    {
+        char *c = str, *end = str + strlen(str);
+
+        bsky_sb_push(sb, '"');
+
+        while (c < end) {
+            char *special = __bsky_json_str_special(c, end);
+
+            bsky_sb_push_str(sb, (struct bsky_str) { c, special });
+            if (special >= end) break;
+
+            switch (*special) {
+            case '"':  bsky_sb_push_str(sb, bsky_mk_str("\\\"")); break;
+            case '\\': bsky_sb_push_str(sb, bsky_mk_str("\\\\")); break;
+            case '\n': bsky_sb_push_str(sb, bsky_mk_str("\\n")); break;
+            case '\r': bsky_sb_push_str(sb, bsky_mk_str("\\r")); break;
+            case '\t': bsky_sb_push_str(sb, bsky_mk_str("\\t")); break;
+            case '\b': bsky_sb_push_str(sb, bsky_mk_str("\\b")); break;
+            case '\f': bsky_sb_push_str(sb, bsky_mk_str("\\f")); break;
+            default:
+                bsky_sb_push_fmt(sb, "\\u%04x", (unsigned char) *special);
+            }
+
+            c = special + 1;
+        }
+
+        bsky_sb_push(sb, '"');
+    }
+
+    // JSON has no infinities and NaN, they are written as `null'. Other
+    // numbers are written with the shortest precision which parses back to
+    // the same value.
+    static void __bsky_sb_push_json_num(struct bsky_str_builder *sb,
+                                        long double num)
+    {
+        char buf[64];
+
+        if (!isfinite(num)) {
+            bsky_sb_push_fmt(sb, "null");
+            return;
+        }
+
+        if (num == truncl(num) && fabsl(num) < 9e18L) {
+            bsky_sb_push_fmt(sb, "%lld", (long long) num);
+            return;
+        }
+
+        for (int precision = 17; precision <= 21; ++precision) {
+            snprintf(buf, sizeof buf, "%.*Lg", precision, num);
+            if (strtold(buf, NULL) == num) break;
+        }
+
+        bsky_sb_push_fmt(sb, "%s", buf);
+    }
+
+    void bsky_sb_push_json(struct bsky_str_builder *sb, struct bsky_json json)
+    {
+        BSKY_PROBE_BEGIN(bsky_probe_Sb_push_json, sb->len ? sb->len - 1 : 0);
+
+        switch (json.var) {
+        case bsky_json_Arr: {
+            bsky_sb_push_fmt(sb, "[");
+
+            for (size_t i = 0; i < json.arr.len; ++i) {
+                if (i != 0) bsky_sb_push_fmt(sb, ",");
+
+                bsky_sb_push_json(sb, json.arr.data[i]);
+            }
+
+            bsky_sb_push_fmt(sb, "]");
+        } break;
+        case bsky_json_Dct: {
+            bsky_sb_push_fmt(sb, "{");
+
+            for (size_t i = 0; i < json.dct.len; ++i) {
+                if (i != 0) bsky_sb_push_fmt(sb, ",");
+
+                __bsky_sb_push_json_str(sb, json.dct.data[i].name);
+                bsky_sb_push(sb, ':');
+                bsky_sb_push_json(sb, json.dct.data[i].value);
+            }
+
+            bsky_sb_push_fmt(sb, "}");
+        } break;
+        case bsky_json_Num: __bsky_sb_push_json_num(sb, json.num); break;
+        case bsky_json_Str:  __bsky_sb_push_json_str(sb, json.str); break;
+        case bsky_json_Null: bsky_sb_push_fmt(sb, "null"); break;
+        case bsky_json_Bool: {
+            bsky_sb_push_fmt(sb, "%s", json._bool ? "true" : "false"); 
+        }break;
+        }
+
+        BSKY_PROBE_END(bsky_probe_Sb_push_json, sb->len ? sb->len - 1 : 0);
+    }
+
+    struct bsky_str bsky_tmp_str_of_json(struct bsky_json json)
+    {
+        struct bsky_str_builder sb = { 0 };
+
+        bsky_sb_push_json(&sb, json);
+
+        return bsky_sb_build_tmp(&sb);
+    }
+
+    struct bsky_json *bsky_json_dct_get(struct bsky_json json, char *key)
+    {
+        if (json.var != bsky_json_Dct) return NULL;
+
+        for (size_t i = 0; i < json.dct.len; ++i) {
+            if (strcmp(json.dct.data[i].name, key) == 0)
+                return &json.dct.data[i].value;
+        }
+
+        return NULL;
+    }
+
+    static int __bsky_json_is_ws(char c) {
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+    }
+
+    static char *__bsky_json_skip_ws(char *c, char *end)
+    {
+        while (c < end && __bsky_json_is_ws(*c)) c++;
+        return c;
+    }
+
+    static int __bsky_json_hex4(char *c, char *end)
+    {
+        int value = 0;
+
+        if (end - c < 4) return -1;
+
+        for (int i = 0; i < 4; ++i) {
+            char h = c[i];
+
+            value <<= 4;
+            if      (h >= '0' && h <= '9') value |= h - '0';
+            else if (h >= 'a' && h <= 'f') value |= h - 'a' + 10;
+            else if (h >= 'A' && h <= 'F') value |= h - 'A' + 10;
+            else return -1;
+        }
+
+        return value;
+    }
+
+    // Decode string body [c, end) into `dst' and return end of decoded
+    // string or NULL on invalid escape. `\u' escapes, including surrogate
+    // pairs, are written as UTF-8. Lone surrogates and `\u0000' are
+    // rejected: the first is not UTF-8 and the second would cut the string.
+    static char *__bsky_json_unescape(char *dst, char *c, char *end)
+    {
+        while (c < end) {
+            char *slash = memchr(c, '\\', end - c);
+            if (slash == NULL) slash = end;
+
+            memcpy(dst, c, slash - c);
+            dst += slash - c;
+            c    = slash;
+
+            if (c >= end) break;
+            if (c + 1 >= end) return NULL;
+
+            c += 2;
+            switch (c[-1]) {
+            case '"':  *dst++ = '"';  continue;
+            case '\\': *dst++ = '\\'; continue;
+            case '/':  *dst++ = '/';  continue;
+            case 'b':  *dst++ = '\b'; continue;
+            case 'f':  *dst++ = '\f'; continue;
+            case 'n':  *dst++ = '\n'; continue;
+            case 'r':  *dst++ = '\r'; continue;
+            case 't':  *dst++ = '\t'; continue;
+            case 'u':  break;
+            default:   return NULL;
+            }
+
+            long cp = __bsky_json_hex4(c, end);
+            c += 4;
+
+            if (cp <= 0 || (cp >= 0xdc00 && cp <= 0xdfff)) return NULL;
+
+            if (cp >= 0xd800 && cp <= 0xdbff) {
+                if (end - c < 6 || c[0] != '\\' || c[1] != 'u') return NULL;
+
+                long low = __bsky_json_hex4(c + 2, end);
+                if (low < 0xdc00 || low > 0xdfff) return NULL;
+
+                cp  = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                c  += 6;
+            }
+
+            if (cp < 0x80) {
+                *dst++ = cp;
+            } else if (cp < 0x800) {
+                *dst++ = 0xc0 | cp >> 6;
+                *dst++ = 0x80 | (cp & 0x3f);
+            } else if (cp < 0x10000) {
+                *dst++ = 0xe0 | cp >> 12;
+                *dst++ = 0x80 | (cp >> 6 & 0x3f);
+                *dst++ = 0x80 | (cp & 0x3f);
+            } else {
+                *dst++ = 0xf0 | cp >> 18;
+                *dst++ = 0x80 | (cp >> 12 & 0x3f);
+                *dst++ = 0x80 | (cp >> 6 & 0x3f);
+                *dst++ = 0x80 | (cp & 0x3f);
+            }
+        }
+
+        return dst;
+    }
+
+    // Return pointer to the closing quote or `end'.
+    static char *__bsky_json_skip_str_body(char *c, char *end)
+    {
+        while ((c = __bsky_json_str_special(c, end)) < end && *c != '"')
+            c += *c == '\\' && c + 1 < end ? 2 : 1;
+
+        return c;
+    }
+
+    // Skip until `depth' open containers are closed (one value for 0) and
+    // return pointer right after.
+    static char *__bsky_json_skip_nested(char *c, char *end, size_t depth)
+    {
+        do {
+            if (c >= end) return end;
+
+            switch (*c) {
+            case '"':
+                c = __bsky_json_skip_str_body(c + 1, end);
+                if (c < end) c++;
+                break;
+            case '{': case '[': depth++; c++; break;
+            case '}': case ']': depth--; c++; break;
+            default:
+                if (depth == 0) {
+                    while (c < end && *c != ',' && *c != '}' && *c != ']' &&
+                           !__bsky_json_is_ws(*c))
+                        c++;
+                } else {
+                    c++;
+                }
+            }
+        } while (depth != 0);
+
+        return c;
+    }
+
+    // Skip one value starting at `c' and return pointer right after it.
+    static char *__bsky_json_skip_value(char *c, char *end) {
+        return __bsky_json_skip_nested(c, end, 0);
+    }
+
+    static int __bsky_json_key_eq(char *name, char *name_end,
+                                  char *key, size_t key_len)
+    {
+        size_t len = name_end - name;
+
+        if (memchr(name, '\\', len) == NULL)
+            return len == key_len && memcmp(name, key, key_len) == 0;
+
+        // escaped key is at least as long as decoded one.
+        if (len < key_len) return 0;
+
+        char  buf[256];
+        char *dst = len < sizeof buf ? buf : bsky_tmp_alloc(len);
+        if (dst == NULL) return 0;
+
+        char *dst_end = __bsky_json_unescape(dst, name, name_end);
+
+        return dst_end != NULL && (size_t) (dst_end - dst) == key_len &&
+               memcmp(dst, key, key_len) == 0;
+    }
+
+    struct bsky_str bsky_json_scan_field(struct bsky_str json, char *key)
+    {
+        size_t key_len = strlen(key);
+        char  *c = __bsky_json_skip_ws(json.start, json.end), *end = json.end;
+
+        if (c >= end || *c != '{') return (struct bsky_str) { 0 };
+        c++;
+
+        while (c < end) {
+            c = __bsky_json_skip_ws(c, end);
+            if (c >= end || *c != '"') break;
+
+            char *name = c + 1;
+            char *name_end = __bsky_json_skip_str_body(name, end);
+
+            c = __bsky_json_skip_ws(name_end + 1, end);
+            if (c >= end || *c != ':') break;
+            c = __bsky_json_skip_ws(c + 1, end);
+
+            char *value = c;
+            c = __bsky_json_skip_value(c, end);
+
+            if (__bsky_json_key_eq(name, name_end, key, key_len)) {
+                if (value < end && *value == '"')
+                    return (struct bsky_str) {
+                        value + 1, __bsky_json_skip_str_body(value + 1, end)
+                    };
+
+                return (struct bsky_str) { value, c };
+            }
+
+            c = __bsky_json_skip_ws(c, end);
+            if (c >= end || *c != ',') break;
+            c++;
+        }
+
+        return (struct bsky_str) { 0 };
+    }
+
+
+    struct bsky_json_path bsky_json_path_compile(const char *path,
+                                                 enum bsky_error_code *ec)
+    {
+        struct bsky_json_path compiled = { 0 };
+        size_t keys_len = 0;
+
+        *ec = bsky_ec_Json_path_invalid;
+
+        if (*path != '\0' && *path != '/') goto defer;
+
+        while (*path == '/') {
+            const char *seg = ++path;
+
+            while (*path != '\0' && *path != '/') path++;
+            if (compiled.len == BSKY_JSON_PATH_MAX) goto defer;
+
+            struct bsky_json_path_step *step = &compiled.steps[compiled.len++];
+
+            step->index = SIZE_MAX;
+
+            if (path - seg == 1 && *seg == '*') {
+                step->kind = bsky_json_path_Any;
+                continue;
+            }
+
+            step->kind = bsky_json_path_Key;
+            step->key  = keys_len;
+
+            for (const char *c = seg; c < path; ++c) {
+                char ch = *c;
+
+                if (ch == '~') {
+                    if      (c + 1 < path && c[1] == '0') ch = '~';
+                    else if (c + 1 < path && c[1] == '1') ch = '/';
+                    else goto defer;
+                    c++;
+                }
+
+                if (keys_len == sizeof compiled.keys) goto defer;
+                compiled.keys[keys_len++] = ch;
+            }
+
+            step->key_len = keys_len - step->key;
+
+            // array index: digits without leading zero.
+            const char *key = compiled.keys + step->key;
+            size_t index = 0, i = 0;
+
+            for (; i < step->key_len && key[i] >= '0' && key[i] <= '9'; ++i) {
+                if (index > (SIZE_MAX - 9) / 10) break;
+                index = index * 10 + (key[i] - '0');
+            }
+
+            if (i == step->key_len && i > 0 && (key[0] != '0' || i == 1))
+                step->index = index;
+        }
+
+        *ec = bsky_ec_Ok;
+        return compiled;
+
+    defer:
+        return (struct bsky_json_path) { 0 };
+    }
+
+    struct __bsky_json_path_query {
+        const struct bsky_json_path *path;
+        char *end;
+        struct bsky_str *out;
+        size_t len, cap;
+        enum bsky_error_code ec;
+    };
+
+    // Match value at `c' against steps from `step' and return pointer after
+    // the value, or NULL on error or when `out' is full. Without
+    // `need_end' caller doesn't need the end, so rest of container after
+    // the only match isn't skipped.
+    static char *__bsky_json_path_match(struct __bsky_json_path_query *q,
+                                        size_t step, char *c, int need_end)
+    {
+        char *end = q->end;
+
+        if (step == q->path->len) {
+            char *value_end = __bsky_json_skip_value(c, end);
+
+            if (*c == '"') {
+                char *quote = __bsky_json_skip_str_body(c + 1, end);
+
+                if (quote >= end) {
+                    q->ec = bsky_ec_Json_expect_CQ;
+                    return NULL;
+                }
+                q->out[q->len++] = (struct bsky_str) { c + 1, quote };
+            } else {
+                q->out[q->len++] = (struct bsky_str) { c, value_end };
+            }
+
+            return q->len == q->cap ? NULL : value_end;
+        }
+
+        const struct bsky_json_path_step *s = &q->path->steps[step];
+        int any = s->kind == bsky_json_path_Any;
+        char close;
+
+        if (*c == '{') {
+            close = '}';
+        } else if (*c == '[') {
+            close = ']';
+        } else {
+            return __bsky_json_skip_value(c, end);
+        }
+
+        c = __bsky_json_skip_ws(c + 1, end);
+        if (c < end && *c == close) return c + 1;
+
+        for (size_t i = 0; ; ++i) {
+            int match = any;
+
+            if (close == '}') {
+                if (c >= end || *c != '"') {
+                    q->ec = bsky_ec_Json_expect_OQ;
+                    return NULL;
+                }
+
+                char *name = c + 1, *name_end;
+
+                name_end = __bsky_json_skip_str_body(name, end);
+                c = __bsky_json_skip_ws(name_end + 1, end);
+                if (name_end >= end || c >= end || *c != ':') {
+                    q->ec = bsky_ec_Json_expect_Colon;
+                    return NULL;
+                }
+                c = __bsky_json_skip_ws(c + 1, end);
+
+                match = match || __bsky_json_key_eq(name, name_end,
+                                        (char *) q->path->keys + s->key,
+                                        s->key_len);
+            } else {
+                match = match || i == s->index;
+            }
+
+            if (c >= end) {
+                q->ec = close == '}' ? bsky_ec_Json_expect_CCB
+                                     : bsky_ec_Json_expect_CSB;
+                return NULL;
+            }
+
+            if (match) {
+                c = __bsky_json_path_match(q, step + 1, c, need_end || any);
+                if (c == NULL) return NULL;
+
+                // keys are unique: the only match is found.
+                if (!any) {
+                    if (!need_end) return c;
+                    return __bsky_json_skip_nested(c, end, 1);
+                }
+            } else {
+                c = __bsky_json_skip_value(c, end);
+            }
+
+            c = __bsky_json_skip_ws(c, end);
+            if (c < end && *c == close) return c + 1;
+            if (c >= end || *c != ',') {
+                q->ec = close == '}' ? bsky_ec_Json_expect_CCB
+                                     : bsky_ec_Json_expect_CSB;
+                return NULL;
+            }
+            c = __bsky_json_skip_ws(c + 1, end);
+        }
+    }
+
+    size_t bsky_json_path_query(const struct bsky_json_path *path,
+                                struct bsky_str json, struct bsky_str *out,
+                                size_t cap, enum bsky_error_code *ec)
+    {
+        struct __bsky_json_path_query q = {
+            .path = path, .end = json.end, .out = out, .cap = cap,
+        };
+        char *c = __bsky_json_skip_ws(json.start, json.end);
+
+        if (c < json.end && cap > 0) __bsky_json_path_match(&q, 0, c, 0);
+
+        *ec = q.ec;
+        return q.len;
+    }
+
+    struct bsky_str bsky_json_path_first(const struct bsky_json_path *path,
+                                         struct bsky_str json)
+    {
+        enum bsky_error_code ec;
+        struct bsky_str first = { 0 };
+
+        bsky_json_path_query(path, json, &first, 1, &ec);
+
+        return first;
+    }
+
+    /*
+     * JSON DOCUMENT
+     */
+
+    // Members of container at `c' as spans of text: dictionary members
+    // from the key. Array in tmp arena is returned.
+    static struct bsky_str *__bsky_json_members(char *c, char *end,
+                                                size_t *len,
+                                                enum bsky_error_code *ec)
+    {
+        struct { struct bsky_str *data; size_t len, cap; } members = { 0 };
+        struct bsky_str *out = NULL;
+        char close = *c == '{' ? '}' : ']';
+
+        *ec = bsky_ec_Ok;
+        c = __bsky_json_skip_ws(c + 1, end);
+
+        while (c < end && *c != close) {
+            struct bsky_str member = { c, NULL };
+
+            if (close == '}') {
+                if (*c != '"') bsky_defer_ec(bsky_ec_Json_expect_OQ);
+
+                c = __bsky_json_skip_str_body(c + 1, end);
+                if (c >= end) bsky_defer_ec(bsky_ec_Json_expect_CQ);
+
+                c = __bsky_json_skip_ws(c + 1, end);
+                if (c >= end || *c != ':')
+                    bsky_defer_ec(bsky_ec_Json_expect_Colon);
+
+                c = __bsky_json_skip_ws(c + 1, end);
+            }
+
+            if (c >= end) break;
+
+            c = member.end = __bsky_json_skip_value(c, end);
+            if (bsky_da_push(&members, member) != bsky_ec_Ok)
+                bsky_defer_ec(bsky_ec_Tmp_overflow);
+
+            c = __bsky_json_skip_ws(c, end);
+            if (c < end && *c == ',') c = __bsky_json_skip_ws(c + 1, end);
+            else break;
+        }
+
+        if (c >= end || *c != close)
+            bsky_defer_ec(close == '}' ? bsky_ec_Json_expect_CCB
+                                       : bsky_ec_Json_expect_CSB);
+
+        out = bsky_tmp_alloc(members.len * sizeof *out);
+        if (out == NULL) bsky_defer_ec(bsky_ec_Tmp_overflow);
+
+        if (members.len > 0)
+            memcpy(out, members.data, members.len * sizeof *out);
+        *len = members.len;
+
+    defer:
+        bsky_da_free(&members);
+        return *ec == bsky_ec_Ok ? out : NULL;
+    }
+
+    // Value of dictionary member which starts with key.
+    static char *__bsky_json_member_value(char *c, char *end)
+    {
+        c = __bsky_json_skip_str_body(c + 1, end);
+        c = __bsky_json_skip_ws(c + 1, end);
+
+        return __bsky_json_skip_ws(c + 1, end);
+    }
+
+    // Value at path in original text and container which holds it.
+    struct __bsky_json_doc_loc {
+        struct bsky_json_path path;
+
+        char *container;                     // NULL for the whole text
+        struct bsky_str *members;
+        size_t len, index;                   // `len' if there is no member
+
+        struct bsky_str value;
+    };
+
+    static enum bsky_error_code
+    __bsky_json_doc_find(const struct bsky_json_doc *doc, const char *path,
+                         struct __bsky_json_doc_loc *loc)
+    {
+        enum bsky_error_code ec;
+        char *end = doc->text.end;
+        char *c   = __bsky_json_skip_ws(doc->text.start, end);
+
+        *loc = (struct __bsky_json_doc_loc) {
+            .path  = bsky_json_path_compile(path, &ec),
+            .value = { c, __bsky_json_skip_value(c, end) },
+        };
+        if (ec != bsky_ec_Ok) return ec;
+
+        for (size_t i = 0; i < loc->path.len; ++i) {
+            const struct bsky_json_path_step *step = &loc->path.steps[i];
+
+            if (step->kind == bsky_json_path_Any)
+                return bsky_ec_Json_path_invalid;
+            if (c >= end || (*c != '{' && *c != '['))
+                return bsky_ec_Json_path_not_found;
+
+            loc->container = c;
+            loc->members   = __bsky_json_members(c, end, &loc->len, &ec);
+            if (ec != bsky_ec_Ok) return ec;
+
+            for (loc->index = 0; loc->index < loc->len; ++loc->index) {
+                char *member = loc->members[loc->index].start;
+
+                if (*c == '[' ? loc->index == step->index
+                              : __bsky_json_key_eq(member + 1,
+                                    __bsky_json_skip_str_body(member + 1,
+                                                              end),
+                                    (char *) loc->path.keys + step->key,
+                                    step->key_len))
+                    break;
+            }
+
+            // only the last step may be missing.
+            if (loc->index == loc->len) {
+                if (i + 1 < loc->path.len) return bsky_ec_Json_path_not_found;
+                loc->value = (struct bsky_str) { 0 };
+                break;
+            }
+
+            loc->value = loc->members[loc->index];
+            if (*c == '{')
+                loc->value.start = __bsky_json_member_value(
+                    loc->value.start, end);
+
+            c = loc->value.start;
+        }
+
+        return bsky_ec_Ok;
+    }
+
+    // Insert edit keeping order by start, return it or NULL.
+    static struct bsky_json_edit *
+    __bsky_json_doc_insert(struct bsky_json_doc *doc,
+                           struct bsky_json_edit edit)
+    {
+        size_t i = doc->edits.len;
+
+        if (bsky_da_push(&doc->edits, edit) != bsky_ec_Ok) return NULL;
+
+        for (; i > 0 && doc->edits.data[i - 1].start > edit.start; --i)
+            doc->edits.data[i] = doc->edits.data[i - 1];
+        doc->edits.data[i] = edit;
+
+        return &doc->edits.data[i];
+    }
+
+    static void __bsky_json_doc_drop(struct bsky_json_doc *doc, size_t i)
+    {
+        bsky_da_free(&doc->edits.data[i].added);
+
+        memmove(doc->edits.data + i, doc->edits.data + i + 1,
+                (doc->edits.len - i - 1) * sizeof *doc->edits.data);
+        doc->edits.len--;
+    }
+
+    // Edit which covers [start, end) and is not edit of container.
+    static int __bsky_json_doc_replaced(const struct bsky_json_doc *doc,
+                                        char *start, char *end)
+    {
+        for (size_t i = 0; i < doc->edits.len; ++i) {
+            const struct bsky_json_edit *edit = &doc->edits.data[i];
+
+            if (edit->members == NULL && edit->start <= start &&
+                end <= edit->end)
+                return 1;
+        }
+
+        return 0;
+    }
+
+    // Container edit of container at `c', created if there is none.
+    static struct bsky_json_edit *
+    __bsky_json_doc_container(struct bsky_json_doc *doc,
+                              struct __bsky_json_doc_loc *loc)
+    {
+        for (size_t i = 0; i < doc->edits.len; ++i)
+            if (doc->edits.data[i].start == loc->container &&
+                doc->edits.data[i].members != NULL)
+                return &doc->edits.data[i];
+
+        struct bsky_json_edit edit = {
+            .start = loc->container,
+            .end   = __bsky_json_skip_value(loc->container, doc->text.end),
+            .members     = loc->members,
+            .members_len = loc->len,
+        };
+
+        return __bsky_json_doc_insert(doc, edit);
+    }
+
+    // Member at `loc' which was removed is put back, so that value set
+    // again is written.
+    static void __bsky_json_doc_restore(struct bsky_json_doc *doc,
+                                        const struct __bsky_json_doc_loc *loc)
+    {
+        if (loc->container == NULL) return;
+
+        for (size_t i = 0; i < doc->edits.len; ++i) {
+            struct bsky_json_edit *edit = &doc->edits.data[i];
+
+            if (edit->start == loc->container && edit->members != NULL) {
+                if (edit->members[loc->index].start == NULL)
+                    edit->members[loc->index] = loc->members[loc->index];
+                return;
+            }
+        }
+    }
+
+    enum bsky_error_code bsky_json_doc_set(struct bsky_json_doc *doc,
+                                           const char *path,
+                                           struct bsky_json value)
+    {
+        struct __bsky_json_doc_loc loc;
+        enum bsky_error_code ec = __bsky_json_doc_find(doc, path, &loc);
+
+        if (ec != bsky_ec_Ok) return ec;
+
+        if (loc.value.start != NULL) {
+            struct bsky_json_edit edit = {
+                .start = loc.value.start, .end = loc.value.end,
+                .value = value,
+            };
+
+            // the same value is set again, edits inside are overwritten.
+            for (size_t i = 0; i < doc->edits.len; ++i) {
+                struct bsky_json_edit *old = &doc->edits.data[i];
+
+                if (old->members == NULL && old->start == edit.start &&
+                    old->end == edit.end) {
+                    old->value = value;
+                    __bsky_json_doc_restore(doc, &loc);
+                    return bsky_ec_Ok;
+                }
+            }
+
+            if (__bsky_json_doc_replaced(doc, edit.start, edit.end))
+                return bsky_ec_Json_edit_conflict;
+
+            __bsky_json_doc_restore(doc, &loc);
+
+            for (size_t i = doc->edits.len; i-- > 0;)
+                if (edit.start <= doc->edits.data[i].start &&
+                    doc->edits.data[i].end <= edit.end)
+                    __bsky_json_doc_drop(doc, i);
+
+            if (__bsky_json_doc_insert(doc, edit) == NULL)
+                return bsky_ec_Tmp_overflow;
+
+            return bsky_ec_Ok;
+        }
+
+        const struct bsky_json_path_step *step =
+            &loc.path.steps[loc.path.len - 1];
+        char *key = (char *) loc.path.keys + step->key;
+        int   dct = *loc.container == '{';
+
+        if (!dct && (step->key_len != 1 || *key != '-'))
+            return bsky_ec_Json_path_not_found;
+
+        if (__bsky_json_doc_replaced(doc, loc.container, loc.container + 1))
+            return bsky_ec_Json_edit_conflict;
+
+        struct bsky_json_edit *edit = __bsky_json_doc_container(doc, &loc);
+        if (edit == NULL) return bsky_ec_Tmp_overflow;
+
+        struct bsky_json_pair pair = { NULL, value };
+
+        if (dct) {
+            for (size_t i = 0; i < edit->added.len; ++i) {
+                if (strlen(edit->added.data[i].name) == step->key_len &&
+                    memcmp(edit->added.data[i].name, key, step->key_len) == 0) {
+                    edit->added.data[i].value = value;
+                    return bsky_ec_Ok;
+                }
+            }
+
+            pair.name = bsky_tmp_alloc(step->key_len + 1);
+            if (pair.name == NULL) return bsky_ec_Tmp_overflow;
+
+            memcpy(pair.name, key, step->key_len);
+            pair.name[step->key_len] = '\0';
+        }
+
+        return bsky_da_push(&edit->added, pair);
+    }
+
+    enum bsky_error_code bsky_json_doc_remove(struct bsky_json_doc *doc,
+                                              const char *path)
+    {
+        struct __bsky_json_doc_loc loc;
+        enum bsky_error_code ec = __bsky_json_doc_find(doc, path, &loc);
+
+        if (ec != bsky_ec_Ok) return ec;
+        if (loc.container == NULL) return bsky_ec_Json_path_invalid;
+
+        if (__bsky_json_doc_replaced(doc, loc.container, loc.container + 1))
+            return bsky_ec_Json_edit_conflict;
+
+        struct bsky_json_edit *edit = __bsky_json_doc_container(doc, &loc);
+        if (edit == NULL) return bsky_ec_Tmp_overflow;
+
+        if (loc.value.start != NULL) {
+            if (edit->members[loc.index].start == NULL)
+                return bsky_ec_Json_path_not_found;
+
+            edit->members[loc.index] = (struct bsky_str) { 0 };
+            return bsky_ec_Ok;
+        }
+
+        // member added by edit.
+        const struct bsky_json_path_step *step =
+            &loc.path.steps[loc.path.len - 1];
+        char *key = (char *) loc.path.keys + step->key;
+
+        for (size_t i = 0; i < edit->added.len; ++i) {
+            char *name = edit->added.data[i].name;
+
+            if (name != NULL && strlen(name) == step->key_len &&
+                memcmp(name, key, step->key_len) == 0) {
+                memmove(edit->added.data + i, edit->added.data + i + 1,
+                        (edit->added.len - i - 1) * sizeof *edit->added.data);
+                edit->added.len--;
+                return bsky_ec_Ok;
+            }
+        }
+
+        return bsky_ec_Json_path_not_found;
+    }
+
+    // Push text [start, end) with edits from `*i' which are inside of it.
+    static void __bsky_sb_push_json_doc(struct bsky_str_builder *sb,
+                                        const struct bsky_json_doc *doc,
+                                        char *start, char *end, size_t *i)
+    {
+        char *c = start;
+
+        while (*i < doc->edits.len && doc->edits.data[*i].start < end) {
+            const struct bsky_json_edit *edit = &doc->edits.data[(*i)++];
+
+            // inside of removed member.
+            if (edit->start < c) continue;
+
+            bsky_sb_push_str(sb, (struct bsky_str) { c, edit->start });
+            c = edit->end;
+
+            if (edit->members == NULL) {
+                bsky_sb_push_json(sb, edit->value);
+                continue;
+            }
+
+            int first = 1;
+
+            bsky_sb_push(sb, *edit->start);
+            for (size_t j = 0; j < edit->members_len; ++j) {
+                struct bsky_str member = edit->members[j];
+
+                if (member.start == NULL) continue;
+                if (!first) bsky_sb_push(sb, ',');
+
+                __bsky_sb_push_json_doc(sb, doc, member.start, member.end, i);
+                first = 0;
+            }
+
+            for (size_t j = 0; j < edit->added.len; ++j) {
+                struct bsky_json_pair *pair = &edit->added.data[j];
+
+                if (!first) bsky_sb_push(sb, ',');
+                if (pair->name != NULL) {
+                    __bsky_sb_push_json_str(sb, pair->name);
+                    bsky_sb_push(sb, ':');
+                }
+
+                bsky_sb_push_json(sb, pair->value);
+                first = 0;
+            }
+            bsky_sb_push(sb, edit->end[-1]);
+        }
+
+        bsky_sb_push_str(sb, (struct bsky_str) { c, end });
+    }
+
+    void bsky_sb_push_json_doc(struct bsky_str_builder *sb,
+                               const struct bsky_json_doc *doc)
+    {
+        size_t i = 0;
+
+        __bsky_sb_push_json_doc(sb, doc, doc->text.start, doc->text.end, &i);
+    }
+
+    void bsky_json_doc_free(struct bsky_json_doc *doc)
+    {
+        for (size_t i = 0; i < doc->edits.len; ++i)
+            bsky_da_free(&doc->edits.data[i].added);
+
+        bsky_da_free(&doc->edits);
+        *doc = (struct bsky_json_doc) { .text = doc->text };
+    }
+
+    /*
+     * CANONICAL ENCODING
+     */
+    static int __bsky_base64url_value(char c);
+
+    // Sorted orders of dictionary keys: `order[0]' for DAG-CBOR and
+    // `order[1]' for JSON, indexes of pairs. Keys follow them.
+    struct __bsky_json_shape {
+        unsigned long long hash;
+        size_t    len;
+        uint32_t *order[2];
+        char     *keys;                      // null separated
+    };
+
+    struct __bsky_json_key {
+        char    *name;
+        size_t   len;
+        uint32_t index;
+    };
+
+    static int __bsky_json_key_cmp_cbor(const void *a, const void *b)
+    {
+        const struct __bsky_json_key *fst = a, *snd = b;
+
+        if (fst->len != snd->len) return fst->len < snd->len ? -1 : 1;
+
+        return memcmp(fst->name, snd->name, fst->len);
+    }
+
+    static int __bsky_json_key_cmp_json(const void *a, const void *b)
+    {
+        const struct __bsky_json_key *fst = a, *snd = b;
+        int cmp = memcmp(fst->name, snd->name,
+                         fst->len < snd->len ? fst->len : snd->len);
+
+        if (cmp != 0 || fst->len == snd->len) return cmp;
+
+        return fst->len < snd->len ? -1 : 1;
+    }
+
+    static void __bsky_json_keys_sort(struct __bsky_json_key *keys,
+                                      size_t len,
+                                      int (*cmp)(const void *, const void *))
+    {
+        if (len > 8) {
+            qsort(keys, len, sizeof *keys, cmp);
+            return;
+        }
+
+        for (size_t i = 1; i < len; ++i) {
+            struct __bsky_json_key key = keys[i];
+            size_t j = i;
+
+            for (; j > 0 && cmp(&keys[j - 1], &key) > 0; --j)
+                keys[j] = keys[j - 1];
+            keys[j] = key;
+        }
+    }
+
+    // Compute both orders into `order' (2 * len indexes).
+    static enum bsky_error_code
+    __bsky_json_keys_order(struct bsky_json json, uint32_t *order)
+    {
+        size_t len = json.dct.len;
+        struct __bsky_json_key small[16], *keys = small;
+
+        if (len > BSKY_ARRAY_LEN(small)) {
+            keys = bsky_tmp_alloc(len * sizeof *keys);
+            if (keys == NULL) return bsky_ec_Tmp_overflow;
+        }
+
+        for (int o = 0; o < 2; ++o) {
+            for (size_t i = 0; i < len; ++i) {
+                char *name = json.dct.data[i].name;
+
+                keys[i] = (struct __bsky_json_key) { name, strlen(name), i };
+            }
+
+            __bsky_json_keys_sort(keys, len, o == 0
+                                  ? __bsky_json_key_cmp_cbor
+                                  : __bsky_json_key_cmp_json);
+
+            for (size_t i = 0; i < len; ++i) {
+                if (i > 0 && keys[i].len == keys[i - 1].len &&
+                    memcmp(keys[i].name, keys[i - 1].name, keys[i].len) == 0)
+                    return bsky_ec_Json_not_canonical;
+
+                order[o * len + i] = keys[i].index;
+            }
+        }
+
+        return bsky_ec_Ok;
+    }
+
+    static int __bsky_json_shape_eq(const struct __bsky_json_shape *shape,
+                                    struct bsky_json json)
+    {
+        char *key = shape->keys;
+
+        if (shape->len != json.dct.len) return 0;
+
+        for (size_t i = 0; i < json.dct.len; ++i) {
+            char *name = json.dct.data[i].name;
+
+            while (*key == *name && *name != '\0') key++, name++;
+            if (*key != *name) return 0;
+            key++;
+        }
+
+        return 1;
+    }
+
+    static enum bsky_error_code
+    __bsky_json_key_cache_grow(struct bsky_json_key_cache *cache)
+    {
+        size_t cap = cache->cap ? cache->cap * 2 : 64;
+        struct __bsky_json_shape *slots = __bsky_calloc(cap, sizeof *slots);
+
+        if (slots == NULL) return bsky_ec_Tmp_overflow;
+
+        for (size_t i = 0; i < cache->cap; ++i) {
+            struct __bsky_json_shape *shape = &cache->slots[i];
+            if (shape->keys == NULL) continue;
+
+            size_t j = shape->hash & (cap - 1);
+            while (slots[j].keys != NULL) j = (j + 1) & (cap - 1);
+            slots[j] = *shape;
+        }
+
+        if (cache->slots != NULL) __bsky_free(cache->slots);
+        cache->slots = slots;
+        cache->cap   = cap;
+
+        return bsky_ec_Ok;
+    }
+
+    // Sorted order of keys of dictionary, `kind' is 0 for DAG-CBOR and 1
+    // for JSON. Order is in cache or in tmp arena.
+    static uint32_t *__bsky_json_key_order(struct bsky_json_key_cache *cache,
+                                           struct bsky_json json, int kind,
+                                           enum bsky_error_code *ec)
+    {
+        size_t len = json.dct.len;
+        unsigned long long hash = BSKY_STR_HASH_SEED;
+        struct __bsky_json_shape *shape = NULL;
+        uint32_t *order;
+
+        *ec = bsky_ec_Ok;
+
+        if (cache != NULL) {
+            for (size_t i = 0; i < len; ++i) {
+                char *name = json.dct.data[i].name;
+
+                // with terminator: ("ab") and ("a", "b") differ.
+                hash = bsky_str_hash((struct bsky_str) {
+                    name, name + strlen(name) + 1
+                }, hash);
+            }
+
+            for (size_t i = cache->cap ? hash & (cache->cap - 1) : 0;
+                 cache->cap != 0 && cache->slots[i].keys != NULL;
+                 i = (i + 1) & (cache->cap - 1)) {
+                shape = &cache->slots[i];
+
+                if (shape->hash == hash && __bsky_json_shape_eq(shape, json)) {
+                    cache->hits++;
+                    return shape->order[kind];
+                }
+            }
+
+            cache->misses++;
+        }
+
+        // unknown shape: sorted and remembered while cache has room.
+        size_t keys_len = 0;
+        for (size_t i = 0; i < len; ++i)
+            keys_len += strlen(json.dct.data[i].name) + 1;
+
+        int   cached = cache != NULL && cache->len < BSKY_JSON_KEY_CACHE_MAX;
+        size_t size  = 2 * len * sizeof *order + keys_len;
+
+        order = cached ? __bsky_malloc(size) : bsky_tmp_alloc(size);
+        if (order == NULL) bsky_defer_ec(bsky_ec_Tmp_overflow);
+
+        *ec = __bsky_json_keys_order(json, order);
+        if (*ec != bsky_ec_Ok) goto defer;
+
+        if (!cached) return order + kind * len;
+
+        if (2 * (cache->len + 1) > cache->cap &&
+            __bsky_json_key_cache_grow(cache) != bsky_ec_Ok)
+            bsky_defer_ec(bsky_ec_Tmp_overflow);
+
+        size_t i = hash & (cache->cap - 1);
+        while (cache->slots[i].keys != NULL) i = (i + 1) & (cache->cap - 1);
+
+        shape = &cache->slots[i];
+        *shape = (struct __bsky_json_shape) {
+            .hash  = hash,
+            .len   = len,
+            .order = { order, order + len },
+            .keys  = (char *) (order + 2 * len),
+        };
+
+        char *key = shape->keys;
+        for (size_t j = 0; j < len; ++j) {
+            size_t name_len = strlen(json.dct.data[j].name) + 1;
+
+            memcpy(key, json.dct.data[j].name, name_len);
+            key += name_len;
+        }
+
+        cache->len++;
+        return order + kind * len;
+
+    defer:
+        if (cached && order != NULL) __bsky_free(order);
+        return NULL;
+    }
+
+    // `{"$link": ...}' and `{"$bytes": ...}', 1 if dictionary is one of
+    // them and is pushed.
+    static int __bsky_cbor_push_json_special(struct bsky_bytes *buf,
+                                             struct bsky_json json,
+                                             enum bsky_error_code *ec)
+    {
+        *ec = bsky_ec_Ok;
+
+        if (json.dct.len != 1 || json.dct.data[0].value.var != bsky_json_Str)
+            return 0;
+
+        char *name = json.dct.data[0].name, *str = json.dct.data[0].value.str;
+
+        if (strcmp(name, "$link") == 0) {
+            struct bsky_cid cid = bsky_parse_cid(bsky_mk_str(str), ec);
+
+            if (*ec == bsky_ec_Ok) *ec = bsky_cbor_push_link(buf, cid);
+            return 1;
+        }
+
+        if (strcmp(name, "$bytes") != 0) return 0;
+
+        // base64 without padding.
+        size_t len = strlen(str);
+        unsigned char *bytes = bsky_tmp_alloc(len * 3 / 4 + 1), *out = bytes;
+        unsigned int acc = 0; int bits = 0;
+
+        if (bytes == NULL) bsky_defer_ec(bsky_ec_Tmp_overflow);
+
+        for (size_t i = 0; i < len; ++i) {
+            int v = __bsky_base64url_value(str[i]);
+            if (v < 0 || str[i] == '-' || str[i] == '_')
+                bsky_defer_ec(bsky_ec_Json_not_canonical);
+
+            acc   = acc << 6 | v;
+            bits += 6;
+
+            if (bits >= 8) {
+                bits -= 8;
+                *out++ = acc >> bits & 0xff;
+            }
+        }
+
+        if (bits >= 6 || (acc & ((1u << bits) - 1)) != 0)
+            bsky_defer_ec(bsky_ec_Json_not_canonical);
+
+        *ec = bsky_cbor_push_bytes(buf, (struct bsky_view) { bytes, out });
+
+    defer:
+        return 1;
+    }
+
+    enum bsky_error_code bsky_cbor_push_json(struct bsky_bytes *buf,
+                                             struct bsky_json json,
+                                             struct bsky_json_key_cache *cache)
+    {
+        enum bsky_error_code ec = bsky_ec_Ok;
+
+        switch (json.var) {
+        case bsky_json_Null: ec = bsky_cbor_push_null(buf); break;
+        case bsky_json_Bool: ec = bsky_cbor_push_bool(buf, json._bool); break;
+        case bsky_json_Str:
+            ec = bsky_cbor_push_text(buf, bsky_mk_str(json.str));
+            break;
+
+        case bsky_json_Num:
+            // NaN fails every comparison.
+            if (!(json.num >= -0x1p63L && json.num < 0x1p63L) ||
+                json.num != truncl(json.num))
+                return bsky_ec_Json_not_canonical;
+
+            ec = bsky_cbor_push_int(buf, (long long) json.num);
+            break;
+
+        case bsky_json_Arr:
+            ec = bsky_cbor_push_arr(buf, json.arr.len);
+
+            for (size_t i = 0; i < json.arr.len && ec == bsky_ec_Ok; ++i)
+                ec = bsky_cbor_push_json(buf, json.arr.data[i], cache);
+            break;
+
+        case bsky_json_Dct:
+            if (__bsky_cbor_push_json_special(buf, json, &ec)) break;
+
+            uint32_t *order = __bsky_json_key_order(cache, json, 0, &ec);
+            if (order == NULL) break;
+
+            ec = bsky_cbor_push_map(buf, json.dct.len);
+
+            for (size_t i = 0; i < json.dct.len && ec == bsky_ec_Ok; ++i) {
+                struct bsky_json_pair *pair = &json.dct.data[order[i]];
+
+                ec = bsky_cbor_push_text(buf, bsky_mk_str(pair->name));
+                if (ec == bsky_ec_Ok)
+                    ec = bsky_cbor_push_json(buf, pair->value, cache);
+            }
+            break;
+        }
+
+        return ec;
+    }
+
+    enum bsky_error_code
+    bsky_sb_push_json_canonical(struct bsky_str_builder *sb,
+                                struct bsky_json json,
+                                struct bsky_json_key_cache *cache)
+    {
+        enum bsky_error_code ec = bsky_ec_Ok;
+
+        switch (json.var) {
+        case bsky_json_Num:
+            if (!isfinite(json.num)) return bsky_ec_Json_not_canonical;
+            __bsky_sb_push_json_num(sb, json.num);
+            break;
+
+        case bsky_json_Arr:
+            bsky_sb_push(sb, '[');
+
+            for (size_t i = 0; i < json.arr.len && ec == bsky_ec_Ok; ++i) {
+                if (i > 0) bsky_sb_push(sb, ',');
+                ec = bsky_sb_push_json_canonical(sb, json.arr.data[i], cache);
+            }
+
+            bsky_sb_push(sb, ']');
+            break;
+
+        case bsky_json_Dct: {
+            uint32_t *order = __bsky_json_key_order(cache, json, 1, &ec);
+            if (order == NULL) break;
+
+            bsky_sb_push(sb, '{');
+
+            for (size_t i = 0; i < json.dct.len && ec == bsky_ec_Ok; ++i) {
+                struct bsky_json_pair *pair = &json.dct.data[order[i]];
+
+                if (i > 0) bsky_sb_push(sb, ',');
+                __bsky_sb_push_json_str(sb, pair->name);
+                bsky_sb_push(sb, ':');
+                ec = bsky_sb_push_json_canonical(sb, pair->value, cache);
+            }
+
+            bsky_sb_push(sb, '}');
+            break;
+        }
+
+        default:
+            bsky_sb_push_json(sb, json);
+        }
+
+        return ec;
+    }
+
+    void bsky_json_key_cache_free(struct bsky_json_key_cache *cache)
+    {
+        for (size_t i = 0; i < cache->cap; ++i)
+            if (cache->slots[i].keys != NULL)
+                __bsky_free(cache->slots[i].order[0]);
+
+        if (cache->slots != NULL) __bsky_free(cache->slots);
+        *cache = (struct bsky_json_key_cache) { 0 };
+    }
+
+    // Current char or '\0' at the end of data.
+    static char __bsky_json_peek(struct bsky_str *data) {
+        return data->start < data->end ? *data->start : '\0';
+    }
+
+    // Parser keeps open containers on explicit stack instead of native
+    // one, so nesting is bounded by `BSKY_JSON_MAX_DEPTH' and not by
+    // stack size. Container pushes its elements on top of shared buffer
+    // and moves them to tmp arena when it's closed, so one buffer serves
+    // whole document (and batch of them) instead of buffer per container.
+    struct __bsky_json_frame {
+        size_t mark;                         // first element in buffer
+        char  *name;                         // key in parent dictionary
+        int    dct;
+    };
+
+    struct __bsky_json_parser {
+        struct bsky_json_da      values;
+        struct bsky_json_pair_da pairs;
+        struct {
+            struct __bsky_json_frame *data; size_t len, cap;
+        } frames;
+
+        // elements of open containers of compact tree.
+        struct {
+            struct bsky_json_node *data; size_t len, cap;
+        } nodes;
+
+        int scratch_failed; // arrays above couldn't grow (not tmp arena).
+    };
+
+    #define __bsky_json_scratch_overflow(p) do {                    \
+                (p)->scratch_failed = 1;                            \
+                bsky_defer_ec(bsky_ec_Tmp_overflow);                \
+            } while (0)
+
+    static void __bsky_json_parser_free(struct __bsky_json_parser *p)
+    {
+        bsky_da_free(&p->values);
+        bsky_da_free(&p->pairs);
+        bsky_da_free(&p->frames);
+        bsky_da_free(&p->nodes);
+    }
+
+    static struct bsky_json __bsky_parse_json(struct __bsky_json_parser *,
+                                              struct bsky_str *,
+                                              enum bsky_error_code *);
+
+    struct bsky_json bsky_parse_json_arr(struct bsky_str *data,
+                                         enum bsky_error_code *ec)
+    {
+        *data = bsky_trim_left(*data);
+
+        if (__bsky_json_peek(data) != '[') {
+            *ec = bsky_ec_Json_expect_OSB;
+            return (struct bsky_json) { 0 };
+        }
+
+        struct __bsky_json_parser p = { 0 };
+        struct bsky_json json = __bsky_parse_json(&p, data, ec);
+
+        __bsky_json_parser_free(&p);
+        return json;
+    }
+
+    struct bsky_json bsky_parse_json_dct(struct bsky_str *data,
+                                         enum bsky_error_code *ec)
+    {
+        *data = bsky_trim_left(*data);
+
+        if (__bsky_json_peek(data) != '{') {
+            *ec = bsky_ec_Json_expect_OCB;
+            return (struct bsky_json) { 0 };
+        }
+
+        struct __bsky_json_parser p = { 0 };
+        struct bsky_json json = __bsky_parse_json(&p, data, ec);
+
+        __bsky_json_parser_free(&p);
+        return json;
+    }
+
+    // String and its decoded length.
+    static struct bsky_json __bsky_parse_json_str(struct bsky_str *data,
+                                                  size_t *len,
+                                                  enum bsky_error_code *ec)
+    {
+        *ec = bsky_ec_Ok;
+
+        struct bsky_json json = { 0 };
+        int escaped = 0;
+
+        *data = bsky_trim_left(*data);
+
+        if (__bsky_json_peek(data) != '"')
+            bsky_defer_ec(bsky_ec_Json_expect_OQ);
+
+        *data = bsky_shift_str(*data, 1);
+
+        char *body = data->start, *end = body;
+
+        while ((end = __bsky_json_str_special(end, data->end)) < data->end &&
+               *end != '"') {
+            if (*end != '\\') bsky_defer_ec(bsky_ec_Json_control_char);
+
+            escaped = 1;
+            end += end + 1 < data->end ? 2 : 1;
+        }
+
+        data->start = end;
+
+        if (end >= data->end) bsky_defer_ec(bsky_ec_Json_expect_CQ);
+
+        data->start++;
+
+        if (!bsky_utf8_valid((struct bsky_str) { body, end }))
+            bsky_defer_ec(bsky_ec_Json_invalid_utf8);
+
+        // decoded string is never longer than escaped one.
+        char *str = bsky_tmp_alloc(end - body + 1), *str_end;
+        if (str == NULL) bsky_defer_ec(bsky_ec_Tmp_overflow);
+
+        if (escaped) {
+            str_end = __bsky_json_unescape(str, body, end);
+            if (str_end == NULL) bsky_defer_ec(bsky_ec_Json_invalid_escape);
+        } else {
+            memcpy(str, body, end - body);
+            str_end = str + (end - body);
+        }
+        *str_end = '\0';
+
+        json.var = bsky_json_Str;
+        json.str = str;
+        *len     = str_end - str;
+
+    defer:
+        return json;
+    }
+
+    struct bsky_json bsky_parse_json_str(struct bsky_str *data,
+                                         enum bsky_error_code *ec)
+    {
+        size_t len;
+
+        return __bsky_parse_json_str(data, &len, ec);
+    }
+
+    struct bsky_json bsky_parse_json_num(struct bsky_str *data,
+                                         enum bsky_error_code *ec)
+    {
+        *ec = bsky_ec_Ok;
+
+        struct bsky_json json = { 0 };
+
+        *data = bsky_trim_left(*data);
+
+        // `strtold' needs null terminated string and accepts more than
+        // JSON grammar (hex, inf, nan, leading '+'), so number is matched
+        // first and then copied.
+        char *c = data->start, *end = data->end;
+
+        if (c < end && *c == '-') c++;
+        if (c >= end || *c < '0' || *c > '9')
+            bsky_defer_ec(bsky_ec_Json_expect_Number);
+
+        if (*c == '0') c++;
+        else while (c < end && *c >= '0' && *c <= '9') c++;
+
+        if (c + 1 < end && *c == '.' && c[1] >= '0' && c[1] <= '9') {
+            c++;
+            while (c < end && *c >= '0' && *c <= '9') c++;
+        }
+
+        if (c < end && (*c == 'e' || *c == 'E')) {
+            char *exp = c + 1;
+
+            if (exp < end && (*exp == '+' || *exp == '-')) exp++;
+            if (exp < end && *exp >= '0' && *exp <= '9') {
+                c = exp;
+                while (c < end && *c >= '0' && *c <= '9') c++;
+            }
+        }
+
+        size_t len = c - data->start;
+        char   small[64], *num = small;
+
+        if (len >= sizeof small) {
+            num = bsky_tmp_alloc(len + 1);
+            if (num == NULL) bsky_defer_ec(bsky_ec_Tmp_overflow);
+        }
+
+        memcpy(num, data->start, len);
+        num[len] = '\0';
+
+        data->start = c;
+
+        json.var = bsky_json_Num;
+        json.num = strtold(num, NULL);
+
+    defer:
+        return json;
+    }
+
+    struct bsky_json bsky_parse_json_null(struct bsky_str *data,
+                                          enum bsky_error_code *ec)
+    {
+        *ec = bsky_ec_Ok;
+
+        struct bsky_json json = { 0 };
+
+        *data = bsky_trim_left(*data);
+
+        if (!bsky_str_starts_with(*data, bsky_mk_str("null")))
+            bsky_defer_ec(bsky_ec_Json_expect_Null);
+
+        json.var = bsky_json_Null;
+
+        data->start += 4;
+
+	defer:
+        return json;
+    }
+
+    struct bsky_json bsky_parse_json_bool(struct bsky_str *data,
+                                          enum bsky_error_code *ec)
+    {
+        *ec = bsky_ec_Ok;
+
+        struct bsky_json json = { 0 };
+
+        *data = bsky_trim_left(*data);
+
+        json.var = bsky_json_Bool;
+
+        if (bsky_str_starts_with(*data, bsky_mk_str("false"))) {
+            data->start += 5;
+            json._bool = 0;
+
+        } else if (bsky_str_starts_with(*data, bsky_mk_str("true"))) {
+            data->start += 4;
+            json._bool = 1;
+
+        } else {
+            bsky_defer_ec(bsky_ec_Json_expect_Bool);
+        }
+
+    defer:
+        return json;
+    }
+
+    // Scalar starting with `c', scalar parser's "expect" error means
+    // that there is no valid value at all.
+    static struct bsky_json __bsky_parse_json_scalar(struct bsky_str *data,
+                                                     char c,
+                                                     enum bsky_error_code *ec)
+    {
+        struct bsky_json json = { 0 };
+
+        switch (c) {
+        case '"':
+            return bsky_parse_json_str(data, ec);
+        case 'n':
+            json = bsky_parse_json_null(data, ec);
+            break;
+        case 't': case 'f':
+            json = bsky_parse_json_bool(data, ec);
+            break;
+        case '-': case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+            json = bsky_parse_json_num(data, ec);
+            break;
+        default:
+            *ec = bsky_ec_Json_expect_Null;
+        }
+
+        if (*ec == bsky_ec_Json_expect_Null ||
+            *ec == bsky_ec_Json_expect_Bool ||
+            *ec == bsky_ec_Json_expect_Number)
+            *ec = bsky_ec_Json_invalid_variant;
+
+        return json;
+    }
+
+    static struct bsky_json __bsky_parse_json(struct __bsky_json_parser *p,
+                                              struct bsky_str *data,
+                                              enum bsky_error_code* ec)
+    {
+        *ec = bsky_ec_Ok;
+
+        struct bsky_json json = { 0 };
+        struct __bsky_json_frame *top = NULL;
+        char  *name = NULL, c;
+        size_t base   = p->frames.len;
+        size_t values = p->values.len, pairs = p->pairs.len;
+
+    value:
+        *data = bsky_trim_left(*data);
+        c = __bsky_json_peek(data);
+
+        if (c != '[' && c != '{') {
+            json = __bsky_parse_json_scalar(data, c, ec);
+            if (*ec != bsky_ec_Ok) goto defer;
+
+            goto element;
+        }
+
+        if (p->frames.len - base >= BSKY_JSON_MAX_DEPTH)
+            bsky_defer_ec(bsky_ec_Json_too_deep);
+
+        struct __bsky_json_frame frame = {
+            c == '{' ? p->pairs.len : p->values.len, name, c == '{'
+        };
+        if (bsky_da_push(&p->frames, frame) != bsky_ec_Ok)
+            __bsky_json_scratch_overflow(p);
+
+        top = &p->frames.data[p->frames.len - 1];
+
+    next:
+        // trailing comma is accepted: `[1,]'.
+        *data = bsky_shift_str(*data, 1);
+        *data = bsky_trim_left(*data);
+
+        c = __bsky_json_peek(data);
+        if (c == (top->dct ? '}' : ']')) goto close;
+        if (!top->dct) goto value;
+
+        json = bsky_parse_json_str(data, ec);
+        if (*ec != bsky_ec_Ok) goto defer;
+
+        name  = json.str;
+        *data = bsky_trim_left(*data);
+
+        if (__bsky_json_peek(data) != ':')
+            bsky_defer_ec(bsky_ec_Json_expect_Colon);
+
+        *data = bsky_shift_str(*data, 1);
+        goto value;
+
+    close:
+        *data = bsky_shift_str(*data, 1);
+
+        size_t len = (top->dct ? p->pairs.len : p->values.len) - top->mark;
+
+        if (top->dct) {
+            struct bsky_json_pair *dct = bsky_tmp_alloc(len * sizeof *dct);
+            if (dct == NULL) bsky_defer_ec(bsky_ec_Tmp_overflow);
+
+            if (len > 0)
+                memcpy(dct, p->pairs.data + top->mark, len * sizeof *dct);
+
+            json = (struct bsky_json) { .var = bsky_json_Dct };
+            json.dct.data = dct;
+            json.dct.len  = len;
+            p->pairs.len  = top->mark;
+        } else {
+            struct bsky_json *arr = bsky_tmp_alloc(len * sizeof *arr);
+            if (arr == NULL) bsky_defer_ec(bsky_ec_Tmp_overflow);
+
+            if (len > 0)
+                memcpy(arr, p->values.data + top->mark, len * sizeof *arr);
+
+            json = (struct bsky_json) { .var = bsky_json_Arr };
+            json.arr.data = arr;
+            json.arr.len  = len;
+            p->values.len = top->mark;
+        }
+
+        name = top->name;
+        p->frames.len--;
+
+    element:
+        if (p->frames.len == base) return json;
+
+        top = &p->frames.data[p->frames.len - 1];
+
+        if (top->dct) {
+            struct bsky_json_pair pair = { name, json };
+
+            if (bsky_da_push(&p->pairs, pair) != bsky_ec_Ok)
+                __bsky_json_scratch_overflow(p);
+        } else if (bsky_da_push(&p->values, json) != bsky_ec_Ok) {
+            __bsky_json_scratch_overflow(p);
+        }
+
+        *data = bsky_trim_left(*data);
+
+        c = __bsky_json_peek(data);
+        if (c == ',') goto next;
+        if (c == (top->dct ? '}' : ']')) goto close;
+
+        *ec = top->dct ? bsky_ec_Json_expect_CCB : bsky_ec_Json_expect_CSB;
+
+    defer:
+        p->frames.len = base;
+        p->values.len = values;
+        p->pairs.len  = pairs;
+
+        return json;
+    }
+
+    struct bsky_json bsky_parse_json(struct bsky_str *data,
+                                     enum bsky_error_code* ec)
+    {
+        BSKY_PROBE_BEGIN(bsky_probe_Parse_json, data->start);
+
+        struct __bsky_json_parser p = { 0 };
+        struct bsky_json json = __bsky_parse_json(&p, data, ec);
+
+        __bsky_json_parser_free(&p);
+
+        BSKY_PROBE_END(bsky_probe_Parse_json, data->start);
+
+        return json;
+    }
+
+    // Node of scalar starting with `c'.
+    static struct bsky_json_node
+    __bsky_parse_json_node(struct bsky_str *data, char c,
+                           enum bsky_error_code *ec)
+    {
+        struct bsky_json_node node = { 0 };
+        struct bsky_json json;
+        size_t len;
+
+        if (c == '"') {
+            json = __bsky_parse_json_str(data, &len, ec);
+            if (len > UINT32_MAX) *ec = bsky_ec_Tmp_overflow;
+
+            node.len = len;
+        } else {
+            json = __bsky_parse_json_scalar(data, c, ec);
+        }
+
+        node.var = json.var;
+        switch (json.var) {
+        case bsky_json_Num:  node.num = json.num; break;
+        case bsky_json_Str:  node.str = json.str; break;
+        case bsky_json_Bool: node._bool = json._bool; break;
+        default: break;
+        }
+
+        return node;
+    }
+
+    // The same state machine as `__bsky_parse_json', but elements are
+    // nodes. Offset of container is known only when container is moved
+    // out of scratch by its parent, until then it's address of elements.
+    static struct bsky_json_node *
+    __bsky_parse_json_compact(struct __bsky_json_parser *p,
+                              struct bsky_str *data, enum bsky_error_code *ec)
+    {
+        *ec = bsky_ec_Ok;
+
+        struct bsky_json_node node = { 0 }, *root = NULL, *elems;
+        struct __bsky_json_frame *top = NULL;
+        char   c;
+        size_t base = p->frames.len, nodes = p->nodes.len;
+
+    value:
+        *data = bsky_trim_left(*data);
+        c = __bsky_json_peek(data);
+
+        if (c != '[' && c != '{') {
+            node = __bsky_parse_json_node(data, c, ec);
+            if (*ec != bsky_ec_Ok) goto defer;
+
+            goto element;
+        }
+
+        if (p->frames.len - base >= BSKY_JSON_MAX_DEPTH)
+            bsky_defer_ec(bsky_ec_Json_too_deep);
+
+        struct __bsky_json_frame frame = { p->nodes.len, NULL, c == '{' };
+        if (bsky_da_push(&p->frames, frame) != bsky_ec_Ok)
+            __bsky_json_scratch_overflow(p);
+
+        top = &p->frames.data[p->frames.len - 1];
+
+    next:
+        *data = bsky_shift_str(*data, 1);
+        *data = bsky_trim_left(*data);
+
+        c = __bsky_json_peek(data);
+        if (c == (top->dct ? '}' : ']')) goto close;
+        if (!top->dct) goto value;
+
+        if (c != '"') bsky_defer_ec(bsky_ec_Json_expect_OQ);
+
+        node = __bsky_parse_json_node(data, c, ec);
+        if (*ec != bsky_ec_Ok) goto defer;
+
+        if (bsky_da_push(&p->nodes, node) != bsky_ec_Ok)
+            __bsky_json_scratch_overflow(p);
+
+        *data = bsky_trim_left(*data);
+
+        if (__bsky_json_peek(data) != ':')
+            bsky_defer_ec(bsky_ec_Json_expect_Colon);
+
+        *data = bsky_shift_str(*data, 1);
+        goto value;
+
+    close:
+        *data = bsky_shift_str(*data, 1);
+
+        size_t len = p->nodes.len - top->mark;
+
+        if (len > UINT32_MAX) bsky_defer_ec(bsky_ec_Tmp_overflow);
+
+        elems = bsky_tmp_alloc(len * sizeof *elems);
+        if (elems == NULL) bsky_defer_ec(bsky_ec_Tmp_overflow);
+
+        for (size_t i = 0; i < len; ++i) {
+            elems[i] = p->nodes.data[top->mark + i];
+
+            if (elems[i].var == bsky_json_Arr || elems[i].var == bsky_json_Dct)
+                elems[i].off -= (intptr_t) &elems[i];
+        }
+
+        node = (struct bsky_json_node) {
+            .var = top->dct ? bsky_json_Dct : bsky_json_Arr,
+            .len = top->dct ? len / 2 : len,
+            .off = (intptr_t) elems,
+        };
+
+        p->nodes.len = top->mark;
+        p->frames.len--;
+
+    element:
+        if (p->frames.len == base) {
+            root = bsky_tmp_alloc(sizeof *root);
+            if (root == NULL) bsky_defer_ec(bsky_ec_Tmp_overflow);
+
+            *root = node;
+            if (root->var == bsky_json_Arr || root->var == bsky_json_Dct)
+                root->off -= (intptr_t) root;
+
+            return root;
+        }
+
+        top = &p->frames.data[p->frames.len - 1];
+
+        if (bsky_da_push(&p->nodes, node) != bsky_ec_Ok)
+            __bsky_json_scratch_overflow(p);
+
+        *data = bsky_trim_left(*data);
+
+        c = __bsky_json_peek(data);
+        if (c == ',') goto next;
+        if (c == (top->dct ? '}' : ']')) goto close;
+
+        *ec = top->dct ? bsky_ec_Json_expect_CCB : bsky_ec_Json_expect_CSB;
+
+    defer:
+        p->frames.len = base;
+        p->nodes.len  = nodes;
+
+        return NULL;
+    }
+
+    struct bsky_json_node *bsky_parse_json_compact(struct bsky_str *data,
+                                                   enum bsky_error_code *ec)
+    {
+        struct __bsky_json_parser p = { 0 };
+        struct bsky_json_node *root = __bsky_parse_json_compact(&p, data, ec);
+
+        __bsky_json_parser_free(&p);
+        return root;
+    }
+
+    static struct bsky_json_node *
+    __bsky_json_node_elems(struct bsky_json_node *node) {
+        return (struct bsky_json_node *) ((char *) node + node->off);
+    }
+
+    struct bsky_json_node *bsky_json_node_at(struct bsky_json_node *node,
+                                             size_t i)
+    {
+        if (i >= node->len) return NULL;
+
+        switch (node->var) {
+        case bsky_json_Arr: return __bsky_json_node_elems(node) + i;
+        case bsky_json_Dct: return __bsky_json_node_elems(node) + 2 * i + 1;
+        default:            return NULL;
+        }
+    }
+
+    char *bsky_json_node_key(struct bsky_json_node *node, size_t i)
+    {
+        if (node->var != bsky_json_Dct || i >= node->len) return NULL;
+
+        return __bsky_json_node_elems(node)[2 * i].str;
+    }
+
+    struct bsky_json_node *bsky_json_node_get(struct bsky_json_node *node,
+                                              char *key)
+    {
+        if (node->var != bsky_json_Dct) return NULL;
+
+        struct bsky_json_node *pair = __bsky_json_node_elems(node);
+
+        for (size_t i = 0; i < node->len; ++i, pair += 2)
+            if (strcmp(pair->str, key) == 0) return pair + 1;
+
+        return NULL;
+    }
+
+    struct bsky_json bsky_json_of_node(struct bsky_json_node *node,
+                                       enum bsky_error_code *ec)
+    {
+        *ec = bsky_ec_Ok;
+
+        struct bsky_json json = { .var = node->var };
+
+        switch (node->var) {
+        case bsky_json_Num:  json.num = node->num; break;
+        case bsky_json_Str:  json.str = node->str; break;
+        case bsky_json_Bool: json._bool = node->_bool; break;
+
+        case bsky_json_Arr:
+            json.arr.len  = node->len;
+            json.arr.data = bsky_tmp_alloc(node->len * sizeof *json.arr.data);
+            if (json.arr.data == NULL) bsky_defer_ec(bsky_ec_Tmp_overflow);
+
+            for (size_t i = 0; i < node->len; ++i) {
+                json.arr.data[i] = bsky_json_of_node(
+                    __bsky_json_node_elems(node) + i, ec);
+                if (*ec != bsky_ec_Ok) goto defer;
+            }
+            break;
+
+        case bsky_json_Dct:
+            json.dct.len  = node->len;
+            json.dct.data = bsky_tmp_alloc(node->len * sizeof *json.dct.data);
+            if (json.dct.data == NULL) bsky_defer_ec(bsky_ec_Tmp_overflow);
+
+            for (size_t i = 0; i < node->len; ++i) {
+                struct bsky_json_node *pair = __bsky_json_node_elems(node) +
+                                              2 * i;
+
+                json.dct.data[i].name  = pair->str;
+                json.dct.data[i].value = bsky_json_of_node(pair + 1, ec);
+                if (*ec != bsky_ec_Ok) goto defer;
+            }
+            break;
+        }
+
+    defer:
+        return json;
+    }
+
+    struct __bsky_json_batch_worker {
+        struct bsky_json_batch *batch;
+        const struct bsky_str *docs;
+        size_t from, to;
+
+        struct bsky_arena region;            // part of batch arena
+        int region_full;                     // document didn't fit
+        struct __bsky_json_parser parser;    // kept between batches
+        pthread_t thread;
+        int started;
+    };
+
+    static void *__bsky_json_batch_work(void *self)
+    {
+        struct __bsky_json_batch_worker *w = self;
+        struct bsky_arena *prev = bsky_tmp_use_arena(&w->region);
+
+        w->region_full = 0;
+
+        for (size_t i = w->from; i < w->to; ++i) {
+            struct bsky_str data = w->docs[i];
+
+            w->parser.scratch_failed = 0;
+            w->batch->docs[i] = __bsky_parse_json(&w->parser, &data,
+                                                  &w->batch->ecs[i]);
+
+            // heap failure of parser scratch isn't fixed by bigger region.
+            if (w->batch->ecs[i] == bsky_ec_Tmp_overflow &&
+                !w->parser.scratch_failed)
+                w->region_full = 1;
+        }
+
+        bsky_tmp_use_arena(prev);
+        return NULL;
+    }
+
+    static enum bsky_error_code
+    __bsky_json_batch_reserve(struct bsky_json_batch *batch, size_t len,
+                              size_t threads)
+    {
+        if (len > batch->cap) {
+            void *docs = __bsky_realloc(batch->docs, len * sizeof *batch->docs);
+            if (docs == NULL) return bsky_ec_Tmp_overflow;
+            batch->docs = docs;
+
+            void *ecs = __bsky_realloc(batch->ecs, len * sizeof *batch->ecs);
+            if (ecs == NULL) return bsky_ec_Tmp_overflow;
+            batch->ecs = ecs;
+
+            batch->cap = len;
+        }
+
+        if (threads > batch->workers_len) {
+            void *workers = __bsky_realloc(batch->workers,
+                                           threads * sizeof *batch->workers);
+            if (workers == NULL) return bsky_ec_Tmp_overflow;
+
+            batch->workers = workers;
+            memset(batch->workers + batch->workers_len, 0,
+                   (threads - batch->workers_len) * sizeof *batch->workers);
+            batch->workers_len = threads;
+        }
+
+        return bsky_ec_Ok;
+    }
+
+    enum bsky_error_code bsky_json_batch_parse(struct bsky_json_batch *batch,
+                                               const struct bsky_str *docs,
+                                               size_t len)
+    {
+        enum bsky_error_code ec;
+        size_t threads = batch->threads > 1 ? batch->threads : 1, total = 0;
+
+        if (threads > len) threads = len ? len : 1;
+
+        ec = __bsky_json_batch_reserve(batch, len, threads);
+        if (ec != bsky_ec_Ok) return ec;
+
+        batch->len = len;
+        if (batch->ratio == 0) batch->ratio = BSKY_JSON_BATCH_RATIO;
+
+        for (size_t i = 0; i < len; ++i) total += bsky_str_len(docs[i]);
+
+    parse:;
+        // small documents need few nodes whatever their size is.
+        const size_t per_doc = 0x40;
+        size_t need = total * batch->ratio + len * per_doc +
+                      threads * BSKY_ARENA_ALIGN;
+
+        if (batch->arena.cap < need) {
+            bsky_arena_free(&batch->arena);
+            batch->arena.cap = need;
+        }
+
+        bsky_arena_reset(&batch->arena);
+        if (bsky_arena_alloc(&batch->arena, 0) == NULL)
+            return bsky_ec_Tmp_overflow;
+
+        // contiguous runs of documents with about equal bytes.
+        size_t from = 0, offset = 0, bytes = 0;
+
+        for (size_t t = 0; t < threads; ++t) {
+            struct __bsky_json_batch_worker *w = &batch->workers[t];
+            size_t to = from, run = 0;
+
+            while (to < len && (t == threads - 1 ||
+                                bytes + run < total / threads * (t + 1)))
+                run += bsky_str_len(docs[to++]);
+
+            size_t size = __bsky_align_up(run * batch->ratio +
+                                          (to - from) * per_doc);
+
+            w->batch  = batch;
+            w->docs   = docs;
+            w->from   = from;
+            w->to     = to;
+            w->region = (struct bsky_arena) {
+                batch->arena.data + offset, 0, size
+            };
+
+            from    = to;
+            bytes  += run;
+            offset += size;
+        }
+
+        // calling thread is the first worker, threads which can't be
+        // started are run by it too.
+        for (size_t t = 1; t < threads; ++t)
+            batch->workers[t].started = pthread_create(
+                &batch->workers[t].thread, NULL, __bsky_json_batch_work,
+                &batch->workers[t]) == 0;
+
+        __bsky_json_batch_work(&batch->workers[0]);
+
+        for (size_t t = 1; t < threads; ++t) {
+            if (batch->workers[t].started)
+                pthread_join(batch->workers[t].thread, NULL);
+            else
+                __bsky_json_batch_work(&batch->workers[t]);
+
+            batch->workers[t].started = 0;
+        }
+
+        for (size_t t = 0; t < threads; ++t) {
+            if (batch->workers[t].region_full && batch->ratio < 0x400) {
+                batch->ratio *= 2;
+                goto parse;
+            }
+        }
+
+        ec = bsky_ec_Ok;
+        for (size_t i = 0; i < len && ec == bsky_ec_Ok; ++i)
+            ec = batch->ecs[i];
+
+        return ec;
+    }
+
+    void bsky_json_batch_free(struct bsky_json_batch *batch)
+    {
+        for (size_t t = 0; t < batch->workers_len; ++t)
+            __bsky_json_parser_free(&batch->workers[t].parser);
+
+        if (batch->workers != NULL) __bsky_free(batch->workers);
+        if (batch->docs != NULL) __bsky_free(batch->docs);
+        if (batch->ecs != NULL) __bsky_free(batch->ecs);
+        bsky_arena_free(&batch->arena);
+
+        *batch = (struct bsky_json_batch) { .threads = batch->threads };
+    }
+
+
+    /*
+     * BSKY XRPC
+     */
+    static int __bsky_is_unreserved(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+               (c >= '0' && c <= '9') ||
+               c == '-' || c == '.' || c == '_' || c == '~';
+    }
+
+    void bsky_sb_push_urlencoded(struct bsky_str_builder *sb,
+                                 struct bsky_str str)
+    {
+        static const char hex[] = "0123456789ABCDEF";
+
+        for (char *c = str.start; c < str.end; ) {
+            char *run = c;
+            while (c < str.end && __bsky_is_unreserved(*c)) c++;
+
+            if (c != run) bsky_sb_push_str(sb, (struct bsky_str) { run, c });
+            if (c == str.end) break;
+
+            char escaped[] = {
+                '%', hex[(unsigned char) *c >> 4], hex[*c & 0xf],
+            };
+            bsky_sb_push_str(sb, (struct bsky_str) { escaped, escaped + 3 });
+            c++;
+        }
+    }
+
+    void bsky_sb_push_xrpc_path(struct bsky_str_builder *sb,
+                                const struct bsky_xrpc_request *req)
+    {
+        bsky_sb_push_fmt(sb, "/xrpc/%s", req->nsid);
+
+        for (size_t i = 0; i < req->params_len; ++i) {
+            bsky_sb_push(sb, i == 0 ? '?' : '&');
+            bsky_sb_push_urlencoded(sb, bsky_mk_str(req->params[i].name));
+            bsky_sb_push(sb, '=');
+            bsky_sb_push_urlencoded(sb, req->params[i].value);
+        }
+    }
+
+    enum bsky_error_code bsky_xrpc_call(struct bsky_xrpc_client *client,
+                                        struct bsky_xrpc_request *req,
+                                        struct bsky_xrpc_response *res)
+    {
+        enum bsky_error_code ec;
+
+        *res = (struct bsky_xrpc_response) { 0 };
+        if (req->host == NULL) req->host = client->host;
+
+        if (client->transport == NULL)
+            bsky_return_error(bsky_ec_Xrpc_transport);
+
+        for (int attempt = 0;; ++attempt) {
+            if (client->limiter) bsky_rate_acquire(client->limiter, req->host);
+
+            ec = client->transport(client->ctx, req, res);
+            if (ec != bsky_ec_Ok) {
+                // release reservation.
+                if (client->limiter)
+                    bsky_rate_update(client->limiter, req->host,
+                                     (struct bsky_xrpc_response) { 0 });
+                bsky_return_error(ec);
+            }
+
+            if (client->limiter == NULL) break;
+
+            bsky_rate_update(client->limiter, req->host, *res);
+
+            if (res->status != 429 || attempt >= client->limiter->max_retries)
+                break;
+
+            *res = (struct bsky_xrpc_response) { 0 };
+        }
+
+        if (res->status < 200 || res->status >= 300)
+            bsky_return_error(bsky_ec_Xrpc_status);
+
+        return bsky_ec_Ok;
+    }
+
+    static char __bsky_ascii_lower(char c) {
+        return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+    }
+
+    struct bsky_str bsky_xrpc_header(struct bsky_xrpc_response res,
+                                     char *name)
+    {
+        size_t name_len = strlen(name);
+        char  *line = res.headers.start, *end = res.headers.end;
+
+        while (line != NULL && line < end) {
+            char *line_end = memchr(line, '\n', end - line);
+            if (line_end == NULL) line_end = end;
+
+            char *colon = memchr(line, ':', line_end - line);
+            size_t i = 0;
+
+            if (colon != NULL && (size_t) (colon - line) == name_len) {
+                while (i < name_len && __bsky_ascii_lower(line[i]) ==
+                                       __bsky_ascii_lower(name[i]))
+                    i++;
+            }
+
+            if (colon != NULL && i == name_len && name_len != 0) {
+                struct bsky_str value = { colon + 1, line_end };
+
+                value = bsky_trim_left(value);
+                while (value.end > value.start &&
+                       (value.end[-1] == '\r' || value.end[-1] == ' '))
+                    value.end--;
+
+                return value;
+            }
+
+            line = line_end + 1;
+        }
+
+        return (struct bsky_str) { 0 };
+    }
+
+    /*
+     * BSKY HYDRATION
+     */
+    static char *__bsky_hydrate_nsid[]  = { "app.bsky.actor.getProfiles",
+                                            "app.bsky.feed.getPosts" };
+    static char *__bsky_hydrate_param[] = { "actors", "uris" };
+    static char *__bsky_hydrate_list[]  = { "profiles", "posts" };
+
+    static int __bsky_hydrate_id_eq(struct bsky_str fst, struct bsky_str snd)
+    {
+        return bsky_str_len(fst) == bsky_str_len(snd) &&
+               memcmp(fst.start, snd.start, bsky_str_len(fst)) == 0;
+    }
+
+    static size_t *__bsky_hydrate_cell(struct bsky_hydrator *h,
+                                       enum bsky_hydrate_kind kind,
+                                       struct bsky_str id,
+                                       unsigned long long hash)
+    {
+        size_t mask = h->index_cap - 1;
+
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            if (h->index[i] == 0) return &h->index[i];
+
+            struct bsky_hydrate_slot *slot = &h->slots.data[h->index[i] - 1];
+
+            if (slot->hash == hash && slot->kind == kind &&
+                __bsky_hydrate_id_eq(slot->id, id))
+                return &h->index[i];
+        }
+    }
+
+    // Old index is kept if allocation fails.
+    static enum bsky_error_code __bsky_hydrate_grow(struct bsky_hydrator *h)
+    {
+        size_t  cap   = h->index_cap ? h->index_cap * 2 : 64;
+        size_t *index = __bsky_calloc(cap, sizeof (size_t));
+
+        if (index == NULL) bsky_return_error(bsky_ec_Tmp_overflow);
+
+        __bsky_free(h->index);
+        h->index     = index;
+        h->index_cap = cap;
+
+        for (size_t i = 0; i < h->slots.len; ++i) {
+            struct bsky_hydrate_slot *slot = &h->slots.data[i];
+
+            // failed allocations are not shared, their id isn't copied.
+            if (slot->ec == bsky_ec_Tmp_overflow) continue;
+
+            *__bsky_hydrate_cell(h, slot->kind, slot->id, slot->hash) = i + 1;
+        }
+
+        return bsky_ec_Ok;
+    }
+
+    static unsigned long long __bsky_hydrate_hash(enum bsky_hydrate_kind kind,
+                                                  struct bsky_str id)
+    {
+        return bsky_str_hash(id, BSKY_STR_HASH_SEED ^ kind);
+    }
+
+    static void __bsky_hydrate_fan_out(struct bsky_hydrator *h,
+                                       enum bsky_hydrate_kind kind,
+                                       struct bsky_json *item, char *key)
+    {
+        struct bsky_json *id = bsky_json_dct_get(*item, key);
+
+        if (id == NULL || id->var != bsky_json_Str) return;
+
+        struct bsky_str id_str = bsky_mk_str(id->str);
+        size_t *cell = __bsky_hydrate_cell(h, kind, id_str,
+                                           __bsky_hydrate_hash(kind, id_str));
+
+        if (*cell != 0) h->slots.data[*cell - 1].value = item;
+    }
+
+    static enum bsky_error_code
+    __bsky_hydrate_send(struct bsky_hydrator *h, enum bsky_hydrate_kind kind,
+                        size_t *batch, struct bsky_xrpc_param *params,
+                        size_t len)
+    {
+        enum bsky_error_code ec;
+        struct bsky_xrpc_response res;
+        struct bsky_json body, *list = NULL;
+
+        struct bsky_xrpc_request req = {
+            .method     = bsky_xrpc_Get,
+            .nsid       = __bsky_hydrate_nsid[kind],
+            .params     = params,
+            .params_len = len,
+        };
+
+        h->calls++;
+
+        ec = bsky_xrpc_call(h->client, &req, &res);
+
+        if (ec == bsky_ec_Ok) body = bsky_parse_json(&res.body, &ec);
+
+        if (ec == bsky_ec_Ok) {
+            list = bsky_json_dct_get(body, __bsky_hydrate_list[kind]);
+            if (list == NULL || list->var != bsky_json_Arr)
+                ec = bsky_ec_Xrpc_bad_response;
+        }
+
+        if (ec == bsky_ec_Ok) {
+            for (size_t i = 0; i < list->arr.len; ++i) {
+                if (kind == bsky_hydrate_Profile) {
+                    __bsky_hydrate_fan_out(h, kind, &list->arr.data[i], "did");
+                    __bsky_hydrate_fan_out(h, kind, &list->arr.data[i],
+                                           "handle");
+                } else {
+                    __bsky_hydrate_fan_out(h, kind, &list->arr.data[i], "uri");
+                }
+            }
+        }
+
+        for (size_t i = 0; i < len; ++i) {
+            h->slots.data[batch[i]].done = 1;
+            h->slots.data[batch[i]].ec   = ec;
+        }
+
+        return ec;
+    }
+
+    static enum bsky_error_code
+    __bsky_hydrate_flush_kind(struct bsky_hydrator *h,
+                              enum bsky_hydrate_kind kind)
+    {
+        enum bsky_error_code ret = bsky_ec_Ok, ec;
+
+        size_t                 batch [BSKY_HYDRATE_BATCH_MAX];
+        struct bsky_xrpc_param params[BSKY_HYDRATE_BATCH_MAX];
+        size_t                 len = 0;
+
+        for (size_t i = h->scan[kind]; i < h->slots.len; ++i) {
+            struct bsky_hydrate_slot *slot = &h->slots.data[i];
+
+            if (slot->kind != kind || slot->done) continue;
+
+            batch[len]  = i;
+            params[len] = (struct bsky_xrpc_param) {
+                __bsky_hydrate_param[kind], slot->id
+            };
+
+            if (++len == BSKY_HYDRATE_BATCH_MAX) {
+                ec  = __bsky_hydrate_send(h, kind, batch, params, len);
+                ret = ret == bsky_ec_Ok ? ec : ret;
+                len = 0;
+            }
+        }
+
+        if (len != 0) {
+            ec  = __bsky_hydrate_send(h, kind, batch, params, len);
+            ret = ret == bsky_ec_Ok ? ec : ret;
+        }
+
+        h->scan[kind]    = h->slots.len;
+        h->pending[kind] = 0;
+
+        return ret;
+    }
+
+    size_t bsky_hydrate_request(struct bsky_hydrator *h,
+                                enum bsky_hydrate_kind kind,
+                                struct bsky_str id)
+    {
+        h->lookups++;
+
+        unsigned long long hash = __bsky_hydrate_hash(kind, id);
+
+        // fuller index still works while it has an empty cell.
+        if ((h->slots.len + 1) * 2 > h->index_cap &&
+            __bsky_hydrate_grow(h) != bsky_ec_Ok &&
+            h->slots.len + 1 >= h->index_cap) {
+            struct bsky_hydrate_slot slot = {
+                .kind = kind, .id = id, .hash = hash,
+                .done = 1,    .ec = bsky_ec_Tmp_overflow,
+            };
+
+            if (bsky_da_push(&h->slots, slot) != bsky_ec_Ok)
+                return BSKY_HYDRATE_NO_SLOT;
+            return h->slots.len - 1;
+        }
+
+        size_t *cell = __bsky_hydrate_cell(h, kind, id, hash);
+
+        if (*cell != 0) {
+            h->coalesced++;
+            return *cell - 1;
+        }
+
+        size_t len  = bsky_str_len(id);
+        char  *copy = bsky_tmp_alloc(len + 1);
+
+        struct bsky_hydrate_slot slot = { .kind = kind, .hash = hash };
+
+        if (copy == NULL) {
+            slot.done = 1;
+            slot.ec   = bsky_ec_Tmp_overflow;
+            slot.id   = id;
+        } else {
+            memcpy(copy, id.start, len);
+            copy[len] = '\0';
+            slot.id   = (struct bsky_str) { copy, copy + len };
+        }
+
+        if (bsky_da_push(&h->slots, slot) != bsky_ec_Ok)
+            return BSKY_HYDRATE_NO_SLOT;
+        if (!slot.done) *cell = h->slots.len;
+
+        if (!slot.done && ++h->pending[kind] >= BSKY_HYDRATE_BATCH_MAX)
+            __bsky_hydrate_flush_kind(h, kind);
+
+        return h->slots.len - 1;
+    }
+
+    enum bsky_error_code bsky_hydrate_flush(struct bsky_hydrator *h)
+    {
+        enum bsky_error_code profiles, posts;
+
+        profiles = __bsky_hydrate_flush_kind(h, bsky_hydrate_Profile);
+        posts    = __bsky_hydrate_flush_kind(h, bsky_hydrate_Post);
+
+        return profiles != bsky_ec_Ok ? profiles : posts;
+    }
+
+    struct bsky_json *bsky_hydrate_get(struct bsky_hydrator *h, size_t idx,
+                                       enum bsky_error_code *ec)
+    {
+        if (idx == BSKY_HYDRATE_NO_SLOT) {
+            *ec = bsky_ec_Tmp_overflow;
+            return NULL;
+        }
+
+        if (!h->slots.data[idx].done)
+            __bsky_hydrate_flush_kind(h, h->slots.data[idx].kind);
+
+        *ec = h->slots.data[idx].ec;
+        return h->slots.data[idx].value;
+    }
+
+    void bsky_hydrator_free(struct bsky_hydrator *h)
+    {
+        bsky_da_free(&h->slots);
+        __bsky_free(h->index);
+
+        *h = (struct bsky_hydrator) { .client = h->client };
+    }
+
+    /*
+     * BSKY XRPC CACHE
+     */
+    #include <time.h>
+
+    long long bsky_clock_ms(void)
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return (long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    }
+
+    static int __bsky_xrpc_param_cmp(const struct bsky_xrpc_param *fst,
+                                     const struct bsky_xrpc_param *snd)
+    {
+        int cmp = strcmp(fst->name, snd->name);
+        if (cmp != 0) return cmp;
+
+        size_t fst_len = bsky_str_len(fst->value);
+        size_t snd_len = bsky_str_len(snd->value);
+
+        cmp = memcmp(fst->value.start, snd->value.start,
+                     fst_len < snd_len ? fst_len : snd_len);
+        if (cmp != 0) return cmp;
+
+        return fst_len < snd_len ? -1 : fst_len > snd_len;
+    }
+
+    enum bsky_error_code
+    bsky_sb_push_xrpc_cache_key(struct bsky_str_builder *sb,
+                                const struct bsky_xrpc_request *req)
+    {
+        const struct bsky_xrpc_param **order =
+            bsky_tmp_alloc(req->params_len * sizeof (*order) + 1);
+
+        if (order == NULL) return bsky_ec_Tmp_overflow;
+
+        // insertion sort, requests have only few parameters.
+        for (size_t i = 0; i < req->params_len; ++i) {
+            size_t j = i;
+
+            for (; j > 0 && __bsky_xrpc_param_cmp(order[j-1],
+                                                  &req->params[i]) > 0; --j)
+                order[j] = order[j-1];
+
+            order[j] = &req->params[i];
+        }
+
+        bsky_sb_push_fmt(sb, "%s/%s", req->host ? req->host : "", req->nsid);
+
+        for (size_t i = 0; i < req->params_len; ++i) {
+            bsky_sb_push(sb, i == 0 ? '?' : '&');
+            bsky_sb_push_urlencoded(sb, bsky_mk_str(order[i]->name));
+            bsky_sb_push(sb, '=');
+            bsky_sb_push_urlencoded(sb, order[i]->value);
+        }
+
+        return bsky_ec_Ok;
+    }
+
+    static struct bsky_xrpc_cache_entry *
+    __bsky_xrpc_cache_at(struct bsky_xrpc_cache *cache, size_t idx)
+    {
+        return &cache->entries.data[idx - 1];
+    }
+
+    static void __bsky_xrpc_cache_lru_unlink(struct bsky_xrpc_cache *cache,
+                                             size_t idx)
+    {
+        struct bsky_xrpc_cache_entry *e = __bsky_xrpc_cache_at(cache, idx);
+
+        if (e->prev) __bsky_xrpc_cache_at(cache, e->prev)->next = e->next;
+        else         cache->head = e->next;
+
+        if (e->next) __bsky_xrpc_cache_at(cache, e->next)->prev = e->prev;
+        else         cache->tail = e->prev;
+
+        e->prev = e->next = 0;
+    }
+
+    static void __bsky_xrpc_cache_lru_front(struct bsky_xrpc_cache *cache,
+                                            size_t idx)
+    {
+        struct bsky_xrpc_cache_entry *e = __bsky_xrpc_cache_at(cache, idx);
+
+        e->prev = 0;
+        e->next = cache->head;
+
+        if (cache->head) __bsky_xrpc_cache_at(cache, cache->head)->prev = idx;
+        else             cache->tail = idx;
+
+        cache->head = idx;
+    }
+
+    static size_t *__bsky_xrpc_cache_bucket(struct bsky_xrpc_cache *cache,
+                                            unsigned long long hash)
+    {
+        return &cache->buckets[hash & (cache->buckets_cap - 1)];
+    }
+
+    static size_t __bsky_xrpc_cache_find(struct bsky_xrpc_cache *cache,
+                                         struct bsky_str key,
+                                         unsigned long long hash)
+    {
+        if (cache->buckets_cap == 0) return 0;
+
+        size_t idx = *__bsky_xrpc_cache_bucket(cache, hash);
+
+        while (idx != 0) {
+            struct bsky_xrpc_cache_entry *e = __bsky_xrpc_cache_at(cache, idx);
+
+            if (e->hash == hash &&
+                bsky_str_len(e->key) == bsky_str_len(key) &&
+                memcmp(e->key.start, key.start, bsky_str_len(key)) == 0)
+                return idx;
+
+            idx = e->chain;
+        }
+
+        return 0;
+    }
+
+    static void __bsky_xrpc_cache_remove(struct bsky_xrpc_cache *cache,
+                                         size_t idx)
+    {
+        struct bsky_xrpc_cache_entry *e = __bsky_xrpc_cache_at(cache, idx);
+        size_t *link = __bsky_xrpc_cache_bucket(cache, e->hash);
+
+        while (*link != idx) link = &__bsky_xrpc_cache_at(cache, *link)->chain;
+        *link = e->chain;
+
+        __bsky_xrpc_cache_lru_unlink(cache, idx);
+
+        cache->used -= bsky_str_len(e->key) + bsky_str_len(e->body) + 2;
+        cache->count--;
+
+        __bsky_free(e->key.start);
+        *e = (struct bsky_xrpc_cache_entry) { .chain = cache->free };
+        cache->free = idx;
+    }
+
+    // Old buckets are kept if allocation fails.
+    static enum bsky_error_code
+    __bsky_xrpc_cache_rehash(struct bsky_xrpc_cache *cache)
+    {
+        size_t  cap     = cache->buckets_cap ? cache->buckets_cap * 2 : 64;
+        size_t *buckets = __bsky_calloc(cap, sizeof (size_t));
+
+        if (buckets == NULL) return bsky_ec_Tmp_overflow;
+
+        __bsky_free(cache->buckets);
+        cache->buckets     = buckets;
+        cache->buckets_cap = cap;
+
+        for (size_t idx = cache->head; idx != 0;) {
+            struct bsky_xrpc_cache_entry *e = __bsky_xrpc_cache_at(cache, idx);
+            size_t *bucket = __bsky_xrpc_cache_bucket(cache, e->hash);
+
+            e->chain = *bucket;
+            *bucket  = idx;
+            idx      = e->next;
+        }
+
+        return bsky_ec_Ok;
+    }
+
+    static void __bsky_xrpc_cache_insert(struct bsky_xrpc_cache *cache,
+                                         struct bsky_str key,
+                                         unsigned long long hash,
+                                         struct bsky_str body,
+                                         long long expires)
+    {
+        size_t key_len = bsky_str_len(key), body_len = bsky_str_len(body);
+        size_t size    = key_len + body_len + 2;
+
+        if (size > cache->capacity) return;
+
+        while (cache->used + size > cache->capacity) {
+            __bsky_xrpc_cache_remove(cache, cache->tail);
+            cache->evictions++;
+        }
+
+        if (cache->count + 1 > cache->buckets_cap &&
+            __bsky_xrpc_cache_rehash(cache) != bsky_ec_Ok)
+            return;
+
+        char *block = __bsky_malloc(size);
+        if (block == NULL) return;
+
+        memcpy(block, key.start, key_len);
+        block[key_len] = '\0';
+        memcpy(block + key_len + 1, body.start, body_len);
+        block[size - 1] = '\0';
+
+        struct bsky_xrpc_cache_entry entry = {
+            .hash    = hash,
+            .key     = { block, block + key_len },
+            .body    = { block + key_len + 1, block + size - 1 },
+            .expires = expires,
+        };
+
+        size_t idx = cache->free;
+
+        if (idx != 0) {
+            cache->free = __bsky_xrpc_cache_at(cache, idx)->chain;
+            *__bsky_xrpc_cache_at(cache, idx) = entry;
+        } else {
+            if (bsky_da_push(&cache->entries, entry) != bsky_ec_Ok) {
+                __bsky_free(block);
+                return;
+            }
+            idx = cache->entries.len;
         }
 
-        memcpy(self->data + self->len++ * elem_size, elem, elem_size);
+        size_t *bucket = __bsky_xrpc_cache_bucket(cache, hash);
+        __bsky_xrpc_cache_at(cache, idx)->chain = *bucket;
+        *bucket = idx;
 
-        return bsky_ec_Ok;
+        __bsky_xrpc_cache_lru_front(cache, idx);
+
+        cache->used += size;
+        cache->count++;
     }
 
-    enum bsky_error_code
-    __bsky_da_append(void *self_gen, const void *elems,
-                     size_t elem_size, size_t len)
+    enum bsky_error_code bsky_xrpc_cached_call(struct bsky_xrpc_cache *cache,
+                                               struct bsky_xrpc_client *client,
+                                               struct bsky_xrpc_request *req,
+                                               struct bsky_xrpc_response *res)
     {
-        struct bsky_dynamic_arr *self = (struct bsky_dynamic_arr*) self_gen;
+        if (req->method != bsky_xrpc_Get)
+            return bsky_xrpc_call(client, req, res);
 
-        if (self->len + len > self->cap) {
-            self->cap  = (self->cap ? self->cap * 2 : 16) + len;
-            self->data = realloc(self->data, self->cap * elem_size);
+        if (req->host == NULL) req->host = client->host;
+
+        struct bsky_str_builder sb = { 0 };
+        enum bsky_error_code ec = bsky_sb_push_xrpc_cache_key(&sb, req);
 
-            if (self->data == NULL) bsky_return_error(bsky_ec_Tmp_overflow);
+        if (ec != bsky_ec_Ok) {
+            bsky_da_free(&sb);
+            return ec;
         }
 
-        memcpy(self->data + self->len, elems, elem_size * len);
-        self->len += len;
+        struct bsky_str key = bsky_sb_build_tmp(&sb);
+        if (key.start == NULL) return bsky_ec_Tmp_overflow;
+
+        unsigned long long hash = bsky_str_hash(key, BSKY_STR_HASH_SEED);
+        long long          now  = cache->now_ms ? cache->now_ms()
+                                                  : bsky_clock_ms();
+
+        size_t idx = __bsky_xrpc_cache_find(cache, key, hash);
+
+        if (idx != 0) {
+            struct bsky_xrpc_cache_entry *e = __bsky_xrpc_cache_at(cache, idx);
+
+            if (e->expires > now) {
+                cache->hits++;
+
+                __bsky_xrpc_cache_lru_unlink(cache, idx);
+                __bsky_xrpc_cache_lru_front(cache, idx);
+
+                struct bsky_view body = bsky_view_to_tmp(
+                                            bsky_view_of_str(e->body));
+
+                *res = (struct bsky_xrpc_response) {
+                    .status = 200,
+                    .body   = { body.start, (char *) body.end - 1 },
+                };
+
+                return bsky_ec_Ok;
+            }
+
+            cache->expired++;
+            __bsky_xrpc_cache_remove(cache, idx);
+        }
+
+        cache->misses++;
+
+        ec = bsky_xrpc_call(client, req, res);
+        if (ec != bsky_ec_Ok) return ec;
+
+        __bsky_xrpc_cache_insert(cache, key, hash, res->body,
+                                 now + cache->ttl_ms);
 
         return bsky_ec_Ok;
     }
 
-    void bsky_clear_da(void *self_gen) {
-        struct bsky_dynamic_arr *self = (struct bsky_dynamic_arr*) self_gen;
+    void bsky_xrpc_cache_clear(struct bsky_xrpc_cache *cache)
+    {
+        while (cache->head != 0) __bsky_xrpc_cache_remove(cache, cache->head);
+    }
 
-        *self = (struct bsky_dynamic_arr) { 0 }; 
+    void bsky_xrpc_cache_free(struct bsky_xrpc_cache *cache)
+    {
+        bsky_xrpc_cache_clear(cache);
+
+        bsky_da_free(&cache->entries);
+        __bsky_free(cache->buckets);
+
+        cache->entries     = (struct bsky_xrpc_cache_entry_da) { 0 };
+        cache->buckets     = NULL;
+        cache->buckets_cap = 0;
+        cache->free        = 0;
     }
 
     /*
-     * BSKY VIEW
+     * BSKY PAGINATOR
      */
-    struct bsky_view __bsky_view_of_da(void *_da, size_t elem_size)
+    #include <pthread.h>
+
+    static void *__bsky_paginator_fetch(void *self)
     {
-        struct bsky_dynamic_arr *da = (struct bsky_dynamic_arr *) _da;
+        struct bsky_paginator *p = self;
+        struct bsky_arena *prev = bsky_tmp_use_arena(&p->arenas[p->target]);
 
-        return (struct bsky_view) { da->data, da->data + da->len * elem_size };
+        p->next_ec = bsky_xrpc_call(p->client, &p->next_req, &p->next_res);
+
+        bsky_tmp_use_arena(prev);
+        return NULL;
     }
 
-    struct bsky_view bsky_view_to_tmp(struct bsky_view view)
+    static void __bsky_paginator_start(struct bsky_paginator *p,
+                                       struct bsky_str cursor)
     {
-        void *data = bsky_tmp_alloc(view.end - view.start);
-        memcpy(data, view.start, view.end - view.start);
+        size_t len = p->req.params_len;
 
-        return (struct bsky_view) { data, data +  (view.end - view.start) };
-    }
+        p->params[len] = (struct bsky_xrpc_param) { "cursor", cursor };
 
-    struct bsky_view __bsky_tmp_view_of_da(void *da, size_t elem_size)
-    {
-        struct bsky_view ret = bsky_view_to_tmp(
-                                 __bsky_view_of_da(da, elem_size));
+        p->next_req            = p->req;
+        p->next_req.params     = p->params;
+        p->next_req.params_len = len + 1;
 
-        bsky_da_free(da);
-        bsky_clear_da(da);
+        p->target = p->cur ^ 1;
+        bsky_arena_reset(&p->arenas[p->target]);
 
-        return ret;
+        if (pthread_create(&p->worker, NULL, __bsky_paginator_fetch, p) == 0)
+            p->fetching = 1;
+        else
+            __bsky_paginator_fetch(p);
     }
 
-    /*
-     * BSKY STRING
-     */
-    void bsky_sb_push(struct bsky_str_builder *sb, char c)
+    int bsky_paginator_next(struct bsky_paginator *p, struct bsky_str *page,
+                            enum bsky_error_code *ec)
     {
-        const char nullc = '\0';
+        *ec = bsky_ec_Ok;
 
-        if (sb->len == 0) {
-            char buf[] = { c, nullc };ic_arr*)da)->data
-            __bsky_da_append(sb, buf, sizeof(buf), 2);
+        if (!p->started) {
+            size_t cap = p->arena_cap ? p->arena_cap
+                                      : BSKY_PAGINATOR_ARENA_CAPACITY;
+
+            p->arenas[0] = (struct bsky_arena) { .cap = cap };
+            p->arenas[1] = (struct bsky_arena) { .cap = cap };
+
+            p->params = __bsky_malloc((p->req.params_len + 1) *
+                                      sizeof (*p->params));
+            if (p->params == NULL) bsky_defer_ec(bsky_ec_Tmp_overflow);
+            if (p->req.params_len != 0)
+                memcpy(p->params, p->req.params,
+                       p->req.params_len * sizeof (*p->params));
+
+            p->started  = 1;
+            p->next_req = p->req;
+            p->target   = p->cur = 0;
+
+            __bsky_paginator_fetch(p);
+        } else {
+            if (p->target == p->cur) return 0; // no more pages.
+
+            if (p->fetching) pthread_join(p->worker, NULL);
+            p->fetching = 0;
+
+            bsky_arena_reset(&p->arenas[p->cur]);
+            p->cur = p->target;
         }
-        else {
-            sb->data[sb->len-1] = c;
-            bsky_da_push(sb, nullc);
+
+        if (p->next_ec != bsky_ec_Ok) {
+            p->target = p->cur;
+            bsky_defer_ec(p->next_ec);
+        }
+
+        *page = p->next_res.body;
+        p->pages++;
+
+        struct bsky_str cursor = bsky_json_scan_field(*page, "cursor");
+
+        // cursor is sent decoded, the copy lives in page arena.
+        if (cursor.start != NULL &&
+            memchr(cursor.start, '\\', bsky_str_len(cursor)) != NULL) {
+            char *str = bsky_arena_alloc(&p->arenas[p->cur],
+                                         bsky_str_len(cursor));
+            char *str_end = str ? __bsky_json_unescape(str, cursor.start,
+                                                       cursor.end)
+                                : NULL;
+
+            if (str_end == NULL) {
+                p->target = p->cur; // no more pages.
+                bsky_defer_ec(str ? bsky_ec_Json_invalid_escape
+                                  : bsky_ec_Tmp_overflow);
+            }
+
+            cursor = (struct bsky_str) { str, str_end };
         }
+
+        if (cursor.start != NULL && cursor.end != cursor.start)
+            __bsky_paginator_start(p, cursor);
+
+        return 1;
+
+    defer:
+        return 0;
     }
 
-    void bsky_sb_push_str(struct bsky_str_builder *sb, struct bsky_str str)
+    struct bsky_arena *bsky_paginator_arena(struct bsky_paginator *p)
     {
-        const char nullc = '\0';
+        return &p->arenas[p->cur];
+    }
 
-        if (sb->len != 0) sb->len--; // remove null character.
+    void bsky_paginator_free(struct bsky_paginator *p)
+    {
+        if (p->fetching) pthread_join(p->worker, NULL);
 
-        __bsky_da_append(sb, str.start, sizeof(char), str.end - str.start);
+        bsky_arena_free(&p->arenas[0]);
+        bsky_arena_free(&p->arenas[1]);
+        __bsky_free(p->params);
 
-        if (sb->data[sb->len-1] != '\0') bsky_da_push(sb, nullc);
+        *p = (struct bsky_paginator) {
+            .client = p->client, .req = p->req, .arena_cap = p->arena_cap,
+        };
     }
 
-    #include <stdarg.h>
+    /*
+     * BSKY RATE LIMITER
+     */
+    #include <sched.h>
 
-    void bsky_sb_push_fmt(struct bsky_str_builder *sb, char *fmt, ...)
+    static void __bsky_rate_lock(struct bsky_rate_limiter *l)
     {
-        va_list args;
-        va_start(args, fmt);
-        int len = vsnprintf(NULL, 0, fmt, args);
-        va_end(args);
+        int unlocked = 0;
 
-        char *result = bsky_tmp_alloc(len + 1);
-        va_start(args, fmt);
-        vsnprintf(result, len + 1, fmt, args);
-        va_end(args);
+        while (!atomic_compare_exchange_weak(&l->lock, &unlocked, 1)) {
+            unlocked = 0;
+            sched_yield();
+        }
+    }
 
-        bsky_sb_push_str(sb, (struct bsky_str) {result, result + len + 1});
+    static void __bsky_rate_unlock(struct bsky_rate_limiter *l) {
+        atomic_store(&l->lock, 0);
     }
 
-    struct bsky_str bsky_sb_build(struct bsky_str_builder *sb)
+    static long long __bsky_rate_now(struct bsky_rate_limiter *l)
     {
-        return (struct bsky_str) { sb->data, sb->data + sb->len-1 };
+        if (l->now_ms) return l->now_ms();
+
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+
+        return (long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
     }
 
-    struct bsky_str bsky_sb_build_tmp(struct bsky_str_builder *sb)
+    static void __bsky_rate_sleep(struct bsky_rate_limiter *l, long long ms)
     {
-        struct bsky_view str = bsky_view_of_str(bsky_sb_build(sb));
-        struct bsky_view tmp = bsky_view_to_tmp(str);
+        struct timespec ts = { ms / 1000, (ms % 1000) * 1000000 };
 
-        bsky_da_free(sb);
-        *sb = (struct bsky_str_builder) { 0 };
+        if (l->sleep_ms) l->sleep_ms(ms);
+        else             while (nanosleep(&ts, &ts) != 0);
+    }
 
-        return (struct bsky_str) { tmp.start, tmp.end-1 };
+    // Memory for new bucket, allocated while lock is released.
+    struct __bsky_rate_spare {
+        char *host;
+        struct bsky_rate_bucket *data; size_t cap;
+    };
+
+    static void __bsky_rate_spare_free(struct __bsky_rate_spare *spare)
+    {
+        __bsky_free(spare->host);
+        __bsky_free(spare->data);
     }
 
-    struct bsky_view bsky_view_of_str(struct bsky_str str)
+    // Lock limiter and return bucket of host, NULL if it can't be added.
+    // Lock is released to allocate new bucket, what is left over in
+    // `spare' must be freed after unlocking.
+    static struct bsky_rate_bucket *
+    __bsky_rate_lock_bucket(struct bsky_rate_limiter *l, char *host,
+                            struct __bsky_rate_spare *spare)
     {
-        return (struct bsky_view) { str.start, str.end + 1 };
+        if (host == NULL) host = "";
+
+        for (;;) {
+            __bsky_rate_lock(l);
+
+            struct bsky_rate_bucket_da *da = &l->buckets;
+
+            for (size_t i = 0; i < da->len; ++i) {
+                if (strcmp(da->data[i].host, host) == 0)
+                    return &da->data[i];
+            }
+
+            size_t len = da->len, cap = da->cap;
+
+            if (spare->host != NULL && (len < cap || spare->cap > cap)) {
+                if (len == cap) {
+                    struct bsky_rate_bucket *old = da->data;
+
+                    if (len > 0) memcpy(spare->data, old, len * sizeof *old);
+                    da->data    = spare->data;
+                    da->cap     = spare->cap;
+                    spare->data = old;
+                    spare->cap  = 0;
+                }
+
+                da->data[len] = (struct bsky_rate_bucket) {
+                    .host = spare->host,
+                };
+                spare->host = NULL;
+
+                return &da->data[da->len++];
+            }
+
+            __bsky_rate_unlock(l);
+
+            if (spare->host == NULL) {
+                size_t host_size = strlen(host) + 1;
+
+                spare->host = __bsky_malloc(host_size);
+                if (spare->host == NULL) break;
+                memcpy(spare->host, host, host_size);
+            }
+
+            if (len == cap && spare->cap <= cap) {
+                __bsky_free(spare->data);
+                spare->cap  = cap ? cap * 2 : 4;
+                spare->data = __bsky_malloc(spare->cap * sizeof *spare->data);
+                if (spare->data == NULL) break;
+            }
+        }
+
+        spare->cap = 0;
+        __bsky_rate_lock(l);
+
+        return NULL;
     }
 
-    static int __s_is_whitespace(char c) {
-        return c == ' ' || c == '\n' || c == '\t';
+    // Return time when request may be sent.
+    static long long __bsky_rate_reserve(struct bsky_rate_limiter *l,
+                                         struct bsky_rate_bucket *b,
+                                         long long now)
+    {
+        long long at = now;
+
+        if (b->retry_ms > at) at = b->retry_ms;
+        if (!b->known) return at;
+
+        if (l->pace && b->next_ms > at) at = b->next_ms;
+
+        if (at >= b->reset_ms || b->tokens < 1) {
+            if (at < b->reset_ms) at = b->reset_ms;
+
+            b->tokens   = b->limit;
+            b->reset_ms = at + b->window_ms;
+        }
+
+        if (l->pace) b->next_ms = at + (b->reset_ms - at) / b->tokens;
+
+        b->tokens -= 1;
+
+        return at;
     }
 
-    struct bsky_str bsky_trim_left(struct bsky_str str)
+    void bsky_rate_acquire(struct bsky_rate_limiter *l, char *host)
     {
-        while (str.start != str.end && __s_is_whitespace(*str.start)) {
-            str.start++;
+        struct __bsky_rate_spare spare = { 0 };
+        long long now = __bsky_rate_now(l);
+        long long at  = now;
+
+        // without bucket host is not limited.
+        struct bsky_rate_bucket *b = __bsky_rate_lock_bucket(l, host, &spare);
+
+        if (b != NULL) {
+            at = __bsky_rate_reserve(l, b, now);
+            b->in_flight++;
         }
 
-        return str;
+        if (at > now) {
+            l->waits++;
+            l->waited_ms += at - now;
+        }
+
+        __bsky_rate_unlock(l);
+        __bsky_rate_spare_free(&spare);
+
+        if (at > now) __bsky_rate_sleep(l, at - now);
     }
 
-    int bsky_str_starts_with(struct bsky_str fst, struct bsky_str pref)
+    void bsky_rate_update(struct bsky_rate_limiter *l, char *host,
+                          struct bsky_xrpc_response res)
     {
-        size_t fst_len = bsky_str_len(fst), pref_len = bsky_str_len(pref);
+        struct bsky_str limit     = bsky_xrpc_header(res, "ratelimit-limit");
+        struct bsky_str remaining = bsky_xrpc_header(res,
+                                                     "ratelimit-remaining");
+        struct bsky_str reset     = bsky_xrpc_header(res, "ratelimit-reset");
+        struct bsky_str policy    = bsky_xrpc_header(res, "ratelimit-policy");
+        struct bsky_str retry     = bsky_xrpc_header(res, "retry-after");
+
+        struct __bsky_rate_spare spare = { 0 };
+        long long now = __bsky_rate_now(l);
+
+        struct bsky_rate_bucket *b = __bsky_rate_lock_bucket(l, host, &spare);
+
+        if (res.status == 429) l->throttled++;
+        if (b == NULL) goto defer;
+
+        if (b->in_flight > 0) b->in_flight--;
+
+        int no_reset = limit.start == NULL || remaining.start == NULL ||
+                       reset.start == NULL;
+
+        // `Retry-After' is taken in seconds, HTTP dates fall to backoff.
+        if (res.status == 429 && retry.start != NULL &&
+            *retry.start >= '0' && *retry.start <= '9') {
+            b->retry_ms = now + strtoll(retry.start, NULL, 10) * 1000;
+        } else if (res.status == 429 && no_reset) {
+            b->backoff_ms = b->backoff_ms ? b->backoff_ms * 2
+                                          : BSKY_RATE_RETRY_MIN_MS;
+            if (b->backoff_ms > BSKY_RATE_RETRY_MAX_MS)
+                b->backoff_ms = BSKY_RATE_RETRY_MAX_MS;
+
+            b->retry_ms = now + b->backoff_ms;
+        } else if (res.status != 0 && res.status != 429) {
+            b->backoff_ms = 0;
+        }
 
-        if (fst_len < pref_len) return 0;
+        if (no_reset) goto defer;
 
-        return memcmp(fst.start, pref.start, pref_len) == 0;
+        // server hasn't seen requests which are still in flight.
+        b->known    = 1;
+        b->limit    = strtod(limit.start, NULL);
+        b->tokens   = strtod(remaining.start, NULL) - b->in_flight;
+        b->reset_ms = strtoll(reset.start, NULL, 10) * 1000;
+
+        // policy looks like "3000;w=300".
+        char *window = policy.start ? memchr(policy.start, '=',
+                                             bsky_str_len(policy))
+                                    : NULL;
+
+        if (window != NULL)
+            b->window_ms = strtoll(window + 1, NULL, 10) * 1000;
+        else if (b->window_ms == 0)
+            b->window_ms = b->reset_ms > now ? b->reset_ms - now : 1000;
+
+        if (b->limit < 1) b->limit = 1;
+
+    defer:
+        __bsky_rate_unlock(l);
+        __bsky_rate_spare_free(&spare);
     }
 
-    int bsky_str_ends_with(struct bsky_str fst, struct bsky_str post)
+    void bsky_rate_limiter_free(struct bsky_rate_limiter *l)
     {
-        size_t fst_len = bsky_str_len(fst), post_len = bsky_str_len(post);
+        for (size_t i = 0; i < l->buckets.len; ++i)
+            __bsky_free(l->buckets.data[i].host);
 
-        if (fst_len < post_len) return 0;
+        bsky_da_free(&l->buckets);
+        l->buckets = (struct bsky_rate_bucket_da) { 0 };
+    }
 
-        return memcmp(fst.start + fst_len - post_len,
-                      post.start, post_len) == 0;
+    /*
+     * BSKY SESSION
+     */
+
+    static long long __bsky_session_now(struct bsky_session *s)
+    {
+        if (s->now_ms) return s->now_ms();
+
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+
+        return (long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
     }
 
-    size_t bsky_str_len(struct bsky_str str) {
-        return (str.end - str.start) / sizeof (char);
+    static int __bsky_base64url_value(char c)
+    {
+        if (c >= 'A' && c <= 'Z') return c - 'A';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+        if (c >= '0' && c <= '9') return c - '0' + 52;
+        if (c == '-' || c == '+') return 62;
+        if (c == '_' || c == '/') return 63;
+
+        return -1;
     }
 
-    int bsky_str_eq(struct bsky_str fst, struct bsky_str snd) {
-        return strcmp(fst.start, snd.start) == 0;
+    // Return unix time (ms) of JWT `exp' claim, LLONG_MAX without it.
+    static long long __bsky_jwt_exp_ms(struct bsky_str jwt)
+    {
+        char *payload = memchr(jwt.start, '.', bsky_str_len(jwt));
+        if (payload == NULL) return LLONG_MAX;
+        payload++;
+
+        char *payload_end = memchr(payload, '.', jwt.end - payload);
+        if (payload_end == NULL) return LLONG_MAX;
+
+        size_t len = 0;
+        char  *json = bsky_tmp_alloc((payload_end - payload) * 3 / 4 + 1);
+        if (json == NULL) return LLONG_MAX;
+
+        unsigned int acc = 0; int bits = 0;
+        for (char *c = payload; c < payload_end; ++c) {
+            int v = __bsky_base64url_value(*c);
+            if (v < 0) break;
+
+            acc   = acc << 6 | v;
+            bits += 6;
+
+            if (bits >= 8) {
+                bits -= 8;
+                json[len++] = acc >> bits & 0xff;
+            }
+        }
+        json[len] = '\0';
+
+        struct bsky_str exp = bsky_json_scan_field(
+                                 (struct bsky_str) { json, json + len },
+                                 "exp");
+
+        return exp.start ? strtoll(exp.start, NULL, 10) * 1000 : LLONG_MAX;
     }
 
-    int bsky_str_cmp(struct bsky_str fst, struct bsky_str snd) {
-        size_t fst_len = bsky_str_len(fst), snd_len = bsky_str_len(snd);
+    static struct bsky_session_tokens *
+    __bsky_session_tokens_of(struct bsky_str body)
+    {
+        struct bsky_str fields[] = {
+            bsky_json_scan_field(body, "accessJwt"),
+            bsky_json_scan_field(body, "refreshJwt"),
+            bsky_json_scan_field(body, "did"),
+            bsky_json_scan_field(body, "handle"),
+        };
+        size_t size = sizeof (struct bsky_session_tokens);
 
-        for (int i = 0; i < (fst_len > snd_len ? fst_len : snd_len); ++i) {
-            if (fst.start[i] > snd.start[i]) return  1 + i;
-            if (fst.start[i] < snd.start[i]) return -1 - i;
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(fields); ++i) {
+            if (fields[i].start == NULL) return NULL;
+            size += bsky_str_len(fields[i]) + 1;
         }
 
-        return fst_len > snd_len ?   1 + snd_len :
-               snd_len > fst_len ? - 1 - fst_len :
-               0;
+        struct bsky_session_tokens *tokens = __bsky_malloc(size);
+        if (tokens == NULL) return NULL;
+
+        char  *strs[BSKY_ARRAY_LEN(fields)];
+        char  *data = (char *) (tokens + 1);
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(fields); ++i) {
+            size_t len = bsky_str_len(fields[i]);
+
+            memcpy(data, fields[i].start, len);
+            data[len] = '\0';
+
+            strs[i] = data;
+            data   += len + 1;
+        }
+
+        *tokens = (struct bsky_session_tokens) {
+            .access_jwt  = strs[0], .refresh_jwt = strs[1],
+            .did         = strs[2], .handle      = strs[3],
+            .expires_ms  = __bsky_jwt_exp_ms(fields[0]),
+        };
+
+        return tokens;
     }
 
+    static void __bsky_session_publish(struct bsky_session *s,
+                                       struct bsky_session_tokens *tokens)
+    {
+        struct bsky_session_tokens *old = atomic_load(&s->tokens);
 
-    struct bsky_str bsky_shift_str(struct bsky_str str, size_t n) {
-        if (n > bsky_str_len(str)) {
-            return (struct bsky_str){str.end, str.end};
+        tokens->retired    = old;
+        tokens->generation = old ? old->generation + 1 : 0;
+
+        atomic_store_explicit(&s->tokens, tokens, memory_order_release);
+
+        // keep only the latest retired snapshots.
+        struct bsky_session_tokens *last = tokens;
+        for (size_t i = 0; i < BSKY_SESSION_RETIRED_MAX && last; ++i)
+            last = last->retired;
+
+        if (last != NULL) {
+            struct bsky_session_tokens *retired = last->retired;
+            last->retired = NULL;
+
+            while (retired != NULL) {
+                struct bsky_session_tokens *next = retired->retired;
+
+                __bsky_free(retired);
+                retired = next;
+            }
         }
+    }
+
+    static enum bsky_error_code
+    __bsky_session_request(struct bsky_session *s, char *nsid, char *auth,
+                           struct bsky_str body)
+    {
+        enum bsky_error_code ec;
+        struct bsky_xrpc_response res;
+        struct bsky_xrpc_request req = {
+            .method = bsky_xrpc_Post, .nsid = nsid,
+            .body   = body,           .auth = auth,
+        };
 
+        ec = bsky_xrpc_call(s->client, &req, &res);
+        if (ec != bsky_ec_Ok) return ec;
 
-        return (struct bsky_str) {str.start + n, str.end};
+        struct bsky_session_tokens *tokens =
+            __bsky_session_tokens_of(res.body);
+        if (tokens == NULL) bsky_return_error(bsky_ec_Xrpc_bad_response);
+
+        __bsky_session_publish(s, tokens);
+
+        return bsky_ec_Ok;
     }
 
-    struct bsky_str bsky_mk_str(char *str) {
-        return (struct bsky_str) { str, str + strlen(str) };
+    enum bsky_error_code bsky_session_login(struct bsky_session *s)
+    {
+        struct bsky_str_builder sb = { 0 };
+
+        // both are user input, so they are escaped.
+        bsky_sb_push_str(&sb, bsky_mk_str("{\"identifier\":"));
+        __bsky_sb_push_json_str(&sb, s->identifier);
+        bsky_sb_push_str(&sb, bsky_mk_str(",\"password\":"));
+        __bsky_sb_push_json_str(&sb, s->password);
+        bsky_sb_push(&sb, '}');
+
+        return __bsky_session_request(s, "com.atproto.server.createSession",
+                                      NULL, bsky_sb_build_tmp(&sb));
     }
 
-    struct bsky_str bsky_mk_str(char *str) {
-        return (struct bsky_str) { str, str + strlen(str) };
+    static enum bsky_error_code
+    __bsky_session_refresh(struct bsky_session *s,
+                           struct bsky_session_tokens *old)
+    {
+        enum bsky_error_code ec = bsky_ec_Xrpc_status;
+
+        // tmp arena is not shared between threads, so refresh uses its own.
+        struct bsky_arena  arena = { .cap = BSKY_SESSION_ARENA_CAPACITY };
+        struct bsky_arena *prev  = bsky_tmp_use_arena(&arena);
+
+        atomic_fetch_add(&s->refreshes, 1);
+
+        if (old != NULL)
+            ec = __bsky_session_request(s,
+                                        "com.atproto.server.refreshSession",
+                                        old->refresh_jwt, (struct bsky_str) {0});
+
+        // refresh token has expired too.
+        if (ec != bsky_ec_Ok && s->password != NULL)
+            ec = bsky_session_login(s);
+
+        bsky_tmp_use_arena(prev);
+        bsky_arena_free(&arena);
+
+        return ec;
     }
 
-	/*
-     * BSKY JSON
-     */
-    void bsky_sb_push_json(struct bsky_str_builder *sb, struct bsky_json json)
+    char *bsky_session_token(struct bsky_session *s, enum bsky_error_code *ec)
     {
-        switch (json.var) {
-        case bsky_json_Arr: {
-            bsky_sb_push_fmt(sb, "[");
+        for (;;) {
+            *ec = bsky_ec_Ok;
 
-            for (size_t i = 0; i < json.arr.len; ++i) {
-                bsky_sb_push_json(sb, json.arr.data[i]);
+            struct bsky_session_tokens *tokens =
+                atomic_load_explicit(&s->tokens, memory_order_acquire);
+            long long now = __bsky_session_now(s);
+
+            if (tokens != NULL &&
+                now + BSKY_SESSION_REFRESH_MARGIN_MS < tokens->expires_ms)
+                return tokens->access_jwt;
+
+            // last refresh has failed, wait for backoff deadline.
+            if (now < atomic_load(&s->retry_ms)) {
+                if (tokens != NULL && now < tokens->expires_ms)
+                    return tokens->access_jwt;
 
-                if (i != json.arr.len-1) bsky_sb_push_fmt(sb, ",");
-                else                     bsky_sb_push_fmt(sb, "]");
+                *ec = atomic_load(&s->refresh_ec);
+                return NULL;
             }
-        } break;
-        case bsky_json_Dct: {
-            bsky_sb_push_fmt(sb, "{");
-
-            for (size_t i = 0; i < json.dct.len; ++i) {
-                bsky_sb_push_fmt(sb, "\"%s\":", json.dct.data[i].name);
-                bsky_sb_push_json(sb, json.dct.data[i].value);
 
-                if (i != json.dct.len-1) bsky_sb_push_fmt(sb, ",");
-                else                     bsky_sb_push_fmt(sb, "}");
+            int idle = 0;
+            if (atomic_compare_exchange_strong(&s->refreshing, &idle, 1)) {
+                // someone could have refreshed it while we were checking.
+                if (tokens == atomic_load(&s->tokens) &&
+                    now >= atomic_load(&s->retry_ms)) {
+                    *ec = __bsky_session_refresh(s, tokens);
+
+                    long long backoff = BSKY_SESSION_RETRY_MIN_MS;
+                    for (int i = 0; i < s->failures &&
+                                    backoff < BSKY_SESSION_RETRY_MAX_MS; ++i)
+                        backoff *= 2;
+                    if (backoff > BSKY_SESSION_RETRY_MAX_MS)
+                        backoff = BSKY_SESSION_RETRY_MAX_MS;
+
+                    s->failures = *ec == bsky_ec_Ok ? 0 : s->failures + 1;
+                    atomic_store(&s->refresh_ec, *ec);
+                    atomic_store(&s->retry_ms, *ec == bsky_ec_Ok
+                                               ? 0 : now + backoff);
+                }
+
+                atomic_store(&s->refreshing, 0);
+                continue;
             }
 
-        } break;
-        case bsky_json_Num: {
-            if (fabsl(json.num - (float)(int)json.num) < 0.0001) {
-                bsky_sb_push_fmt(sb, "%d", (int)json.num);
-            } else {
-                bsky_sb_push_fmt(sb, "%f.3",    json.num);
+            // refresh is in progress, old token is still usable.
+            if (tokens != NULL && now < tokens->expires_ms)
+                return tokens->access_jwt;
+
+            while (atomic_load(&s->refreshing) &&
+                   atomic_load(&s->tokens) == tokens)
+                sched_yield();
+
+            // refresh has failed, report its error.
+            if (atomic_load(&s->tokens) == tokens) {
+                *ec = atomic_load(&s->refresh_ec);
+                if (*ec == bsky_ec_Ok) *ec = bsky_ec_Xrpc_status;
+                return NULL;
             }
-        }break;
-        case bsky_json_Str:  bsky_sb_push_fmt(sb, "\"%s\"", json.str); break;
-        case bsky_json_Null: bsky_sb_push_fmt(sb, "null"); break;
-        case bsky_json_Bool: {
-            bsky_sb_push_fmt(sb, "%s", json._bool ? "true" : "false"); 
-        }break;
         }
     }
 
-    struct bsky_str bsky_tmp_str_of_json(struct bsky_json json)
+    enum bsky_error_code bsky_session_call(struct bsky_session *s,
+                                           struct bsky_xrpc_request *req,
+                                           struct bsky_xrpc_response *res)
     {
-        struct bsky_str_builder sb = { 0 };
+        enum bsky_error_code ec;
 
-        bsky_sb_push_json(&sb, json);
+        req->auth = bsky_session_token(s, &ec);
+        if (ec != bsky_ec_Ok) return ec;
 
-        return bsky_sb_build_tmp(&sb);
+        return bsky_xrpc_call(s->client, req, res);
     }
 
-
-    struct bsky_json bsky_parse_json_arr(struct bsky_str *data,
-                                         enum bsky_error_code *ec)
+    void bsky_session_free(struct bsky_session *s)
     {
-        *ec = bsky_ec_Ok;
+        struct bsky_session_tokens *tokens = atomic_load(&s->tokens);
 
-        struct bsky_json_da arr_da = { 0 };
-        struct bsky_json json = { 0 };
+        while (tokens != NULL) {
+            struct bsky_session_tokens *retired = tokens->retired;
 
-        *data = bsky_trim_left(*data);
+            __bsky_free(tokens);
+            tokens = retired;
+        }
 
-        if (*data->start != '[') bsky_defer_ec(bsky_ec_Json_expect_OSB);
+        atomic_store(&s->tokens, NULL);
+    }
 
-        do {
-            *data = bsky_shift_str(*data, 1);
-            *data = bsky_trim_left(*data);
-            if (*data->start == ']') break;
+    /*
+     * BSKY ASYNC LOG
+     */
+    struct bsky_log_record {
+        enum bsky_log_level level;
+        const char *fmt;
+        size_t nargs;
 
-            struct bsky_json elem = bsky_parse_json(data, ec);
-            if (*ec != bsky_ec_Ok) bsky_defer_ec(*ec);
+        struct bsky_log_arg args[BSKY_LOG_MAX_ARGS];
+        char strs[BSKY_LOG_STR_CAPACITY]; // string args, `u' is offset.
+    };
 
-            bsky_da_push(&arr_da, elem);
+    // Single producer (owner thread), single consumer (logger thread).
+    // `head' and `tail' are padded to separate cache lines by hand: ring is
+    // allocated with `__bsky_calloc', which doesn't honour `_Alignas(64)'.
+    struct bsky_log_ring {
+        _Atomic size_t head;
+        char __pad_head[64 - sizeof (size_t)];
+        _Atomic size_t tail;
+        char __pad_tail[64 - sizeof (size_t)];
+        _Atomic size_t dropped;
+        _Atomic int    owned; // 0 after owner thread exits, ring is reused.
+
+        struct bsky_log_ring  *next;
+        struct bsky_log_record records[BSKY_LOG_RING_CAPACITY];
+    };
 
-            *data = bsky_trim_left(*data);
-        } while(*data->start == ',');
+    static _Atomic (struct bsky_log_ring *) __bsky_log_rings;
+    static _Thread_local struct bsky_log_ring *__bsky_log_ring;
 
-        if (*data->start != ']') bsky_defer_ec(bsky_ec_Json_expect_CSB);
+    static pthread_once_t __bsky_log_key_once = PTHREAD_ONCE_INIT;
+    static pthread_key_t  __bsky_log_key;
 
-        *ec = bsky_ec_Ok;
-        *data = bsky_shift_str(*data, 1);
+    static _Atomic int    __bsky_log_state; // 0 stopped, 1 running, 2 stop.
+    static _Atomic size_t __bsky_log_cycles;
+    static _Atomic (FILE *) __bsky_log_out;
+    static pthread_t      __bsky_log_thread;
 
-        struct bsky_view arr = bsky_tmp_view_of_da(&arr_da);
+    // Idle worker parks on condition, producers signal it only if it's
+    // parked, so busy logging doesn't touch the mutex.
+    static pthread_mutex_t __bsky_log_mutex = PTHREAD_MUTEX_INITIALIZER;
+    static pthread_cond_t  __bsky_log_cond  = PTHREAD_COND_INITIALIZER;
+    static _Atomic int     __bsky_log_parked;
 
-        json.var = bsky_json_Arr;
-        json.arr.data = arr.start;
-        json.arr.len  = (arr.end - arr.start) / sizeof (struct bsky_json);
+    struct bsky_log_arg __bsky_log_arg_i(long long v) {
+        return (struct bsky_log_arg) { bsky_log_arg_Int, .i = v };
+    }
 
-    defer:
-        bsky_da_free(&arr_da);
-        return json;
+    struct bsky_log_arg __bsky_log_arg_u(unsigned long long v) {
+        return (struct bsky_log_arg) { bsky_log_arg_Uint, .u = v };
     }
 
+    struct bsky_log_arg __bsky_log_arg_d(long double v) {
+        return (struct bsky_log_arg) { bsky_log_arg_Double, .d = v };
+    }
 
-    struct bsky_json bsky_parse_json_dct(struct bsky_str *data,
-                                         enum bsky_error_code *ec)
-    {
-        *ec = bsky_ec_Ok;
+    struct bsky_log_arg __bsky_log_arg_s(const char *v) {
+        return (struct bsky_log_arg) { bsky_log_arg_Str, .s = v };
+    }
 
-        struct bsky_json_pair_da dct_da = { 0 };
-        struct bsky_json json = { 0 };
+    struct bsky_log_arg __bsky_log_arg_p(const void *v) {
+        return (struct bsky_log_arg) { bsky_log_arg_Ptr, .p = v };
+    }
 
-        *data = bsky_trim_left(*data);
+    // Format one conversion starting at `%' and return pointer after it.
+    static const char *__bsky_log_format_spec(FILE *out, const char *fmt,
+                                              struct bsky_log_record *rec,
+                                              size_t *arg)
+    {
+        char spec[64];
+        size_t len = 0;
 
-        if (*data->start != '{') bsky_defer_ec(bsky_ec_Json_expect_OCB);
+        spec[len++] = *fmt++;
 
-        json.var = bsky_json_Dct;
+        while (*fmt && len < sizeof spec - 8) {
+            char c = *fmt;
 
-        struct bsky_json elem = { 0 };
-        struct bsky_json name = { 0 };
-        struct bsky_json_pair pair = { 0 };
+            if (c == '*') {
+                long long v = *arg < rec->nargs ? rec->args[(*arg)++].i : 0;
+                len += snprintf(spec + len, sizeof spec - 8 - len, "%lld", v);
+            } else if (strchr("hlLqjzt", c) == NULL) {
+                if (strchr("-+ #0123456789.", c) == NULL) break;
+                spec[len++] = c;
+            }
 
-        do {
-            *data = bsky_shift_str(*data, 1);
+            fmt++;
+        }
 
-            name = bsky_parse_json_str(data, ec);
-            if (*ec != bsky_ec_Ok) bsky_defer_ec(*ec);
+        char conv = *fmt;
+        if (conv == '\0') return fmt;
+        fmt++;
 
-            *data = bsky_trim_left(*data);
+        if (conv == '%') {
+            fputc('%', out);
+            return fmt;
+        }
 
-            if (*data->start != ':') bsky_defer_ec(bsky_ec_Json_expect_Colon);
+        if (*arg >= rec->nargs) { // not enough arguments, print as is.
+            fwrite(spec, 1, len, out);
+            fputc(conv, out);
+            return fmt;
+        }
 
-            *data = bsky_shift_str(*data, 1);
+        struct bsky_log_arg *a = &rec->args[(*arg)++];
+
+        switch (conv) {
+        case 'd': case 'i':
+            spec[len++] = 'l'; spec[len++] = 'l'; spec[len++] = conv;
+            spec[len]   = '\0';
+            fprintf(out, spec, a->kind == bsky_log_arg_Double ? (long long) a->d
+                                                              : a->i);
+            break;
+        case 'u': case 'x': case 'X': case 'o':
+            spec[len++] = 'l'; spec[len++] = 'l'; spec[len++] = conv;
+            spec[len]   = '\0';
+            fprintf(out, spec, a->u);
+            break;
+        case 'c':
+            spec[len++] = conv; spec[len] = '\0';
+            fprintf(out, spec, (int) a->i);
+            break;
+        case 'f': case 'F': case 'e': case 'E':
+        case 'g': case 'G': case 'a': case 'A':
+            spec[len++] = conv; spec[len] = '\0';
+            fprintf(out, spec, a->kind == bsky_log_arg_Double ? a->d
+                                                              : (double) a->i);
+            break;
+        case 's':
+            spec[len++] = conv; spec[len] = '\0';
+            fprintf(out, spec, a->kind == bsky_log_arg_Str ? rec->strs + a->u
+                                                           : "(?)");
+            break;
+        default:
+            spec[len++] = 'p'; spec[len] = '\0';
+            fprintf(out, spec, a->p);
+        }
 
-            elem = bsky_parse_json(data, ec);
+        return fmt;
+    }
 
-            if (*ec != bsky_ec_Ok) bsky_defer_ec(*ec);
+    static void __bsky_log_format(FILE *out, struct bsky_log_record *rec)
+    {
+        const char *fmt = rec->fmt;
+        size_t arg = 0;
+
+        switch (rec->level) {
+        case bsky_log_None:    return;
+        case bsky_log_Error:   fputs("\x1b[31m[ERR]: `", out); break;
+        case bsky_log_Warning: fputs("\x1b[33m[WAR]: `", out); break;
+        case bsky_log_Info:    fputs("[INF]: `", out);         break;
+        }
 
-            pair.name  = name.str;
-            pair.value = elem;
-            bsky_da_push(&dct_da, pair);
+        while (*fmt) {
+            const char *pct = strchr(fmt, '%');
+            if (pct == NULL) pct = fmt + strlen(fmt);
 
-            *data = bsky_trim_left(*data);
-        } while(*data->start == ',');
+            fwrite(fmt, 1, pct - fmt, out);
+            fmt = *pct ? __bsky_log_format_spec(out, pct, rec, &arg) : pct;
+        }
 
-        if (*data->start != '}') bsky_defer_ec(bsky_ec_Json_expect_CCB);
+        fputs(rec->level == bsky_log_Info ? "'\n" : "'\n\x1b[0m", out);
+    }
 
-        *data = bsky_shift_str(*data, 1);
+    static size_t __bsky_log_drain(FILE *out)
+    {
+        size_t drained = 0;
+
+        for (struct bsky_log_ring *ring = atomic_load(&__bsky_log_rings);
+             ring != NULL; ring = ring->next) {
+            size_t tail = atomic_load_explicit(&ring->tail,
+                                               memory_order_relaxed);
+            size_t head = atomic_load_explicit(&ring->head,
+                                               memory_order_acquire);
+
+            for (; tail != head; ++tail, ++drained) {
+                __bsky_log_format(out, &ring->records[
+                                           tail & (BSKY_LOG_RING_CAPACITY-1)]);
+                atomic_store_explicit(&ring->tail, tail + 1,
+                                      memory_order_release);
+            }
+        }
 
-        struct bsky_view dct = bsky_tmp_view_of_da(&dct_da);
+        return drained;
+    }
 
-        json.dct.data = dct.start;
-        json.dct.len  = (dct.end - dct.start) / sizeof (struct bsky_json_pair);
+    static int __bsky_log_pending(void)
+    {
+        for (struct bsky_log_ring *ring = atomic_load(&__bsky_log_rings);
+             ring != NULL; ring = ring->next) {
+            if (atomic_load(&ring->head) != atomic_load(&ring->tail))
+                return 1;
+        }
 
-    defer:
-        bsky_da_free(&dct_da);
-        return json;
+        return 0;
     }
 
-    struct bsky_json bsky_parse_json_str(struct bsky_str *data,
-                                         enum bsky_error_code *ec)
+    static void __bsky_log_wake(void)
     {
-        *ec = bsky_ec_Ok;
+        if (!atomic_load(&__bsky_log_parked)) return;
 
-        struct bsky_str_builder sb = { 0 };
-        struct bsky_json json = { 0 };
+        pthread_mutex_lock(&__bsky_log_mutex);
+        pthread_cond_signal(&__bsky_log_cond);
+        pthread_mutex_unlock(&__bsky_log_mutex);
+    }
 
-        *data = bsky_trim_left(*data);
+    // `parked' is set before rings are checked again and producers check
+    // it after publishing record, so one of them sees the other.
+    static void __bsky_log_park(void)
+    {
+        pthread_mutex_lock(&__bsky_log_mutex);
+        atomic_store(&__bsky_log_parked, 1);
 
-        if (*data->start != '"') bsky_defer_ec(bsky_ec_Json_expect_OQ);
+        if (!__bsky_log_pending() && atomic_load(&__bsky_log_state) == 1)
+            pthread_cond_wait(&__bsky_log_cond, &__bsky_log_mutex);
 
-        *data = bsky_shift_str(*data, 1);
+        atomic_store(&__bsky_log_parked, 0);
+        pthread_mutex_unlock(&__bsky_log_mutex);
+    }
 
-        char *end = data->start;
+    static void *__bsky_log_worker(void *arg)
+    {
+        size_t idle = 0;
+        (void) arg;
+
+        for (;;) {
+            FILE *out = atomic_load(&__bsky_log_out);
+            if (out == NULL) out = stdout;
+
+            int stop = atomic_load(&__bsky_log_state) == 2;
+
+            if (__bsky_log_drain(out) != 0) {
+                fflush(out);
+                idle = 0;
+            } else if (stop) {
+                break;
+            } else if (idle++ < BSKY_LOG_IDLE_SPINS) {
+                sched_yield(); // burst may continue, don't pay for wake up.
+            } else {
+                __bsky_log_park();
+                idle = 0;
+            }
 
-        while (end < data->end && *end != '"') {
-            if (*end == '\\' && end+1 != data->end) end++;
-            end++;
+            atomic_fetch_add(&__bsky_log_cycles, 1);
         }
 
-        bsky_sb_push_str(&sb, (struct bsky_str) { data->start, end });
-        data->start = end;
+        atomic_fetch_add(&__bsky_log_cycles, 1);
+        return NULL;
+    }
 
-        if (end >= data->end) bsky_defer_ec(bsky_ec_Json_expect_CQ);
+    static void __bsky_log_start(void)
+    {
+        int stopped = 0;
 
-        data->start++;
+        if (atomic_compare_exchange_strong(&__bsky_log_state, &stopped, 1) &&
+            pthread_create(&__bsky_log_thread, NULL, __bsky_log_worker,
+                           NULL) != 0)
+            atomic_store(&__bsky_log_state, 0);
+    }
+
+    // Thread exit: records left in the ring are still drained by worker,
+    // next registered thread continues from its head.
+    static void __bsky_log_ring_release(void *arg)
+    {
+        struct bsky_log_ring *ring = arg;
 
+        __bsky_log_ring = NULL;
+        atomic_store(&ring->owned, 0);
+    }
+
+    static void __bsky_log_key_init(void)
+    {
+        pthread_key_create(&__bsky_log_key, __bsky_log_ring_release);
+    }
 
+    static struct bsky_log_ring *__bsky_log_ring_register(void)
+    {
+        struct bsky_log_ring *ring;
 
-        struct bsky_str str = bsky_sb_build_tmp(&sb);
+        pthread_once(&__bsky_log_key_once, __bsky_log_key_init);
 
-        json.var = bsky_json_Str;
-        json.str = str.start;
+        // reuse ring of exited thread.
+        for (ring = atomic_load(&__bsky_log_rings); ring != NULL;
+             ring = ring->next) {
+            int owned = 0;
 
-    defer:
-        bsky_da_free(&sb);
-        return json;
+            if (atomic_compare_exchange_strong(&ring->owned, &owned, 1))
+                break;
+        }
+
+        if (ring == NULL) {
+            ring = __bsky_calloc(1, sizeof (*ring));
+            if (ring == NULL) return NULL;
+
+            ring->owned = 1;
+            ring->next  = atomic_load(&__bsky_log_rings);
+            while (!atomic_compare_exchange_weak(&__bsky_log_rings,
+                                                 &ring->next, ring));
+        }
+
+        pthread_setspecific(__bsky_log_key, ring);
+        return __bsky_log_ring = ring;
     }
 
-    struct bsky_json bsky_parse_json_num(struct bsky_str *data,
-                                         enum bsky_error_code *ec)
+    void bsky_log_async_push(enum bsky_log_level level, const char *fmt,
+                             size_t nargs, const struct bsky_log_arg *args)
     {
-        *ec = bsky_ec_Ok;
+        struct bsky_log_ring *ring = __bsky_log_ring;
 
-        struct bsky_json json = { 0 };
+        if (ring == NULL && (ring = __bsky_log_ring_register()) == NULL)
+            return;
 
-        *data = bsky_trim_left(*data);
+        if (atomic_load_explicit(&__bsky_log_state,
+                                 memory_order_relaxed) != 1)
+            __bsky_log_start();
 
-        char *endptr = NULL;
-        long double v = strtold(data->start, &endptr);
+        size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
 
-        if (endptr == data->start) bsky_defer_ec(bsky_ec_Json_expect_Number);
+        if (head - tail >= BSKY_LOG_RING_CAPACITY) {
+            atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+            return;
+        }
 
-        data->start = endptr;
+        struct bsky_log_record *rec =
+            &ring->records[head & (BSKY_LOG_RING_CAPACITY - 1)];
+        size_t strs = 0;
 
-        json.var = bsky_json_Num;
-        json.num = v;
+        rec->level = level;
+        rec->fmt   = fmt;
+        rec->nargs = nargs < BSKY_LOG_MAX_ARGS ? nargs : BSKY_LOG_MAX_ARGS;
 
-    defer:
-        return json;
+        for (size_t i = 0; i < rec->nargs; ++i) {
+            rec->args[i] = args[i];
+
+            if (args[i].kind != bsky_log_arg_Str) continue;
+
+            const char *str = args[i].s ? args[i].s : "(null)";
+            size_t len = strnlen(str, BSKY_LOG_STR_CAPACITY - strs - 1);
+
+            memcpy(rec->strs + strs, str, len);
+            rec->strs[strs + len] = '\0';
+
+            rec->args[i].u = strs;
+            strs += len + (strs + len + 1 < BSKY_LOG_STR_CAPACITY);
+        }
+
+        atomic_store(&ring->head, head + 1);
+        __bsky_log_wake();
     }
 
-    struct bsky_json bsky_parse_json_null(struct bsky_str *data,
-                                          enum bsky_error_code *ec)
+    void bsky_log_async_flush(void)
     {
-        *ec = bsky_ec_Ok;
+        if (atomic_load(&__bsky_log_state) == 0) return;
 
-        struct bsky_json json = { 0 };
+        for (struct bsky_log_ring *ring = atomic_load(&__bsky_log_rings);
+             ring != NULL; ring = ring->next) {
+            size_t head = atomic_load(&ring->head);
 
-        *data = bsky_trim_left(*data);
+            while ((ptrdiff_t) (head - atomic_load(&ring->tail)) > 0)
+                sched_yield();
+        }
 
-        if (!bsky_str_starts_with(*data, bsky_mk_str("null")))
-            bsky_defer_ec(bsky_ec_Json_expect_Null);
+        // wait till worker passes its `fflush'.
+        size_t cycles = atomic_load(&__bsky_log_cycles);
+        while (atomic_load(&__bsky_log_cycles) - cycles < 2 &&
+               atomic_load(&__bsky_log_state) != 0) {
+            __bsky_log_wake();
+            sched_yield();
+        }
+    }
 
-        json.var = bsky_json_Null;
+    void bsky_log_async_stop(void)
+    {
+        int running = 1;
 
-        data->start += 4;
+        if (!atomic_compare_exchange_strong(&__bsky_log_state, &running, 2))
+            return;
 
-	defer:
-        return json;
+        __bsky_log_wake();
+        pthread_join(__bsky_log_thread, NULL);
+        atomic_store(&__bsky_log_state, 0);
     }
 
-    struct bsky_json bsky_parse_json_bool(struct bsky_str *data,
-                                          enum bsky_error_code *ec)
+    void bsky_log_async_output(FILE *out)
     {
-        *ec = bsky_ec_Ok;
+        bsky_log_async_flush();
+        atomic_store(&__bsky_log_out, out);
+    }
 
-        struct bsky_json json = { 0 };
+    size_t bsky_log_async_dropped(void)
+    {
+        size_t dropped = 0;
 
-        *data = bsky_trim_left(*data);
+        for (struct bsky_log_ring *ring = atomic_load(&__bsky_log_rings);
+             ring != NULL; ring = ring->next)
+            dropped += atomic_load(&ring->dropped);
 
-        json.var = bsky_json_Bool;
+        return dropped;
+    }
 
-        if (bsky_str_starts_with(*data, bsky_mk_str("false"))) {
-            data->start += 5;
-            json._bool = 0;
+    /*
+     * BSKY INSTRUMENTATION
+     */
+    struct __bsky_probe_stats {
+        _Atomic unsigned long long count, ticks, bytes;
+        _Atomic unsigned long long hist[BSKY_PROBE_BUCKETS];
+    };
 
-        } else if (bsky_str_starts_with(*data, bsky_mk_str("true"))) {
-            data->start += 4;
-            json._bool = 1;
+    struct __bsky_probe_block {
+        struct __bsky_probe_stats stats[bsky_probe_Count];
+        struct __bsky_probe_block *next;
+    };
 
-        } else {
-            bsky_defer_ec(bsky_ec_Json_expect_Bool);
+    _Thread_local int __bsky_probe_depth[bsky_probe_Count];
+
+    static _Thread_local struct __bsky_probe_block *__bsky_probe_local;
+    static _Atomic (struct __bsky_probe_block *) __bsky_probe_blocks;
+
+    #if defined(BSKY_INSTRUMENT) && !defined(__x86_64__) && !defined(__i386__)
+        unsigned long long __bsky_probe_clock_ns(void)
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+
+            return (unsigned long long) ts.tv_sec * 1000000000ull + ts.tv_nsec;
         }
+    #endif
 
-    defer:
-        return json;
+    // Blocks are never freed: thread may exit, but its counters stay in
+    // snapshot.
+    static struct __bsky_probe_block *__bsky_probe_register(void)
+    {
+        struct __bsky_probe_block *block = __bsky_calloc(1, sizeof *block);
+        if (block == NULL) return NULL;
+
+        block->next = atomic_load(&__bsky_probe_blocks);
+        while (!atomic_compare_exchange_weak(&__bsky_probe_blocks,
+                                             &block->next, block));
+
+        return __bsky_probe_local = block;
     }
 
-    struct bsky_json bsky_parse_json(struct bsky_str *data,
-                                     enum bsky_error_code* ec)
+    // Counter has single writer, so plain load and store is enough.
+    static void __bsky_probe_add(_Atomic unsigned long long *counter,
+                                 unsigned long long value)
     {
-        *ec = bsky_ec_Ok;
-        struct bsky_json json = { 0 };
+        atomic_store_explicit(counter,
+            atomic_load_explicit(counter, memory_order_relaxed) + value,
+            memory_order_relaxed);
+    }
 
-        *data = bsky_trim_left(*data);
-        struct bsky_str data_s = *data;
+    void __bsky_probe_record(enum bsky_probe_kind kind,
+                             unsigned long long ticks, size_t bytes)
+    {
+        struct __bsky_probe_block *block = __bsky_probe_local;
 
-        json = bsky_parse_json_null(data, ec);
-        if (*ec != bsky_ec_Json_expect_Null) return json;
+        if (block == NULL && (block = __bsky_probe_register()) == NULL)
+            return;
 
-        *data = data_s;
-        json = bsky_parse_json_bool(data, ec);
-        if (*ec != bsky_ec_Json_expect_Bool) return json;
+        struct __bsky_probe_stats *stats = &block->stats[kind];
 
-        *data = data_s;
-        json = bsky_parse_json_num(data, ec);
-        if (*ec != bsky_ec_Json_expect_Number) return json;
+        size_t bucket = ticks ? 64 - __builtin_clzll(ticks) : 0;
+        if (bucket >= BSKY_PROBE_BUCKETS) bucket = BSKY_PROBE_BUCKETS - 1;
 
-        *data = data_s;
-        json = bsky_parse_json_str(data, ec);
-        if (*ec != bsky_ec_Json_expect_OQ) return json;
+        __bsky_probe_add(&stats->count, 1);
+        __bsky_probe_add(&stats->ticks, ticks);
+        __bsky_probe_add(&stats->bytes, bytes);
+        __bsky_probe_add(&stats->hist[bucket], 1);
+    }
 
-        *data = data_s;
-        json = bsky_parse_json_arr(data, ec);
-        if (*ec != bsky_ec_Json_expect_OSB) return json;
+    const char *bsky_str_of_probe_kind(enum bsky_probe_kind kind)
+    {
+        switch (kind) {
+        case bsky_probe_Parse_json:   return "parse_json";
+        case bsky_probe_Sb_push_json: return "sb_push_json";
+        case bsky_probe_Da_realloc:   return "da_realloc";
+        case bsky_probe_Tmp_alloc:    return "tmp_alloc";
+        case bsky_probe_Tmp_overflow: return "tmp_overflow";
+        case bsky_probe_Count:        break;
+        }
 
-        *data = data_s;
-        json = bsky_parse_json_dct(data, ec);
-        if (*ec != bsky_ec_Json_expect_OCB) return json;
+        return "unknown";
+    }
 
-        *ec = bsky_ec_Json_invalid_variant;
+    static struct bsky_json __bsky_probe_num(long double num) {
+        return (struct bsky_json) { .var = bsky_json_Num, .num = num };
+    }
 
-    defer:
-        return json;
+    struct bsky_json bsky_probe_snapshot(void)
+    {
+        struct bsky_json json = { .var = bsky_json_Null };
+
+        size_t fields = 3 + bsky_probe_Count;
+        struct bsky_json_pair *pairs =
+            bsky_tmp_alloc(fields * sizeof(struct bsky_json_pair));
+        if (pairs == NULL) return json;
+
+        size_t threads = 0;
+        struct __bsky_probe_block *blocks = atomic_load(&__bsky_probe_blocks);
+        for (struct __bsky_probe_block *b = blocks; b != NULL; b = b->next)
+            threads++;
+
+        #ifdef BSKY_INSTRUMENT
+            int enabled = 1;
+        #else
+            int enabled = 0;
+        #endif
+
+        pairs[0] = (struct bsky_json_pair) { "enabled",
+            { .var = bsky_json_Bool, ._bool = enabled } };
+        pairs[1] = (struct bsky_json_pair) { "unit",
+            { .var = bsky_json_Str, .str = BSKY_PROBE_UNIT } };
+        pairs[2] = (struct bsky_json_pair) { "threads",
+            __bsky_probe_num(threads) };
+
+        for (size_t kind = 0; kind < bsky_probe_Count; ++kind) {
+            struct bsky_json_pair *stat =
+                bsky_tmp_alloc(4 * sizeof(struct bsky_json_pair));
+            struct bsky_json *hist =
+                bsky_tmp_alloc(BSKY_PROBE_BUCKETS * sizeof(struct bsky_json));
+            if (stat == NULL || hist == NULL) return json;
+
+            unsigned long long count = 0, ticks = 0, bytes = 0;
+            for (size_t i = 0; i < BSKY_PROBE_BUCKETS; ++i)
+                hist[i] = __bsky_probe_num(0);
+
+            for (struct __bsky_probe_block *b = blocks; b; b = b->next) {
+                struct __bsky_probe_stats *s = &b->stats[kind];
+
+                count += atomic_load_explicit(&s->count, memory_order_relaxed);
+                ticks += atomic_load_explicit(&s->ticks, memory_order_relaxed);
+                bytes += atomic_load_explicit(&s->bytes, memory_order_relaxed);
+
+                for (size_t i = 0; i < BSKY_PROBE_BUCKETS; ++i)
+                    hist[i].num += atomic_load_explicit(&s->hist[i],
+                                                        memory_order_relaxed);
+            }
+
+            stat[0] = (struct bsky_json_pair) { "count", __bsky_probe_num(count) };
+            stat[1] = (struct bsky_json_pair) { "ticks", __bsky_probe_num(ticks) };
+            stat[2] = (struct bsky_json_pair) { "bytes", __bsky_probe_num(bytes) };
+            stat[3] = (struct bsky_json_pair) { "hist",
+                { .var = bsky_json_Arr,
+                  .arr = { hist, BSKY_PROBE_BUCKETS } } };
+
+            pairs[3 + kind] = (struct bsky_json_pair) {
+                (char *) bsky_str_of_probe_kind(kind),
+                { .var = bsky_json_Dct, .dct = { stat, 4 } } };
+        }
+
+        return (struct bsky_json) {
+            .var = bsky_json_Dct, .dct = { pairs, fields } };
     }
 
+    void bsky_probe_reset(void)
+    {
+        struct __bsky_probe_block *b = atomic_load(&__bsky_probe_blocks);
+
+        for (; b != NULL; b = b->next) {
+            for (size_t kind = 0; kind < bsky_probe_Count; ++kind) {
+                struct __bsky_probe_stats *s = &b->stats[kind];
+
+                atomic_store_explicit(&s->count, 0, memory_order_relaxed);
+                atomic_store_explicit(&s->ticks, 0, memory_order_relaxed);
+                atomic_store_explicit(&s->bytes, 0, memory_order_relaxed);
+                for (size_t i = 0; i < BSKY_PROBE_BUCKETS; ++i)
+                    atomic_store_explicit(&s->hist[i], 0, memory_order_relaxed);
+            }
+        }
+    }
 
 #endif
 
@@ -1122,6 +12419,41 @@
     #define ec_Json_expect_CQ       bsky_ec_Json_expect_CQ
     #define ec_Json_expect_Colon    bsky_ec_Json_expect_Colon
     #define ec_Json_invalid_variant bsky_ec_Json_invalid_variant
+    #define ec_Json_control_char    bsky_ec_Json_control_char
+    #define ec_Json_invalid_escape  bsky_ec_Json_invalid_escape
+    #define ec_Json_invalid_utf8    bsky_ec_Json_invalid_utf8
+    #define ec_Json_path_invalid    bsky_ec_Json_path_invalid
+    #define ec_Json_too_deep        bsky_ec_Json_too_deep
+    #define ec_Json_path_not_found  bsky_ec_Json_path_not_found
+    #define ec_Json_edit_conflict   bsky_ec_Json_edit_conflict
+    #define ec_Json_not_canonical   bsky_ec_Json_not_canonical
+
+    #define ec_At_uri_scheme        bsky_ec_At_uri_scheme
+    #define ec_At_uri_authority     bsky_ec_At_uri_authority
+    #define ec_At_uri_collection    bsky_ec_At_uri_collection
+    #define ec_At_uri_rkey          bsky_ec_At_uri_rkey
+
+    #define ec_Cid_multibase        bsky_ec_Cid_multibase
+    #define ec_Cid_invalid          bsky_ec_Cid_invalid
+    #define ec_Cid_unsupported      bsky_ec_Cid_unsupported
+    #define ec_Cbor_truncated       bsky_ec_Cbor_truncated
+    #define ec_Cbor_invalid         bsky_ec_Cbor_invalid
+    #define ec_Cbor_unsupported     bsky_ec_Cbor_unsupported
+    #define ec_Block_not_found      bsky_ec_Block_not_found
+    #define ec_Block_mismatch       bsky_ec_Block_mismatch
+    #define ec_Car_invalid          bsky_ec_Car_invalid
+    #define ec_Block_file_io        bsky_ec_Block_file_io
+    #define ec_Mst_invalid_node     bsky_ec_Mst_invalid_node
+    #define ec_Mst_unsorted_keys    bsky_ec_Mst_unsorted_keys
+    #define ec_Repo_invalid_commit  bsky_ec_Repo_invalid_commit
+    #define ec_Backfill_io          bsky_ec_Backfill_io
+    #define ec_Key_invalid          bsky_ec_Key_invalid
+    #define ec_Key_unsupported      bsky_ec_Key_unsupported
+    #define ec_Key_no_secret        bsky_ec_Key_no_secret
+    #define ec_Sig_invalid          bsky_ec_Sig_invalid
+    #define ec_Xrpc_transport       bsky_ec_Xrpc_transport
+    #define ec_Xrpc_status          bsky_ec_Xrpc_status
+    #define ec_Xrpc_bad_response    bsky_ec_Xrpc_bad_response
 
     #define str_of_error_code(ec)     bsky_str_of_error_code(ec)
     #define log_error(ec)             bsky_log_error(ec)
@@ -1134,6 +12466,10 @@
      */
     #define tmp_alloc(size) bsky_tmp_alloc(size)
     #define default_tmp_reset() bsky_default_tmp_reset()
+    #define arena_alloc(arena, size) bsky_arena_alloc(arena, size)
+    #define arena_reset(arena) bsky_arena_reset(arena)
+    #define arena_free(arena) bsky_arena_free(arena)
+    #define tmp_use_arena(arena) bsky_tmp_use_arena(arena)
 
     /*
      * BSKY DYNAMIC ARRAY
@@ -1170,8 +12506,165 @@
     #define str_ends_with(fst, snd) bsky_str_ends_with(fst, snd)
     #define str_eq(fst, snd) bsky_str_eq(fst, snd)
     #define str_cmp(fst, snd) bsky_str_cmp(fst, snd)
-    #define str_len(str) str_len(str)
+    #define str_len(str) bsky_str_len(str)
     #define shift_str(str, n) bsky_shift_str(str, n)
+    #define str_hash(str, seed) bsky_str_hash(str, seed)
+    #define str_find_char(str, c) bsky_str_find_char(str, c)
+    #define str_find(str, sub) bsky_str_find(str, sub)
+    #define str_split(rest, sep) bsky_str_split(rest, sep)
+
+    /*
+     * BSKY UTF-8
+     */
+    #define utf8_valid(str) bsky_utf8_valid(str)
+    #define utf8_graphemes(str) bsky_utf8_graphemes(str)
+    #define utf8_grapheme_offset(str, n) bsky_utf8_grapheme_offset(str, n)
+    #define utf8_slice(str, start, end) bsky_utf8_slice(str, start, end)
+
+    /*
+     * BSKY IDENTIFIERS
+     */
+    #define did_valid(str) bsky_did_valid(str)
+    #define handle_valid(str) bsky_handle_valid(str)
+    #define nsid_valid(str) bsky_nsid_valid(str)
+    #define rkey_valid(str) bsky_rkey_valid(str)
+    #define tid_valid(str) bsky_tid_valid(str)
+    #define tid_timestamp(str, clock_id) bsky_tid_timestamp(str, clock_id)
+    #define tid_of_timestamp(buf, ts, clock_id) \
+                bsky_tid_of_timestamp(buf, ts, clock_id)
+    #define parse_at_uri(str, ec) bsky_parse_at_uri(str, ec)
+    #define did_key_pack(str, key) bsky_did_key_pack(str, key)
+    #define did_key_unpack(buf, key) bsky_did_key_unpack(buf, key)
+    #define did_key_cmp(fst, snd) bsky_did_key_cmp(fst, snd)
+    #define did_key_hash(key) bsky_did_key_hash(key)
+    #define tid_key_pack(str, key) bsky_tid_key_pack(str, key)
+    #define tid_key_unpack(buf, key) bsky_tid_key_unpack(buf, key)
+    #define tid_key_hash(key) bsky_tid_key_hash(key)
+
+    #define At_Uri bsky_At_Uri
+
+    /*
+     * BSKY CID
+     */
+    #define cid_Raw      bsky_cid_Raw
+    #define cid_Dag_cbor bsky_cid_Dag_cbor
+
+    #define sha256_init(sha) bsky_sha256_init(sha)
+    #define sha256_update(sha, data, len) bsky_sha256_update(sha, data, len)
+    #define sha256_final(sha, digest) bsky_sha256_final(sha, digest)
+    #define sha256(data, len, digest) bsky_sha256(data, len, digest)
+    #define sha256_backend() bsky_sha256_backend()
+    #define cid_of_block(codec, block) bsky_cid_of_block(codec, block)
+    #define cid_batch(codec, blocks, len, cids) \
+                bsky_cid_batch(codec, blocks, len, cids)
+    #define cid_verify(cid, block) bsky_cid_verify(cid, block)
+    #define cid_eq(fst, snd) bsky_cid_eq(fst, snd)
+    #define parse_cid(str, ec) bsky_parse_cid(str, ec)
+    #define cid_format(buf, cid) bsky_cid_format(buf, cid)
+    #define parse_cid_bytes(view, ec) bsky_parse_cid_bytes(view, ec)
+    #define cid_to_bytes(buf, cid) bsky_cid_to_bytes(buf, cid)
+
+    /*
+     * BSKY DAG-CBOR
+     */
+    #define cbor_Int   bsky_cbor_Int
+    #define cbor_Bytes bsky_cbor_Bytes
+    #define cbor_Text  bsky_cbor_Text
+    #define cbor_Arr   bsky_cbor_Arr
+    #define cbor_Map   bsky_cbor_Map
+    #define cbor_Link  bsky_cbor_Link
+    #define cbor_Bool  bsky_cbor_Bool
+    #define cbor_Null  bsky_cbor_Null
+    #define cbor_Float bsky_cbor_Float
+
+    #define cbor_read(data, ec) bsky_cbor_read(data, ec)
+    #define cbor_skip(data, ec) bsky_cbor_skip(data, ec)
+    #define cbor_push_int(buf, value) bsky_cbor_push_int(buf, value)
+    #define cbor_push_bytes(buf, bytes) bsky_cbor_push_bytes(buf, bytes)
+    #define cbor_push_text(buf, text) bsky_cbor_push_text(buf, text)
+    #define cbor_push_link(buf, cid) bsky_cbor_push_link(buf, cid)
+    #define cbor_push_bool(buf, value) bsky_cbor_push_bool(buf, value)
+    #define cbor_push_null(buf) bsky_cbor_push_null(buf)
+    #define cbor_push_arr(buf, len) bsky_cbor_push_arr(buf, len)
+    #define cbor_push_map(buf, len) bsky_cbor_push_map(buf, len)
+
+    /*
+     * BSKY BLOCKS
+     */
+    #define block_map_get(map, cid, block) bsky_block_map_get(map, cid, block)
+    #define block_map_put(map, cid, block) bsky_block_map_put(map, cid, block)
+    #define block_map_store(map) bsky_block_map_store(map)
+    #define block_map_reset(map) bsky_block_map_reset(map)
+    #define block_map_free(map) bsky_block_map_free(map)
+    #define car_open(data, ec) bsky_car_open(data, ec)
+    #define car_next(car, cid, block, ec) bsky_car_next(car, cid, block, ec)
+    #define car_load(car, store, verify) bsky_car_load(car, store, verify)
+    #define car_push_header(buf, root) bsky_car_push_header(buf, root)
+    #define car_push_block(buf, cid, block) bsky_car_push_block(buf, cid, block)
+
+    #define block_file_open(path, ec) bsky_block_file_open(path, ec)
+    #define block_file_get(file, cid, block) bsky_block_file_get(file, cid, block)
+    #define block_file_put(file, cid, block) bsky_block_file_put(file, cid, block)
+    #define block_file_flush(file) bsky_block_file_flush(file)
+    #define block_file_compact(file, keep, ctx) \
+                bsky_block_file_compact(file, keep, ctx)
+    #define block_file_store(file) bsky_block_file_store(file)
+    #define block_file_len(file) bsky_block_file_len(file)
+    #define block_file_close(file) bsky_block_file_close(file)
+
+    /*
+     * BSKY MERKLE SEARCH TREE
+     */
+    #define mst_Create bsky_mst_Create
+    #define mst_Update bsky_mst_Update
+    #define mst_Delete bsky_mst_Delete
+
+    #define mst_iter_init(store, root) bsky_mst_iter_init(store, root)
+    #define mst_next(iter, entry, ec) bsky_mst_next(iter, entry, ec)
+    #define mst_iter_free(iter) bsky_mst_iter_free(iter)
+    #define mst_get(store, root, key, value, ec) \
+                bsky_mst_get(store, root, key, value, ec)
+    #define mst_diff(store, from, to, fn, ctx, loaded) \
+                bsky_mst_diff(store, from, to, fn, ctx, loaded)
+    #define mst_build(store, entries, len, ec) \
+                bsky_mst_build(store, entries, len, ec)
+    #define mst_key_layer(key) bsky_mst_key_layer(key)
+
+    #define Mst_Entry bsky_Mst_Entry
+
+    /*
+     * BSKY REPOSITORY
+     */
+    #define parse_commit(block, ec) bsky_parse_commit(block, ec)
+    #define cbor_push_commit(buf, commit) bsky_cbor_push_commit(buf, commit)
+    #define backfill_run(backfill, stats) bsky_backfill_run(backfill, stats)
+
+    #define Commit bsky_Commit
+
+    /*
+     * BSKY SIGNATURES
+     */
+    #define key_Secp256k1 bsky_key_Secp256k1
+    #define key_P256      bsky_key_P256
+
+    #define key_parse_did(str, ec) bsky_key_parse_did(str, ec)
+    #define key_format_did(buf, key) bsky_key_format_did(buf, key)
+    #define key_of_secret(curve, secret, ec) \
+                bsky_key_of_secret(curve, secret, ec)
+    #define key_sign(key, digest, sig) bsky_key_sign(key, digest, sig)
+    #define key_verify(key, digest, sig) bsky_key_verify(key, digest, sig)
+    #define sig_verify_batch(checks, len) bsky_sig_verify_batch(checks, len)
+    #define commit_digest(commit, digest) bsky_commit_digest(commit, digest)
+    #define commit_sign(commit, key, sig) bsky_commit_sign(commit, key, sig)
+    #define commit_verify(commit, key) bsky_commit_verify(commit, key)
+    #define key_cache_get(cache, did) bsky_key_cache_get(cache, did)
+    #define key_cache_put(cache, did, did_key, ec) \
+                bsky_key_cache_put(cache, did, did_key, ec)
+    #define key_cache_free(cache) bsky_key_cache_free(cache)
+
+    #define Key       bsky_Key
+    #define Key_Cache bsky_Key_Cache
+    #define Sig_Check bsky_Sig_Check
 
     /*
      * BSKY JSON
@@ -1194,9 +12687,130 @@
     #define parse_json_bool(str, ec) bsky_parse_json_bool(str, ec)
     #define parse_json_null(str, ec) bsky_parse_json_null(str, ec)
 
+    #define json_batch_parse(batch, docs, len) \
+        bsky_json_batch_parse(batch, docs, len)
+    #define json_batch_free(batch) bsky_json_batch_free(batch)
+
     #define Json      bsky_Json;
     #define Json_Pair bsky_Json_Pair;
 
+    #define json_dct_get(json, key) bsky_json_dct_get(json, key)
+
+    #define Json_Node bsky_Json_Node
+
+    #define parse_json_compact(str, ec) bsky_parse_json_compact(str, ec)
+    #define json_node_at(node, i) bsky_json_node_at(node, i)
+    #define json_node_key(node, i) bsky_json_node_key(node, i)
+    #define json_node_get(node, key) bsky_json_node_get(node, key)
+    #define json_of_node(node, ec) bsky_json_of_node(node, ec)
+    #define json_scan_field(str, key) bsky_json_scan_field(str, key)
+
+    #define json_path_Key bsky_json_path_Key
+    #define json_path_Any bsky_json_path_Any
+
+    #define json_path_compile(path, ec) bsky_json_path_compile(path, ec)
+    #define json_path_query(path, json, out, cap, ec) \
+                bsky_json_path_query(path, json, out, cap, ec)
+    #define json_path_first(path, json) bsky_json_path_first(path, json)
+
+    #define Json_Doc  bsky_Json_Doc
+    #define Json_Edit bsky_Json_Edit
+
+    #define json_doc_set(doc, path, value) bsky_json_doc_set(doc, path, value)
+    #define json_doc_remove(doc, path) bsky_json_doc_remove(doc, path)
+    #define sb_push_json_doc(sb, doc) bsky_sb_push_json_doc(sb, doc)
+    #define json_doc_free(doc) bsky_json_doc_free(doc)
+
+    #define Json_Key_Cache bsky_Json_Key_Cache
+
+    #define cbor_push_json(buf, json, cache) \
+                bsky_cbor_push_json(buf, json, cache)
+    #define sb_push_json_canonical(sb, json, cache) \
+                bsky_sb_push_json_canonical(sb, json, cache)
+    #define json_key_cache_free(cache) bsky_json_key_cache_free(cache)
+
+    /*
+     * BSKY XRPC
+     */
+    #define xrpc_Get  bsky_xrpc_Get
+    #define xrpc_Post bsky_xrpc_Post
+
+    #define xrpc_call(client, req, res)  bsky_xrpc_call(client, req, res)
+    #define sb_push_xrpc_path(sb, req)   bsky_sb_push_xrpc_path(sb, req)
+    #define sb_push_urlencoded(sb, str)  bsky_sb_push_urlencoded(sb, str)
+    #define xrpc_header(res, name)       bsky_xrpc_header(res, name)
+
+    /*
+     * BSKY HYDRATION
+     */
+    #define hydrate_Profile bsky_hydrate_Profile
+    #define hydrate_Post    bsky_hydrate_Post
+
+    #define hydrate_request(h, kind, id) bsky_hydrate_request(h, kind, id)
+    #define hydrate_flush(h)             bsky_hydrate_flush(h)
+    #define hydrate_get(h, slot, ec)     bsky_hydrate_get(h, slot, ec)
+    #define hydrator_free(h)             bsky_hydrator_free(h)
+
+
+    /*
+     * BSKY XRPC CACHE
+     */
+    #define clock_ms() bsky_clock_ms()
+    #define xrpc_cached_call(cache, client, req, res)\
+          bsky_xrpc_cached_call(cache, client, req, res)
+    #define sb_push_xrpc_cache_key(sb, req) bsky_sb_push_xrpc_cache_key(sb, req)
+    #define xrpc_cache_clear(cache) bsky_xrpc_cache_clear(cache)
+    #define xrpc_cache_free(cache)  bsky_xrpc_cache_free(cache)
+
+
+    /*
+     * BSKY PAGINATOR
+     */
+    #define paginator_next(p, page, ec) bsky_paginator_next(p, page, ec)
+    #define paginator_arena(p)          bsky_paginator_arena(p)
+    #define paginator_free(p)           bsky_paginator_free(p)
+
+
+    /*
+     * BSKY RATE LIMITER
+     */
+    #define rate_acquire(l, host)       bsky_rate_acquire(l, host)
+    #define rate_update(l, host, res)   bsky_rate_update(l, host, res)
+    #define rate_limiter_free(l)        bsky_rate_limiter_free(l)
+
+
+    /*
+     * BSKY SESSION
+     */
+    #define session_login(s)          bsky_session_login(s)
+    #define session_token(s, ec)      bsky_session_token(s, ec)
+    #define session_call(s, req, res) bsky_session_call(s, req, res)
+    #define session_free(s)           bsky_session_free(s)
+
+
+    /*
+     * BSKY ASYNC LOG
+     */
+    #define log_async(level, fmt, ...) bsky_log_async(level, fmt, __VA_ARGS__)
+    #define log_async_flush()          bsky_log_async_flush()
+    #define log_async_stop()           bsky_log_async_stop()
+    #define log_async_output(out)      bsky_log_async_output(out)
+    #define log_async_dropped()        bsky_log_async_dropped()
+
+    /*
+     * BSKY INSTRUMENTATION
+     */
+    #define probe_Parse_json   bsky_probe_Parse_json
+    #define probe_Sb_push_json bsky_probe_Sb_push_json
+    #define probe_Da_realloc   bsky_probe_Da_realloc
+    #define probe_Tmp_alloc    bsky_probe_Tmp_alloc
+    #define probe_Tmp_overflow bsky_probe_Tmp_overflow
+    #define probe_Count        bsky_probe_Count
+
+    #define str_of_probe_kind(kind) bsky_str_of_probe_kind(kind)
+    #define probe_snapshot()        bsky_probe_snapshot()
+    #define probe_reset()           bsky_probe_reset()
+
 #endif
 
 #endif //GUARD
@@ -0,0 +1,87 @@
+/*
+ * Different ways to read the same document must agree: full parse against
+ * targeted `bsky_json_scan_field' (every top level field found by parser
+ * must be found by scan with the same value) and against compact tree
+ * (the same result, numbers are doubles there).
+ */
+#include "fuzz.h"
+
+static int node_eq(struct bsky_json_node *node, struct bsky_json json)
+{
+    if (json.var == bsky_json_Num && node->var == bsky_json_Num)
+        return node->num == (double) json.num ||
+               (isnan(node->num) && isnan((double) json.num));
+
+    if (node->var != json.var) return 0;
+
+    switch (json.var) {
+    case bsky_json_Arr:
+        if (node->len != json.arr.len) return 0;
+
+        for (size_t i = 0; i < json.arr.len; ++i)
+            if (!node_eq(bsky_json_node_at(node, i), json.arr.data[i]))
+                return 0;
+
+        return 1;
+    case bsky_json_Dct:
+        if (node->len != json.dct.len) return 0;
+
+        for (size_t i = 0; i < json.dct.len; ++i) {
+            if (strcmp(bsky_json_node_key(node, i),
+                       json.dct.data[i].name) != 0 ||
+                !node_eq(bsky_json_node_at(node, i), json.dct.data[i].value))
+                return 0;
+        }
+
+        return 1;
+    case bsky_json_Str:
+        return node->len == strlen(json.str) &&
+               strcmp(node->str, json.str) == 0;
+    case bsky_json_Bool: return node->_bool == json._bool;
+    default:             return 1;
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    struct bsky_str  str = { (char *) data, (char *) data + size };
+    struct bsky_json json, value;
+
+    if (fuzz_parse(str, &json) && json.var == bsky_json_Dct) {
+        for (size_t i = 0; i < json.dct.len; ++i) {
+            char *key = json.dct.data[i].name;
+
+            // scan returns first field with the name.
+            struct bsky_json *expect = bsky_json_dct_get(json, key);
+            if (expect != &json.dct.data[i].value) continue;
+
+            struct bsky_str found = bsky_json_scan_field(str, key);
+            fuzz_assert(found.start != NULL);
+
+            // strings are found without quotes and still escaped.
+            if (expect->var == bsky_json_Str)
+                found = (struct bsky_str) { found.start - 1, found.end + 1 };
+
+            fuzz_assert(fuzz_parse(found, &value));
+            fuzz_assert(fuzz_json_eq(*expect, value));
+        }
+    }
+
+    struct bsky_str full = str, compact = str;
+    enum bsky_error_code full_ec, compact_ec;
+
+    json = bsky_parse_json(&full, &full_ec);
+
+    struct bsky_json_node *root = bsky_parse_json_compact(&compact,
+                                                          &compact_ec);
+
+    fuzz_assert(full_ec == compact_ec);
+    if (full_ec == bsky_ec_Ok) {
+        fuzz_assert(full.start == compact.start);
+        fuzz_assert(node_eq(root, json));
+    }
+
+    bsky_default_tmp_reset();
+
+    return 0;
+}
@@ -0,0 +1,16 @@
+/*
+ * Parser must not crash or read out of input on any data.
+ */
+#include "fuzz.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    struct bsky_str  str = { (char *) data, (char *) data + size };
+    struct bsky_json json;
+
+    if (fuzz_parse(str, &json)) bsky_tmp_str_of_json(json);
+
+    bsky_default_tmp_reset();
+
+    return 0;
+}
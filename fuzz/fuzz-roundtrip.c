@@ -0,0 +1,28 @@
+/*
+ * parse -> `bsky_sb_push_json' -> parse must give the same tree, and
+ * serializing it again must give the same text.
+ */
+#include "fuzz.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    struct bsky_str  str = { (char *) data, (char *) data + size };
+    struct bsky_json json, again;
+
+    if (fuzz_parse(str, &json)) {
+        struct bsky_str text = bsky_tmp_str_of_json(json);
+
+        fuzz_assert(fuzz_parse(text, &again));
+        fuzz_assert(fuzz_json_eq(json, again));
+
+        struct bsky_str text_again = bsky_tmp_str_of_json(again);
+
+        fuzz_assert(bsky_str_len(text) == bsky_str_len(text_again));
+        fuzz_assert(memcmp(text.start, text_again.start,
+                           bsky_str_len(text)) == 0);
+    }
+
+    bsky_default_tmp_reset();
+
+    return 0;
+}
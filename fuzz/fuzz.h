@@ -0,0 +1,122 @@
+#ifndef fuzz_h_INCLUDED
+#define fuzz_h_INCLUDED
+
+/*
+ * Shared part of fuzz targets. Every target defines
+ * `LLVMFuzzerTestOneInput' and works with libFuzzer directly. With
+ * `FUZZ_STANDALONE' target gets `main' which runs inputs from files given
+ * as arguments (or stdin), so it can be used with AFL (`@@') or to replay
+ * corpus with any compiler.
+ *
+ * Input is copied to buffer of exact size without null terminator, so
+ * sanitizers catch every read past `data->end'.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BSKY_API_IMPLEMENTATION
+#include "../bsky-api.h"
+
+#define fuzz_assert(cond) do {                                          \
+        if (!(cond)) {                                                  \
+            fprintf(stderr, "%s:%d: assertion `%s' failed\n",          \
+                    __FILE__, __LINE__, #cond);                         \
+            abort();                                                    \
+        }                                                               \
+    } while (0)
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+/*
+ * Structural equality. Infinite numbers are serialized as `null', so they
+ * are equal to it.
+ */
+static int fuzz_json_eq(struct bsky_json a, struct bsky_json b)
+{
+    if (a.var == bsky_json_Num && !isfinite(a.num)) a.var = bsky_json_Null;
+    if (b.var == bsky_json_Num && !isfinite(b.num)) b.var = bsky_json_Null;
+
+    if (a.var != b.var) return 0;
+
+    switch (a.var) {
+    case bsky_json_Arr:
+        if (a.arr.len != b.arr.len) return 0;
+
+        for (size_t i = 0; i < a.arr.len; ++i)
+            if (!fuzz_json_eq(a.arr.data[i], b.arr.data[i])) return 0;
+
+        return 1;
+    case bsky_json_Dct:
+        if (a.dct.len != b.dct.len) return 0;
+
+        for (size_t i = 0; i < a.dct.len; ++i) {
+            if (strcmp(a.dct.data[i].name, b.dct.data[i].name) != 0 ||
+                !fuzz_json_eq(a.dct.data[i].value, b.dct.data[i].value))
+                return 0;
+        }
+
+        return 1;
+    case bsky_json_Num:  return a.num == b.num;
+    case bsky_json_Str:  return strcmp(a.str, b.str) == 0;
+    case bsky_json_Bool: return a._bool == b._bool;
+    case bsky_json_Null: return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Parse whole input, trailing whitespaces are allowed. Return 0 on error.
+ */
+static int fuzz_parse(struct bsky_str str, struct bsky_json *json)
+{
+    enum bsky_error_code ec;
+
+    *json = bsky_parse_json(&str, &ec);
+    if (ec != bsky_ec_Ok) return 0;
+
+    str = bsky_trim_left(str);
+
+    return str.start == str.end;
+}
+
+#ifdef FUZZ_STANDALONE
+    static void fuzz_run(FILE *file)
+    {
+        size_t len = 0, cap = 0x1000;
+        uint8_t *buf = malloc(cap);
+
+        while (!feof(file) && !ferror(file)) {
+            if (len == cap) buf = realloc(buf, cap *= 2);
+            len += fread(buf + len, 1, cap - len, file);
+        }
+
+        // exact size copy.
+        uint8_t *data = malloc(len ? len : 1);
+        memcpy(data, buf, len);
+
+        LLVMFuzzerTestOneInput(data, len);
+
+        free(data);
+        free(buf);
+    }
+
+    int main(int argc, char **argv)
+    {
+        if (argc == 1) fuzz_run(stdin);
+
+        for (int i = 1; i < argc; ++i) {
+            FILE *file = fopen(argv[i], "rb");
+            if (file == NULL) { perror(argv[i]); return 1; }
+
+            fuzz_run(file);
+            fclose(file);
+        }
+
+        return 0;
+    }
+#endif
+
+#endif // fuzz_h_INCLUDED
@@ -0,0 +1,63 @@
+#ifndef alloc_tests_h_INCLUDED
+#define alloc_tests_h_INCLUDED
+
+void run_alloc_tests(void);
+
+
+#ifdef IMPLEMENT_TESTS
+    #include "../bsky-api.h"
+    #include <unity.h>
+
+    static void alloc_track_sites(void)
+    {
+        struct bsky_str_builder sb = { 0 };
+
+        bsky_alloc_stats_reset();
+        struct bsky_alloc_stats before = bsky_alloc_stats();
+
+        for (int i = 0; i < 100; ++i) bsky_sb_push(&sb, 'a' + i % 26);
+
+        struct bsky_alloc_stats grown = bsky_alloc_stats();
+        bsky_da_free(&sb);
+        struct bsky_alloc_stats after = bsky_alloc_stats();
+
+    #ifdef BSKY_TRACK_ALLOCS
+        // first push appends char with '\0': 18, 36, 72, 144 bytes.
+        TEST_ASSERT_EQUAL(4, grown.reallocs);
+        TEST_ASSERT_EQUAL(18 + 36 + 72 + 144, grown.bytes);
+        TEST_ASSERT_EQUAL(before.live_bytes + 144, grown.live_bytes);
+        TEST_ASSERT_EQUAL(before.live_bytes + 144, grown.peak_bytes);
+
+        TEST_ASSERT_EQUAL(1, after.frees);
+        TEST_ASSERT_EQUAL(before.live_bytes, after.live_bytes);
+        TEST_ASSERT_EQUAL(grown.peak_bytes, after.peak_bytes);
+
+        struct bsky_alloc_site sites[BSKY_ALLOC_SITES_MAX];
+        size_t len = bsky_alloc_sites(sites, BSKY_ARRAY_LEN(sites));
+        size_t reallocs = 0, frees = 0;
+
+        for (size_t i = 0; i < len; ++i) {
+            if (strcmp(sites[i].func, "__bsky_da_push") == 0 ||
+                strcmp(sites[i].func, "__bsky_da_append") == 0)
+                reallocs += sites[i].reallocs;
+            if (strcmp(sites[i].func, "bsky_da_free") == 0)
+                frees += sites[i].frees;
+        }
+
+        TEST_ASSERT_EQUAL(4, reallocs);
+        TEST_ASSERT_EQUAL(1, frees);
+    #else
+        (void) before;
+        TEST_ASSERT_EQUAL(0, grown.reallocs);
+        TEST_ASSERT_EQUAL(0, after.peak_bytes);
+    #endif
+    }
+
+    void run_alloc_tests(void)
+    {
+        RUN_TEST(alloc_track_sites);
+    }
+
+#endif
+
+#endif // alloc-tests_h_INCLUDED
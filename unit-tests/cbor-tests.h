@@ -0,0 +1,478 @@
+#ifndef cbor_tests_h_INCLUDED
+#define cbor_tests_h_INCLUDED
+
+void run_cbor_tests(void);
+
+
+#ifdef IMPLEMENT_TESTS
+    #include "../bsky-api.h"
+    #include <unity.h>
+    #include <unistd.h>
+
+    static struct bsky_view cbor_view(struct bsky_bytes buf) {
+        return (struct bsky_view) { buf.data, buf.data + buf.len };
+    }
+
+    static void cbor_read_write(void)
+    {
+        enum bsky_error_code ec;
+        struct bsky_bytes buf = { 0 };
+        struct bsky_cid cid = bsky_cid_of_block(bsky_cid_Raw,
+                                                (struct bsky_view) { 0 });
+
+        static const long long ints[] = {
+            0, 23, 24, 255, 256, 65535, 65536, 4294967296LL, -1, -24, -25,
+            -257, 9223372036854775807LL, -9223372036854775807LL - 1,
+        };
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(ints); ++i)
+            bsky_cbor_push_int(&buf, ints[i]);
+
+        bsky_cbor_push_map(&buf, 2);
+        bsky_cbor_push_text(&buf, bsky_mk_str("a"));
+        bsky_cbor_push_bytes(&buf, (struct bsky_view) { "\0\1", "\0\1" + 2 });
+        bsky_cbor_push_text(&buf, bsky_mk_str("bc"));
+        bsky_cbor_push_arr(&buf, 4);
+        bsky_cbor_push_link(&buf, cid);
+        bsky_cbor_push_bool(&buf, 1);
+        bsky_cbor_push_bool(&buf, 0);
+        bsky_cbor_push_null(&buf);
+
+        struct bsky_view data = cbor_view(buf);
+        struct bsky_cbor item;
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(ints); ++i) {
+            item = bsky_cbor_read(&data, &ec);
+            TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+            TEST_ASSERT_EQUAL(bsky_cbor_Int, item.type);
+            TEST_ASSERT_TRUE(ints[i] == item.integer);
+        }
+
+        item = bsky_cbor_read(&data, &ec);
+        TEST_ASSERT_EQUAL(bsky_cbor_Map, item.type);
+        TEST_ASSERT_EQUAL(2, item.len);
+
+        item = bsky_cbor_read(&data, &ec);
+        TEST_ASSERT_EQUAL(bsky_cbor_Text, item.type);
+        TEST_ASSERT_TRUE(bsky_str_eq(bsky_mk_str("a"), item.text));
+
+        item = bsky_cbor_read(&data, &ec);
+        TEST_ASSERT_EQUAL(bsky_cbor_Bytes, item.type);
+        TEST_ASSERT_EQUAL(2, (char *) item.bytes.end -
+                             (char *) item.bytes.start);
+        TEST_ASSERT_EQUAL_MEMORY("\0\1", item.bytes.start, 2);
+
+        bsky_cbor_read(&data, &ec);
+        item = bsky_cbor_read(&data, &ec);
+        TEST_ASSERT_EQUAL(bsky_cbor_Arr, item.type);
+        TEST_ASSERT_EQUAL(4, item.len);
+
+        item = bsky_cbor_read(&data, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL(bsky_cbor_Link, item.type);
+        TEST_ASSERT_TRUE(bsky_cid_eq(cid, item.link));
+
+        item = bsky_cbor_read(&data, &ec);
+        TEST_ASSERT_TRUE(item.type == bsky_cbor_Bool && item._bool);
+        item = bsky_cbor_read(&data, &ec);
+        TEST_ASSERT_TRUE(item.type == bsky_cbor_Bool && !item._bool);
+        item = bsky_cbor_read(&data, &ec);
+        TEST_ASSERT_EQUAL(bsky_cbor_Null, item.type);
+        TEST_ASSERT_EQUAL(data.end, data.start);
+
+        bsky_cbor_read(&data, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Cbor_truncated, ec);
+
+        // item which doesn't fit is not pushed.
+        size_t len = buf.len;
+        unsigned char *big = calloc(buf.cap, 1);
+
+        test_alloc_left = 0;
+        TEST_ASSERT_EQUAL(bsky_ec_Tmp_overflow, bsky_cbor_push_bytes(&buf,
+                              (struct bsky_view) { big, big + buf.cap }));
+        TEST_ASSERT_EQUAL(len, buf.len);
+
+        while (buf.len + 1 + 2 + 1 + BSKY_CID_BYTES <= buf.cap)
+            bsky_cbor_push_null(&buf);
+        len = buf.len;
+        TEST_ASSERT_EQUAL(bsky_ec_Tmp_overflow, bsky_cbor_push_link(&buf, cid));
+        TEST_ASSERT_EQUAL(len, buf.len);
+        TEST_ASSERT_EQUAL(bsky_ec_Tmp_overflow,
+                          bsky_car_push_block(&buf, cid, (struct bsky_view) {
+                              big, big + buf.cap }));
+        TEST_ASSERT_EQUAL(len, buf.len);
+        test_alloc_left = -1;
+        free(big);
+
+        // shortest heads.
+        buf.len = 0;
+        bsky_cbor_push_int(&buf, 24);
+        bsky_cbor_push_int(&buf, -1);
+        bsky_cbor_push_int(&buf, 256);
+        bsky_cbor_push_text(&buf, bsky_mk_str("a"));
+        TEST_ASSERT_EQUAL(8, buf.len);
+        TEST_ASSERT_EQUAL_MEMORY("\x18\x18\x20\x19\x01\x00\x61\x61",
+                                 buf.data, 8);
+
+        // whole map is skipped.
+        buf.len = 0;
+        bsky_cbor_push_map(&buf, 1);
+        bsky_cbor_push_text(&buf, bsky_mk_str("e"));
+        bsky_cbor_push_arr(&buf, 2);
+        bsky_cbor_push_arr(&buf, 0);
+        bsky_cbor_push_map(&buf, 1);
+        bsky_cbor_push_int(&buf, 1);
+        bsky_cbor_push_link(&buf, cid);
+        bsky_cbor_push_int(&buf, 7);
+
+        data = cbor_view(buf);
+        bsky_cbor_skip(&data, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        item = bsky_cbor_read(&data, &ec);
+        TEST_ASSERT_EQUAL(7, item.integer);
+
+        bsky_da_free(&buf);
+    }
+
+    static void cbor_reject(void)
+    {
+        struct {
+            char *data; size_t len;
+            enum bsky_error_code ec;
+        } invalid[] = {
+            { "\x18\x05", 2,                 bsky_ec_Cbor_invalid },
+            { "\x19\x00\xff", 3,             bsky_ec_Cbor_invalid },
+            { "\x1c", 1,                     bsky_ec_Cbor_invalid },
+            { "\x61\xff", 2,                 bsky_ec_Cbor_invalid },
+            { "\x5f\x41\x00\xff", 4,         bsky_ec_Cbor_unsupported },
+            { "\xc0\x61\x30", 3,             bsky_ec_Cbor_unsupported },
+            { "\xf9\x00\x00", 3,             bsky_ec_Cbor_unsupported },
+            { "\xf7", 1,                     bsky_ec_Cbor_unsupported },
+            { "\x1b\xff\xff\xff\xff\xff\xff\xff\xff", 9,
+              bsky_ec_Cbor_unsupported },
+            { "\x42\x00", 2,                 bsky_ec_Cbor_truncated },
+            { "\x19\x01", 2,                 bsky_ec_Cbor_truncated },
+            { "\x83\x01\x02", 3,             bsky_ec_Cbor_truncated },
+            { "\xd8\x2a\x41\x00", 4,         bsky_ec_Cbor_invalid },
+        };
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(invalid); ++i) {
+            enum bsky_error_code ec;
+            struct bsky_view data = { invalid[i].data,
+                                      invalid[i].data + invalid[i].len };
+
+            bsky_cbor_skip(&data, &ec);
+            TEST_ASSERT_EQUAL_MESSAGE(invalid[i].ec, ec, "case");
+            TEST_ASSERT_EQUAL(invalid[i].data, data.start);
+        }
+
+        // map keys: text, sorted by length then bytes, unique.
+        struct { char *data; size_t len; enum bsky_error_code ec; } maps[] = {
+            { "\xa2\x61\x62\x01\x62\x61\x61\x02", 8, bsky_ec_Ok },
+            { "\xa2\x62\x61\x61\x01\x61\x62\x02", 8, bsky_ec_Cbor_invalid },
+            { "\xa2\x61\x62\x01\x61\x61\x02", 7,     bsky_ec_Cbor_invalid },
+            { "\xa2\x61\x61\x01\x61\x61\x02", 7,     bsky_ec_Cbor_invalid },
+            { "\xa1\x01\x02", 3,                     bsky_ec_Cbor_invalid },
+            { "\xa1\x61\x61\x82\x01", 5,             bsky_ec_Cbor_truncated },
+        };
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(maps); ++i) {
+            enum bsky_error_code ec;
+            struct bsky_view data = { maps[i].data,
+                                      maps[i].data + maps[i].len };
+
+            struct bsky_cbor map = bsky_cbor_read(&data, &ec);
+            TEST_ASSERT_EQUAL_MESSAGE(maps[i].ec, ec, "map");
+
+            if (ec == bsky_ec_Ok) {
+                TEST_ASSERT_EQUAL(bsky_cbor_Map, map.type);
+                TEST_ASSERT_EQUAL(2, map.len);
+                TEST_ASSERT_EQUAL(maps[i].data + 1, data.start);
+            } else {
+                TEST_ASSERT_EQUAL(maps[i].data, data.start);
+            }
+        }
+    }
+
+    static void cbor_car(void)
+    {
+        enum bsky_error_code ec;
+        struct bsky_bytes buf = { 0 };
+        char *blocks[] = { "first", "", "third block" };
+        struct bsky_cid cids[BSKY_ARRAY_LEN(blocks)];
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(blocks); ++i)
+            cids[i] = bsky_cid_of_block(bsky_cid_Raw, (struct bsky_view) {
+                                        blocks[i],
+                                        blocks[i] + strlen(blocks[i]) });
+
+        bsky_car_push_header(&buf, cids[2]);
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(blocks); ++i)
+            bsky_car_push_block(&buf, cids[i], (struct bsky_view) {
+                                blocks[i], blocks[i] + strlen(blocks[i]) });
+
+        struct bsky_car car = bsky_car_open(cbor_view(buf), &ec);
+        struct bsky_cid cid;
+        struct bsky_view block;
+
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL(1, car.roots);
+        TEST_ASSERT_TRUE(bsky_cid_eq(cids[2], car.root));
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(blocks); ++i) {
+            TEST_ASSERT_TRUE(bsky_car_next(&car, &cid, &block, &ec));
+            TEST_ASSERT_TRUE(bsky_cid_eq(cids[i], cid));
+            TEST_ASSERT_EQUAL(strlen(blocks[i]),
+                              (char *) block.end - (char *) block.start);
+        }
+        TEST_ASSERT_FALSE(bsky_car_next(&car, &cid, &block, &ec));
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+
+        // copies outlive CAR data.
+        struct bsky_block_map map = { 0 };
+        struct bsky_block_store store = bsky_block_map_store(&map);
+
+        car = bsky_car_open(cbor_view(buf), &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_car_load(&car, store, 1));
+        TEST_ASSERT_EQUAL(3, map.len);
+
+        buf.data[buf.len - 1] ^= 1;
+        car = bsky_car_open(cbor_view(buf), &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Block_mismatch,
+                          bsky_car_load(&car, store, 1));
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(blocks); ++i) {
+            TEST_ASSERT_EQUAL(bsky_ec_Ok, store.get(store.ctx, cids[i],
+                                                    &block));
+            TEST_ASSERT_EQUAL_MEMORY(blocks[i], block.start,
+                                     strlen(blocks[i]));
+        }
+
+        cid.digest[0] ^= 1;
+        TEST_ASSERT_EQUAL(bsky_ec_Block_not_found,
+                          store.get(store.ctx, cid, &block));
+
+        // truncated section and CARv2 pragma.
+        car = bsky_car_open((struct bsky_view) { buf.data, buf.data + 60 },
+                            &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_FALSE(bsky_car_next(&car, &cid, &block, &ec));
+        TEST_ASSERT_EQUAL(bsky_ec_Car_invalid, ec);
+
+        char *v2 = "\x0a\xa1\x67version\x02";
+        bsky_car_open((struct bsky_view) { v2, v2 + 11 }, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Car_invalid, ec);
+
+        bsky_block_map_free(&map);
+        bsky_da_free(&buf);
+    }
+
+    #define CBOR_FILE_BLOCKS 1000
+
+    static struct bsky_view cbor_file_block(char *buf, size_t i)
+    {
+        int len = snprintf(buf, 32, "block %zu", i * 7919);
+
+        return (struct bsky_view) { buf, buf + len };
+    }
+
+    static int cbor_file_keep_even(void *ctx, struct bsky_cid cid)
+    {
+        struct bsky_cid *cids = ctx;
+
+        for (size_t i = 0; i < CBOR_FILE_BLOCKS; i += 2)
+            if (bsky_cid_eq(cids[i], cid)) return 1;
+
+        return 0;
+    }
+
+    static void cbor_block_file(void)
+    {
+        enum bsky_error_code ec;
+        static struct bsky_cid cids[CBOR_FILE_BLOCKS + 1];
+        char buf[32], dir[] = "/tmp/bsky-blocks-XXXXXX", path[64], idx[64];
+        struct bsky_view block;
+
+        TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+        snprintf(path, sizeof path, "%s/blocks", dir);
+        snprintf(idx, sizeof idx, "%s/blocks.idx", dir);
+
+        struct bsky_block_file file = bsky_block_file_open(path, &ec);
+        struct bsky_block_store store = bsky_block_file_store(&file);
+
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        file.batch = 512;
+
+        for (size_t i = 0; i < CBOR_FILE_BLOCKS; ++i) {
+            struct bsky_view data = cbor_file_block(buf, i);
+
+            cids[i] = bsky_cid_of_block(bsky_cid_Raw, data);
+            TEST_ASSERT_EQUAL(bsky_ec_Ok, store.put(store.ctx, cids[i], data));
+            TEST_ASSERT_EQUAL(bsky_ec_Ok, store.put(store.ctx, cids[i], data));
+        }
+        TEST_ASSERT_EQUAL(CBOR_FILE_BLOCKS, bsky_block_file_len(&file));
+
+        // pending blocks are read too.
+        TEST_ASSERT_TRUE(file.pending.len > 0);
+        for (size_t i = CBOR_FILE_BLOCKS; i-- > 0;) {
+            struct bsky_view data = cbor_file_block(buf, i);
+
+            TEST_ASSERT_EQUAL(bsky_ec_Ok, store.get(store.ctx, cids[i],
+                                                    &block));
+            TEST_ASSERT_EQUAL_MEMORY(data.start, block.start,
+                                     (char *) data.end - (char *) data.start);
+        }
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_block_file_close(&file));
+
+        // from index.
+        file = bsky_block_file_open(path, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL(CBOR_FILE_BLOCKS, file.index_len);
+        TEST_ASSERT_EQUAL(0, file.recent_len);
+
+        for (size_t i = 0; i < CBOR_FILE_BLOCKS; ++i) {
+            TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_block_file_get(&file, cids[i],
+                                                              &block));
+            TEST_ASSERT_TRUE(bsky_cid_verify(cids[i], block));
+        }
+
+        struct bsky_cid missing = cids[0];
+        missing.digest[31] ^= 1;
+        TEST_ASSERT_EQUAL(bsky_ec_Block_not_found,
+                          bsky_block_file_get(&file, missing, &block));
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_block_file_close(&file));
+
+        // crash: section appended after index and torn section.
+        struct bsky_bytes tail = { 0 };
+        struct bsky_view data = cbor_file_block(buf, CBOR_FILE_BLOCKS);
+
+        cids[CBOR_FILE_BLOCKS] = bsky_cid_of_block(bsky_cid_Raw, data);
+        bsky_car_push_block(&tail, cids[CBOR_FILE_BLOCKS], data);
+        bsky_car_push_block(&tail, cids[0], data);
+
+        FILE *f = fopen(path, "ab");
+        fwrite(tail.data, 1, tail.len - 3, f);
+        fclose(f);
+
+        file = bsky_block_file_open(path, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL(CBOR_FILE_BLOCKS + 1, bsky_block_file_len(&file));
+        TEST_ASSERT_EQUAL(1, file.recent_len);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_block_file_get(&file,
+                                            cids[CBOR_FILE_BLOCKS], &block));
+        TEST_ASSERT_EQUAL_MEMORY(data.start, block.start,
+                                 (char *) data.end - (char *) data.start);
+
+        // compaction keeps views valid.
+        struct bsky_view odd;
+
+        bsky_block_file_get(&file, cids[1], &odd);
+        ec = bsky_block_file_compact(&file, cbor_file_keep_even, cids);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL(CBOR_FILE_BLOCKS / 2, bsky_block_file_len(&file));
+        TEST_ASSERT_TRUE(bsky_cid_verify(cids[1], odd));
+
+        for (size_t i = 0; i < CBOR_FILE_BLOCKS; ++i)
+            TEST_ASSERT_EQUAL(i % 2 ? bsky_ec_Block_not_found : bsky_ec_Ok,
+                              bsky_block_file_get(&file, cids[i], &block));
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_block_file_close(&file));
+
+        // lost index.
+        unlink(idx);
+        file = bsky_block_file_open(path, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL(CBOR_FILE_BLOCKS / 2, file.recent_len);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_block_file_get(&file, cids[2],
+                                                          &block));
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_block_file_close(&file));
+
+        // crash: section which parses but doesn't match its CID and
+        // zero-filled tail. Only the tail is cut off.
+        struct stat st;
+        char zeros[64] = { 0 };
+
+        TEST_ASSERT_EQUAL(0, stat(path, &st));
+
+        tail.len = 0;
+        bsky_car_push_block(&tail, cids[CBOR_FILE_BLOCKS],
+                            cbor_file_block(buf, 1));
+
+        f = fopen(path, "ab");
+        fwrite(tail.data, 1, tail.len, f);
+        fwrite(zeros, 1, sizeof zeros, f);
+        fclose(f);
+
+        file = bsky_block_file_open(path, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL(CBOR_FILE_BLOCKS / 2, bsky_block_file_len(&file));
+        TEST_ASSERT_EQUAL(st.st_size + tail.len, file.data_len);
+        TEST_ASSERT_EQUAL(bsky_ec_Block_not_found,
+                          bsky_block_file_get(&file, cids[CBOR_FILE_BLOCKS],
+                                              &block));
+
+        // compaction which fails before data file is replaced leaves
+        // store intact.
+        for (long left = 0;; ++left) {
+            test_alloc_left = left;
+            ec = bsky_block_file_compact(&file, NULL, NULL);
+            test_alloc_left = -1;
+
+            if (ec == bsky_ec_Ok ||
+                file.data_len != (size_t) st.st_size + tail.len)
+                break;
+
+            TEST_ASSERT_EQUAL(bsky_ec_Tmp_overflow, ec);
+            TEST_ASSERT_EQUAL(CBOR_FILE_BLOCKS / 2,
+                              bsky_block_file_len(&file));
+            TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_block_file_get(&file, cids[2],
+                                                              &block));
+        }
+
+        // damaged block is dropped.
+        TEST_ASSERT_EQUAL(bsky_ec_Ok,
+                          bsky_block_file_compact(&file, NULL, NULL));
+        TEST_ASSERT_EQUAL(st.st_size, file.data_len);
+        TEST_ASSERT_EQUAL(CBOR_FILE_BLOCKS / 2, bsky_block_file_len(&file));
+
+        size_t data_len = file.data_len;
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_block_file_close(&file));
+
+        // section which doesn't parse before the tail isn't cut off.
+        tail.len = 0;
+        bsky_car_push_block(&tail, cids[0], cbor_file_block(buf, 0));
+        tail.data[1] = 0xff; // CID version.
+
+        f = fopen(path, "ab");
+        fwrite(tail.data, 1, tail.len, f);
+        fwrite(tail.data, 1, tail.len, f);
+        fclose(f);
+
+        bsky_block_file_open(path, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Block_file_io, ec);
+        TEST_ASSERT_EQUAL(0, stat(path, &st));
+        TEST_ASSERT_EQUAL(data_len + 2 * tail.len, st.st_size);
+
+        // not a block file.
+        f = fopen(path, "wb");
+        fputs("not a block file", f);
+        fclose(f);
+        bsky_block_file_open(path, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Block_file_io, ec);
+
+        unlink(path);
+        unlink(idx);
+        rmdir(dir);
+        bsky_da_free(&tail);
+    }
+
+    void run_cbor_tests(void)
+    {
+        RUN_TEST(cbor_read_write);
+        RUN_TEST(cbor_reject);
+        RUN_TEST(cbor_car);
+        RUN_TEST(cbor_block_file);
+    }
+
+#endif
+
+#endif // cbor-tests_h_INCLUDED
@@ -0,0 +1,155 @@
+#ifndef cid_tests_h_INCLUDED
+#define cid_tests_h_INCLUDED
+
+void run_cid_tests(void);
+
+
+#ifdef IMPLEMENT_TESTS
+    #include "../bsky-api.h"
+    #include <unity.h>
+
+    static void cid_hex(char *buf, const unsigned char *digest)
+    {
+        for (size_t i = 0; i < BSKY_SHA256_LEN; ++i)
+            sprintf(buf + i * 2, "%02x", digest[i]);
+    }
+
+    static void cid_sha256(void)
+    {
+        unsigned char digest[BSKY_SHA256_LEN];
+        char hex[BSKY_SHA256_LEN * 2 + 1];
+
+        bsky_sha256("", 0, digest);
+        cid_hex(hex, digest);
+        TEST_ASSERT_EQUAL_STRING("e3b0c44298fc1c149afbf4c8996fb924"
+                                 "27ae41e4649b934ca495991b7852b855", hex);
+
+        bsky_sha256("abc", 3, digest);
+        cid_hex(hex, digest);
+        TEST_ASSERT_EQUAL_STRING("ba7816bf8f01cfea414140de5dae2223"
+                                 "b00361a396177a9cb410ff61f20015ad", hex);
+
+        // one million of 'a' fed in uneven pieces.
+        static char a[1000000];
+        struct bsky_sha256 sha;
+
+        memset(a, 'a', sizeof a);
+        bsky_sha256_init(&sha);
+        for (size_t off = 0, step = 1; off < sizeof a; off += step, step++)
+            bsky_sha256_update(&sha, a + off, off + step < sizeof a
+                                                  ? step : sizeof a - off);
+        bsky_sha256_final(&sha, digest);
+        cid_hex(hex, digest);
+        TEST_ASSERT_EQUAL_STRING("cdc76e5c9914fb9281a1c7e284d73e67"
+                                 "f1809a48a497200e046d39ccc7112cd0", hex);
+
+        // backend in use agrees with portable code on every padding.
+        for (size_t len = 0; len < 200; ++len) {
+            unsigned char padded[256] = { 0 }, expect[BSKY_SHA256_LEN];
+            size_t blocks = (len + 9 + 63) / 64;
+
+            memcpy(padded, a, len);
+            padded[len] = 0x80;
+            for (int i = 0; i < 8; ++i)
+                padded[blocks * 64 - 1 - i] = (uint64_t) len * 8 >> i * 8;
+
+            bsky_sha256_init(&sha);
+            __bsky_sha256_blocks_portable(sha.state, padded, blocks);
+            for (int i = 0; i < 32; ++i)
+                expect[i] = sha.state[i / 4] >> (24 - i % 4 * 8);
+
+            bsky_sha256(a, len, digest);
+            TEST_ASSERT_EQUAL_MEMORY(expect, digest, BSKY_SHA256_LEN);
+        }
+    }
+
+    static void cid_format_parse(void)
+    {
+        enum bsky_error_code ec;
+        char buf[BSKY_CID_STR_LEN + 1];
+        char *json = "{\"hello\":\"world\"}";
+
+        struct bsky_cid cid = bsky_cid_of_block(bsky_cid_Dag_cbor,
+            (struct bsky_view) { json, json + strlen(json) });
+
+        bsky_cid_format(buf, cid);
+        TEST_ASSERT_EQUAL_STRING(
+            "bafyreietui4xdkiu4xvmx4fi2jivjtndbhb4drzpxomrjvd4mdz4w2avra", buf);
+
+        struct bsky_cid parsed = bsky_parse_cid(bsky_mk_str(buf), &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_TRUE(bsky_cid_eq(cid, parsed));
+        TEST_ASSERT_TRUE(bsky_cid_verify(parsed,
+            (struct bsky_view) { json, json + strlen(json) }));
+        TEST_ASSERT_FALSE(bsky_cid_verify(parsed,
+            (struct bsky_view) { json, json + strlen(json) - 1 }));
+
+        cid = bsky_cid_of_block(bsky_cid_Raw, (struct bsky_view) { 0 });
+        bsky_cid_format(buf, cid);
+        TEST_ASSERT_EQUAL_STRING(
+            "bafkreihdwdcefgh4dqkjv67uzcmw7ojee6xedzdetojuzjevtenxquvyku", buf);
+
+        unsigned char bytes[BSKY_CID_BYTES + 1] = { 0 };
+        struct bsky_view view = { bytes, bytes + sizeof bytes };
+
+        TEST_ASSERT_EQUAL(BSKY_CID_BYTES, bsky_cid_to_bytes(bytes, cid));
+        parsed = bsky_parse_cid_bytes(&view, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_TRUE(bsky_cid_eq(cid, parsed));
+        TEST_ASSERT_EQUAL(bytes + BSKY_CID_BYTES, view.start);
+
+        struct {
+            char *text;
+            enum bsky_error_code ec;
+        } invalid[] = {
+            { "QmdfTbBqBPQ7VNxZEYEj14VmRuZBkqFbiwReogJgS1zR1n",
+              bsky_ec_Cid_multibase },
+            { "",                               bsky_ec_Cid_multibase },
+            { "bafyreietui4xdkiu4xvmx4fi2jivjtndbhb4drzpxomrjvd4mdz4w2avr",
+              bsky_ec_Cid_invalid },
+            { "bafyreietui4xdkiu4xvmx4fi2jivjtndbhb4drzpxomrjvd4mdz4w2av1a",
+              bsky_ec_Cid_invalid },
+            // sha2-512 hash, dag-pb codec and CIDv0 prefix.
+            { "bafyrgietui4xdkiu4xvmx4fi2jivjtndbhb4drzpxomrjvd4mdz4w2avra",
+              bsky_ec_Cid_unsupported },
+            { "bafybeietui4xdkiu4xvmx4fi2jivjtndbhb4drzpxomrjvd4mdz4w2avra",
+              bsky_ec_Cid_unsupported },
+            { "babyreietui4xdkiu4xvmx4fi2jivjtndbhb4drzpxomrjvd4mdz4w2avra",
+              bsky_ec_Cid_unsupported },
+        };
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(invalid); ++i) {
+            bsky_parse_cid(bsky_mk_str(invalid[i].text), &ec);
+            TEST_ASSERT_EQUAL_MESSAGE(invalid[i].ec, ec, invalid[i].text);
+        }
+    }
+
+    static void cid_batch(void)
+    {
+        char *blocks_data[] = { "", "a", "record", "{\"hello\":\"world\"}" };
+        struct bsky_view blocks[BSKY_ARRAY_LEN(blocks_data)];
+        struct bsky_cid  cids[BSKY_ARRAY_LEN(blocks_data)];
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(blocks); ++i)
+            blocks[i] = (struct bsky_view) {
+                blocks_data[i], blocks_data[i] + strlen(blocks_data[i])
+            };
+
+        bsky_cid_batch(bsky_cid_Dag_cbor, blocks, BSKY_ARRAY_LEN(blocks),
+                       cids);
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(blocks); ++i)
+            TEST_ASSERT_TRUE(bsky_cid_eq(cids[i],
+                bsky_cid_of_block(bsky_cid_Dag_cbor, blocks[i])));
+    }
+
+    void run_cid_tests(void)
+    {
+        RUN_TEST(cid_sha256);
+        RUN_TEST(cid_format_parse);
+        RUN_TEST(cid_batch);
+    }
+
+#endif
+
+#endif // cid-tests_h_INCLUDED
@@ -0,0 +1,197 @@
+#ifndef ident_tests_h_INCLUDED
+#define ident_tests_h_INCLUDED
+
+void run_ident_tests(void);
+
+
+#ifdef IMPLEMENT_TESTS
+    #include "../bsky-api.h"
+    #include <unity.h>
+
+    static void ident_validate(void)
+    {
+        struct {
+            int  (*valid)(struct bsky_str);
+            char *text;
+            int   expect;
+        } cases[] = {
+            { bsky_did_valid, "did:plc:z72i7hdynmk6r22z27h6tvur", 1 },
+            { bsky_did_valid, "did:web:example.com",              1 },
+            { bsky_did_valid, "did:web:localhost%3A8080",         1 },
+            { bsky_did_valid, "did:PLC:abc",                      0 },
+            { bsky_did_valid, "did::abc",                         0 },
+            { bsky_did_valid, "did:plc:",                         0 },
+            { bsky_did_valid, "did:plc:abc:",                     0 },
+            { bsky_did_valid, "did:plc:a/b",                      0 },
+            { bsky_did_valid, "plc:abc",                          0 },
+
+            { bsky_handle_valid, "alice.bsky.social",             1 },
+            { bsky_handle_valid, "XN--LDK.test",                  1 },
+            { bsky_handle_valid, "a-b.c0m",                       1 },
+            { bsky_handle_valid, "alice",                         0 },
+            { bsky_handle_valid, "alice.",                        0 },
+            { bsky_handle_valid, ".alice.com",                    0 },
+            { bsky_handle_valid, "-alice.com",                    0 },
+            { bsky_handle_valid, "alice.1com",                    0 },
+            { bsky_handle_valid, "al_ice.com",                    0 },
+
+            { bsky_nsid_valid, "app.bsky.feed.post",              1 },
+            { bsky_nsid_valid, "com.example.fooBar2",             1 },
+            { bsky_nsid_valid, "com.exa-mple.foo",                1 },
+            { bsky_nsid_valid, "com.example",                     0 },
+            { bsky_nsid_valid, "com.example.foo-bar",             0 },
+            { bsky_nsid_valid, "com.example.2foo",                0 },
+            { bsky_nsid_valid, "1com.example.foo",                0 },
+            { bsky_nsid_valid, "com..example.foo",                0 },
+
+            { bsky_rkey_valid, "3jzfcijpj2z2a",                   1 },
+            { bsky_rkey_valid, "self",                            1 },
+            { bsky_rkey_valid, "a:b~c_d.e-f",                     1 },
+            { bsky_rkey_valid, "",                                0 },
+            { bsky_rkey_valid, ".",                               0 },
+            { bsky_rkey_valid, "..",                              0 },
+            { bsky_rkey_valid, "a/b",                             0 },
+
+            { bsky_tid_valid, "3jzfcijpj2z2a",                    1 },
+            { bsky_tid_valid, "2222222222222",                    1 },
+            { bsky_tid_valid, "kjzfcijpj2z2a",                    0 },
+            { bsky_tid_valid, "3jzfcijpj2z2",                     0 },
+            { bsky_tid_valid, "3jzfcijpj2z21",                    0 },
+            { bsky_tid_valid, "3JZFCIJPJ2Z2A",                    0 },
+        };
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(cases); ++i) {
+            if (cases[i].valid(bsky_mk_str(cases[i].text)) != cases[i].expect)
+                TEST_FAIL_MESSAGE(cases[i].text);
+        }
+    }
+
+    static void ident_tid(void)
+    {
+        char buf[BSKY_TID_LEN + 1];
+        unsigned clock_id = 0;
+
+        TEST_ASSERT_EQUAL(1688137381887007LL,
+            bsky_tid_timestamp(bsky_mk_str("3jzfcijpj2z2a"), &clock_id));
+        TEST_ASSERT_EQUAL(6, clock_id);
+
+        TEST_ASSERT_EQUAL(0,
+            bsky_tid_timestamp(bsky_mk_str("2222222222222"), NULL));
+        TEST_ASSERT_EQUAL(-1,
+            bsky_tid_timestamp(bsky_mk_str("kjzfcijpj2z2a"), NULL));
+
+        struct bsky_str tid = bsky_tid_of_timestamp(buf, 1688137381887007LL, 6);
+        TEST_ASSERT_EQUAL_STRING("3jzfcijpj2z2a", buf);
+        TEST_ASSERT_EQUAL(BSKY_TID_LEN, bsky_str_len(tid));
+
+        // TIDs sort as their timestamps.
+        char later[BSKY_TID_LEN + 1];
+        bsky_tid_of_timestamp(later, 1688137381887008LL, 0);
+        TEST_ASSERT(strcmp(buf, later) < 0);
+    }
+
+    static void ident_at_uri(void)
+    {
+        enum bsky_error_code ec;
+        struct bsky_at_uri uri = bsky_parse_at_uri(bsky_mk_str(
+            "at://did:plc:z72i7hdynmk6r22z27h6tvur/app.bsky.feed.post/"
+            "3jzfcijpj2z2a"), &ec);
+
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT(bsky_str_eq(bsky_mk_str(
+            "did:plc:z72i7hdynmk6r22z27h6tvur"), uri.authority));
+        TEST_ASSERT(bsky_str_eq(bsky_mk_str("app.bsky.feed.post"),
+                                uri.collection));
+        TEST_ASSERT(bsky_str_eq(bsky_mk_str("3jzfcijpj2z2a"), uri.rkey));
+
+        uri = bsky_parse_at_uri(bsky_mk_str("at://alice.bsky.social"), &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT(bsky_str_eq(bsky_mk_str("alice.bsky.social"),
+                                uri.authority));
+        TEST_ASSERT_NULL(uri.collection.start);
+        TEST_ASSERT_NULL(uri.rkey.start);
+
+        struct {
+            char *text;
+            enum bsky_error_code ec;
+        } invalid[] = {
+            { "http://alice.bsky.social",              bsky_ec_At_uri_scheme },
+            { "at:/",                                  bsky_ec_At_uri_scheme },
+            { "at://",                              bsky_ec_At_uri_authority },
+            { "at://did:plc:/app.bsky.feed.post",   bsky_ec_At_uri_authority },
+            { "at://alice.com/",                   bsky_ec_At_uri_collection },
+            { "at://alice.com/app.bsky",           bsky_ec_At_uri_collection },
+            { "at://alice.com/app.bsky.feed.post/",      bsky_ec_At_uri_rkey },
+            { "at://alice.com/app.bsky.feed.post/a/b",   bsky_ec_At_uri_rkey },
+            { "at://alice.com/app.bsky.feed.post/a?q",   bsky_ec_At_uri_rkey },
+        };
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(invalid); ++i) {
+            uri = bsky_parse_at_uri(bsky_mk_str(invalid[i].text), &ec);
+            TEST_ASSERT_EQUAL_MESSAGE(invalid[i].ec, ec, invalid[i].text);
+            TEST_ASSERT_NULL(uri.authority.start);
+        }
+    }
+
+    static void ident_keys(void)
+    {
+        char *dids[] = {
+            "did:plc:z72i7hdynmk6r22z27h6tvur",
+            "did:plc:aaaaaaaaaaaaaaaaaaaaaaaa",
+            "did:plc:777777777777777777777777",
+            "did:plc:ewvi7nxzyoun6zhxrhs64oiz",
+        };
+        struct bsky_did_key keys[BSKY_ARRAY_LEN(dids)];
+        char buf[BSKY_DID_PLC_LEN + 1];
+
+        TEST_ASSERT_EQUAL(15, sizeof (struct bsky_did_key));
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(dids); ++i) {
+            TEST_ASSERT_TRUE(bsky_did_key_pack(bsky_mk_str(dids[i]),
+                                               &keys[i]));
+            bsky_did_key_unpack(buf, keys[i]);
+            TEST_ASSERT_EQUAL_STRING(dids[i], buf);
+        }
+
+        TEST_ASSERT_EQUAL(0, bsky_did_key_cmp(&keys[0], &keys[0]));
+        TEST_ASSERT(bsky_did_key_cmp(&keys[1], &keys[2]) < 0);
+        TEST_ASSERT(bsky_did_key_hash(keys[0]) != bsky_did_key_hash(keys[3]));
+
+        // base32 value of '7' is 31: all bits are set.
+        for (size_t i = 0; i < 15; ++i)
+            TEST_ASSERT_EQUAL(0xff, keys[2].bytes[i]);
+
+        char *invalid[] = {
+            "did:web:example.com", "did:plc:z72i7hdynmk6r22z27h6tvu",
+            "did:plc:z72i7hdynmk6r22z27h6tvu1",
+            "did:plc:Z72i7hdynmk6r22z27h6tvur",
+        };
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(invalid); ++i)
+            TEST_ASSERT_FALSE(bsky_did_key_pack(bsky_mk_str(invalid[i]),
+                                                &keys[0]));
+
+        unsigned long long fst, snd;
+        char tid[BSKY_TID_LEN + 1];
+
+        TEST_ASSERT_TRUE(bsky_tid_key_pack(bsky_mk_str("3jzfcijpj2z2a"), &fst));
+        TEST_ASSERT_EQUAL(1688137381887007ULL << 10 | 6, fst);
+        bsky_tid_key_unpack(tid, fst);
+        TEST_ASSERT_EQUAL_STRING("3jzfcijpj2z2a", tid);
+
+        TEST_ASSERT_TRUE(bsky_tid_key_pack(bsky_mk_str("3jzfcijpj2z2b"), &snd));
+        TEST_ASSERT(fst < snd);
+        TEST_ASSERT(bsky_tid_key_hash(fst) != bsky_tid_key_hash(snd));
+        TEST_ASSERT_FALSE(bsky_tid_key_pack(bsky_mk_str("3jzfcijpj2z2"), &fst));
+    }
+
+    void run_ident_tests(void)
+    {
+        RUN_TEST(ident_validate);
+        RUN_TEST(ident_tid);
+        RUN_TEST(ident_at_uri);
+        RUN_TEST(ident_keys);
+    }
+
+#endif
+
+#endif // ident-tests_h_INCLUDED
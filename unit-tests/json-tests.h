@@ -265,7 +265,7 @@ void run_json_tests(void);
         json = bsky_parse_json_str(&str, &ec);
         TEST_ASSERT_EQUAL(ec, bsky_ec_Ok);
         TEST_ASSERT(json.var == bsky_json_Str);
-        TEST_ASSERT_EQUAL_STRING("a\\\"str\\\"", json.str);
+        TEST_ASSERT_EQUAL_STRING("a\"str\"", json.str);
         TEST_ASSERT(bsky_str_len(str) == 0);
 
         str  = bsky_mk_str("  \"a\\");
@@ -369,6 +369,638 @@ void run_json_tests(void);
         TEST_ASSERT_EQUAL_STRING("Vlad", json.dct.data[1].value.str);
     }
 
+    static void json_scan_field(void)
+    {
+        struct bsky_str json = bsky_mk_str(
+            "{ \"feed\": [ { \"cursor\": \"nested\" }, \"a]\\\"\" ],"
+            "  \"obj\" : { \"cursor\": 1 },"
+            "  \"count\": 42 ,"
+            "  \"cursor\":\"3kz\\\"x\" }");
+        struct bsky_str field;
+
+        field = bsky_json_scan_field(json, "cursor");
+        TEST_ASSERT_EQUAL(6, bsky_str_len(field));
+        TEST_ASSERT_EQUAL_STRING_LEN("3kz\\\"x", field.start, 6);
+
+        field = bsky_json_scan_field(json, "count");
+        TEST_ASSERT_EQUAL(2, bsky_str_len(field));
+        TEST_ASSERT_EQUAL_STRING_LEN("42", field.start, 2);
+
+        field = bsky_json_scan_field(json, "obj");
+        TEST_ASSERT_EQUAL_STRING_LEN("{ \"cursor\": 1 }", field.start,
+                                     bsky_str_len(field));
+
+        field = bsky_json_scan_field(json, "missing");
+        TEST_ASSERT_NULL(field.start);
+
+        field = bsky_json_scan_field(bsky_mk_str("[1, 2]"), "cursor");
+        TEST_ASSERT_NULL(field.start);
+    }
+
+    static void json_path_compile(void)
+    {
+        enum bsky_error_code ec;
+        struct bsky_json_path path;
+
+        path = bsky_json_path_compile("/a~1b/*/~0/12/01/", &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL(6, path.len);
+        TEST_ASSERT_EQUAL_STRING_LEN("a/b", path.keys + path.steps[0].key,
+                                     path.steps[0].key_len);
+        TEST_ASSERT_EQUAL(bsky_json_path_Any, path.steps[1].kind);
+        TEST_ASSERT_EQUAL_STRING_LEN("~", path.keys + path.steps[2].key,
+                                     path.steps[2].key_len);
+        TEST_ASSERT_EQUAL(12, path.steps[3].index);
+        TEST_ASSERT_EQUAL(SIZE_MAX, path.steps[4].index);
+        TEST_ASSERT_EQUAL(0, path.steps[5].key_len);
+
+        path = bsky_json_path_compile("", &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL(0, path.len);
+
+        char *invalid[] = {
+            "a/b", "/a~2", "/a~",
+            "/1/2/3/4/5/6/7/8/9/10/11/12/13/14/15/16/17",
+        };
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(invalid); ++i) {
+            bsky_json_path_compile(invalid[i], &ec);
+            TEST_ASSERT_EQUAL_MESSAGE(bsky_ec_Json_path_invalid, ec,
+                                      invalid[i]);
+        }
+    }
+
+    static void json_path_query(void)
+    {
+        enum bsky_error_code ec;
+        struct bsky_str json = bsky_mk_str(
+            "{ \"cursor\": \"c\", \"feed\": ["
+            "  { \"post\": { \"record\": { \"text\": \"one\" },"
+            "               \"likes\": 1 } },"
+            "  { \"reply\": { \"post\": { \"record\": { \"text\": 0 } } },"
+            "    \"post\": { \"record\": { \"text\": \"t\\\"wo\" } } },"
+            "  { \"post\": { \"record\": { \"te\\u0078t\": [1, {}] } } },"
+            "  { \"post\": null }"
+            "] }");
+        struct bsky_json_path path = bsky_json_path_compile(
+            "/feed/" "*" "/post/record/text", &ec);
+        struct bsky_str out[8];
+
+        TEST_ASSERT_EQUAL(3, bsky_json_path_query(&path, json, out, 8, &ec));
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL_STRING_LEN("one", out[0].start, bsky_str_len(out[0]));
+        TEST_ASSERT_EQUAL_STRING_LEN("t\\\"wo", out[1].start,
+                                     bsky_str_len(out[1]));
+        TEST_ASSERT_EQUAL('"', out[1].start[-1]);
+        TEST_ASSERT_EQUAL_STRING_LEN("[1, {}]", out[2].start,
+                                     bsky_str_len(out[2]));
+
+        // stops when output is full.
+        TEST_ASSERT_EQUAL(2, bsky_json_path_query(&path, json, out, 2, &ec));
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+
+        struct { char *path, *first; } firsts[] = {
+            { "/cursor",              "c" },
+            { "/feed/1/post/record",  "{ \"text\": \"t\\\"wo\" }" },
+            { "/feed/2/*/*/text/1",   "{}" },
+            { "/feed/" "*" "/likes",  NULL },
+            { "/feed/3/post",         "null" },
+            { "/feed/4",              NULL },
+            { "/feed/01",             NULL },
+        };
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(firsts); ++i) {
+            path = bsky_json_path_compile(firsts[i].path, &ec);
+
+            struct bsky_str first = bsky_json_path_first(&path, json);
+
+            if (firsts[i].first == NULL) {
+                TEST_ASSERT_NULL_MESSAGE(first.start, firsts[i].path);
+                continue;
+            }
+            TEST_ASSERT_EQUAL_STRING_LEN_MESSAGE(firsts[i].first, first.start,
+                                                 bsky_str_len(first),
+                                                 firsts[i].path);
+            TEST_ASSERT_EQUAL(strlen(firsts[i].first), bsky_str_len(first));
+        }
+
+        // whole document and malformed one on the path.
+        path = bsky_json_path_compile("", &ec);
+        TEST_ASSERT_EQUAL(1, bsky_json_path_query(&path, json, out, 8, &ec));
+        TEST_ASSERT_EQUAL(json.end, out[0].end);
+
+        path = bsky_json_path_compile("/a/b", &ec);
+        bsky_json_path_query(&path, bsky_mk_str("{\"a\": {\"b\" 1}}"), out, 8,
+                             &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Json_expect_Colon, ec);
+        bsky_json_path_query(&path, bsky_mk_str("{\"a\": [1, 2"), out, 8, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Json_expect_CSB, ec);
+    }
+
+    static void json_parse_bounds(void)
+    {
+        enum bsky_error_code ec;
+        struct bsky_json json = { 0 };
+        struct bsky_str str   = { 0 };
+
+        // data is not null terminated, parser must stop at `end'.
+        char text[] = "{\"a\": [1, 2], \"b\": 1.5e3}";
+        for (size_t len = 0; len < sizeof text - 1; ++len) {
+            str  = (struct bsky_str) { text, text + len };
+            json = bsky_parse_json(&str, &ec);
+            TEST_ASSERT(ec != bsky_ec_Ok);
+        }
+
+        str  = bsky_mk_str("{ \"a\": [], \"b\": {} }");
+        json = bsky_parse_json(&str, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL_STRING("{\"a\":[],\"b\":{}}",
+                                 bsky_tmp_str_of_json(json).start);
+
+        str  = bsky_mk_str("[1.25, -0.5, 1e20, 123456789012, \"\"]");
+        json = bsky_parse_json(&str, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL_STRING("[1.25,-0.5,1e+20,"
+                                 "123456789012,\"\"]",
+                                 bsky_tmp_str_of_json(json).start);
+
+        char *invalid[] = { "+1", ".5", "-", "nan", "inf" };
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(invalid); ++i) {
+            str  = bsky_mk_str(invalid[i]);
+            json = bsky_parse_json_num(&str, &ec);
+            TEST_ASSERT_EQUAL(bsky_ec_Json_expect_Number, ec);
+        }
+
+        str  = bsky_mk_str("\"a\nb\"");
+        json = bsky_parse_json_str(&str, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Json_control_char, ec);
+    }
+
+    static void json_parse_escapes(void)
+    {
+        enum bsky_error_code ec;
+        struct bsky_json json = { 0 };
+        struct bsky_str str   = { 0 };
+
+        str  = bsky_mk_str("\"a\\nb\\t\\u00e9\\ud83d\\ude00\\/\"");
+        json = bsky_parse_json_str(&str, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL_STRING("a\nb\t\xc3\xa9\xf0\x9f\x98\x80/", json.str);
+
+        char *invalid[] = {
+            "\"\\x\"", "\"\\u12\"", "\"\\ud83d\"", "\"\\ude00\"",
+            "\"\\ud83d\\u0041\"", "\"\\u0000\"",
+        };
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(invalid); ++i) {
+            str  = bsky_mk_str(invalid[i]);
+            json = bsky_parse_json_str(&str, &ec);
+            TEST_ASSERT_EQUAL(bsky_ec_Json_invalid_escape, ec);
+        }
+
+        str  = bsky_mk_str("\"\xc0\xaf\"");
+        json = bsky_parse_json_str(&str, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Json_invalid_utf8, ec);
+
+        // serializer escapes what parser decoded.
+        str  = bsky_mk_str("{\"k\\\"ey\": \"line\\nbreak\\u0001\"}");
+        json = bsky_parse_json(&str, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL_STRING("{\"k\\\"ey\":\"line\\nbreak\\u0001\"}",
+                                 bsky_tmp_str_of_json(json).start);
+
+        struct bsky_str field = bsky_json_scan_field(
+            bsky_mk_str("{\"\\u0063ursor\": 1}"), "cursor");
+        TEST_ASSERT(bsky_str_eq(bsky_mk_str("1"), field));
+    }
+
+    static void json_parse_depth(void)
+    {
+        enum bsky_error_code ec;
+        struct bsky_json json = { 0 };
+        struct bsky_str str   = { 0 };
+
+        // hostile input: nesting much deeper than native stack allows.
+        size_t len = 0x100000;
+        char *deep = malloc(2 * len + 1);
+        TEST_ASSERT_NOT_NULL(deep);
+
+        memset(deep, '[', len);
+        str  = (struct bsky_str) { deep, deep + len };
+        json = bsky_parse_json(&str, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Json_too_deep, ec);
+
+        // exactly `BSKY_JSON_MAX_DEPTH' levels of mixed containers.
+        len = 0;
+        for (size_t i = 0; i < BSKY_JSON_MAX_DEPTH; ++i)
+            len += sprintf(deep + len, i % 2 ? "[" : "{\"k\":");
+        deep[len++] = '1';
+        for (size_t i = BSKY_JSON_MAX_DEPTH; i-- > 0;)
+            deep[len++] = i % 2 ? ']' : '}';
+
+        str  = (struct bsky_str) { deep, deep + len };
+        json = bsky_parse_json(&str, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL(deep + len, str.start);
+
+        struct bsky_json *value = &json;
+        for (size_t i = 0; i < BSKY_JSON_MAX_DEPTH; ++i) {
+            TEST_ASSERT_EQUAL(i % 2 ? bsky_json_Arr : bsky_json_Dct,
+                              value->var);
+            value = i % 2 ? &value->arr.data[0] : bsky_json_dct_get(*value,
+                                                                     "k");
+            TEST_ASSERT_NOT_NULL(value);
+        }
+        TEST_ASSERT_EQUAL(bsky_json_Num, value->var);
+
+        // one more level.
+        memmove(deep + 1, deep, len);
+        deep[0] = '[';
+        str  = (struct bsky_str) { deep, deep + len + 1 };
+        json = bsky_parse_json(&str, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Json_too_deep, ec);
+
+        free(deep);
+
+        // errors inside nested containers.
+        char *invalid[] = { "[[1, 2]", "[{\"a\": 1]", "{\"a\": [1}",
+                            "{\"a\" [1]}", "[{\"a\": 1,}, x]", "{1: 2}" };
+        enum bsky_error_code codes[] = {
+            bsky_ec_Json_expect_CSB, bsky_ec_Json_expect_CCB,
+            bsky_ec_Json_expect_CSB, bsky_ec_Json_expect_Colon,
+            bsky_ec_Json_invalid_variant, bsky_ec_Json_expect_OQ,
+        };
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(invalid); ++i) {
+            str  = bsky_mk_str(invalid[i]);
+            json = bsky_parse_json(&str, &ec);
+            TEST_ASSERT_EQUAL(codes[i], ec);
+        }
+
+        str  = bsky_mk_str("{\"a\": [1, {\"b\": [[], {}]}], \"c\": {}}");
+        json = bsky_parse_json(&str, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL_STRING("{\"a\":[1,{\"b\":[[],{}]}],\"c\":{}}",
+                                 bsky_tmp_str_of_json(json).start);
+    }
+
+    static void json_parse_compact(void)
+    {
+        enum bsky_error_code ec;
+        struct bsky_str str = bsky_mk_str(
+            " {\"a\": [1, {\"b\": [[], {}]}, \"x\"], \"c\": {\"d\": null},"
+            "  \"e\": true, \"f\": -2.5, \"a\": \"dup\"}");
+        struct bsky_str copy = str;
+
+        TEST_ASSERT_EQUAL(16, sizeof(struct bsky_json_node));
+
+        struct bsky_json_node *root = bsky_parse_json_compact(&str, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_NOT_NULL(root);
+        TEST_ASSERT_EQUAL(bsky_json_Dct, root->var);
+        TEST_ASSERT_EQUAL(5, root->len);
+        TEST_ASSERT_EQUAL(copy.end, str.start);
+
+        TEST_ASSERT_EQUAL_STRING("c", bsky_json_node_key(root, 1));
+        TEST_ASSERT_NULL(bsky_json_node_key(root, 5));
+        TEST_ASSERT_NULL(bsky_json_node_get(root, "z"));
+
+        // first of duplicate keys.
+        struct bsky_json_node *a = bsky_json_node_get(root, "a");
+        TEST_ASSERT_NOT_NULL(a);
+        TEST_ASSERT_EQUAL(bsky_json_Arr, a->var);
+        TEST_ASSERT_EQUAL(3, a->len);
+        TEST_ASSERT_EQUAL(1, bsky_json_node_at(a, 0)->num);
+        TEST_ASSERT_EQUAL_STRING("x", bsky_json_node_at(a, 2)->str);
+        TEST_ASSERT_EQUAL(1, bsky_json_node_at(a, 2)->len);
+        TEST_ASSERT_NULL(bsky_json_node_at(a, 3));
+
+        struct bsky_json_node *b = bsky_json_node_get(bsky_json_node_at(a, 1),
+                                                      "b");
+        TEST_ASSERT_EQUAL(2, b->len);
+        TEST_ASSERT_EQUAL(0, bsky_json_node_at(b, 0)->len);
+        TEST_ASSERT_EQUAL(bsky_json_Dct, bsky_json_node_at(b, 1)->var);
+
+        TEST_ASSERT_EQUAL(bsky_json_Null,
+                          bsky_json_node_get(bsky_json_node_get(root, "c"),
+                                             "d")->var);
+        TEST_ASSERT_TRUE(bsky_json_node_get(root, "e")->_bool);
+        TEST_ASSERT_EQUAL(-2.5, bsky_json_node_at(root, 3)->num);
+        TEST_ASSERT_EQUAL_STRING("dup", bsky_json_node_at(root, 4)->str);
+
+        // the same document as regular tree.
+        struct bsky_json json = bsky_json_of_node(root, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+
+        str = copy;
+        struct bsky_json expect = bsky_parse_json(&str, &ec);
+        TEST_ASSERT_EQUAL_STRING(bsky_tmp_str_of_json(expect).start,
+                                 bsky_tmp_str_of_json(json).start);
+
+        // scalar document and errors.
+        str  = bsky_mk_str("\"only\"");
+        root = bsky_parse_json_compact(&str, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL(bsky_json_Str, root->var);
+        TEST_ASSERT_EQUAL(4, root->len);
+
+        char *invalid[] = { "[1, 2", "{\"a\" 1}", "{\"a\": 1,", "[x]" };
+        enum bsky_error_code codes[] = {
+            bsky_ec_Json_expect_CSB, bsky_ec_Json_expect_Colon,
+            bsky_ec_Json_expect_OQ, bsky_ec_Json_invalid_variant,
+        };
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(invalid); ++i) {
+            str = bsky_mk_str(invalid[i]);
+            TEST_ASSERT_NULL(bsky_parse_json_compact(&str, &ec));
+            TEST_ASSERT_EQUAL(codes[i], ec);
+        }
+    }
+
+    static char *json_doc_str(struct bsky_json_doc *doc)
+    {
+        struct bsky_str_builder sb = { 0 };
+
+        bsky_sb_push_json_doc(&sb, doc);
+        return bsky_sb_build_tmp(&sb).start;
+    }
+
+    static void json_doc_edit(void)
+    {
+        struct bsky_json text  = { .var = bsky_json_Str, .str = "new\n" };
+        struct bsky_json num   = { .var = bsky_json_Num, .num = 7 };
+        struct bsky_json flag  = { .var = bsky_json_Bool, ._bool = 1 };
+        struct bsky_json_doc doc = { .text = bsky_mk_str(
+            "{ \"text\": \"old\",  \"n\": 1.50,\n"
+            "  \"tags\": [ \"a\", \"b\" ], \"embed\": { \"x\": [1, 2] } }") };
+
+        // untouched document is copied as is.
+        TEST_ASSERT_EQUAL_STRING(doc.text.start, json_doc_str(&doc));
+
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_json_doc_set(&doc, "/text", text));
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_json_doc_set(&doc, "/embed/x/1",
+                                                        num));
+        TEST_ASSERT_EQUAL_STRING(
+            "{ \"text\": \"new\\n\",  \"n\": 1.50,\n"
+            "  \"tags\": [ \"a\", \"b\" ], \"embed\": { \"x\": [1, 7] } }",
+            json_doc_str(&doc));
+
+        // members are added and removed, the rest keeps formatting.
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_json_doc_remove(&doc, "/n"));
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_json_doc_set(&doc, "/new", flag));
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_json_doc_set(&doc, "/tags/-",
+                                                        num));
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_json_doc_remove(&doc, "/tags/0"));
+        TEST_ASSERT_EQUAL_STRING(
+            "{\"text\": \"new\\n\",\"tags\": [\"b\",7],"
+            "\"embed\": { \"x\": [1, 7] },\"new\":true}",
+            json_doc_str(&doc));
+
+        // replaced value drops edits inside of it.
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_json_doc_set(&doc, "/embed", num));
+        TEST_ASSERT_EQUAL(bsky_ec_Json_edit_conflict,
+                          bsky_json_doc_set(&doc, "/embed/x", num));
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_json_doc_remove(&doc, "/new"));
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_json_doc_set(&doc, "/text", num));
+        TEST_ASSERT_EQUAL_STRING("{\"text\": 7,\"tags\": [\"b\",7],"
+                                 "\"embed\": 7}", json_doc_str(&doc));
+
+        TEST_ASSERT_EQUAL(bsky_ec_Json_path_not_found,
+                          bsky_json_doc_remove(&doc, "/n"));
+        TEST_ASSERT_EQUAL(bsky_ec_Json_path_not_found,
+                          bsky_json_doc_set(&doc, "/a/b", num));
+        TEST_ASSERT_EQUAL(bsky_ec_Json_path_not_found,
+                          bsky_json_doc_set(&doc, "/tags/5", num));
+        TEST_ASSERT_EQUAL(bsky_ec_Json_path_invalid,
+                          bsky_json_doc_set(&doc, "/" "*", num));
+
+        // whole document.
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_json_doc_set(&doc, "", flag));
+        TEST_ASSERT_EQUAL_STRING("true", json_doc_str(&doc));
+
+        bsky_json_doc_free(&doc);
+        TEST_ASSERT_EQUAL(0, doc.edits.len);
+
+        // removed member is set again.
+        doc.text = bsky_mk_str("{\"x\": 1, \"y\": {\"z\": 2}}");
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_json_doc_remove(&doc, "/x"));
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_json_doc_set(&doc, "/x", num));
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_json_doc_remove(&doc, "/y"));
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_json_doc_set(&doc, "/y", flag));
+        TEST_ASSERT_EQUAL_STRING("{\"x\": 7,\"y\": true}", json_doc_str(&doc));
+
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_json_doc_remove(&doc, "/x"));
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_json_doc_set(&doc, "/x", flag));
+        TEST_ASSERT_EQUAL_STRING("{\"x\": true,\"y\": true}",
+                                 json_doc_str(&doc));
+        bsky_json_doc_free(&doc);
+
+        // escaped keys and invalid text.
+        doc.text = bsky_mk_str("{\"a\\u0062\": 1, \"c\": [1 2]}");
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_json_doc_set(&doc, "/ab", num));
+        TEST_ASSERT_EQUAL(bsky_ec_Json_expect_CSB,
+                          bsky_json_doc_set(&doc, "/c/0", num));
+        bsky_json_doc_free(&doc);
+    }
+
+    static void json_batch_parse(void)
+    {
+        char texts[40][64];
+        struct bsky_str docs[40];
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(docs); ++i) {
+            int len = snprintf(texts[i], sizeof texts[i],
+                               "{\"i\": %zu, \"tags\": [\"a\", \"b%zu\"]}",
+                               i, i);
+            docs[i] = (struct bsky_str) { texts[i], texts[i] + len };
+        }
+        docs[7] = bsky_mk_str("{\"i\": 7,");
+
+        size_t threads[] = { 1, 3 };
+
+        for (size_t t = 0; t < BSKY_ARRAY_LEN(threads); ++t) {
+            // too small region at first, batch is parsed again.
+            struct bsky_json_batch batch = {
+                .threads = threads[t], .ratio = 1,
+            };
+
+            for (size_t round = 0; round < 2; ++round) {
+                TEST_ASSERT_EQUAL(bsky_ec_Json_expect_OQ,
+                                  bsky_json_batch_parse(&batch, docs,
+                                                        BSKY_ARRAY_LEN(docs)));
+                TEST_ASSERT_EQUAL(BSKY_ARRAY_LEN(docs), batch.len);
+                TEST_ASSERT_TRUE(batch.ratio > 1);
+
+                for (size_t i = 0; i < batch.len; ++i) {
+                    if (i == 7) {
+                        TEST_ASSERT_EQUAL(bsky_ec_Json_expect_OQ,
+                                          batch.ecs[i]);
+                        continue;
+                    }
+
+                    char expected[64];
+                    snprintf(expected, sizeof expected,
+                             "{\"i\":%zu,\"tags\":[\"a\",\"b%zu\"]}", i, i);
+
+                    TEST_ASSERT_EQUAL(bsky_ec_Ok, batch.ecs[i]);
+                    TEST_ASSERT_EQUAL_STRING(expected, bsky_tmp_str_of_json(
+                                                 batch.docs[i]).start);
+                }
+            }
+
+            docs[7] = bsky_mk_str("[]");
+            TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_json_batch_parse(&batch, docs,
+                                                                10));
+            TEST_ASSERT_EQUAL(bsky_json_Arr, batch.docs[7].var);
+            TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_json_batch_parse(&batch, docs,
+                                                                0));
+            TEST_ASSERT_EQUAL(0, batch.len);
+            docs[7] = bsky_mk_str("{\"i\": 7,");
+
+            bsky_json_batch_free(&batch);
+            TEST_ASSERT_NULL(batch.docs);
+        }
+
+        // parser scratch which can't grow doesn't grow the region.
+        static char text[1001];
+        struct bsky_json_batch batch = { .threads = 1 };
+
+        memset(text, 'x', sizeof text - 1);
+        text[0] = text[sizeof text - 2] = '"';
+        docs[0] = bsky_mk_str(text);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_json_batch_parse(&batch, docs, 1));
+
+        size_t ratio = batch.ratio;
+        for (size_t i = 0; i < sizeof text - 1; ++i)
+            text[i] = i % 2 ? '1' : ',';
+        text[0] = '[';
+        text[sizeof text - 3] = '1';
+        text[sizeof text - 2] = ']';
+
+        test_alloc_left = 0;
+        TEST_ASSERT_EQUAL(bsky_ec_Tmp_overflow,
+                          bsky_json_batch_parse(&batch, docs, 1));
+        test_alloc_left = -1;
+        TEST_ASSERT_EQUAL(ratio, batch.ratio);
+
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_json_batch_parse(&batch, docs, 1));
+        TEST_ASSERT_EQUAL(499, batch.docs[0].arr.len);
+        bsky_json_batch_free(&batch);
+    }
+
+    static void json_canonical(void)
+    {
+        enum bsky_error_code ec;
+        char *cid =
+            "bafyreietui4xdkiu4xvmx4fi2jivjtndbhb4drzpxomrjvd4mdz4w2avra";
+        char text[512];
+
+        snprintf(text, sizeof text, "{\"text\": \"hi\", \"$type\": \"post\", "
+                 "\"createdAt\": \"2024\", \"langs\": [\"en\"], \"n\": -3, "
+                 "\"f\": 15, \"b\": {\"$bytes\": \"AQID\"}, "
+                 "\"l\": {\"$link\": \"%s\"}}", cid);
+
+        struct bsky_str str = bsky_mk_str(text);
+        struct bsky_json json = bsky_parse_json(&str, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+
+        // shorter keys first, then bytewise.
+        struct bsky_bytes expected = { 0 };
+
+        bsky_cbor_push_map(&expected, 8);
+        bsky_cbor_push_text(&expected, bsky_mk_str("b"));
+        bsky_cbor_push_bytes(&expected, (struct bsky_view) {
+            "\1\2\3", "\1\2\3" + 3
+        });
+        bsky_cbor_push_text(&expected, bsky_mk_str("f"));
+        bsky_cbor_push_int(&expected, 15);
+        bsky_cbor_push_text(&expected, bsky_mk_str("l"));
+        bsky_cbor_push_link(&expected, bsky_parse_cid(bsky_mk_str(cid), &ec));
+        bsky_cbor_push_text(&expected, bsky_mk_str("n"));
+        bsky_cbor_push_int(&expected, -3);
+        bsky_cbor_push_text(&expected, bsky_mk_str("text"));
+        bsky_cbor_push_text(&expected, bsky_mk_str("hi"));
+        bsky_cbor_push_text(&expected, bsky_mk_str("$type"));
+        bsky_cbor_push_text(&expected, bsky_mk_str("post"));
+        bsky_cbor_push_text(&expected, bsky_mk_str("langs"));
+        bsky_cbor_push_arr(&expected, 1);
+        bsky_cbor_push_text(&expected, bsky_mk_str("en"));
+        bsky_cbor_push_text(&expected, bsky_mk_str("createdAt"));
+        bsky_cbor_push_text(&expected, bsky_mk_str("2024"));
+
+        // without cache, missed and cached shapes give the same bytes.
+        struct bsky_json_key_cache cache = { 0 };
+        struct bsky_bytes buf = { 0 };
+
+        for (int round = 0; round < 3; ++round) {
+            buf.len = 0;
+            TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_cbor_push_json(
+                                  &buf, json, round ? &cache : NULL));
+            TEST_ASSERT_EQUAL(expected.len, buf.len);
+            TEST_ASSERT_EQUAL_MEMORY(expected.data, buf.data, buf.len);
+        }
+        // `$bytes' and `$link' are not shapes.
+        TEST_ASSERT_EQUAL(1, cache.len);
+        TEST_ASSERT_EQUAL(1, cache.hits);
+
+        struct bsky_str_builder sb = { 0 };
+        TEST_ASSERT_EQUAL(bsky_ec_Ok,
+                          bsky_sb_push_json_canonical(&sb, json, &cache));
+        bsky_sb_push(&sb, '\0');
+        snprintf(text, sizeof text, "{\"$type\":\"post\",\"b\":{\"$bytes\":"
+                 "\"AQID\"},\"createdAt\":\"2024\",\"f\":15,\"l\":{\"$link\":"
+                 "\"%s\"},\"langs\":[\"en\"],\"n\":-3,\"text\":\"hi\"}", cid);
+        TEST_ASSERT_EQUAL_STRING(text, sb.data);
+
+        // same shape in other order is other shape, but same encoding.
+        char *reordered = "{\"b\": 1, \"a\": 2, \"ab\": {\"a\": null}}";
+        char *ordered   = "{\"a\": 2, \"ab\": {\"a\": null}, \"b\": 1}";
+        struct bsky_bytes other = { 0 };
+
+        str  = bsky_mk_str(reordered);
+        json = bsky_parse_json(&str, &ec);
+        buf.len = 0;
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_cbor_push_json(&buf, json,
+                                                          &cache));
+        str  = bsky_mk_str(ordered);
+        json = bsky_parse_json(&str, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_cbor_push_json(&other, json,
+                                                          &cache));
+        TEST_ASSERT_EQUAL(other.len, buf.len);
+        TEST_ASSERT_EQUAL_MEMORY(other.data, buf.data, buf.len);
+
+        // values without canonical encoding.
+        char *invalid[] = {
+            "{\"a\": 1, \"b\": 2, \"a\": 3}",
+            "[{\"$bytes\": \"AQJ\"}]",
+            "{\"$bytes\": \"AQ-D\"}",
+            "{\"$bytes\": \"A\"}",
+            "{\"f\": 1.5}",
+            "[9223372036854775808]",
+        };
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(invalid); ++i) {
+            str  = bsky_mk_str(invalid[i]);
+            json = bsky_parse_json(&str, &ec);
+            TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+            TEST_ASSERT_EQUAL(bsky_ec_Json_not_canonical,
+                              bsky_cbor_push_json(&buf, json, &cache));
+        }
+
+        json = (struct bsky_json) { .var = bsky_json_Num, .num = NAN };
+        TEST_ASSERT_EQUAL(bsky_ec_Json_not_canonical,
+                          bsky_cbor_push_json(&buf, json, NULL));
+
+        str  = bsky_mk_str("{\"$link\": \"bafy\"}");
+        json = bsky_parse_json(&str, &ec);
+        TEST_ASSERT_NOT_EQUAL(bsky_ec_Ok,
+                              bsky_cbor_push_json(&buf, json, NULL));
+
+        bsky_json_key_cache_free(&cache);
+        TEST_ASSERT_NULL(cache.slots);
+        bsky_da_free(&expected);
+        bsky_da_free(&other);
+        bsky_da_free(&buf);
+        bsky_da_free(&sb);
+    }
+
     void run_json_tests(void)
     {
         RUN_TEST(json_to_string_array_nums);
@@ -380,6 +1012,16 @@ void run_json_tests(void);
         RUN_TEST(json_parse_str);
         RUN_TEST(json_parse_arr);
         RUN_TEST(json_parse_dct);
+        RUN_TEST(json_scan_field);
+        RUN_TEST(json_path_compile);
+        RUN_TEST(json_path_query);
+        RUN_TEST(json_parse_bounds);
+        RUN_TEST(json_parse_escapes);
+        RUN_TEST(json_parse_depth);
+        RUN_TEST(json_parse_compact);
+        RUN_TEST(json_doc_edit);
+        RUN_TEST(json_batch_parse);
+        RUN_TEST(json_canonical);
     }
 
 #endif
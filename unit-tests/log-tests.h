@@ -0,0 +1,166 @@
+#ifndef log_tests_h_INCLUDED
+#define log_tests_h_INCLUDED
+
+void run_log_tests(void);
+
+
+#ifdef IMPLEMENT_TESTS
+    #include "../bsky-api.h"
+    #include <unity.h>
+
+    static char *read_log(FILE *out)
+    {
+        static char buf[1024];
+        size_t len;
+
+        rewind(out);
+        len = fread(buf, 1, sizeof buf - 1, out);
+        buf[len] = '\0';
+
+        return buf;
+    }
+
+    static void log_async_format(void)
+    {
+        FILE *out = tmpfile();
+        char name[] = "alice";
+        size_t count = 3;
+
+        bsky_log_async_output(out);
+
+        bsky_log_async(bsky_log_Info, "%s has %zu posts", name, count);
+
+        // string args are copied, so changing buffer doesn't matter.
+        name[0] = 'A';
+
+        bsky_log_async(bsky_log_Info, "[%5d|%-3u|%x|%c]", -42, 7u, 255, 'z');
+        bsky_log_async(bsky_log_Info, "%.2f %e %ld%%", 1.5, 100.0, -3L);
+        bsky_log_async(bsky_log_Error, "%s. %s:%d",
+                       bsky_str_of_error_code(bsky_ec_Xrpc_status),
+                       "file.c", 10);
+        bsky_log_async(bsky_log_Warning, "%s %s", (char *) NULL, "x");
+        bsky_log_async(bsky_log_Info, "%p %s", (void *) 0x10, "extra %d");
+
+        bsky_log_async_flush();
+
+        TEST_ASSERT_EQUAL_STRING(
+            "[INF]: `alice has 3 posts'\n"
+            "[INF]: `[  -42|7  |ff|z]'\n"
+            "[INF]: `1.50 1.000000e+02 -3%'\n"
+            "\x1b[31m[ERR]: `XRPC: server respond with error status!. "
+            "file.c:10'\n\x1b[0m"
+            "\x1b[33m[WAR]: `(null) x'\n\x1b[0m"
+            "[INF]: `0x10 extra %d'\n",
+            read_log(out));
+
+        bsky_log_async_stop();
+        bsky_log_async_output(NULL);
+        fclose(out);
+        TEST_ASSERT_EQUAL(0, bsky_log_async_dropped());
+    }
+
+    static void log_async_restart(void)
+    {
+        FILE *out = tmpfile();
+
+        bsky_log_async_output(out);
+
+        for (int i = 0; i < 3; ++i) {
+            bsky_log_async(bsky_log_Info, "run %d", i);
+            bsky_log_async_stop();
+        }
+
+        TEST_ASSERT_EQUAL_STRING("[INF]: `run 0'\n"
+                                 "[INF]: `run 1'\n"
+                                 "[INF]: `run 2'\n",
+                                 read_log(out));
+
+        bsky_log_async_output(NULL);
+        fclose(out);
+    }
+
+    static void *log_async_thread(void *arg)
+    {
+        bsky_log_async(bsky_log_Info, "thread %d", *(int *) arg);
+        return NULL;
+    }
+
+    static size_t log_async_rings(void)
+    {
+        size_t len = 0;
+
+        for (struct bsky_log_ring *ring = atomic_load(&__bsky_log_rings);
+             ring != NULL; ring = ring->next)
+            len++;
+
+        return len;
+    }
+
+    static void log_async_thread_exit(void)
+    {
+        FILE *out = tmpfile();
+        size_t rings = 0;
+
+        bsky_log_async_output(out);
+
+        // ring of exited thread is reused by the next one.
+        for (int i = 0; i < 4; ++i) {
+            pthread_t thread;
+
+            pthread_create(&thread, NULL, log_async_thread, &i);
+            pthread_join(thread, NULL);
+            bsky_log_async_flush();
+
+            if (i == 0) rings = log_async_rings();
+            TEST_ASSERT_EQUAL_INT(rings, log_async_rings());
+        }
+
+        TEST_ASSERT_EQUAL_STRING("[INF]: `thread 0'\n"
+                                 "[INF]: `thread 1'\n"
+                                 "[INF]: `thread 2'\n"
+                                 "[INF]: `thread 3'\n",
+                                 read_log(out));
+
+        bsky_log_async_output(NULL);
+        fclose(out);
+    }
+
+    static void log_async_idle(void)
+    {
+        FILE *out = tmpfile();
+
+        bsky_log_async_output(out);
+        bsky_log_async(bsky_log_Info, "run %d", 1);
+        bsky_log_async_flush();
+
+        // idle worker parks instead of polling.
+        while (!atomic_load(&__bsky_log_parked)) sched_yield();
+
+        size_t cycles = atomic_load(&__bsky_log_cycles);
+        struct timespec ts = { 0, 20 * 1000 * 1000 };
+        nanosleep(&ts, NULL);
+        TEST_ASSERT_EQUAL(cycles, atomic_load(&__bsky_log_cycles));
+
+        bsky_log_async(bsky_log_Info, "run %d", 2);
+        bsky_log_async_flush();
+
+        TEST_ASSERT_EQUAL_STRING("[INF]: `run 1'\n"
+                                 "[INF]: `run 2'\n",
+                                 read_log(out));
+
+        bsky_log_async_stop();
+        bsky_log_async_output(NULL);
+        fclose(out);
+    }
+
+    void run_log_tests(void)
+    {
+        RUN_TEST(log_async_format);
+        RUN_TEST(log_async_restart);
+        RUN_TEST(log_async_thread_exit);
+        RUN_TEST(log_async_idle);
+    }
+
+#endif
+
+#endif // log-tests_h_INCLUDED
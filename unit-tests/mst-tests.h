@@ -0,0 +1,370 @@
+#ifndef mst_tests_h_INCLUDED
+#define mst_tests_h_INCLUDED
+
+void run_mst_tests(void);
+
+
+#ifdef IMPLEMENT_TESTS
+    #include "../bsky-api.h"
+    #include <unity.h>
+
+    #define MST_TEST_KEYS 2000
+
+    static char mst_keys[MST_TEST_KEYS][32];
+
+    // sorted keys of record per id, values differ per `version'.
+    static void mst_entries(struct bsky_mst_entry *entries, size_t len,
+                            int version)
+    {
+        for (size_t i = 0; i < len; ++i) {
+            int n = snprintf(mst_keys[i], sizeof mst_keys[i],
+                             "app.bsky.feed.post/%06zu", i * 7);
+            struct bsky_view v = { &version, &version + 1 };
+
+            entries[i].key   = (struct bsky_str) { mst_keys[i],
+                                                   mst_keys[i] + n };
+            entries[i].value = bsky_cid_of_block(bsky_cid_Dag_cbor, v);
+            entries[i].value.digest[0] = i;
+            entries[i].value.digest[1] = i >> 8;
+        }
+    }
+
+    static void mst_key_layer(void)
+    {
+        struct { char *key; int layer; } keys[] = {
+            { "", 0 }, { "asdf", 0 }, { "blue", 1 }, { "2653ae71", 0 },
+            { "88bfafc7", 2 }, { "2a92d355", 4 }, { "884976f5", 6 },
+            { "app.bsky.feed.post/454397e440ec", 4 },
+            { "app.bsky.feed.post/9adeb165882c", 8 },
+        };
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(keys); ++i)
+            TEST_ASSERT_EQUAL_MESSAGE(keys[i].layer,
+                bsky_mst_key_layer(bsky_mk_str(keys[i].key)), keys[i].key);
+    }
+
+    // root CIDs of reference implementation.
+    static void mst_build_interop(void)
+    {
+        enum bsky_error_code ec;
+        struct bsky_block_map map = { 0 };
+        struct bsky_block_store store = bsky_block_map_store(&map);
+        struct bsky_mst_entry entries[6];
+        char buf[BSKY_CID_STR_LEN + 1];
+
+        struct bsky_str value_str = bsky_mk_str(
+            "bafyreie5cvv4h45feadgeuwhbcutmh6t2ceseocckahdoe6uat64zmz454");
+        struct bsky_cid value = bsky_parse_cid(value_str, &ec);
+
+        char *keys[] = {
+            "com.example.record/3jqfcqzm3fo2j",
+            "com.example.record/3jqfcqzm3fp2j",
+            "com.example.record/3jqfcqzm3fr2j",
+            "com.example.record/3jqfcqzm3fs2j", // layer 1
+            "com.example.record/3jqfcqzm3ft2j",
+            "com.example.record/3jqfcqzm4fc2j",
+        };
+        struct { size_t from, len; char *root; } cases[] = {
+            { 0, 0,
+              "bafyreie5737gdxlw5i64vzichcalba3z2v5n6icifvx5xytvske7mr3hpm" },
+            { 0, 1,
+              "bafyreibj4lsc3aqnrvphp5xmrnfoorvru4wynt6lwidqbm2623a6tatzdu" },
+            { 1, 5,
+              "bafyreicmahysq4n6wfuxo522m6dpiy7z7qzym3dzs756t5n7nfdgccwq7m" },
+        };
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(keys); ++i)
+            entries[i] = (struct bsky_mst_entry) { bsky_mk_str(keys[i]),
+                                                   value };
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(cases); ++i) {
+            struct bsky_cid root = bsky_mst_build(store,
+                                                  entries + cases[i].from,
+                                                  cases[i].len, &ec);
+
+            TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+            bsky_cid_format(buf, root);
+            TEST_ASSERT_EQUAL_STRING(cases[i].root, buf);
+        }
+
+        // three nodes: layer 1 root and two leaves.
+        TEST_ASSERT_EQUAL(2 + 3, map.len);
+
+        // node which can't be encoded isn't stored under wrong CID, even
+        // if following allocations succeed.
+        for (long left = 0, done = 0; !done; ++left) {
+            struct bsky_block_map oom_map = { 0 };
+            struct bsky_block_store oom_store = bsky_block_map_store(&oom_map);
+
+            test_alloc_left = left;
+            test_alloc_once = 1;
+            struct bsky_cid root = bsky_mst_build(oom_store, entries + 1, 5,
+                                                  &ec);
+            done = test_alloc_left > 0;
+            test_alloc_left = -1;
+            test_alloc_once = 0;
+
+            if (ec == bsky_ec_Ok) {
+                bsky_cid_format(buf, root);
+                TEST_ASSERT_EQUAL_STRING(cases[2].root, buf);
+            } else {
+                TEST_ASSERT_EQUAL(bsky_ec_Tmp_overflow, ec);
+            }
+            bsky_block_map_free(&oom_map);
+        }
+
+        entries[1] = entries[0];
+        bsky_mst_build(store, entries, 2, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Mst_unsorted_keys, ec);
+
+        bsky_block_map_free(&map);
+    }
+
+    static void mst_iterate(void)
+    {
+        enum bsky_error_code ec;
+        static struct bsky_mst_entry entries[MST_TEST_KEYS];
+        struct bsky_block_map map = { 0 };
+        struct bsky_block_store store = bsky_block_map_store(&map);
+
+        mst_entries(entries, MST_TEST_KEYS, 0);
+
+        struct bsky_cid root = bsky_mst_build(store, entries, MST_TEST_KEYS,
+                                              &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+
+        struct bsky_mst_iter iter = bsky_mst_iter_init(store, root);
+        struct bsky_mst_entry entry;
+        size_t count = 0;
+
+        while (bsky_mst_next(&iter, &entry, &ec)) {
+            TEST_ASSERT_TRUE(count < MST_TEST_KEYS);
+            TEST_ASSERT_TRUE(bsky_str_eq(entries[count].key, entry.key));
+            TEST_ASSERT_TRUE(bsky_cid_eq(entries[count].value, entry.value));
+            count++;
+        }
+
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL(MST_TEST_KEYS, count);
+        TEST_ASSERT_EQUAL(map.len, iter.loaded);
+        TEST_ASSERT_FALSE(bsky_mst_next(&iter, &entry, &ec));
+        bsky_mst_iter_free(&iter);
+
+        struct bsky_cid value;
+        for (size_t i = 0; i < MST_TEST_KEYS; i += 97) {
+            TEST_ASSERT_TRUE(bsky_mst_get(store, root, entries[i].key,
+                                          &value, &ec));
+            TEST_ASSERT_TRUE(bsky_cid_eq(entries[i].value, value));
+        }
+
+        char *missing[] = { "a", "app.bsky.feed.post/000001", "zzz" };
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(missing); ++i) {
+            TEST_ASSERT_FALSE(bsky_mst_get(store, root,
+                              bsky_mk_str(missing[i]), &value, &ec));
+            TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        }
+
+        // tree with missing blocks.
+        struct bsky_block_map partial = { .borrow = 1 };
+        struct bsky_view block;
+
+        store.get(store.ctx, root, &block);
+        bsky_block_map_put(&partial, root, block);
+
+        iter = bsky_mst_iter_init(bsky_block_map_store(&partial), root);
+        while (bsky_mst_next(&iter, &entry, &ec)) {}
+        TEST_ASSERT_EQUAL(bsky_ec_Block_not_found, ec);
+        bsky_mst_iter_free(&iter);
+
+        bsky_block_map_free(&partial);
+        bsky_block_map_free(&map);
+    }
+
+    static void mst_invalid_node(void)
+    {
+        enum bsky_error_code ec;
+        struct bsky_block_map map = { 0 };
+        struct bsky_block_store store = bsky_block_map_store(&map);
+        struct bsky_bytes node = { 0 };
+        struct bsky_cid value = bsky_cid_of_block(bsky_cid_Raw,
+                                                  (struct bsky_view) { 0 });
+
+        // {"e": [{"k": "b", "p": 0, ...}, {"k": "a", "p": p, ...}]}
+        for (int prefix = 0; prefix < 3; ++prefix) {
+            node.len = 0;
+            bsky_cbor_push_map(&node, 2);
+            bsky_cbor_push_text(&node, bsky_mk_str("e"));
+            bsky_cbor_push_arr(&node, 2);
+
+            for (int i = 0; i < 2; ++i) {
+                bsky_cbor_push_map(&node, 4);
+                bsky_cbor_push_text(&node, bsky_mk_str("k"));
+                bsky_cbor_push_bytes(&node, (struct bsky_view) {
+                                     i ? "a" : "b", (i ? "a" : "b") + 1 });
+                bsky_cbor_push_text(&node, bsky_mk_str("p"));
+                bsky_cbor_push_int(&node, i ? prefix : 0);
+                bsky_cbor_push_text(&node, bsky_mk_str("t"));
+                bsky_cbor_push_null(&node);
+                bsky_cbor_push_text(&node, bsky_mk_str("v"));
+                bsky_cbor_push_link(&node, value);
+            }
+
+            bsky_cbor_push_text(&node, bsky_mk_str("l"));
+            bsky_cbor_push_null(&node);
+
+            struct bsky_view block = { node.data, node.data + node.len };
+            struct bsky_cid root = bsky_cid_of_block(bsky_cid_Dag_cbor,
+                                                     block);
+            struct bsky_mst_iter iter;
+            struct bsky_mst_entry entry;
+
+            bsky_block_map_put(&map, root, block);
+            iter = bsky_mst_iter_init(store, root);
+
+            // "b" then "a" or "ba", prefix 2 is longer than "b".
+            if (prefix == 1) {
+                TEST_ASSERT_TRUE(bsky_mst_next(&iter, &entry, &ec));
+                TEST_ASSERT_TRUE(bsky_mst_next(&iter, &entry, &ec));
+                TEST_ASSERT_TRUE(bsky_str_eq(bsky_mk_str("ba"), entry.key));
+                TEST_ASSERT_FALSE(bsky_mst_next(&iter, &entry, &ec));
+                TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+            } else {
+                TEST_ASSERT_FALSE(bsky_mst_next(&iter, &entry, &ec));
+                TEST_ASSERT_EQUAL(bsky_ec_Mst_invalid_node, ec);
+            }
+
+            bsky_mst_iter_free(&iter);
+        }
+
+        // {"l": null, "e": []}, keys are not sorted.
+        node.len = 0;
+        bsky_cbor_push_map(&node, 2);
+        bsky_cbor_push_text(&node, bsky_mk_str("l"));
+        bsky_cbor_push_null(&node);
+        bsky_cbor_push_text(&node, bsky_mk_str("e"));
+        bsky_cbor_push_arr(&node, 0);
+
+        struct bsky_view block = { node.data, node.data + node.len };
+        struct bsky_cid root = bsky_cid_of_block(bsky_cid_Dag_cbor, block);
+        struct bsky_mst_iter iter;
+        struct bsky_mst_entry entry;
+
+        bsky_block_map_put(&map, root, block);
+        iter = bsky_mst_iter_init(store, root);
+
+        TEST_ASSERT_FALSE(bsky_mst_next(&iter, &entry, &ec));
+        TEST_ASSERT_EQUAL(bsky_ec_Mst_invalid_node, ec);
+        bsky_mst_iter_free(&iter);
+
+        bsky_da_free(&node);
+        bsky_block_map_free(&map);
+    }
+
+    struct mst_diff_ops {
+        struct bsky_mst_op ops[MST_TEST_KEYS];
+        char keys[MST_TEST_KEYS][32];
+        size_t len;
+    };
+
+    static enum bsky_error_code mst_collect(void *ctx,
+                                            const struct bsky_mst_op *op)
+    {
+        struct mst_diff_ops *ops = ctx;
+
+        char *key = ops->keys[ops->len];
+        size_t len = bsky_str_len(op->key);
+
+        // keys are only valid during call.
+        memcpy(key, op->key.start, len);
+        ops->ops[ops->len] = *op;
+        ops->ops[ops->len++].key = (struct bsky_str) { key, key + len };
+
+        return bsky_ec_Ok;
+    }
+
+    static void mst_diff(void)
+    {
+        enum bsky_error_code ec;
+        static struct bsky_mst_entry from[MST_TEST_KEYS], to[MST_TEST_KEYS],
+                                     updated[MST_TEST_KEYS];
+        static struct mst_diff_ops ops;
+        struct bsky_block_map map = { 0 };
+        struct bsky_block_store store = bsky_block_map_store(&map);
+        size_t to_len = 0, loaded = 0;
+
+        mst_entries(from, MST_TEST_KEYS, 0);
+        mst_entries(updated, MST_TEST_KEYS, 1);
+
+        // delete every 500th, update every 300th.
+        for (size_t i = 0; i < MST_TEST_KEYS; ++i) {
+            if (i % 500 == 3) continue;
+
+            to[to_len] = from[i];
+            if (i % 300 == 5) to[to_len].value = updated[i].value;
+            to_len++;
+        }
+
+        struct bsky_cid root_from = bsky_mst_build(store, from, MST_TEST_KEYS,
+                                                   &ec);
+        size_t nodes = map.len;
+        struct bsky_cid root_to = bsky_mst_build(store, to, to_len, &ec);
+
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+
+        ops.len = 0;
+        ec = bsky_mst_diff(store, root_from, root_to, mst_collect, &ops,
+                           &loaded);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL(4 + 7, ops.len);
+
+        for (size_t i = 0, op = 0; i < MST_TEST_KEYS; ++i) {
+            if (i % 500 != 3 && i % 300 != 5) continue;
+
+            TEST_ASSERT_EQUAL(i % 500 == 3 ? bsky_mst_Delete
+                                           : bsky_mst_Update,
+                              ops.ops[op].kind);
+            TEST_ASSERT_TRUE(bsky_str_eq(from[i].key, ops.ops[op].key));
+            TEST_ASSERT_TRUE(bsky_cid_eq(from[i].value, ops.ops[op].prev));
+            op++;
+        }
+
+        // only changed paths are loaded.
+        TEST_ASSERT_TRUE(loaded < nodes / 4);
+
+        // back: deleted keys are created.
+        ops.len = 0;
+        ec = bsky_mst_diff(store, root_to, root_from, mst_collect, &ops,
+                           NULL);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL(11, ops.len);
+        TEST_ASSERT_EQUAL(bsky_mst_Create, ops.ops[0].kind);
+        TEST_ASSERT_TRUE(bsky_cid_eq(from[3].value, ops.ops[0].value));
+
+        ec = bsky_mst_diff(store, root_to, root_to, mst_collect, &ops,
+                           &loaded);
+        TEST_ASSERT_EQUAL(0, loaded);
+
+        // from empty tree everything is created.
+        struct bsky_cid empty = bsky_mst_build(store, NULL, 0, &ec);
+
+        ops.len = 0;
+        ec = bsky_mst_diff(store, empty, root_from, mst_collect, &ops, NULL);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL(MST_TEST_KEYS, ops.len);
+        TEST_ASSERT_EQUAL(bsky_mst_Create, ops.ops[MST_TEST_KEYS - 1].kind);
+
+        bsky_block_map_free(&map);
+    }
+
+    void run_mst_tests(void)
+    {
+        RUN_TEST(mst_key_layer);
+        RUN_TEST(mst_build_interop);
+        RUN_TEST(mst_iterate);
+        RUN_TEST(mst_invalid_node);
+        RUN_TEST(mst_diff);
+    }
+
+#endif
+
+#endif // mst-tests_h_INCLUDED
@@ -0,0 +1,78 @@
+#ifndef probe_tests_h_INCLUDED
+#define probe_tests_h_INCLUDED
+
+void run_probe_tests(void);
+
+
+#ifdef IMPLEMENT_TESTS
+    #include "../bsky-api.h"
+    #include <unity.h>
+
+    static long double probe_field(struct bsky_json snapshot,
+                                   char *probe, char *field)
+    {
+        struct bsky_json *stat = bsky_json_dct_get(snapshot, probe);
+        TEST_ASSERT_NOT_NULL(stat);
+
+        struct bsky_json *value = bsky_json_dct_get(*stat, field);
+        TEST_ASSERT_NOT_NULL(value);
+
+        return value->num;
+    }
+
+    static void probe_snapshot(void)
+    {
+        enum bsky_error_code ec;
+
+        bsky_probe_reset();
+
+        char text[] = "{\"a\": [1, 2, {\"b\": null}]}";
+        struct bsky_str str = bsky_mk_str(text);
+        struct bsky_json json = bsky_parse_json(&str, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+
+        struct bsky_str out = bsky_tmp_str_of_json(json);
+
+        struct bsky_json snapshot = bsky_probe_snapshot();
+        TEST_ASSERT_EQUAL(bsky_json_Dct, snapshot.var);
+
+        struct bsky_json *enabled = bsky_json_dct_get(snapshot, "enabled");
+        TEST_ASSERT_NOT_NULL(enabled);
+
+        struct bsky_json *hist = bsky_json_dct_get(
+            *bsky_json_dct_get(snapshot, "parse_json"), "hist");
+        TEST_ASSERT_EQUAL(BSKY_PROBE_BUCKETS, hist->arr.len);
+
+        #ifdef BSKY_INSTRUMENT
+            TEST_ASSERT_TRUE(enabled->_bool);
+
+            // nested values are counted once, by outermost call.
+            TEST_ASSERT_EQUAL(1, probe_field(snapshot, "parse_json", "count"));
+            TEST_ASSERT_EQUAL(sizeof text - 1,
+                              probe_field(snapshot, "parse_json", "bytes"));
+            TEST_ASSERT_EQUAL(1, probe_field(snapshot, "sb_push_json", "count"));
+            TEST_ASSERT_EQUAL(bsky_str_len(out),
+                              probe_field(snapshot, "sb_push_json", "bytes"));
+            TEST_ASSERT_TRUE(probe_field(snapshot, "tmp_alloc", "count") > 0);
+            TEST_ASSERT_TRUE(probe_field(snapshot, "da_realloc", "count") > 0);
+
+            long double total = 0;
+            for (size_t i = 0; i < hist->arr.len; ++i)
+                total += hist->arr.data[i].num;
+            TEST_ASSERT_EQUAL(1, total);
+        #else
+            (void) out;
+            TEST_ASSERT_FALSE(enabled->_bool);
+            TEST_ASSERT_EQUAL(0, probe_field(snapshot, "parse_json", "count"));
+            TEST_ASSERT_EQUAL(0, probe_field(snapshot, "tmp_alloc", "count"));
+        #endif
+    }
+
+    void run_probe_tests(void)
+    {
+        RUN_TEST(probe_snapshot);
+    }
+
+#endif
+
+#endif // probe-tests_h_INCLUDED
@@ -0,0 +1,251 @@
+#ifndef repo_tests_h_INCLUDED
+#define repo_tests_h_INCLUDED
+
+void run_repo_tests(void);
+
+
+#ifdef IMPLEMENT_TESTS
+    #include "../bsky-api.h"
+    #include <unity.h>
+    #include <stdatomic.h>
+    #include <unistd.h>
+
+    static void repo_commit(void)
+    {
+        enum bsky_error_code ec;
+        struct bsky_bytes buf = { 0 };
+        struct bsky_commit commit = {
+            .did     = bsky_mk_str("did:plc:ewvi7nxzyoun6zhxrhs64oiz"),
+            .rev     = bsky_mk_str("3jzfcijpj2z2a"),
+            .data    = bsky_cid_of_block(bsky_cid_Dag_cbor,
+                                         (struct bsky_view) { 0 }),
+            .version = 3,
+        };
+
+        bsky_cbor_push_commit(&buf, &commit);
+
+        struct bsky_view block = { buf.data, buf.data + buf.len };
+        struct bsky_commit parsed = bsky_parse_commit(block, &ec);
+
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_TRUE(bsky_str_eq(commit.did, parsed.did));
+        TEST_ASSERT_TRUE(bsky_str_eq(commit.rev, parsed.rev));
+        TEST_ASSERT_TRUE(bsky_cid_eq(commit.data, parsed.data));
+        TEST_ASSERT_EQUAL(0, parsed.prev.codec);
+        TEST_ASSERT_NULL(parsed.sig.start);
+        TEST_ASSERT_EQUAL(3, parsed.version);
+
+        // signed commit with prev.
+        commit.prev = commit.data;
+        commit.sig  = (struct bsky_view) { "\1\2\3", "\1\2\3" + 3 };
+
+        buf.len = 0;
+        bsky_cbor_push_commit(&buf, &commit);
+        block  = (struct bsky_view) { buf.data, buf.data + buf.len };
+        parsed = bsky_parse_commit(block, &ec);
+
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_TRUE(bsky_cid_eq(commit.data, parsed.prev));
+        TEST_ASSERT_EQUAL(3, (char *) parsed.sig.end -
+                             (char *) parsed.sig.start);
+
+        // bad version and bad DID.
+        commit.version = 4;
+        buf.len = 0;
+        bsky_cbor_push_commit(&buf, &commit);
+        block = (struct bsky_view) { buf.data, buf.data + buf.len };
+        bsky_parse_commit(block, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Repo_invalid_commit, ec);
+
+        commit.version = 3;
+        commit.did     = bsky_mk_str("plc:ewvi7nxzyoun6zhxrhs64oiz");
+        buf.len = 0;
+        bsky_cbor_push_commit(&buf, &commit);
+        block = (struct bsky_view) { buf.data, buf.data + buf.len };
+        bsky_parse_commit(block, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Repo_invalid_commit, ec);
+
+        bsky_da_free(&buf);
+    }
+
+    #define REPO_TEST_RECORDS 50
+
+    // repository of `records' posts as CAR file in directory.
+    static void repo_write(const char *dir, const char *name, size_t records)
+    {
+        enum bsky_error_code ec;
+        struct bsky_block_map map = { 0 };
+        struct bsky_block_store store = bsky_block_map_store(&map);
+        struct bsky_mst_entry entries[REPO_TEST_RECORDS];
+        char keys[REPO_TEST_RECORDS][48];
+        struct bsky_bytes buf = { 0 };
+
+        for (size_t i = 0; i < records; ++i) {
+            buf.len = 0;
+            bsky_cbor_push_map(&buf, 2);
+            bsky_cbor_push_text(&buf, bsky_mk_str("text"));
+            bsky_cbor_push_int(&buf, i);
+            bsky_cbor_push_text(&buf, bsky_mk_str("$type"));
+            bsky_cbor_push_text(&buf, bsky_mk_str("app.bsky.feed.post"));
+
+            struct bsky_view record = { buf.data, buf.data + buf.len };
+            int len = snprintf(keys[i], sizeof keys[i],
+                               "app.bsky.feed.post/%s%04zu", name, i);
+
+            entries[i].key   = (struct bsky_str) { keys[i], keys[i] + len };
+            entries[i].value = bsky_cid_of_block(bsky_cid_Dag_cbor, record);
+            bsky_block_map_put(&map, entries[i].value, record);
+        }
+
+        struct bsky_commit commit = {
+            .did     = bsky_mk_str("did:plc:ewvi7nxzyoun6zhxrhs64oiz"),
+            .rev     = bsky_mk_str("3jzfcijpj2z2a"),
+            .data    = bsky_mst_build(store, entries, records, &ec),
+            .version = 3,
+        };
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+
+        buf.len = 0;
+        bsky_cbor_push_commit(&buf, &commit);
+
+        struct bsky_view block = { buf.data, buf.data + buf.len };
+        struct bsky_cid root = bsky_cid_of_block(bsky_cid_Dag_cbor, block);
+        struct bsky_bytes car = { 0 };
+
+        bsky_car_push_header(&car, root);
+        bsky_car_push_block(&car, root, block);
+        for (size_t i = 0; i < map.cap; ++i)
+            if (map.slots[i].block.start != NULL)
+                bsky_car_push_block(&car, map.slots[i].cid,
+                                    map.slots[i].block);
+
+        char path[256];
+        snprintf(path, sizeof path, "%s/%s", dir, name);
+
+        FILE *file = fopen(path, "wb");
+        TEST_ASSERT_NOT_NULL(file);
+        fwrite(car.data, 1, car.len, file);
+        fclose(file);
+
+        bsky_da_free(&car);
+        bsky_da_free(&buf);
+        bsky_block_map_free(&map);
+    }
+
+    struct repo_counter {
+        _Atomic size_t records;
+        size_t stop_after;
+        _Atomic size_t errors;
+    };
+
+    static enum bsky_error_code
+    repo_count(void *ctx, const struct bsky_backfill_record *record)
+    {
+        struct repo_counter *counter = ctx;
+
+        if (!bsky_str_eq(record->collection,
+                         bsky_mk_str("app.bsky.feed.post")) ||
+            bsky_str_len(record->rkey) < 4 ||
+            !bsky_cid_verify(record->cid, record->block) ||
+            bsky_tmp_alloc(64) == NULL)
+            return bsky_ec_Cbor_invalid;
+
+        size_t count = atomic_fetch_add(&counter->records, 1) + 1;
+
+        if (counter->stop_after != 0 && count >= counter->stop_after)
+            return bsky_ec_Tmp_overflow;
+
+        return bsky_ec_Ok;
+    }
+
+    static void repo_error(void *ctx, const char *path,
+                           enum bsky_error_code ec)
+    {
+        struct repo_counter *counter = ctx;
+
+        TEST_ASSERT_NOT_NULL(strstr(path, "broken.car"));
+        TEST_ASSERT_EQUAL(bsky_ec_Car_invalid, ec);
+        atomic_fetch_add(&counter->errors, 1);
+    }
+
+    static void repo_backfill(void)
+    {
+        char dir[] = "/tmp/bsky-backfill-XXXXXX";
+        TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+
+        char *names[] = { "a.car", "b.car", "c.car", "d.car", "e.car" };
+        size_t records = 0;
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(names); ++i) {
+            repo_write(dir, names[i], REPO_TEST_RECORDS - i * 10);
+            records += REPO_TEST_RECORDS - i * 10;
+        }
+
+        // broken repository and file which is not CAR.
+        char path[256];
+        char *junk[] = { "broken.car", "notes.txt" };
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(junk); ++i) {
+            snprintf(path, sizeof path, "%s/%s", dir, junk[i]);
+
+            FILE *file = fopen(path, "wb");
+            fputs("not a CAR file", file);
+            fclose(file);
+        }
+
+        size_t threads[] = { 1, 3, 0 };
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(threads); ++i) {
+            struct repo_counter counter = { 0 };
+            struct bsky_backfill backfill = {
+                .dir = dir, .threads = threads[i], .verify = 1,
+                .fn  = repo_count, .on_error = repo_error, .ctx = &counter,
+            };
+            struct bsky_backfill_stats stats;
+
+            TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_backfill_run(&backfill,
+                                                            &stats));
+            TEST_ASSERT_EQUAL(BSKY_ARRAY_LEN(names), stats.repos);
+            TEST_ASSERT_EQUAL(1, stats.failed);
+            TEST_ASSERT_EQUAL(1, counter.errors);
+            TEST_ASSERT_EQUAL(records, stats.records);
+            TEST_ASSERT_EQUAL(records, counter.records);
+            TEST_ASSERT_TRUE(stats.blocks > records);
+        }
+
+        // callback error stops all workers.
+        struct repo_counter counter = { .stop_after = 30 };
+        struct bsky_backfill backfill = {
+            .dir = dir, .threads = 2, .fn = repo_count, .ctx = &counter,
+        };
+        struct bsky_backfill_stats stats;
+
+        TEST_ASSERT_EQUAL(bsky_ec_Tmp_overflow,
+                          bsky_backfill_run(&backfill, &stats));
+        TEST_ASSERT_TRUE(stats.records < records);
+        TEST_ASSERT_TRUE(counter.records < records);
+
+        backfill.dir = "/nonexistent/bsky-backfill";
+        TEST_ASSERT_EQUAL(bsky_ec_Backfill_io,
+                          bsky_backfill_run(&backfill, NULL));
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(names); ++i) {
+            snprintf(path, sizeof path, "%s/%s", dir, names[i]);
+            unlink(path);
+        }
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(junk); ++i) {
+            snprintf(path, sizeof path, "%s/%s", dir, junk[i]);
+            unlink(path);
+        }
+        rmdir(dir);
+    }
+
+    void run_repo_tests(void)
+    {
+        RUN_TEST(repo_commit);
+        RUN_TEST(repo_backfill);
+    }
+
+#endif
+
+#endif // repo-tests_h_INCLUDED
@@ -1,8 +1,45 @@
 #define IMPLEMENT_TESTS
 #define BSKY_API_IMPLEMENTATION
+#define BSKY_TRACK_ALLOCS
+
+#include <stdlib.h>
+
+// number of heap allocations of the library before they start to fail,
+// -1 for no limit (out of memory tests). With `test_alloc_once' only one
+// allocation fails.
+static _Thread_local long test_alloc_left = -1;
+static _Thread_local int  test_alloc_once;
+
+static int test_alloc_ok(void)
+{
+    if (test_alloc_left < 0) return 1;
+
+    if (test_alloc_left == 0) {
+        if (test_alloc_once) test_alloc_left = -1;
+        return 0;
+    }
+
+    test_alloc_left--;
+    return 1;
+}
+
+#define BSKY_MALLOC(size)       (test_alloc_ok() ? malloc(size) : NULL)
+#define BSKY_REALLOC(ptr, size) (test_alloc_ok() ? realloc(ptr, size) : NULL)
+#define BSKY_FREE(ptr)          free(ptr)
 
 #include "json-tests.h"
 #include "string-tests.h"
+#include "utf8-tests.h"
+#include "ident-tests.h"
+#include "cid-tests.h"
+#include "cbor-tests.h"
+#include "mst-tests.h"
+#include "repo-tests.h"
+#include "sig-tests.h"
+#include "xrpc-tests.h"
+#include "log-tests.h"
+#include "probe-tests.h"
+#include "alloc-tests.h"
 
 #include <unity.h>
 
@@ -19,6 +56,28 @@ int main(int argc, char **argv)
 
     run_string_tests();
 
+    run_utf8_tests();
+
+    run_ident_tests();
+
+    run_cid_tests();
+
+    run_cbor_tests();
+
+    run_mst_tests();
+
+    run_repo_tests();
+
+    run_sig_tests();
+
+    run_xrpc_tests();
+
+    run_log_tests();
+
+    run_probe_tests();
+
+    run_alloc_tests();
+
 
 	return UNITY_END();
 }
@@ -0,0 +1,394 @@
+#ifndef sig_tests_h_INCLUDED
+#define sig_tests_h_INCLUDED
+
+void run_sig_tests(void);
+
+
+#ifdef IMPLEMENT_TESTS
+    #include "../bsky-api.h"
+    #include <unity.h>
+
+    static void sig_of_hex(unsigned char *out, const char *hex)
+    {
+        for (size_t i = 0; hex[2 * i] != '\0'; ++i)
+            sscanf(hex + 2 * i, "%2hhx", &out[i]);
+    }
+
+    static struct bsky_key sig_test_key(enum bsky_key_curve curve, int seed)
+    {
+        enum bsky_error_code ec;
+        unsigned char secret[BSKY_KEY_SECRET_LEN];
+
+        for (size_t i = 0; i < sizeof secret; ++i) secret[i] = seed + i * 7;
+
+        struct bsky_key key = bsky_key_of_secret(curve, secret, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+
+        return key;
+    }
+
+    static void sig_known_vectors(void)
+    {
+        enum bsky_error_code ec;
+        unsigned char secret[BSKY_KEY_SECRET_LEN], digest[BSKY_SHA256_LEN];
+        unsigned char sig[BSKY_SIG_LEN], expected[BSKY_SIG_LEN];
+
+        // RFC 6979 A.2.5, "sample", s is low-S (n - s of the RFC).
+        sig_of_hex(secret, "c9afa9d845ba75166b5c215767b1d693"
+                           "4e50c3db36e89b127b8a622b120f6721");
+        sig_of_hex(expected, "efd48b2aacb6a8fd1140dd9cd45e81d6"
+                             "9d2c877b56aaf991c34d0ea84eaf3716"
+                             "0834e36ad29a83bf2bc9385e491d6099"
+                             "c8fdf9d1ed67aa7ea5f51f93782857a9");
+        bsky_sha256("sample", 6, digest);
+
+        struct bsky_key key = bsky_key_of_secret(bsky_key_P256, secret, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_key_sign(&key, digest, sig));
+        TEST_ASSERT_EQUAL_MEMORY(expected, sig, BSKY_SIG_LEN);
+
+        // secp256k1 signature made by OpenSSL.
+        sig_of_hex(expected, "5021260876752a5c000d0414a65dc3f4"
+                             "8add4d1b329f6d3305b8c95a83d97297"
+                             "42176b53a8fe9c099741647446e4eb73"
+                             "3d4612c47c07f1be4ee95d034e13f733");
+        bsky_sha256("at protocol", 11, digest);
+
+        key = bsky_key_parse_did(bsky_mk_str(
+            "did:key:zQ3shXWjDKaDJg36rwq52zD7a5W5fnrqHbvgKQSifxgyfKDdn"), &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL(bsky_key_Secp256k1, key.curve);
+        TEST_ASSERT_TRUE(bsky_key_verify(&key, digest, (struct bsky_view) {
+            expected, expected + BSKY_SIG_LEN
+        }));
+        TEST_ASSERT_EQUAL(bsky_ec_Key_no_secret,
+                          bsky_key_sign(&key, digest, sig));
+    }
+
+    // affine point (normal form) of jacobian one, it's not infinity.
+    static void jac_affine(const struct __bsky_curve *c,
+                           const struct __bsky_jac *p, uint64_t x[4],
+                           uint64_t y[4])
+    {
+        uint64_t zi[4], zz[4];
+
+        __bsky_mod_inv(&c->p, zi, p->z);
+        __bsky_mod_mul(&c->p, zz, zi, zi);
+        __bsky_mod_mul(&c->p, x, p->x, zz);
+        __bsky_mod_mul(&c->p, zz, zz, zi);
+        __bsky_mod_mul(&c->p, y, p->y, zz);
+    }
+
+    // constant time multiplication agrees with one used for verification.
+    static void sig_mul_secret(void)
+    {
+        for (int curve = 0; curve < 2; ++curve) {
+            const struct __bsky_curve *c = __bsky_curve_of(curve);
+            uint64_t ks[][4] = {
+                { 1 }, { 2 }, { 15 }, { 16 }, { 0xf0f0 },
+                { c->n.m[0] - 1, c->n.m[1], c->n.m[2], c->n.m[3] },
+                { 0x0123456789abcdefULL, 0xfedcba9876543210ULL,
+                  0x00000000ffffffffULL, 0x8000000000000000ULL },
+            };
+
+            for (size_t i = 0; i < BSKY_ARRAY_LEN(ks); ++i) {
+                struct __bsky_proj fixed;
+                struct __bsky_jac  naf;
+                uint64_t x1[4], y1[4], x2[4], y2[4];
+
+                __bsky_ec_mul_secret(c, &fixed, ks[i]);
+                __bsky_ec_mul(c, &naf, ks[i], NULL, NULL);
+
+                __bsky_proj_affine(c, &fixed, x1, y1);
+                TEST_ASSERT_FALSE(__bsky_u256_is_zero(naf.z));
+                jac_affine(c, &naf, x2, y2);
+                TEST_ASSERT_EQUAL_MEMORY(x2, x1, sizeof x1);
+                TEST_ASSERT_EQUAL_MEMORY(y2, y1, sizeof y1);
+            }
+        }
+    }
+
+    static void sig_did_key(void)
+    {
+        enum bsky_error_code ec;
+        char buf[BSKY_DID_KEY_STR_LEN + 1];
+        enum bsky_key_curve curves[] = { bsky_key_Secp256k1, bsky_key_P256 };
+        char *prefixes[] = { "did:key:zQ3s", "did:key:zDna" };
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(curves); ++i) {
+            for (int seed = 0; seed < 8; ++seed) {
+                struct bsky_key key = sig_test_key(curves[i], seed);
+                struct bsky_str str = bsky_key_format_did(buf, &key);
+
+                TEST_ASSERT_TRUE(bsky_str_starts_with(
+                                     str, bsky_mk_str(prefixes[i])));
+                TEST_ASSERT_EQUAL('\0', *str.end);
+
+                // as is and as `publicKeyMultibase'.
+                struct bsky_str multibase = {
+                    str.start + strlen("did:key:"), str.end
+                };
+                struct bsky_str strs[] = { str, multibase };
+
+                for (size_t j = 0; j < BSKY_ARRAY_LEN(strs); ++j) {
+                    struct bsky_key parsed = bsky_key_parse_did(strs[j], &ec);
+
+                    TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+                    TEST_ASSERT_EQUAL(curves[i], parsed.curve);
+                    TEST_ASSERT_EQUAL_MEMORY(key.table, parsed.table,
+                                             sizeof key.table);
+                }
+            }
+        }
+
+        struct { char *str; enum bsky_error_code ec; } invalid[] = {
+            { "did:key:", bsky_ec_Key_invalid },
+            { "did:web:zQ3shXWjDKaDJg36rwq52zD7a5W5fnrqHbvgKQSifxgyfKDdn",
+              bsky_ec_Key_invalid },
+            { "did:key:zQ3shXWjDKaDJg36rwq52zD7a5W5fnrqHbvgKQSifxgyfKDd0",
+              bsky_ec_Key_invalid },
+            // shorter base58 is other number, without known codec.
+            { "did:key:zQ3shXWjDKaDJg36rwq52zD7a5W5fnrqHbvgKQSifxgyfKD",
+              bsky_ec_Key_unsupported },
+            { "did:key:z6MkhaXgBZDvotDkL5257faiztiGiC2QtKLGpbnnEGta2doK",
+              bsky_ec_Key_unsupported },
+            // x = 5 isn't on secp256k1: x^3 + 7 isn't a square.
+            { "did:key:zQ3shMQnkqiyfujhRPGFFqSEeD2yV9kUcmyBiu2fT2BXfFPMN",
+              bsky_ec_Key_invalid },
+        };
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(invalid); ++i) {
+            bsky_key_parse_did(bsky_mk_str(invalid[i].str), &ec);
+            TEST_ASSERT_EQUAL(invalid[i].ec, ec);
+        }
+
+        // secrets out of [1, n).
+        unsigned char secret[BSKY_KEY_SECRET_LEN] = { 0 };
+        bsky_key_of_secret(bsky_key_P256, secret, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Key_invalid, ec);
+        memset(secret, 0xff, sizeof secret);
+        bsky_key_of_secret(bsky_key_Secp256k1, secret, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Key_invalid, ec);
+    }
+
+    static void sig_sign_verify(void)
+    {
+        enum bsky_error_code ec;
+        unsigned char digest[BSKY_SHA256_LEN], sig[BSKY_SIG_LEN];
+        unsigned char again[BSKY_SIG_LEN];
+        enum bsky_key_curve curves[] = { bsky_key_Secp256k1, bsky_key_P256 };
+
+        // group orders, for high-S twins of signatures.
+        char *orders[] = {
+            "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364141",
+            "ffffffff00000000ffffffffffffffffbce6faada7179e84f3b9cac2fc632551",
+        };
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(curves); ++i) {
+            struct bsky_key key   = sig_test_key(curves[i], 1);
+            struct bsky_key other = sig_test_key(curves[i], 2);
+            struct bsky_view view = { sig, sig + BSKY_SIG_LEN };
+            unsigned char order[32];
+
+            sig_of_hex(order, orders[i]);
+
+            for (int msg = 0; msg < 16; ++msg) {
+                bsky_sha256(&msg, sizeof msg, digest);
+
+                TEST_ASSERT_EQUAL(bsky_ec_Ok,
+                                  bsky_key_sign(&key, digest, sig));
+                TEST_ASSERT_EQUAL(bsky_ec_Ok,
+                                  bsky_key_sign(&key, digest, again));
+                TEST_ASSERT_EQUAL_MEMORY(sig, again, BSKY_SIG_LEN);
+
+                TEST_ASSERT_TRUE(bsky_key_verify(&key, digest, view));
+                TEST_ASSERT_FALSE(bsky_key_verify(&other, digest, view));
+
+                // s' = n - s verifies mathematically but is high-S.
+                unsigned char high[BSKY_SIG_LEN];
+                int borrow = 0;
+
+                memcpy(high, sig, 32);
+                for (int j = 31; j >= 0; --j) {
+                    int d = order[j] - sig[32 + j] - borrow;
+
+                    borrow       = d < 0;
+                    high[32 + j] = d + (borrow ? 0x100 : 0);
+                }
+                TEST_ASSERT_FALSE(bsky_key_verify(&key, digest,
+                    (struct bsky_view) { high, high + BSKY_SIG_LEN }));
+
+                digest[msg % BSKY_SHA256_LEN] ^= 1;
+                TEST_ASSERT_FALSE(bsky_key_verify(&key, digest, view));
+            }
+
+            // r = 0, s = 0 and wrong length.
+            memset(sig, 0, 32);
+            TEST_ASSERT_FALSE(bsky_key_verify(&key, digest, view));
+            memset(sig, 1, sizeof sig);
+            memset(sig + 32, 0, 32);
+            TEST_ASSERT_FALSE(bsky_key_verify(&key, digest, view));
+            view.end = sig + BSKY_SIG_LEN - 1;
+            TEST_ASSERT_FALSE(bsky_key_verify(&key, digest, view));
+        }
+
+        struct bsky_key key = bsky_key_parse_did(bsky_mk_str(
+            "zDnaepBuvsQ8cpsWrVKw8fbpGpvPeNSjVPTWoq6cRqaYzBKVP"), &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Key_no_secret,
+                          bsky_key_sign(&key, digest, sig));
+    }
+
+    #define SIG_TEST_BATCH 150
+
+    static void sig_batch(void)
+    {
+        static struct bsky_sig_check checks[SIG_TEST_BATCH];
+        static unsigned char sigs[SIG_TEST_BATCH][BSKY_SIG_LEN];
+        struct bsky_key keys[] = {
+            sig_test_key(bsky_key_Secp256k1, 3),
+            sig_test_key(bsky_key_P256, 4),
+            sig_test_key(bsky_key_Secp256k1, 5),
+        };
+        size_t expected = 0;
+
+        for (size_t i = 0; i < SIG_TEST_BATCH; ++i) {
+            struct bsky_sig_check *check = &checks[i];
+
+            check->key = &keys[i % BSKY_ARRAY_LEN(keys)];
+            check->sig = (struct bsky_view) {
+                sigs[i], sigs[i] + BSKY_SIG_LEN
+            };
+            bsky_sha256(&i, sizeof i, check->digest);
+            TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_key_sign(check->key,
+                                                        check->digest,
+                                                        sigs[i]));
+
+            // every 7th is broken: signed by other key, digest or sig.
+            if (i % 7 == 3) check->key = &keys[(i + 2) % 3];
+            if (i % 7 == 5) check->digest[0] ^= 0x80;
+            if (i % 7 == 6) check->sig.end = sigs[i] + 10;
+
+            expected += i % 7 != 3 && i % 7 != 5 && i % 7 != 6;
+            check->valid = -1;
+        }
+
+        TEST_ASSERT_EQUAL(expected,
+                          bsky_sig_verify_batch(checks, SIG_TEST_BATCH));
+
+        for (size_t i = 0; i < SIG_TEST_BATCH; ++i) {
+            int valid = i % 7 != 3 && i % 7 != 5 && i % 7 != 6;
+
+            TEST_ASSERT_EQUAL(valid, checks[i].valid);
+            TEST_ASSERT_EQUAL(valid, bsky_key_verify(checks[i].key,
+                                                     checks[i].digest,
+                                                     checks[i].sig));
+        }
+
+        TEST_ASSERT_EQUAL(0, bsky_sig_verify_batch(checks, 0));
+    }
+
+    static void sig_commit(void)
+    {
+        enum bsky_error_code ec;
+        unsigned char sig[BSKY_SIG_LEN];
+        struct bsky_bytes buf = { 0 };
+        struct bsky_key key   = sig_test_key(bsky_key_Secp256k1, 6);
+        struct bsky_commit commit = {
+            .did     = bsky_mk_str("did:plc:ewvi7nxzyoun6zhxrhs64oiz"),
+            .rev     = bsky_mk_str("3jzfcijpj2z2a"),
+            .data    = bsky_cid_of_block(bsky_cid_Dag_cbor,
+                                         (struct bsky_view) { 0 }),
+            .version = 3,
+        };
+
+        TEST_ASSERT_EQUAL(bsky_ec_Sig_invalid,
+                          bsky_commit_verify(&commit, &key));
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_commit_sign(&commit, &key, sig));
+        TEST_ASSERT_TRUE(commit.sig.start == sig);
+
+        // signature survives encoding, and covers every field.
+        bsky_cbor_push_commit(&buf, &commit);
+
+        struct bsky_view block = { buf.data, buf.data + buf.len };
+        struct bsky_commit parsed = bsky_parse_commit(block, &ec);
+
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_commit_verify(&parsed, &key));
+
+        parsed.rev = bsky_mk_str("3jzfcijpj2z2b");
+        TEST_ASSERT_EQUAL(bsky_ec_Sig_invalid,
+                          bsky_commit_verify(&parsed, &key));
+
+        bsky_da_free(&buf);
+    }
+
+    static void sig_key_cache(void)
+    {
+        enum bsky_error_code ec;
+        struct bsky_key_cache cache = { 0 };
+        char dids[200][40], did_key[BSKY_DID_KEY_STR_LEN + 1];
+
+        TEST_ASSERT_NULL(bsky_key_cache_get(&cache, bsky_mk_str("did:x")));
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(dids); ++i) {
+            struct bsky_key key = sig_test_key(i % 2, i);
+
+            snprintf(dids[i], sizeof dids[i], "did:plc:%024zu", i);
+            bsky_key_format_did(did_key, &key);
+
+            const struct bsky_key *stored = bsky_key_cache_put(
+                &cache, bsky_mk_str(dids[i]), bsky_mk_str(did_key), &ec);
+
+            TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+            TEST_ASSERT_EQUAL_MEMORY(key.table, stored->table,
+                                     sizeof key.table);
+        }
+        TEST_ASSERT_EQUAL(BSKY_ARRAY_LEN(dids), cache.len);
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(dids); ++i) {
+            const struct bsky_key *key = bsky_key_cache_get(
+                &cache, bsky_mk_str(dids[i]));
+
+            TEST_ASSERT_NOT_NULL(key);
+            TEST_ASSERT_EQUAL(i % 2, key->curve);
+        }
+        TEST_ASSERT_EQUAL(BSKY_ARRAY_LEN(dids), cache.hits);
+        TEST_ASSERT_NULL(bsky_key_cache_get(&cache,
+                                            bsky_mk_str("did:plc:other")));
+
+        // rotation replaces key, invalid key leaves cache as is.
+        struct bsky_key rotated = sig_test_key(bsky_key_P256, 77);
+        const struct bsky_key *before = bsky_key_cache_get(
+            &cache, bsky_mk_str(dids[0]));
+
+        bsky_key_format_did(did_key, &rotated);
+        TEST_ASSERT_TRUE(before == bsky_key_cache_put(
+            &cache, bsky_mk_str(dids[0]), bsky_mk_str(did_key), &ec));
+        TEST_ASSERT_EQUAL(bsky_key_P256, before->curve);
+        TEST_ASSERT_EQUAL(BSKY_ARRAY_LEN(dids), cache.len);
+
+        TEST_ASSERT_NULL(bsky_key_cache_put(&cache, bsky_mk_str(dids[1]),
+                                            bsky_mk_str("z"), &ec));
+        TEST_ASSERT_EQUAL(bsky_ec_Key_invalid, ec);
+        TEST_ASSERT_NOT_NULL(bsky_key_cache_get(&cache,
+                                                bsky_mk_str(dids[1])));
+
+        bsky_key_cache_free(&cache);
+        TEST_ASSERT_NULL(cache.slots);
+    }
+
+    void run_sig_tests(void)
+    {
+        RUN_TEST(sig_known_vectors);
+        RUN_TEST(sig_mul_secret);
+        RUN_TEST(sig_did_key);
+        RUN_TEST(sig_sign_verify);
+        RUN_TEST(sig_batch);
+        RUN_TEST(sig_commit);
+        RUN_TEST(sig_key_cache);
+    }
+
+#endif
+
+#endif // sig-tests_h_INCLUDED
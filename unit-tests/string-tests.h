@@ -98,11 +98,64 @@ void run_string_tests(void);
     }
 
 
+    static void string_search(void)
+    {
+        // long enough to cross vector blocks, not null terminated.
+        char text[80];
+        for (size_t i = 0; i < sizeof text; ++i) text[i] = 'a' + i % 7;
+
+        struct bsky_str str = { text, text + sizeof text };
+
+        for (size_t i = 0; i < sizeof text; ++i) {
+            char copy[sizeof text];
+            memcpy(copy, text, sizeof text);
+            copy[i] = 'Z';
+
+            struct bsky_str other = { copy, copy + sizeof text };
+
+            TEST_ASSERT_FALSE(bsky_str_eq(str, other));
+            TEST_ASSERT_EQUAL(-1 - (int) i, bsky_str_cmp(other, str));
+            TEST_ASSERT_EQUAL(copy + i, bsky_str_find_char(other, 'Z'));
+            TEST_ASSERT_EQUAL(copy + i, bsky_str_find(other,
+                (struct bsky_str) { copy + i, copy + sizeof text }));
+        }
+
+        TEST_ASSERT_NULL(bsky_str_find_char(str, 'Z'));
+        TEST_ASSERT_NULL(bsky_str_find(str, bsky_mk_str("abcdefgh")));
+        TEST_ASSERT_EQUAL(text + 6, bsky_str_find(str, bsky_mk_str("gab")));
+        TEST_ASSERT_EQUAL(text, bsky_str_find(str, bsky_mk_str("")));
+
+        // bytes are compared as unsigned.
+        TEST_ASSERT(bsky_str_cmp(bsky_mk_str("\xc3\xa9"),
+                                 bsky_mk_str("z")) > 0);
+    }
+
+    static void string_split(void)
+    {
+        struct bsky_str rest =
+            bsky_mk_str("at://did:plc:abc/app.bsky.feed.post/");
+        char *parts[] = {
+            "at:", "", "did:plc:abc", "app.bsky.feed.post", "",
+        };
+        size_t i = 0;
+
+        while (rest.start != NULL) {
+            struct bsky_str part = bsky_str_split(&rest, '/');
+
+            TEST_ASSERT(i < BSKY_ARRAY_LEN(parts));
+            TEST_ASSERT(bsky_str_eq(part, bsky_mk_str(parts[i++])));
+        }
+
+        TEST_ASSERT_EQUAL(BSKY_ARRAY_LEN(parts), i);
+    }
+
     void run_string_tests(void)
     {
         RUN_TEST(string_builder);
         RUN_TEST(string_trim);
         RUN_TEST(string_cmp);
+        RUN_TEST(string_search);
+        RUN_TEST(string_split);
     }
 
 #endif
@@ -0,0 +1,94 @@
+#ifndef utf8_tests_h_INCLUDED
+#define utf8_tests_h_INCLUDED
+
+void run_utf8_tests(void);
+
+
+#ifdef IMPLEMENT_TESTS
+    #include "../bsky-api.h"
+    #include <unity.h>
+
+    #define THUMBS_UP_MEDIUM "\xf0\x9f\x91\x8d\xf0\x9f\x8f\xbd"
+
+    static void utf8_valid(void)
+    {
+        char *valid[] = {
+            "", "plain ascii", "h\xc3\xa9llo", "\xe6\x97\xa5\xe6\x9c\xac",
+            "\xf0\x9f\x98\x80", "\xf4\x8f\xbf\xbf",
+            "long ascii run before multibyte \xc3\xa9 and after it too",
+        };
+        char *invalid[] = {
+            "\x80", "\xc0\xaf", "\xe0\x80\xaf", "\xed\xa0\x80",
+            "\xf4\x90\x80\x80", "\xe2\x82", "\xf8\x88\x80\x80\x80",
+            "long ascii run before broken tail \xe2\x82",
+            "long ascii run before \xc3 broken middle byte",
+        };
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(valid); ++i)
+            TEST_ASSERT_TRUE(bsky_utf8_valid(bsky_mk_str(valid[i])));
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(invalid); ++i)
+            TEST_ASSERT_FALSE(bsky_utf8_valid(bsky_mk_str(invalid[i])));
+    }
+
+    static void utf8_graphemes(void)
+    {
+        struct {
+            char  *text;
+            size_t count;
+        } cases[] = {
+            { "",                                       0 },
+            { "abc",                                    3 },
+            { "e\xcc\x81",                              1 },
+            { "\r\n",                                   1 },
+            { "\xe6\x97\xa5\xe6\x9c\xac",               2 },
+            { "\xe2\x9d\xa4\xef\xb8\x8f",               1 },
+            { THUMBS_UP_MEDIUM,                         1 },
+            // family: man, ZWJ, woman, ZWJ, girl.
+            { "\xf0\x9f\x91\xa8\xe2\x80\x8d\xf0\x9f\x91\xa9"
+              "\xe2\x80\x8d\xf0\x9f\x91\xa7",           1 },
+            // two flags: regional indicators are paired.
+            { "\xf0\x9f\x87\xba\xf0\x9f\x87\xa6"
+              "\xf0\x9f\x87\xaf\xf0\x9f\x87\xb5",       2 },
+            { "hi " THUMBS_UP_MEDIUM "!",               5 },
+        };
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(cases); ++i)
+            TEST_ASSERT_EQUAL(cases[i].count,
+                bsky_utf8_graphemes(bsky_mk_str(cases[i].text)));
+    }
+
+    static void utf8_facets(void)
+    {
+        struct bsky_str text =
+            bsky_mk_str("hi " THUMBS_UP_MEDIUM " there");
+        struct bsky_str emoji = bsky_mk_str(THUMBS_UP_MEDIUM);
+
+        size_t start = bsky_utf8_grapheme_offset(text, 3);
+        size_t end   = bsky_utf8_grapheme_offset(text, 4);
+
+        TEST_ASSERT_EQUAL(3, start);
+        TEST_ASSERT_EQUAL(3 + bsky_str_len(emoji), end);
+        TEST_ASSERT_EQUAL(bsky_str_len(text),
+                          bsky_utf8_grapheme_offset(text, 100));
+
+        TEST_ASSERT(bsky_str_eq(emoji, bsky_utf8_slice(text, start, end)));
+        TEST_ASSERT(bsky_str_eq(bsky_mk_str("there"),
+            bsky_utf8_slice(text, end + 1, bsky_str_len(text))));
+
+        // inside of code point, reversed and out of text.
+        TEST_ASSERT_NULL(bsky_utf8_slice(text, start + 1, end).start);
+        TEST_ASSERT_NULL(bsky_utf8_slice(text, end, start).start);
+        TEST_ASSERT_NULL(bsky_utf8_slice(text, 0, 100).start);
+    }
+
+    void run_utf8_tests(void)
+    {
+        RUN_TEST(utf8_valid);
+        RUN_TEST(utf8_graphemes);
+        RUN_TEST(utf8_facets);
+    }
+
+#endif
+
+#endif // utf8-tests_h_INCLUDED
@@ -0,0 +1,1184 @@
+#ifndef xrpc_tests_h_INCLUDED
+#define xrpc_tests_h_INCLUDED
+
+void run_xrpc_tests(void);
+
+
+#ifdef IMPLEMENT_TESTS
+    #include "../bsky-api.h"
+    #include <unity.h>
+    #include <pthread.h>
+
+    /*
+     * Mock XRPC server. Answers `getProfiles' and `getPosts' with one view
+     * per requested identifier (identifiers starting with "missing" are
+     * unknown) and counts calls.
+     */
+    struct mock_xrpc {
+        size_t calls, max_batch;
+        int fail;
+    };
+
+    static enum bsky_error_code
+    mock_xrpc_transport(void *ctx, const struct bsky_xrpc_request *req,
+                        struct bsky_xrpc_response *res)
+    {
+        struct mock_xrpc *mock = ctx;
+        struct bsky_str_builder sb = { 0 };
+        int posts = strcmp(req->nsid, "app.bsky.feed.getPosts") == 0;
+
+        mock->calls++;
+        if (mock->fail) return bsky_ec_Xrpc_transport;
+
+        if (req->params_len > mock->max_batch)
+            mock->max_batch = req->params_len;
+
+        bsky_sb_push_fmt(&sb, "{\"%s\":[", posts ? "posts" : "profiles");
+
+        int first = 1;
+        for (size_t i = 0; i < req->params_len; ++i) {
+            struct bsky_str id = req->params[i].value;
+
+            if (bsky_str_starts_with(id, bsky_mk_str("missing"))) continue;
+
+            if (!first) bsky_sb_push(&sb, ',');
+            first = 0;
+
+            if (posts) {
+                bsky_sb_push_fmt(&sb, "{\"uri\":\"%.*s\",\"likeCount\":%zu}",
+                                 (int) bsky_str_len(id), id.start, i);
+            } else {
+                struct bsky_str did = bsky_mk_str("did:plc:");
+
+                if (bsky_str_starts_with(id, did))
+                    id = bsky_shift_str(id, bsky_str_len(did));
+
+                bsky_sb_push_fmt(&sb, "{\"did\":\"did:plc:%.*s\","
+                                      "\"handle\":\"%.*s\"}",
+                                 (int) bsky_str_len(id), id.start,
+                                 (int) bsky_str_len(id), id.start);
+            }
+        }
+        bsky_sb_push_fmt(&sb, "]}");
+
+        res->status = 200;
+        res->body   = bsky_sb_build_tmp(&sb);
+
+        return bsky_ec_Ok;
+    }
+
+    static void xrpc_path(void)
+    {
+        struct bsky_str_builder sb = { 0 };
+        struct bsky_xrpc_param params[] = {
+            { "actors", bsky_mk_str("did:plc:abc") },
+            { "actors", bsky_mk_str("alice.bsky.social") },
+        };
+        struct bsky_xrpc_request req = {
+            .nsid = "app.bsky.actor.getProfiles",
+            .params = params, .params_len = BSKY_ARRAY_LEN(params),
+        };
+
+        bsky_sb_push_xrpc_path(&sb, &req);
+        TEST_ASSERT_EQUAL_STRING("/xrpc/app.bsky.actor.getProfiles"
+                                 "?actors=did%3Aplc%3Aabc"
+                                 "&actors=alice.bsky.social",
+                                 bsky_sb_build_tmp(&sb).start);
+    }
+
+    static void hydrate_coalesce(void)
+    {
+        enum bsky_error_code ec;
+        struct mock_xrpc mock = { 0 };
+        struct bsky_xrpc_client client = { mock_xrpc_transport, &mock };
+        struct bsky_hydrator h = { .client = &client };
+
+        size_t alice   = bsky_hydrate_request(&h, bsky_hydrate_Profile,
+                                              bsky_mk_str("alice"));
+        size_t bob     = bsky_hydrate_request(&h, bsky_hydrate_Profile,
+                                              bsky_mk_str("bob"));
+        size_t alice2  = bsky_hydrate_request(&h, bsky_hydrate_Profile,
+                                              bsky_mk_str("alice"));
+        size_t missing = bsky_hydrate_request(&h, bsky_hydrate_Profile,
+                                              bsky_mk_str("missing"));
+        size_t post    = bsky_hydrate_request(&h, bsky_hydrate_Post,
+                                              bsky_mk_str("at://x/y/z"));
+
+        TEST_ASSERT_EQUAL(alice, alice2);
+        TEST_ASSERT_EQUAL(0, mock.calls);
+
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_hydrate_flush(&h));
+        TEST_ASSERT_EQUAL(2, mock.calls);
+        TEST_ASSERT_EQUAL(5, h.lookups);
+        TEST_ASSERT_EQUAL(1, h.coalesced);
+
+        struct bsky_json *profile = bsky_hydrate_get(&h, bob, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_NOT_NULL(profile);
+        TEST_ASSERT_EQUAL_STRING("did:plc:bob",
+                                 bsky_json_dct_get(*profile, "did")->str);
+
+        TEST_ASSERT_NOT_NULL(bsky_hydrate_get(&h, alice, &ec));
+        TEST_ASSERT_NULL(bsky_hydrate_get(&h, missing, &ec));
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+
+        struct bsky_json *view = bsky_hydrate_get(&h, post, &ec);
+        TEST_ASSERT_NOT_NULL(view);
+        TEST_ASSERT_EQUAL_STRING("at://x/y/z",
+                                 bsky_json_dct_get(*view, "uri")->str);
+
+        // both did and handle lookups are resolved by the same view.
+        size_t by_did    = bsky_hydrate_request(&h, bsky_hydrate_Profile,
+                                                bsky_mk_str("did:plc:carol"));
+        size_t by_handle = bsky_hydrate_request(&h, bsky_hydrate_Profile,
+                                                bsky_mk_str("carol"));
+        TEST_ASSERT_NOT_NULL(bsky_hydrate_get(&h, by_did, &ec));
+        TEST_ASSERT_NOT_NULL(bsky_hydrate_get(&h, by_handle, &ec));
+        TEST_ASSERT_EQUAL(3, mock.calls);
+
+        bsky_hydrator_free(&h);
+    }
+
+    static void hydrate_out_of_memory(void)
+    {
+        enum bsky_error_code ec;
+        struct mock_xrpc mock = { 0 };
+        struct bsky_xrpc_client client = { mock_xrpc_transport, &mock };
+        struct bsky_hydrator h = { .client = &client };
+        char ids[64][8];
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(ids); ++i)
+            snprintf(ids[i], sizeof ids[i], "id%zu", i);
+
+        // 31 lookups fill half of the first index.
+        for (size_t i = 0; i < 31; ++i)
+            bsky_hydrate_request(&h, bsky_hydrate_Profile,
+                                 bsky_mk_str(ids[i]));
+        TEST_ASSERT_EQUAL(64, h.index_cap);
+
+        // index can't grow, the old one is kept and still coalesces.
+        test_alloc_left = 0;
+        size_t slot = bsky_hydrate_request(&h, bsky_hydrate_Profile,
+                                           bsky_mk_str(ids[31]));
+        TEST_ASSERT_EQUAL(64, h.index_cap);
+        TEST_ASSERT_EQUAL(0, bsky_hydrate_request(&h, bsky_hydrate_Profile,
+                                                  bsky_mk_str(ids[0])));
+
+        // slots can't grow either.
+        size_t failed = bsky_hydrate_request(&h, bsky_hydrate_Profile,
+                                             bsky_mk_str(ids[32]));
+        test_alloc_left = -1;
+
+        TEST_ASSERT_EQUAL(BSKY_HYDRATE_NO_SLOT, failed);
+        TEST_ASSERT_NULL(bsky_hydrate_get(&h, failed, &ec));
+        TEST_ASSERT_EQUAL(bsky_ec_Tmp_overflow, ec);
+
+        TEST_ASSERT_NOT_NULL(bsky_hydrate_get(&h, slot, &ec));
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+
+        // memory is back, index grows on the next lookup.
+        slot = bsky_hydrate_request(&h, bsky_hydrate_Profile,
+                                    bsky_mk_str(ids[32]));
+        TEST_ASSERT_EQUAL(128, h.index_cap);
+        TEST_ASSERT_NOT_NULL(bsky_hydrate_get(&h, slot, &ec));
+
+        bsky_hydrator_free(&h);
+    }
+
+    static void hydrate_batches(void)
+    {
+        enum bsky_error_code ec;
+        struct mock_xrpc mock = { 0 };
+        struct bsky_xrpc_client client = { mock_xrpc_transport, &mock };
+        struct bsky_hydrator h = { .client = &client };
+        size_t slots[60];
+        char name[16];
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(slots); ++i) {
+            snprintf(name, sizeof name, "actor%zu", i);
+            slots[i] = bsky_hydrate_request(&h, bsky_hydrate_Profile,
+                                            bsky_mk_str(name));
+            slots[i] = bsky_hydrate_request(&h, bsky_hydrate_Profile,
+                                            bsky_mk_str(name));
+        }
+
+        // two full batches have been sent immediately.
+        TEST_ASSERT_EQUAL(2, mock.calls);
+
+        TEST_ASSERT_NOT_NULL(bsky_hydrate_get(&h, slots[59], &ec));
+        TEST_ASSERT_EQUAL(3, mock.calls);
+        TEST_ASSERT_EQUAL(BSKY_HYDRATE_BATCH_MAX, mock.max_batch);
+        TEST_ASSERT_EQUAL(60, h.coalesced);
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(slots); ++i) {
+            snprintf(name, sizeof name, "did:plc:actor%zu", i);
+            struct bsky_json *profile = bsky_hydrate_get(&h, slots[i], &ec);
+            TEST_ASSERT_NOT_NULL(profile);
+            TEST_ASSERT_EQUAL_STRING(name,
+                                     bsky_json_dct_get(*profile, "did")->str);
+        }
+        TEST_ASSERT_EQUAL(3, mock.calls);
+
+        bsky_hydrator_free(&h);
+    }
+
+    static void hydrate_transport_error(void)
+    {
+        enum bsky_error_code ec;
+        struct mock_xrpc mock = { .fail = 1 };
+        struct bsky_xrpc_client client = { mock_xrpc_transport, &mock };
+        struct bsky_hydrator h = { .client = &client };
+
+        size_t slot = bsky_hydrate_request(&h, bsky_hydrate_Post,
+                                           bsky_mk_str("at://a/b/c"));
+
+        TEST_ASSERT_EQUAL(bsky_ec_Xrpc_transport, bsky_hydrate_flush(&h));
+        TEST_ASSERT_NULL(bsky_hydrate_get(&h, slot, &ec));
+        TEST_ASSERT_EQUAL(bsky_ec_Xrpc_transport, ec);
+        TEST_ASSERT_EQUAL(1, mock.calls);
+
+        bsky_hydrator_free(&h);
+    }
+
+    static long long fake_now_ms;
+    static long long fake_clock_ms(void) { return fake_now_ms; }
+
+    static enum bsky_error_code
+    cached_get_posts(struct bsky_xrpc_cache *cache,
+                     struct bsky_xrpc_client *client,
+                     struct bsky_xrpc_param *params, size_t len,
+                     struct bsky_xrpc_response *res)
+    {
+        struct bsky_xrpc_request req = {
+            .nsid = "app.bsky.feed.getPosts", .params = params,
+            .params_len = len,
+        };
+
+        return bsky_xrpc_cached_call(cache, client, &req, res);
+    }
+
+    static void xrpc_cache_hits(void)
+    {
+        struct mock_xrpc mock = { 0 };
+        struct bsky_xrpc_client client = { mock_xrpc_transport, &mock };
+        struct bsky_xrpc_cache cache = {
+            .capacity = 0x1000, .ttl_ms = 1000, .now_ms = fake_clock_ms,
+        };
+        struct bsky_xrpc_response res;
+        struct bsky_xrpc_param ab[] = {
+            { "uris", bsky_mk_str("at://a") },
+            { "uris", bsky_mk_str("at://b") },
+        };
+        struct bsky_xrpc_param ba[] = {
+            { "uris", bsky_mk_str("at://b") },
+            { "uris", bsky_mk_str("at://a") },
+        };
+
+        fake_now_ms = 0;
+
+        TEST_ASSERT_EQUAL(bsky_ec_Ok,
+                          cached_get_posts(&cache, &client, ab, 2, &res));
+        struct bsky_str first = res.body;
+
+        // same parameters in different order hit the same entry.
+        TEST_ASSERT_EQUAL(bsky_ec_Ok,
+                          cached_get_posts(&cache, &client, ba, 2, &res));
+        TEST_ASSERT_EQUAL(1, mock.calls);
+        TEST_ASSERT_EQUAL(1, cache.hits);
+        TEST_ASSERT_EQUAL(1, cache.misses);
+        TEST_ASSERT_EQUAL(200, res.status);
+        TEST_ASSERT_EQUAL_STRING(first.start, res.body.start);
+
+        TEST_ASSERT_EQUAL(bsky_ec_Ok,
+                          cached_get_posts(&cache, &client, ab, 1, &res));
+        TEST_ASSERT_EQUAL(2, mock.calls);
+
+        // entries expire after ttl.
+        fake_now_ms = 1000;
+        TEST_ASSERT_EQUAL(bsky_ec_Ok,
+                          cached_get_posts(&cache, &client, ab, 2, &res));
+        TEST_ASSERT_EQUAL(3, mock.calls);
+        TEST_ASSERT_EQUAL(1, cache.expired);
+        TEST_ASSERT_EQUAL(2, cache.count);
+
+        // failed requests are not cached.
+        mock.fail = 1;
+        TEST_ASSERT_EQUAL(bsky_ec_Xrpc_transport,
+                          cached_get_posts(&cache, &client, ba, 1, &res));
+        TEST_ASSERT_EQUAL(2, cache.count);
+
+        // no room for the key in tmp arena.
+        struct bsky_arena  arena = { .cap = 64 };
+        struct bsky_arena *prev  = bsky_tmp_use_arena(&arena);
+        size_t calls = mock.calls;
+
+        while (bsky_tmp_alloc(8) != NULL);
+        TEST_ASSERT_EQUAL(bsky_ec_Tmp_overflow,
+                          cached_get_posts(&cache, &client, ab, 2, &res));
+        TEST_ASSERT_EQUAL(calls, mock.calls);
+
+        bsky_tmp_use_arena(prev);
+        bsky_arena_free(&arena);
+
+        bsky_xrpc_cache_free(&cache);
+        TEST_ASSERT_EQUAL(0, cache.count);
+        TEST_ASSERT_EQUAL(0, cache.used);
+
+        // out of memory at every allocation: response is just not cached.
+        mock.fail = 0;
+        for (long left = 0;; ++left) {
+            enum bsky_error_code ec;
+
+            test_alloc_left = left;
+            ec = cached_get_posts(&cache, &client, ab, 2, &res);
+            test_alloc_left = -1;
+
+            TEST_ASSERT(ec == bsky_ec_Ok || ec == bsky_ec_Tmp_overflow);
+            if (cache.count == 1) break;
+            bsky_xrpc_cache_free(&cache);
+        }
+
+        bsky_xrpc_cache_free(&cache);
+    }
+
+    static void xrpc_cache_lru(void)
+    {
+        struct mock_xrpc mock = { 0 };
+        struct bsky_xrpc_client client = { mock_xrpc_transport, &mock };
+        struct bsky_xrpc_cache cache = {
+            .capacity = 400, .ttl_ms = 1000, .now_ms = fake_clock_ms,
+        };
+        struct bsky_xrpc_response res;
+        struct bsky_xrpc_param params[] = {
+            { "uris", bsky_mk_str("at://0") },
+            { "uris", bsky_mk_str("at://1") },
+            { "uris", bsky_mk_str("at://2") },
+            { "uris", bsky_mk_str("at://3") },
+        };
+
+        fake_now_ms = 0;
+
+        // every entry takes ~90 bytes, so only four fit.
+        for (size_t i = 0; i < 4; ++i)
+            cached_get_posts(&cache, &client, &params[i], 1, &res);
+        TEST_ASSERT_EQUAL(4, cache.count);
+        TEST_ASSERT_EQUAL(0, cache.evictions);
+        TEST_ASSERT_LESS_OR_EQUAL(cache.capacity, cache.used);
+
+        // touch first entry, so second one is least recently used.
+        cached_get_posts(&cache, &client, &params[0], 1, &res);
+        TEST_ASSERT_EQUAL(1, cache.hits);
+
+        struct bsky_xrpc_param extra = { "uris", bsky_mk_str("at://extra") };
+        cached_get_posts(&cache, &client, &extra, 1, &res);
+        TEST_ASSERT_EQUAL(1, cache.evictions);
+        TEST_ASSERT_LESS_OR_EQUAL(cache.capacity, cache.used);
+
+        size_t calls = mock.calls;
+        cached_get_posts(&cache, &client, &params[0], 1, &res);
+        TEST_ASSERT_EQUAL(calls, mock.calls);
+        cached_get_posts(&cache, &client, &params[1], 1, &res);
+        TEST_ASSERT_EQUAL(calls + 1, mock.calls);
+
+        bsky_xrpc_cache_free(&cache);
+    }
+
+    /*
+     * Mock listing endpoint: `pages' pages, each page has its number in
+     * `feed' and cursor of the next page (except the last one).
+     * `escape' sends cursor with json escapes (2 - invalid ones).
+     */
+    struct mock_listing {
+        size_t calls, pages, bad_cursors;
+        int fail_at, escape;
+    };
+
+    static enum bsky_error_code
+    mock_listing_transport(void *ctx, const struct bsky_xrpc_request *req,
+                           struct bsky_xrpc_response *res)
+    {
+        struct mock_listing *mock = ctx;
+        struct bsky_str_builder sb = { 0 };
+        size_t page = 0;
+
+        mock->calls++;
+
+        for (size_t i = 0; i < req->params_len; ++i) {
+            struct bsky_str value = req->params[i].value;
+
+            if (strcmp(req->params[i].name, "cursor") != 0) continue;
+            if (value.start[0] != 'p' || value.start[1] != '/')
+                mock->bad_cursors++;
+            page = strtoul(value.start + 2, NULL, 10);
+        }
+
+        if (mock->fail_at && page == (size_t) mock->fail_at) {
+            res->status = 500;
+            return bsky_ec_Ok;
+        }
+
+        bsky_sb_push_fmt(&sb, "{\"feed\":[{\"post\":{\"cursor\":\"x\","
+                              "\"page\":%zu}}]", page);
+        if (page + 1 < mock->pages) {
+            const char *prefix = mock->escape == 0 ? "p/"
+                               : mock->escape == 1 ? "\\u0070\\/"
+                                                   : "p\\q";
+
+            bsky_sb_push_fmt(&sb, ",\"cursor\":\"%s%zu\"", prefix,
+                             page + 1);
+        }
+        bsky_sb_push_fmt(&sb, "}");
+
+        res->status = 200;
+        res->body   = bsky_sb_build_tmp(&sb);
+
+        return bsky_ec_Ok;
+    }
+
+    static int in_default_tmp_arena(void)
+    {
+        struct bsky_str_builder sb = { 0 };
+        bsky_sb_push_fmt(&sb, "abc");
+        char *tmp = bsky_sb_build_tmp(&sb).start;
+
+        return tmp >= (char *) __bsky_default_tmp_arena.allocator &&
+               tmp <  (char *) __bsky_default_tmp_arena.allocator
+                      + BSKY_DEFAULT_TMP_ARENA_CAPACITY;
+    }
+
+    static void paginator_walk(void)
+    {
+        enum bsky_error_code ec;
+        struct mock_listing mock = { .pages = 500 };
+        struct bsky_xrpc_client client = { mock_listing_transport, &mock };
+        struct bsky_xrpc_param actor = { "actor", bsky_mk_str("alice") };
+        struct bsky_paginator p = {
+            .client = &client, .arena_cap = 0x1000,
+            .req = {
+                .nsid = "app.bsky.feed.getAuthorFeed",
+                .params = &actor, .params_len = 1,
+            },
+        };
+        struct bsky_str page;
+        size_t pages = 0;
+
+        while (bsky_paginator_next(&p, &page, &ec)) {
+            // tmp arena is left as it was.
+            TEST_ASSERT_TRUE(in_default_tmp_arena());
+
+            struct bsky_arena *prev =
+                bsky_tmp_use_arena(bsky_paginator_arena(&p));
+            struct bsky_json json = bsky_parse_json(&page, &ec);
+            bsky_tmp_use_arena(prev);
+            TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+
+            struct bsky_json *feed = bsky_json_dct_get(json, "feed");
+            struct bsky_json *post = bsky_json_dct_get(feed->arr.data[0],
+                                                       "post");
+            TEST_ASSERT_EQUAL(pages,
+                              bsky_json_dct_get(*post, "page")->num);
+
+            // parsed json lives in the page arena.
+            struct bsky_arena *arena = bsky_paginator_arena(&p);
+            char *node = (char *) feed->arr.data;
+            TEST_ASSERT(node >= arena->data &&
+                        node <  arena->data + arena->cap);
+
+            pages++;
+        }
+
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL(500, pages);
+        TEST_ASSERT_EQUAL(500, mock.calls);
+        TEST_ASSERT_EQUAL(500, p.pages);
+        TEST_ASSERT_FALSE(bsky_paginator_next(&p, &page, &ec));
+
+        bsky_paginator_free(&p);
+
+        // stopping early doesn't leave tmp arena redirected.
+        TEST_ASSERT_TRUE(bsky_paginator_next(&p, &page, &ec));
+        TEST_ASSERT_TRUE(bsky_paginator_next(&p, &page, &ec));
+        TEST_ASSERT_TRUE(in_default_tmp_arena());
+
+        bsky_paginator_free(&p);
+        TEST_ASSERT_TRUE(in_default_tmp_arena());
+    }
+
+    static void paginator_error(void)
+    {
+        enum bsky_error_code ec;
+        struct mock_listing mock = { .pages = 10, .fail_at = 3 };
+        struct bsky_xrpc_client client = { mock_listing_transport, &mock };
+        struct bsky_paginator p = {
+            .client = &client,
+            .req = { .nsid = "com.atproto.repo.listRecords" },
+        };
+        struct bsky_str page;
+        size_t pages = 0;
+
+        while (bsky_paginator_next(&p, &page, &ec)) pages++;
+
+        TEST_ASSERT_EQUAL(3, pages);
+        TEST_ASSERT_EQUAL(bsky_ec_Xrpc_status, ec);
+        TEST_ASSERT_FALSE(bsky_paginator_next(&p, &page, &ec));
+        TEST_ASSERT_EQUAL(4, mock.calls);
+
+        bsky_paginator_free(&p);
+    }
+
+    static void paginator_cursor_escape(void)
+    {
+        enum bsky_error_code ec;
+        struct mock_listing mock = { .pages = 10, .escape = 1 };
+        struct bsky_xrpc_client client = { mock_listing_transport, &mock };
+        struct bsky_paginator p = {
+            .client = &client, .arena_cap = 0x1000,
+            .req = { .nsid = "com.atproto.repo.listRecords" },
+        };
+        struct bsky_str page;
+        size_t pages = 0;
+
+        // cursor is sent decoded.
+        while (bsky_paginator_next(&p, &page, &ec)) pages++;
+
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL(10, pages);
+        TEST_ASSERT_EQUAL(10, mock.calls);
+        TEST_ASSERT_EQUAL(0, mock.bad_cursors);
+
+        bsky_paginator_free(&p);
+
+        // invalid escape stops pagination.
+        mock = (struct mock_listing) { .pages = 10, .escape = 2 };
+        pages = 0;
+
+        while (bsky_paginator_next(&p, &page, &ec)) pages++;
+
+        TEST_ASSERT_EQUAL(bsky_ec_Json_invalid_escape, ec);
+        TEST_ASSERT_EQUAL(0, pages);
+        TEST_ASSERT_EQUAL(1, mock.calls);
+        TEST_ASSERT_FALSE(bsky_paginator_next(&p, &page, &ec));
+        TEST_ASSERT_EQUAL(1, mock.calls);
+
+        bsky_paginator_free(&p);
+    }
+
+    /*
+     * Mock server enforcing `limit' requests per fixed `window_s' window
+     * on fake clock.
+     */
+    struct mock_limited {
+        size_t calls, rejected, limit, window_s;
+        size_t window, used;
+        long long sent_at[64];
+    };
+
+    static long long fake_unix_ms;
+    static long long fake_unix_clock(void) { return fake_unix_ms; }
+    static void fake_unix_sleep(long long ms) { fake_unix_ms += ms; }
+
+    static enum bsky_error_code
+    mock_limited_transport(void *ctx, const struct bsky_xrpc_request *req,
+                           struct bsky_xrpc_response *res)
+    {
+        struct mock_limited *mock = ctx;
+        struct bsky_str_builder sb = { 0 };
+        size_t window = fake_unix_ms / (mock->window_s * 1000);
+
+        if (mock->calls < BSKY_ARRAY_LEN(mock->sent_at))
+            mock->sent_at[mock->calls] = fake_unix_ms;
+        mock->calls++;
+
+        if (window != mock->window) {
+            mock->window = window;
+            mock->used   = 0;
+        }
+
+        res->status = ++mock->used > mock->limit ? 429 : 200;
+        if (res->status == 429) mock->rejected++;
+
+        bsky_sb_push_fmt(&sb, "ratelimit-limit: %zu\r\n"
+                              "RateLimit-Remaining: %zu\r\n"
+                              "ratelimit-reset: %zu\r\n"
+                              "ratelimit-policy: %zu;w=%zu\r\n",
+                         mock->limit,
+                         mock->used > mock->limit ? 0
+                                                  : mock->limit - mock->used,
+                         (window + 1) * mock->window_s,
+                         mock->limit, mock->window_s);
+        res->headers = bsky_sb_build_tmp(&sb);
+        res->body    = bsky_mk_str("{}");
+
+        return bsky_ec_Ok;
+    }
+
+    static size_t limited_calls(struct bsky_xrpc_client *client, size_t n)
+    {
+        struct bsky_xrpc_response res;
+        size_t failed = 0;
+
+        for (size_t i = 0; i < n; ++i) {
+            struct bsky_xrpc_request req = { .nsid = "app.bsky.feed.getLikes" };
+            failed += bsky_xrpc_call(client, &req, &res) != bsky_ec_Ok;
+            fake_unix_ms += 10; // time to process response.
+        }
+
+        return failed;
+    }
+
+    static void rate_limit_headers(void)
+    {
+        struct bsky_xrpc_response res = {
+            .headers = bsky_mk_str("Content-Type: application/json\r\n"
+                                   "RateLimit-Reset:  1700000000 \r\n"
+                                   "x: y"),
+        };
+        struct bsky_str value = bsky_xrpc_header(res, "ratelimit-reset");
+
+        TEST_ASSERT_EQUAL_STRING_LEN("1700000000", value.start,
+                                     bsky_str_len(value));
+        TEST_ASSERT_EQUAL(10, bsky_str_len(value));
+        TEST_ASSERT_EQUAL(1, bsky_str_len(bsky_xrpc_header(res, "X")));
+        TEST_ASSERT_NULL(bsky_xrpc_header(res, "ratelimit").start);
+    }
+
+    static void rate_limit_burst(void)
+    {
+        struct mock_limited mock = { .limit = 5, .window_s = 10 };
+        struct bsky_rate_limiter limiter = {
+            .now_ms = fake_unix_clock, .sleep_ms = fake_unix_sleep,
+        };
+        struct bsky_xrpc_client client = {
+            mock_limited_transport, &mock, .limiter = &limiter,
+        };
+
+        // without limiter server rejects requests.
+        fake_unix_ms = 1000;
+        client.limiter = NULL;
+        TEST_ASSERT_EQUAL(15, limited_calls(&client, 20));
+
+        mock = (struct mock_limited) { .limit = 5, .window_s = 10 };
+        client.limiter = &limiter;
+        fake_unix_ms = 1000;
+
+        TEST_ASSERT_EQUAL(0, limited_calls(&client, 23));
+        TEST_ASSERT_EQUAL(0, mock.rejected);
+        TEST_ASSERT_EQUAL(23, mock.calls);
+        TEST_ASSERT_EQUAL(4, limiter.waits);
+
+        // 23 requests need five windows, no time is wasted beyond that.
+        TEST_ASSERT_EQUAL(4, fake_unix_ms / 10000);
+
+        bsky_rate_limiter_free(&limiter);
+    }
+
+    static void rate_limit_pace(void)
+    {
+        struct mock_limited mock = { .limit = 5, .window_s = 10 };
+        struct bsky_rate_limiter limiter = {
+            .pace = 1, .now_ms = fake_unix_clock, .sleep_ms = fake_unix_sleep,
+        };
+        struct bsky_xrpc_client client = {
+            mock_limited_transport, &mock, .limiter = &limiter,
+        };
+
+        fake_unix_ms = 0;
+        TEST_ASSERT_EQUAL(0, limited_calls(&client, 16));
+        TEST_ASSERT_EQUAL(0, mock.rejected);
+
+        // requests are spread evenly over the window.
+        for (size_t i = 2; i < 5; ++i) {
+            long long gap = mock.sent_at[i] - mock.sent_at[i-1];
+            TEST_ASSERT(gap >= 2000 && gap <= 3000);
+        }
+        TEST_ASSERT_EQUAL(10000, mock.sent_at[5]);
+
+        bsky_rate_limiter_free(&limiter);
+    }
+
+    static void rate_limit_retry(void)
+    {
+        struct mock_limited mock = { .limit = 1, .window_s = 1, .window = 7 };
+        struct bsky_rate_limiter limiter = {
+            .max_retries = 1,
+            .now_ms = fake_unix_clock, .sleep_ms = fake_unix_sleep,
+        };
+        struct bsky_xrpc_client client = {
+            mock_limited_transport, &mock, .limiter = &limiter,
+        };
+
+        // server state is unknown to the limiter before first response.
+        fake_unix_ms = 7500;
+        mock.used    = 1;
+
+        TEST_ASSERT_EQUAL(0, limited_calls(&client, 1));
+        TEST_ASSERT_EQUAL(1, limiter.throttled);
+        TEST_ASSERT_EQUAL(2, mock.calls);
+        TEST_ASSERT_EQUAL(8000, mock.sent_at[1]);
+
+        bsky_rate_limiter_free(&limiter);
+    }
+
+    static void rate_update_remaining(struct bsky_rate_limiter *limiter,
+                                      size_t remaining)
+    {
+        struct bsky_str_builder sb = { 0 };
+
+        bsky_sb_push_fmt(&sb, "ratelimit-limit: 5\r\n"
+                              "ratelimit-remaining: %zu\r\n"
+                              "ratelimit-reset: 10\r\n"
+                              "ratelimit-policy: 5;w=10\r\n", remaining);
+        bsky_rate_update(limiter, "h", (struct bsky_xrpc_response) {
+            .status = 200, .headers = bsky_sb_build_tmp(&sb),
+        });
+    }
+
+    static void rate_limit_in_flight(void)
+    {
+        struct bsky_rate_limiter limiter = {
+            .now_ms = fake_unix_clock, .sleep_ms = fake_unix_sleep,
+        };
+
+        fake_unix_ms = 1000;
+
+        bsky_rate_acquire(&limiter, "h");
+        rate_update_remaining(&limiter, 4);
+
+        // three requests are sent, the server has seen only the first.
+        for (size_t i = 0; i < 3; ++i) bsky_rate_acquire(&limiter, "h");
+        rate_update_remaining(&limiter, 3);
+
+        // two are in flight, so one token is left.
+        bsky_rate_acquire(&limiter, "h");
+        TEST_ASSERT_EQUAL(0, limiter.waits);
+        bsky_rate_acquire(&limiter, "h");
+        TEST_ASSERT_EQUAL(1, limiter.waits);
+        TEST_ASSERT_EQUAL(10000, fake_unix_ms);
+
+        // responses without headers release reservations too.
+        for (size_t i = 0; i < 4; ++i)
+            bsky_rate_update(&limiter, "h", (struct bsky_xrpc_response) {0});
+        TEST_ASSERT_EQUAL(0, limiter.buckets.data[0].in_flight);
+
+        bsky_rate_limiter_free(&limiter);
+    }
+
+    // Server which throttles without `ratelimit-*' headers.
+    struct mock_throttled {
+        size_t calls;
+        char *retry_after; // `Retry-After' header, NULL without it.
+        long long sent_at[8];
+    };
+
+    static enum bsky_error_code
+    mock_throttled_transport(void *ctx, const struct bsky_xrpc_request *req,
+                             struct bsky_xrpc_response *res)
+    {
+        struct mock_throttled *mock = ctx;
+
+        if (mock->calls < BSKY_ARRAY_LEN(mock->sent_at))
+            mock->sent_at[mock->calls] = fake_unix_ms;
+        mock->calls++;
+
+        res->status  = 429;
+        res->headers = mock->retry_after ? bsky_mk_str(mock->retry_after)
+                                         : bsky_mk_str("");
+        res->body    = bsky_mk_str("{}");
+
+        return bsky_ec_Ok;
+    }
+
+    static void rate_limit_backoff(void)
+    {
+        struct mock_throttled mock = { 0 };
+        struct bsky_rate_limiter limiter = {
+            .max_retries = 3,
+            .now_ms = fake_unix_clock, .sleep_ms = fake_unix_sleep,
+        };
+        struct bsky_xrpc_client client = {
+            mock_throttled_transport, &mock, .limiter = &limiter,
+        };
+        struct bsky_xrpc_request req = { .nsid = "app.bsky.feed.getLikes" };
+        struct bsky_xrpc_response res;
+
+        // without reset time waits double.
+        fake_unix_ms = 0;
+        TEST_ASSERT_EQUAL(bsky_ec_Xrpc_status,
+                          bsky_xrpc_call(&client, &req, &res));
+        TEST_ASSERT_EQUAL(4, mock.calls);
+        TEST_ASSERT_EQUAL(1000, mock.sent_at[1]);
+        TEST_ASSERT_EQUAL(3000, mock.sent_at[2]);
+        TEST_ASSERT_EQUAL(7000, mock.sent_at[3]);
+        TEST_ASSERT_EQUAL(4, limiter.throttled);
+
+        // `Retry-After' takes precedence.
+        mock = (struct mock_throttled) { .retry_after = "Retry-After: 5" };
+        fake_unix_ms = 100000;
+        limiter.max_retries = 1;
+
+        TEST_ASSERT_EQUAL(bsky_ec_Xrpc_status,
+                          bsky_xrpc_call(&client, &req, &res));
+        TEST_ASSERT_EQUAL(2, mock.calls);
+        TEST_ASSERT_EQUAL(105000, mock.sent_at[1]);
+
+        // success resets backoff.
+        bsky_rate_update(&limiter, NULL, (struct bsky_xrpc_response) {
+            .status = 200,
+        });
+        TEST_ASSERT_EQUAL(0, limiter.buckets.data[0].backoff_ms);
+
+        // bucket which can't be allocated leaves host unlimited.
+        test_alloc_left = 0;
+        bsky_rate_acquire(&limiter, "other");
+        bsky_rate_update(&limiter, "other", (struct bsky_xrpc_response) {0});
+        test_alloc_left = -1;
+        TEST_ASSERT_EQUAL(1, limiter.buckets.len);
+
+        // buckets grow with lock released.
+        char host[8];
+        for (int i = 0; i < 20; ++i) {
+            snprintf(host, sizeof host, "h%d", i);
+            bsky_rate_acquire(&limiter, host);
+        }
+        TEST_ASSERT_EQUAL(21, limiter.buckets.len);
+        TEST_ASSERT_EQUAL_STRING("h19", limiter.buckets.data[20].host);
+        TEST_ASSERT_EQUAL(0, limiter.lock);
+
+        bsky_rate_limiter_free(&limiter);
+    }
+
+    /*
+     * Mock auth endpoint. Access tokens are valid for an hour of fake
+     * clock, token payload contains its generation.
+     */
+    struct mock_auth {
+        _Atomic size_t logins, refreshes;
+        int reject_refresh;
+        enum bsky_error_code refresh_ec; // transport error of refresh.
+        char *password;                  // expected in login body.
+
+        // unity is not thread safe, so transport only counts failed
+        // checks and test asserts on them after joining.
+        _Atomic size_t bad;
+    };
+
+    static _Atomic long long fake_session_ms;
+    static long long fake_session_clock(void) { return fake_session_ms; }
+
+    static void push_base64url(struct bsky_str_builder *sb, char *str)
+    {
+        static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                     "abcdefghijklmnopqrstuvwxyz0123456789-_";
+        unsigned int acc = 0; int bits = 0;
+
+        for (; *str; ++str) {
+            acc   = acc << 8 | (unsigned char) *str;
+            bits += 8;
+
+            while (bits >= 6) {
+                bits -= 6;
+                bsky_sb_push(sb, digits[acc >> bits & 0x3f]);
+            }
+        }
+        if (bits) bsky_sb_push(sb, digits[acc << (6 - bits) & 0x3f]);
+    }
+
+    static enum bsky_error_code
+    mock_auth_transport(void *ctx, const struct bsky_xrpc_request *req,
+                        struct bsky_xrpc_response *res)
+    {
+        struct mock_auth *mock = ctx;
+        struct bsky_str_builder sb = { 0 };
+        char payload[64];
+        size_t gen;
+
+        if (strcmp(req->nsid, "com.atproto.server.refreshSession") == 0) {
+            if (mock->reject_refresh) {
+                res->status = 401;
+                return bsky_ec_Ok;
+            }
+
+            if (mock->refresh_ec != bsky_ec_Ok) {
+                struct timespec ts = { 0, 1000000 };
+                nanosleep(&ts, NULL); // let others wait for refresh.
+                return mock->refresh_ec;
+            }
+
+            if (req->auth == NULL || strncmp(req->auth, "refresh", 7) != 0)
+                atomic_fetch_add(&mock->bad, 1);
+            gen = atomic_fetch_add(&mock->refreshes, 1) + 1;
+
+            struct timespec ts = { 0, 1000000 };
+            nanosleep(&ts, NULL); // widen the race window.
+        } else {
+            if (mock->password != NULL) {
+                enum bsky_error_code ec;
+                struct bsky_str body = req->body;
+                struct bsky_json json = bsky_parse_json(&body, &ec);
+
+                struct bsky_json *password = ec == bsky_ec_Ok
+                    ? bsky_json_dct_get(json, "password") : NULL;
+
+                if (json.dct.len != 2 || password == NULL ||
+                    strcmp(mock->password, password->str) != 0)
+                    atomic_fetch_add(&mock->bad, 1);
+            }
+
+            gen = atomic_fetch_add(&mock->logins, 1) * 1000;
+        }
+
+        snprintf(payload, sizeof payload, "{\"exp\":%lld,\"gen\":%zu}",
+                 fake_session_ms / 1000 + 3600, gen);
+
+        bsky_sb_push_fmt(&sb, "{\"accessJwt\":\"eyJhbGciOiJIUzI1NiJ9.");
+        push_base64url(&sb, payload);
+        bsky_sb_push_fmt(&sb, ".sig\",\"refreshJwt\":\"refresh%zu\","
+                              "\"handle\":\"alice.test\","
+                              "\"did\":\"did:plc:alice\"}", gen);
+
+        res->status = 200;
+        res->body   = bsky_sb_build_tmp(&sb);
+
+        return bsky_ec_Ok;
+    }
+
+    struct session_reader {
+        struct bsky_session *session;
+        pthread_barrier_t   *barrier;
+        char *token;
+        enum bsky_error_code ec;
+    };
+
+    static void *session_reader_run(void *arg)
+    {
+        struct session_reader *reader = arg;
+        enum bsky_error_code ec;
+
+        pthread_barrier_wait(reader->barrier);
+
+        for (size_t i = 0; i < 2000; ++i) {
+            reader->token = bsky_session_token(reader->session, &ec);
+            reader->ec    = ec;
+            if (ec != bsky_ec_Ok) reader->token = NULL;
+        }
+
+        return NULL;
+    }
+
+    static void session_refresh_once(void)
+    {
+        struct mock_auth mock = { 0 };
+        struct bsky_xrpc_client client = { mock_auth_transport, &mock };
+        struct bsky_session session = {
+            .client = &client, .now_ms = fake_session_clock,
+            .identifier = "alice.test", .password = "pass",
+        };
+        struct session_reader readers[8];
+        pthread_t threads[BSKY_ARRAY_LEN(readers)];
+        pthread_barrier_t barrier;
+
+        fake_session_ms = 1700000000000LL;
+
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_session_login(&session));
+        TEST_ASSERT_EQUAL_STRING("did:plc:alice",
+                                 atomic_load(&session.tokens)->did);
+        TEST_ASSERT_EQUAL(fake_session_ms + 3600 * 1000,
+                          atomic_load(&session.tokens)->expires_ms);
+
+        for (size_t round = 1; round <= 5; ++round) {
+            // access token expires.
+            fake_session_ms += 3600 * 1000;
+
+            pthread_barrier_init(&barrier, NULL, BSKY_ARRAY_LEN(readers));
+
+            for (size_t i = 0; i < BSKY_ARRAY_LEN(readers); ++i) {
+                readers[i] = (struct session_reader) { &session, &barrier };
+                pthread_create(&threads[i], NULL, session_reader_run,
+                               &readers[i]);
+            }
+            for (size_t i = 0; i < BSKY_ARRAY_LEN(readers); ++i)
+                pthread_join(threads[i], NULL);
+
+            pthread_barrier_destroy(&barrier);
+
+            TEST_ASSERT_EQUAL(round, mock.refreshes);
+            TEST_ASSERT_EQUAL(round, session.refreshes);
+            TEST_ASSERT_EQUAL(round, atomic_load(&session.tokens)->generation);
+
+            for (size_t i = 0; i < BSKY_ARRAY_LEN(readers); ++i)
+                TEST_ASSERT_EQUAL_STRING(atomic_load(&session.tokens)
+                                             ->access_jwt,
+                                         readers[i].token);
+        }
+
+        TEST_ASSERT_EQUAL(1, mock.logins);
+        TEST_ASSERT_EQUAL(0, mock.bad);
+
+        // only the latest replaced snapshots are kept.
+        size_t retired = 0;
+        for (struct bsky_session_tokens *t = atomic_load(&session.tokens)
+                                                 ->retired;
+             t != NULL; t = t->retired)
+            retired++;
+        TEST_ASSERT_EQUAL(BSKY_SESSION_RETIRED_MAX, retired);
+
+        bsky_session_free(&session);
+    }
+
+    static void session_relogin(void)
+    {
+        enum bsky_error_code ec;
+        struct mock_auth mock = { .reject_refresh = 1 };
+        struct bsky_xrpc_client client = { mock_auth_transport, &mock };
+        struct bsky_session session = {
+            .client = &client, .now_ms = fake_session_clock,
+            .identifier = "alice.test", .password = "pass",
+        };
+
+        fake_session_ms = 1700000000000LL;
+
+        char *first = bsky_session_token(&session, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_NOT_NULL(first);
+        TEST_ASSERT_EQUAL(first, bsky_session_token(&session, &ec));
+
+        // refresh token is rejected, so session is created again.
+        fake_session_ms += 3600 * 1000;
+        char *second = bsky_session_token(&session, &ec);
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT(strcmp(first, second) != 0);
+        TEST_ASSERT_EQUAL(2, mock.logins);
+        TEST_ASSERT_EQUAL(0, mock.refreshes);
+
+        bsky_session_free(&session);
+    }
+
+    static void session_login_escape(void)
+    {
+        char password[] = "p\"a\\ss\",\"identifier\":\"mallory";
+        struct mock_auth mock = { .password = password };
+        struct bsky_xrpc_client client = { mock_auth_transport, &mock };
+        struct bsky_session session = {
+            .client = &client, .now_ms = fake_session_clock,
+            .identifier = "alice.test", .password = password,
+        };
+
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_session_login(&session));
+        TEST_ASSERT_EQUAL(1, mock.logins);
+        TEST_ASSERT_EQUAL(0, mock.bad);
+
+        bsky_session_free(&session);
+    }
+
+    static void session_refresh_error(void)
+    {
+        struct mock_auth mock = { .refresh_ec = bsky_ec_Xrpc_transport };
+        struct bsky_xrpc_client client = { mock_auth_transport, &mock };
+        struct bsky_session session = {
+            .client = &client, .now_ms = fake_session_clock,
+            .identifier = "alice.test", .password = "pass",
+        };
+        struct session_reader readers[4];
+        pthread_t threads[BSKY_ARRAY_LEN(readers)];
+        pthread_barrier_t barrier;
+
+        fake_session_ms = 1700000000000LL;
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, bsky_session_login(&session));
+
+        // no password to log in again, every caller gets refresh error.
+        session.password = NULL;
+        fake_session_ms += 3600 * 1000;
+        pthread_barrier_init(&barrier, NULL, BSKY_ARRAY_LEN(readers));
+
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(readers); ++i) {
+            readers[i] = (struct session_reader) { &session, &barrier };
+            pthread_create(&threads[i], NULL, session_reader_run,
+                           &readers[i]);
+        }
+        for (size_t i = 0; i < BSKY_ARRAY_LEN(readers); ++i) {
+            pthread_join(threads[i], NULL);
+            TEST_ASSERT_EQUAL(bsky_ec_Xrpc_transport, readers[i].ec);
+        }
+
+        pthread_barrier_destroy(&barrier);
+
+        // failed refresh is not repeated until backoff deadline.
+        enum bsky_error_code ec;
+        long long backoff = BSKY_SESSION_RETRY_MIN_MS;
+
+        TEST_ASSERT_EQUAL(1, session.refreshes);
+
+        for (size_t round = 2; round <= 4; ++round) {
+            fake_session_ms += backoff - 1;
+            TEST_ASSERT_NULL(bsky_session_token(&session, &ec));
+            TEST_ASSERT_EQUAL(bsky_ec_Xrpc_transport, ec);
+            TEST_ASSERT_EQUAL(round - 1, session.refreshes);
+
+            fake_session_ms += 1;
+            TEST_ASSERT_NULL(bsky_session_token(&session, &ec));
+            TEST_ASSERT_EQUAL(round, session.refreshes);
+
+            backoff *= 2;
+        }
+
+        // refresh succeeds after the next deadline.
+        mock.refresh_ec = bsky_ec_Ok;
+        fake_session_ms += backoff;
+        TEST_ASSERT_NOT_NULL(bsky_session_token(&session, &ec));
+        TEST_ASSERT_EQUAL(bsky_ec_Ok, ec);
+        TEST_ASSERT_EQUAL(5, session.refreshes);
+        TEST_ASSERT_EQUAL(0, atomic_load(&session.retry_ms));
+        TEST_ASSERT_EQUAL(0, mock.bad);
+
+        bsky_session_free(&session);
+    }
+
+    static void session_no_exp(void)
+    {
+        enum bsky_error_code ec;
+        struct bsky_session_tokens *tokens = __bsky_session_tokens_of(
+            bsky_mk_str("{\"accessJwt\":\"eyJhbGciOiJIUzI1NiJ9.e30.sig\","
+                        "\"refreshJwt\":\"r\",\"did\":\"d\","
+                        "\"handle\":\"h\"}"));
+        struct bsky_session session = { .now_ms = fake_session_clock };
+
+        // `{}' payload, token doesn't expire and is never refreshed.
+        TEST_ASSERT_NOT_NULL(tokens);
+        TEST_ASSERT_EQUAL(LLONG_MAX, tokens->expires_ms);
+
+        __bsky_session_publish(&session, tokens);
+        TEST_ASSERT_EQUAL_STRING(tokens->access_jwt,
+                                 bsky_session_token(&session, &ec));
+        TEST_ASSERT_EQUAL(0, session.refreshes);
+
+        bsky_session_free(&session);
+    }
+
+    void run_xrpc_tests(void)
+    {
+        RUN_TEST(xrpc_path);
+        RUN_TEST(hydrate_coalesce);
+        RUN_TEST(hydrate_out_of_memory);
+        RUN_TEST(hydrate_batches);
+        RUN_TEST(hydrate_transport_error);
+        RUN_TEST(xrpc_cache_hits);
+        RUN_TEST(xrpc_cache_lru);
+        RUN_TEST(paginator_walk);
+        RUN_TEST(paginator_error);
+        RUN_TEST(paginator_cursor_escape);
+        RUN_TEST(rate_limit_headers);
+        RUN_TEST(rate_limit_burst);
+        RUN_TEST(rate_limit_pace);
+        RUN_TEST(rate_limit_retry);
+        RUN_TEST(rate_limit_in_flight);
+        RUN_TEST(rate_limit_backoff);
+        RUN_TEST(session_refresh_once);
+        RUN_TEST(session_relogin);
+        RUN_TEST(session_login_escape);
+        RUN_TEST(session_refresh_error);
+        RUN_TEST(session_no_exp);
+    }
+
+#endif
+
+#endif // xrpc-tests_h_INCLUDED